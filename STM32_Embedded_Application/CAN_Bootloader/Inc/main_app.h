@@ -0,0 +1,10 @@
+#ifndef MAIN_APP_H_
+#define MAIN_APP_H_
+
+#include "stm32f4xx_hal.h"
+
+/* Bootloader fault indication (NUCLEO-F446RE user LED) */
+#define BOOT_LED_PORT   GPIOA
+#define BOOT_LED_PIN    GPIO_PIN_5
+
+#endif /* MAIN_APP_H_ */
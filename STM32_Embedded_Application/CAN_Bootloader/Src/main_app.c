@@ -0,0 +1,162 @@
+/*
+ * CAN bootloader: picks the application slot to run and jumps to it.
+ *
+ * Linked with STM32F446RETX_BOOT.ld into flash sector 0.  Shares
+ * boot_ctrl.c, flash_if.c and crc32.c (and their headers) with
+ * CAN_Normal_Mode, where the update agent writes the images.  The bootloader
+ * itself never talks CAN: the application receives the update while it
+ * keeps running, and the switch happens here on the next reset.
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "main_app.h"
+#include "boot_ctrl.h"
+#include "flash_if.h"
+
+/* Private function prototypes ----------------------------------------------*/
+static const Boot_RecordTypeDef *Boot_Select(void);
+static uint32_t Boot_VectorsOk(uint32_t base);
+static void Boot_Jump(uint32_t base);
+static void Boot_Fail(void);
+
+/* -------------------------------------------------------------------------- */
+/*                                  main                                      */
+/* -------------------------------------------------------------------------- */
+
+int main(void)
+{
+    const Boot_RecordTypeDef *rec;
+
+    /* HSI 16 MHz is plenty for one CRC pass and a flash word */
+    HAL_Init();
+
+    rec = Boot_Select();
+    if (rec != NULL)
+    {
+        Boot_Jump(Boot_Ctrl_SlotAddr(rec->slot));
+    }
+
+    /* No records yet: image loaded into slot A by the debugger */
+    if (Boot_VectorsOk(Boot_Ctrl_SlotAddr(BOOT_SLOT_A)) != 0U)
+    {
+        Boot_Jump(Boot_Ctrl_SlotAddr(BOOT_SLOT_A));
+    }
+
+    Boot_Fail();
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                              Local helpers                                 */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Decide which record to boot.
+  *         - new image (never tried): verify, mark tried, run it
+  *         - confirmed image: verify, run it
+  *         - tried but never confirmed: the trial failed, roll back to the
+  *           last confirmed image
+  */
+static const Boot_RecordTypeDef *Boot_Select(void)
+{
+    const Boot_RecordTypeDef *rec = Boot_Ctrl_Latest();
+
+    if (rec != NULL)
+    {
+        if (rec->tried == FLASH_IF_ERASED_WORD)
+        {
+            if ((Boot_Ctrl_ImageValid(rec) != 0U) &&
+                (Boot_VectorsOk(Boot_Ctrl_SlotAddr(rec->slot)) != 0U) &&
+                (Boot_Ctrl_MarkTried(rec) == HAL_OK))
+            {
+                return rec;
+            }
+        }
+        else if ((rec->confirmed == 0U) && (Boot_Ctrl_ImageValid(rec) != 0U))
+        {
+            return rec;
+        }
+    }
+
+    rec = Boot_Ctrl_LastConfirmed();
+    if ((rec != NULL) && (Boot_Ctrl_ImageValid(rec) != 0U))
+    {
+        return rec;
+    }
+
+    return NULL;
+}
+
+/**
+  * @brief  Initial SP inside SRAM and reset vector inside the slot.
+  */
+static uint32_t Boot_VectorsOk(uint32_t base)
+{
+    uint32_t sp = ((const uint32_t *)base)[0];
+    uint32_t pc = ((const uint32_t *)base)[1];
+
+    return ((sp > SRAM1_BASE) && (sp <= (SRAM1_BASE + 0x20000U)) &&
+            (pc > base) && (pc < (base + Boot_Ctrl_SlotSize()))) ? 1U : 0U;
+}
+
+/**
+  * @brief  Hand over to the application with the core as close to its reset
+  *         state as possible.  The application keeps VTOR as set here
+  *         (USER_VECT_TAB_ADDRESS is not defined in its SystemInit).
+  */
+static void Boot_Jump(uint32_t base)
+{
+    uint32_t sp = ((const uint32_t *)base)[0];
+    void (*entry)(void) = (void (*)(void))((const uint32_t *)base)[1];
+    uint32_t i;
+
+    __disable_irq();
+
+    SysTick->CTRL = 0U;
+    HAL_RCC_DeInit();
+    HAL_DeInit();
+
+    for (i = 0U; i < 8U; i++)
+    {
+        NVIC->ICER[i] = 0xFFFFFFFFUL;
+        NVIC->ICPR[i] = 0xFFFFFFFFUL;
+    }
+
+    SCB->VTOR = base;
+    __DSB();
+    __ISB();
+
+    __set_MSP(sp);
+    __enable_irq();
+
+    entry();
+}
+
+static void Boot_Fail(void)
+{
+    GPIO_InitTypeDef gpio;
+
+    __HAL_RCC_GPIOA_CLK_ENABLE();
+
+    gpio.Pin   = BOOT_LED_PIN;
+    gpio.Mode  = GPIO_MODE_OUTPUT_PP;
+    gpio.Pull  = GPIO_NOPULL;
+    gpio.Speed = GPIO_SPEED_FREQ_LOW;
+    HAL_GPIO_Init(BOOT_LED_PORT, &gpio);
+
+    while (1)
+    {
+        HAL_GPIO_TogglePin(BOOT_LED_PORT, BOOT_LED_PIN);
+        HAL_Delay(100);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/*                              HAL callbacks                                 */
+/* -------------------------------------------------------------------------- */
+
+void SysTick_Handler(void)
+{
+    HAL_IncTick();
+}
@@ -0,0 +1,64 @@
+#ifndef BOOT_CTRL_H_
+#define BOOT_CTRL_H_
+
+#include "main_app.h"
+
+/*
+ * Boot control records, shared by the CAN bootloader and the update agent.
+ *
+ *   Two application slots (STM32F446RETX_SLOT_A.ld / _SLOT_B.ld), each
+ *   linked for its own address; the F446 has no bank swap, so "swapping"
+ *   means the bootloader jumps to the other slot.
+ *
+ *   Sector 3 holds an append-only list of records.  The newest record with
+ *   a valid check word names the image to run:
+ *     tried and confirmed erased  new image, not started yet
+ *     tried programmed            bootloader has started it once
+ *     confirmed programmed        the image came up and confirmed itself
+ *   A record that was tried but never confirmed is rolled back to the last
+ *   confirmed one.
+ *
+ *   When sector 3 is full it is erased and the last confirmed record
+ *   rewritten.  So that a power loss in between cannot lose it, that record
+ *   is first staged in the trailer of its own slot: the last
+ *   BOOT_TRAILER_RECORDS records of the slot, which images never use and
+ *   the update agent erases with the slot.  Only when sector 3 holds no
+ *   confirmed record are the trailers consulted.
+ *
+ *   Image CRC: CRC unit (CRC32/MPEG-2) over the image padded with 0xFF to
+ *   whole little-endian words.
+ */
+
+#define BOOT_SLOT_A         0U
+#define BOOT_SLOT_B         1U
+#define BOOT_SLOT_NONE      0xFFFFFFFFUL
+
+#define BOOT_RECORD_MAGIC   0xB0075107UL
+#define BOOT_TRAILER_RECORDS 4U
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t slot;
+    uint32_t size;                  /* image bytes                           */
+    uint32_t crc;
+    uint32_t seq;
+    uint32_t check;                 /* ~(magic ^ slot ^ size ^ crc ^ seq)    */
+    uint32_t tried;                 /* 0 once started by the bootloader      */
+    uint32_t confirmed;             /* 0 once the image confirmed itself     */
+} Boot_RecordTypeDef;
+
+const Boot_RecordTypeDef *Boot_Ctrl_Latest(void);
+const Boot_RecordTypeDef *Boot_Ctrl_LastConfirmed(void);
+HAL_StatusTypeDef         Boot_Ctrl_Append(uint32_t slot, uint32_t size, uint32_t crc);
+HAL_StatusTypeDef         Boot_Ctrl_MarkTried(const Boot_RecordTypeDef *rec);
+HAL_StatusTypeDef         Boot_Ctrl_Confirm(void);
+
+uint32_t                  Boot_Ctrl_SlotAddr(uint32_t slot);
+uint32_t                  Boot_Ctrl_SlotSize(void);
+uint32_t                  Boot_Ctrl_ImageMax(void);
+uint32_t                  Boot_Ctrl_RunningSlot(void);
+uint32_t                  Boot_Ctrl_ImageCrc(uint32_t slot, uint32_t size);
+uint32_t                  Boot_Ctrl_ImageValid(const Boot_RecordTypeDef *rec);
+
+#endif /* BOOT_CTRL_H_ */
@@ -0,0 +1,63 @@
+#ifndef CAN_LP_H_
+#define CAN_LP_H_
+
+#include "main_app.h"
+#include "can_rx.h"
+
+/*
+ * Low-power CAN node (CAN_LOW_POWER in main_app.h).
+ *
+ *   When no frame has arrived for CAN_LP_IDLE_MS and no update is running,
+ *   CAN_AppTask() calls CAN_Lp_Enter().  That puts bxCAN into SLEEP and the
+ *   core into one of:
+ *
+ *   STOP (default)  All clocks stop, bxCAN included, so it cannot see the
+ *                   bus and the SCE wake-up interrupt (WKUI) cannot fire.
+ *                   PA11 (CAN1_RX) stays in its alternate function and
+ *                   EXTI11 is armed on the falling edge.  The SOF of the
+ *                   next frame wakes the core, the PLL is restored, and
+ *                   only then is bxCAN woken.  AWUM is off while in STOP:
+ *                   on HSI, PCLK1 is not the rate the bit timing was
+ *                   programmed for, and bxCAN must not resync at that rate.
+ *
+ *   SLEEP           (CAN_LP_USE_SLEEP) The core waits in WFI with clocks
+ *                   running.  bxCAN leaves SLEEP by itself on the SOF
+ *                   (AWUM), and WKUI on the SCE line wakes the core.
+ *
+ *   Either way bxCAN has to see 11 recessive bits before it takes part
+ *   again, so the frame that woke the node is lost, and in STOP possibly
+ *   more while the PLL locks.
+ *
+ *   Loss measurement: the host sends bursts on CAN_LP_BENCH_ID with the
+ *   frame index in data[0..1].  The first bench frame after each wake-up
+ *   is answered on CAN_LP_REPORT_ID with
+ *     [lost (LE16), wakeups (LE16), awake ms (LE32)]
+ *   lost is the index of that frame, i.e. how many leading frames were
+ *   missed.  SysTick is suspended while asleep, so awake ms is the time
+ *   actually spent awake.  tools/can_wake_bench.py turns it into a duty
+ *   cycle and an average current per bus load.
+ */
+
+#define CAN_LP_IDLE_MS          20U
+
+/* Above the update data range (0x600-0x6FF), still inside filter bank 1 */
+#define CAN_LP_BENCH_ID         0x7F0U
+#define CAN_LP_REPORT_ID        0x7F8U
+
+/* Stay in SLEEP (clocks on, WKUI wake-up) instead of STOP */
+/* #define CAN_LP_USE_SLEEP */
+
+typedef struct
+{
+    uint32_t wakeups;
+    uint32_t lastLost;              /* leading bench frames missed, last wake */
+    uint32_t awakeMs;               /* HAL tick, stopped while asleep         */
+} CAN_Lp_StatsTypeDef;
+
+void     CAN_Lp_Init(void);
+void     CAN_Lp_Enter(void);
+uint32_t CAN_Lp_HandleFrame(const CAN_Rx_FrameTypeDef *frame);
+void     CAN_Lp_WakeIRQHandler(void);
+void     CAN_Lp_GetStats(CAN_Lp_StatsTypeDef *stats);
+
+#endif /* CAN_LP_H_ */
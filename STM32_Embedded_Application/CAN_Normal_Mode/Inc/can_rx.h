@@ -0,0 +1,35 @@
+#ifndef CAN_RX_H_
+#define CAN_RX_H_
+
+#include "main_app.h"
+
+/*
+ * CAN1 FIFO0 reception without HAL.
+ *
+ *   CAN1_RX0_IRQHandler drains the hardware FIFO into a RAM ring buffer by
+ *   register access.  Handler, helpers and buffer all live in SRAM, so frames
+ *   keep being received while flash is being programmed or erased (see
+ *   flash_if.h).  The main loop pops frames with CAN_Rx_Pop().
+ */
+
+#define CAN_RX_RING_SIZE    64U     /* frames, power of two; > CAN_UPD_WINDOW */
+
+/* Runs during flash operations: must stay above FLASH_IF_BASEPRI */
+#define CAN_RX_IRQ_PRIORITY 2U
+
+typedef struct
+{
+    uint32_t id;                    /* StdId or ExtId                        */
+    uint8_t  ide;                   /* CAN_ID_STD / CAN_ID_EXT               */
+    uint8_t  rtr;                   /* CAN_RTR_DATA / CAN_RTR_REMOTE         */
+    uint8_t  dlc;
+    uint8_t  filter;                /* filter match index                    */
+    uint16_t timestamp;             /* bit-time counter at SOF (TTCM)        */
+    uint8_t  data[8];
+} CAN_Rx_FrameTypeDef;
+
+void     CAN_Rx_IRQHandler(void);
+uint32_t CAN_Rx_Pop(CAN_Rx_FrameTypeDef *frame);
+uint32_t CAN_Rx_GetDropped(void);
+
+#endif /* CAN_RX_H_ */
@@ -0,0 +1,55 @@
+#ifndef CAN_UPDATE_H_
+#define CAN_UPDATE_H_
+
+#include "main_app.h"
+#include "can_rx.h"
+
+/*
+ * Firmware update agent: receives an image over CAN into the slot that is
+ * not running while the application carries on (see boot_ctrl.h).
+ *
+ *   0x7E0  host -> node  command   [cmd, args...]
+ *   0x7E8  node -> host  response  [rsp, status, value (LE32), arg, arg]
+ *   0x600 + (n & 0xFF)   data frame n: image bytes 8n .. 8n+7
+ *
+ *   START  [0x01, size (LE24), crc (LE32)]   erase the inactive slot
+ *          -> [0x81, status, slot, 0, 0, 0, window, ackEvery]
+ *   data   go-back-N: up to CAN_UPD_WINDOW frames beyond the last ACK
+ *          -> [0x82, 0, next frame]   every CAN_UPD_ACK_EVERY frames
+ *          -> [0x83, 0, expected]     on a gap; host resends from there
+ *          -> [0x84, status, crc]     after the last byte, image checked
+ *   ABORT  [0x03]                     -> [0x81, status]
+ *   REBOOT [0x04]                     reset into the new image
+ *   STATUS [0x05]                     -> [0x85, state, next frame]
+ *
+ *   The sequence lives in the identifier so every data frame carries a
+ *   full 8-byte payload.  Frames are programmed straight into flash from
+ *   CAN_AppTask(); the ring in can_rx absorbs the window.
+ */
+
+#define CAN_UPD_CMD_ID          0x7E0U
+#define CAN_UPD_RSP_ID          0x7E8U
+#define CAN_UPD_DATA_ID_BASE    0x600U
+
+#define CAN_UPD_WINDOW          48U     /* < CAN_RX_RING_SIZE                */
+#define CAN_UPD_ACK_EVERY       16U
+
+#define CAN_UPD_OK              0x00U
+#define CAN_UPD_ERR_STATE       0x01U
+#define CAN_UPD_ERR_SIZE        0x02U
+#define CAN_UPD_ERR_FLASH       0x03U
+#define CAN_UPD_ERR_CRC         0x04U
+#define CAN_UPD_ERR_NO_SLOT     0x05U
+
+typedef enum
+{
+    CAN_UPD_IDLE = 0,
+    CAN_UPD_RECEIVING,
+    CAN_UPD_DONE,
+    CAN_UPD_FAILED
+} CAN_Upd_StateTypeDef;
+
+uint32_t             CAN_Upd_HandleFrame(const CAN_Rx_FrameTypeDef *frame);
+CAN_Upd_StateTypeDef CAN_Upd_GetState(void);
+
+#endif /* CAN_UPDATE_H_ */
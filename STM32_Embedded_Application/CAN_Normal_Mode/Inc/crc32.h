@@ -0,0 +1,16 @@
+#ifndef CRC32_H_
+#define CRC32_H_
+
+#include "main_app.h"
+
+/*
+ * CRC32 on the CRC calculation unit (polynomial 0x04C11DB7, init
+ * 0xFFFFFFFF, 32-bit words, no reflection, no final XOR).
+ * HAL CRC is not enabled in this project, so the unit is driven directly.
+ */
+
+void     CRC32_Reset(void);
+uint32_t CRC32_Accumulate(const uint32_t *words, uint32_t count);
+uint32_t CRC32_Compute(const uint32_t *words, uint32_t count);
+
+#endif /* CRC32_H_ */
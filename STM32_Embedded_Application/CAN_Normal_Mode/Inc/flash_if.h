@@ -0,0 +1,37 @@
+#ifndef FLASH_IF_H_
+#define FLASH_IF_H_
+
+#include "main_app.h"
+
+/*
+ * Flash programming layer.
+ *
+ *   STM32F446RE: sectors 0..3 are 16 KB, sector 4 is 64 KB and sectors
+ *   5..7 are 128 KB.  Programming is done by 32-bit words (voltage range 3,
+ *   2.7 V..3.6 V).  Flash is read through the memory map.
+ *
+ *   The F446 has a single bank, so any fetch from flash stalls while a
+ *   program or erase is in progress.  The busy-wait loops live in .RamFunc
+ *   (copied to SRAM with .data), the vector table is moved to SRAM by
+ *   Flash_If_Init(), and BASEPRI masks every IRQ with a preemption priority
+ *   of FLASH_IF_BASEPRI or lower urgency during the operation.  IRQs that
+ *   must be served meanwhile (CAN RX, USART2 RX) get a higher priority and
+ *   must be __RAM_FUNC together with everything they call.
+ */
+
+#define FLASH_IF_BASE           0x08000000UL
+#define FLASH_IF_END            0x08080000UL
+#define FLASH_IF_ERASED_WORD    0xFFFFFFFFUL
+
+/* IRQs with preemption priority < FLASH_IF_BASEPRI run during flash writes */
+#define FLASH_IF_BASEPRI        4U
+
+void              Flash_If_Init(void);
+uint32_t          Flash_If_GetSector(uint32_t addr);
+uint32_t          Flash_If_GetSectorSize(uint32_t sector);
+HAL_StatusTypeDef Flash_If_EraseSector(uint32_t sector);
+HAL_StatusTypeDef Flash_If_Program(uint32_t addr, const uint32_t *words, uint32_t count);
+HAL_StatusTypeDef Flash_If_ProgramWord(uint32_t addr, uint32_t word);
+uint32_t          Flash_If_IsErased(uint32_t addr, uint32_t len);
+
+#endif /* FLASH_IF_H_ */
@@ -0,0 +1,37 @@
+#ifndef JITTER_H_
+#define JITTER_H_
+
+#include "main_app.h"
+
+/*
+ * Interrupt latency probe (JITTER_PROBE in main_app.h).
+ *
+ *   TIM7 counts up at the full timer clock and overflows at
+ *   JITTER_RATE_HZ.  The first thing TIM7_IRQHandler does is read the
+ *   counter: that value is the time from the update event to handler
+ *   entry.  Its spread (max - min) is the ISR jitter, which includes flash
+ *   wait states and ART misses on the way to the handler.  Compare a build
+ *   with FASTCODE_IN_RAM against one without.
+ *
+ *   The probe runs below FLASH_IF_BASEPRI, so flash erases show up as
+ *   large maxima; reset the statistics after KV compactions or updates.
+ */
+
+#define JITTER_RATE_HZ          10000U
+#define JITTER_IRQ_PRIORITY     5U      /* masked during flash operations */
+
+typedef struct
+{
+    uint32_t samples;
+    uint32_t minTicks;              /* timer ticks from update to entry      */
+    uint32_t maxTicks;
+    uint32_t meanTicks;
+    uint32_t timerHz;               /* tick rate                             */
+} Jitter_StatsTypeDef;
+
+void Jitter_Init(void);
+void Jitter_Reset(void);
+void Jitter_GetStats(Jitter_StatsTypeDef *stats);
+void Jitter_IRQHandler(void);
+
+#endif /* JITTER_H_ */
@@ -0,0 +1,48 @@
+#ifndef KVSTORE_H_
+#define KVSTORE_H_
+
+#include "main_app.h"
+
+/*
+ * Log-structured key-value store on two flash sectors (KVSTORE region in
+ * the linker script, sectors 1 and 2).
+ *
+ *   Records are appended to the active sector:
+ *     word 0   key[15:0] | len[30:16] | tombstone[31]
+ *     word 1   CRC32 over word 0 and the padded value
+ *     word 2.. value, padded to a word with 0xFF
+ *   The CRC word is programmed last, so a record is committed only once it
+ *   reads back with a matching CRC.
+ *
+ *   A RAM hash index (key -> record address) is rebuilt at boot by scanning
+ *   the log.  When the active sector fills up, the live records are copied
+ *   to the other sector, which is marked valid only after the copy, and the
+ *   old one is then erased.  KV_Idle() does this in small steps.
+ *
+ *   Power loss at any point leaves either the old or the new sector valid.
+ *   A torn record at the end of the log is dropped, and the sector is
+ *   compacted before the next write.
+ */
+
+#define KV_MAX_KEYS         48U
+#define KV_MAX_VALUE_LEN    256U
+#define KV_KEY_INVALID      0xFFFFU
+
+typedef struct
+{
+    uint32_t keys;
+    uint32_t usedBytes;         /* log bytes in the active sector            */
+    uint32_t liveBytes;         /* bytes a compaction would keep             */
+    uint32_t freeBytes;
+    uint32_t generation;        /* compactions since the store was created   */
+    uint32_t tornRecords;       /* dropped at boot after a power loss        */
+} KV_StatsTypeDef;
+
+HAL_StatusTypeDef KV_Init(void);
+HAL_StatusTypeDef KV_Put(uint16_t key, const void *value, uint16_t len);
+HAL_StatusTypeDef KV_Get(uint16_t key, void *value, uint16_t size, uint16_t *len);
+HAL_StatusTypeDef KV_Delete(uint16_t key);
+void              KV_Idle(void);
+void              KV_GetStats(KV_StatsTypeDef *stats);
+
+#endif /* KVSTORE_H_ */
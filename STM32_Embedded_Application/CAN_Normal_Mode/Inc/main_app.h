@@ -28,4 +28,36 @@
 #define TRUE  1
 #define FALSE 0
 
+/* Buffers only touched by DMA (and read back by the CPU in bulk): SRAM2,
+ * .dma_buffer section, not zeroed at startup.  16-byte aligned so 4-beat
+ * word bursts never cross a 1 KB boundary mid-burst. */
+#define DMA_BUFFER  __attribute__((section(".dma_buffer"), aligned(16)))
+
+/* Latency-critical code: ISRs and their fast paths.  With FASTCODE_IN_RAM
+ * (the RAM build profile) it goes to the .fastcode section, which SystemInit()
+ * copies to SRAM1, so it runs without flash wait states or ART misses.
+ * Without it, FASTCODE is empty and the code stays in flash. */
+/* #define FASTCODE_IN_RAM */
+#ifdef FASTCODE_IN_RAM
+#define FASTCODE    __attribute__((section(".fastcode"), noinline))
+#else
+#define FASTCODE
+#endif
+
+/* TIM7 interrupt latency probe (jitter.c), reported every 5 s */
+/* #define JITTER_PROBE */
+
+/* Sleep in STOP between bursts of CAN traffic (can_lp.h) */
+/* #define CAN_LOW_POWER */
+
+/* Event trace of ISRs, tasks and STOP (trace.h), console "trace" dumps it */
+/* #define TRACE_RECORDER */
+
+/* Key-value store keys */
+#define KV_KEY_BOOT_COUNT   0x0001U
+#define KV_KEY_CAN_TX_ID    0x0002U
+#define KV_KEY_CAN_FILTER   0x0003U     /* application filter: id, mask      */
+
+#define CAN_APP_DEFAULT_TX_ID   0x65DU
+
 #endif /* MAIN_H_ */
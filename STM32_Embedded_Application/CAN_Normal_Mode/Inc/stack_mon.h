@@ -0,0 +1,30 @@
+#ifndef STACK_MON_H_
+#define STACK_MON_H_
+
+#include "main_app.h"
+
+/*
+ * MSP high-water mark.
+ *
+ *   SystemInit() paints every word between the end of the heap (_end) and
+ *   the current stack pointer with STACK_MON_PATTERN, before .data/.bss are
+ *   initialised.  The deepest excursion of the stack, interrupts included,
+ *   is then the first word from the bottom that no longer holds the
+ *   pattern.  Compare against tools/stack_report.py, which gives the static
+ *   worst case per IRQ and task from -fstack-usage.
+ */
+
+#define STACK_MON_PATTERN   0xA5A5A5A5UL
+
+typedef struct
+{
+    uint32_t reserved;              /* _Min_Stack_Size from the linker script */
+    uint32_t available;             /* _estack - _end                        */
+    uint32_t highWater;             /* deepest use since reset, bytes        */
+    uint32_t current;               /* use at the time of the call, bytes    */
+} Stack_Mon_StatsTypeDef;
+
+uint32_t Stack_Mon_HighWater(void);
+void     Stack_Mon_GetStats(Stack_Mon_StatsTypeDef *stats);
+
+#endif /* STACK_MON_H_ */
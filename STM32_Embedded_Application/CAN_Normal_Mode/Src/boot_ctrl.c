@@ -0,0 +1,344 @@
+/* Includes ------------------------------------------------------------------*/
+#include "boot_ctrl.h"
+#include "flash_if.h"
+#include "crc32.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define BOOT_RECORD_WORDS   (sizeof(Boot_RecordTypeDef) / 4U)
+
+/* Private variables ---------------------------------------------------------*/
+extern uint32_t _sbootctrl;
+extern uint32_t _ebootctrl;
+extern uint32_t _sslot_a;
+extern uint32_t _sslot_b;
+extern uint32_t _slot_size;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t                  Boot_Ctrl_RecordOk(const Boot_RecordTypeDef *rec);
+static const Boot_RecordTypeDef *Boot_Ctrl_FreeRecord(void);
+static const Boot_RecordTypeDef *Boot_Ctrl_Trailer(uint32_t slot);
+static const Boot_RecordTypeDef *Boot_Ctrl_TrailerConfirmed(void);
+static HAL_StatusTypeDef         Boot_Ctrl_Stage(const Boot_RecordTypeDef *rec);
+static HAL_StatusTypeDef         Boot_Ctrl_WriteConfirmed(const Boot_RecordTypeDef *at,
+                                                          const Boot_RecordTypeDef *rec);
+static HAL_StatusTypeDef         Boot_Ctrl_Write(const Boot_RecordTypeDef *at, uint32_t slot,
+                                                 uint32_t size, uint32_t crc, uint32_t seq);
+
+/* -------------------------------------------------------------------------- */
+/*                               Public API                                   */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Newest intact record, or NULL if the sector holds none.
+  */
+const Boot_RecordTypeDef *Boot_Ctrl_Latest(void)
+{
+    const Boot_RecordTypeDef *rec = (const Boot_RecordTypeDef *)&_sbootctrl;
+    const Boot_RecordTypeDef *end = (const Boot_RecordTypeDef *)&_ebootctrl;
+    const Boot_RecordTypeDef *latest = NULL;
+
+    /* Torn records are skipped but still occupy their place */
+    for (; (rec < end) && (rec->magic != FLASH_IF_ERASED_WORD); rec++)
+    {
+        if (Boot_Ctrl_RecordOk(rec) != 0U)
+        {
+            latest = rec;
+        }
+    }
+
+    return latest;
+}
+
+/**
+  * @brief  Newest confirmed record; from the slot trailers if sector 3 has
+  *         none (power lost while it was being rewritten).
+  */
+const Boot_RecordTypeDef *Boot_Ctrl_LastConfirmed(void)
+{
+    const Boot_RecordTypeDef *rec = (const Boot_RecordTypeDef *)&_sbootctrl;
+    const Boot_RecordTypeDef *end = (const Boot_RecordTypeDef *)&_ebootctrl;
+    const Boot_RecordTypeDef *confirmed = NULL;
+
+    for (; (rec < end) && (rec->magic != FLASH_IF_ERASED_WORD); rec++)
+    {
+        if ((Boot_Ctrl_RecordOk(rec) != 0U) && (rec->confirmed == 0U))
+        {
+            confirmed = rec;
+        }
+    }
+
+    return (confirmed != NULL) ? confirmed : Boot_Ctrl_TrailerConfirmed();
+}
+
+/**
+  * @brief  Register a freshly written image; the bootloader starts it on
+  *         the next reset.  When the sector is full it is erased and the
+  *         last confirmed record is carried over first, staged beforehand in
+  *         its slot trailer.
+  */
+HAL_StatusTypeDef Boot_Ctrl_Append(uint32_t slot, uint32_t size, uint32_t crc)
+{
+    const Boot_RecordTypeDef *latest = Boot_Ctrl_Latest();
+    const Boot_RecordTypeDef *confirmed = Boot_Ctrl_LastConfirmed();
+    const Boot_RecordTypeDef *at = Boot_Ctrl_FreeRecord();
+    Boot_RecordTypeDef keep;
+    uint32_t seq;
+
+    /* After a lost rewrite the sector may be empty: stay above the trailer */
+    seq = (latest != NULL) ? latest->seq : ((confirmed != NULL) ? confirmed->seq : 0U);
+    seq++;
+
+    if (at == NULL)
+    {
+        if (confirmed != NULL)
+        {
+            /* Not a single moment without a copy on flash */
+            if (Boot_Ctrl_Stage(confirmed) != HAL_OK)
+            {
+                return HAL_ERROR;
+            }
+            keep = *confirmed;
+        }
+
+        if (Flash_If_EraseSector(Flash_If_GetSector((uint32_t)&_sbootctrl)) != HAL_OK)
+        {
+            return HAL_ERROR;
+        }
+
+        at = (const Boot_RecordTypeDef *)&_sbootctrl;
+        if (confirmed != NULL)
+        {
+            if (Boot_Ctrl_WriteConfirmed(at, &keep) != HAL_OK)
+            {
+                return HAL_ERROR;
+            }
+            at++;
+        }
+    }
+
+    return Boot_Ctrl_Write(at, slot, size, crc, seq);
+}
+
+HAL_StatusTypeDef Boot_Ctrl_MarkTried(const Boot_RecordTypeDef *rec)
+{
+    return Flash_If_ProgramWord((uint32_t)&rec->tried, 0U);
+}
+
+/**
+  * @brief  Called by the application once it is up: keeps the running image
+  *         from being rolled back.  No-op if already confirmed or if the
+  *         image was not started through a record (standalone build).
+  */
+HAL_StatusTypeDef Boot_Ctrl_Confirm(void)
+{
+    const Boot_RecordTypeDef *rec = Boot_Ctrl_Latest();
+
+    if ((rec == NULL) || (rec->slot != Boot_Ctrl_RunningSlot()) || (rec->confirmed == 0U))
+    {
+        return HAL_OK;
+    }
+
+    return Flash_If_ProgramWord((uint32_t)&rec->confirmed, 0U);
+}
+
+uint32_t Boot_Ctrl_SlotAddr(uint32_t slot)
+{
+    return (slot == BOOT_SLOT_A) ? (uint32_t)&_sslot_a : (uint32_t)&_sslot_b;
+}
+
+uint32_t Boot_Ctrl_SlotSize(void)
+{
+    return (uint32_t)&_slot_size;
+}
+
+/**
+  * @brief  Largest image a slot takes: the trailer is kept clear.
+  */
+uint32_t Boot_Ctrl_ImageMax(void)
+{
+    uint32_t trailer = BOOT_TRAILER_RECORDS * sizeof(Boot_RecordTypeDef);
+
+    return (Boot_Ctrl_SlotSize() > trailer) ? (Boot_Ctrl_SlotSize() - trailer) : 0U;
+}
+
+/**
+  * @brief  Slot this code is executing from, BOOT_SLOT_NONE for the
+  *         bootloader or a standalone build: STM32F446RETX_FLASH.ld and
+  *         _RAM.ld link _slot_size = 0, so no address is inside a slot.
+  */
+uint32_t Boot_Ctrl_RunningSlot(void)
+{
+    uint32_t pc = (uint32_t)&Boot_Ctrl_RunningSlot;
+    uint32_t slot;
+
+    for (slot = BOOT_SLOT_A; slot <= BOOT_SLOT_B; slot++)
+    {
+        if ((pc >= Boot_Ctrl_SlotAddr(slot)) && (pc < (Boot_Ctrl_SlotAddr(slot) + Boot_Ctrl_SlotSize())))
+        {
+            return slot;
+        }
+    }
+
+    return BOOT_SLOT_NONE;
+}
+
+/**
+  * @brief  CRC of the first @p size bytes of a slot, last word padded 0xFF.
+  */
+uint32_t Boot_Ctrl_ImageCrc(uint32_t slot, uint32_t size)
+{
+    const uint32_t *image = (const uint32_t *)Boot_Ctrl_SlotAddr(slot);
+    uint32_t whole = size / 4U;
+    uint32_t tail = 0xFFFFFFFFUL;
+    uint32_t crc;
+    uint32_t i;
+
+    crc = CRC32_Compute(image, whole);
+
+    if ((size % 4U) != 0U)
+    {
+        for (i = 0U; i < (size % 4U); i++)
+        {
+            ((uint8_t *)&tail)[i] = ((const uint8_t *)&image[whole])[i];
+        }
+        crc = CRC32_Accumulate(&tail, 1U);
+    }
+
+    return crc;
+}
+
+uint32_t Boot_Ctrl_ImageValid(const Boot_RecordTypeDef *rec)
+{
+    if ((rec->slot > BOOT_SLOT_B) || (rec->size == 0U) || (rec->size > Boot_Ctrl_ImageMax()))
+    {
+        return 0U;
+    }
+
+    return (Boot_Ctrl_ImageCrc(rec->slot, rec->size) == rec->crc) ? 1U : 0U;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                              Local helpers                                 */
+/* -------------------------------------------------------------------------- */
+
+static uint32_t Boot_Ctrl_RecordOk(const Boot_RecordTypeDef *rec)
+{
+    return ((rec->magic == BOOT_RECORD_MAGIC) &&
+            (rec->check == ~(rec->magic ^ rec->slot ^ rec->size ^ rec->crc ^ rec->seq))) ? 1U : 0U;
+}
+
+static const Boot_RecordTypeDef *Boot_Ctrl_FreeRecord(void)
+{
+    const Boot_RecordTypeDef *rec = (const Boot_RecordTypeDef *)&_sbootctrl;
+    const Boot_RecordTypeDef *end = (const Boot_RecordTypeDef *)&_ebootctrl;
+
+    for (; rec < end; rec++)
+    {
+        if (Flash_If_IsErased((uint32_t)rec, sizeof(Boot_RecordTypeDef)) != 0U)
+        {
+            return rec;
+        }
+    }
+
+    return NULL;
+}
+
+static const Boot_RecordTypeDef *Boot_Ctrl_Trailer(uint32_t slot)
+{
+    return (const Boot_RecordTypeDef *)(Boot_Ctrl_SlotAddr(slot) + Boot_Ctrl_ImageMax());
+}
+
+/**
+  * @brief  Newest intact, confirmed record staged in either slot trailer.
+  */
+static const Boot_RecordTypeDef *Boot_Ctrl_TrailerConfirmed(void)
+{
+    const Boot_RecordTypeDef *rec;
+    const Boot_RecordTypeDef *best = NULL;
+    uint32_t slot;
+    uint32_t i;
+
+    if (Boot_Ctrl_ImageMax() == 0U)
+    {
+        return NULL;
+    }
+
+    for (slot = BOOT_SLOT_A; slot <= BOOT_SLOT_B; slot++)
+    {
+        rec = Boot_Ctrl_Trailer(slot);
+        for (i = 0U; i < BOOT_TRAILER_RECORDS; i++, rec++)
+        {
+            if ((Boot_Ctrl_RecordOk(rec) != 0U) && (rec->confirmed == 0U) &&
+                (rec->slot == slot) && ((best == NULL) || (rec->seq > best->seq)))
+            {
+                best = rec;
+            }
+        }
+    }
+
+    return best;
+}
+
+/**
+  * @brief  Copy @p rec into the trailer of its slot, unless it is there.
+  *         A torn copy from an earlier attempt is skipped; with no room
+  *         left the sector is not erased at all.
+  */
+static HAL_StatusTypeDef Boot_Ctrl_Stage(const Boot_RecordTypeDef *rec)
+{
+    const Boot_RecordTypeDef *at = Boot_Ctrl_Trailer(rec->slot);
+    uint32_t i;
+
+    if (Boot_Ctrl_ImageMax() == 0U)
+    {
+        return HAL_ERROR;
+    }
+
+    for (i = 0U; i < BOOT_TRAILER_RECORDS; i++, at++)
+    {
+        if ((Boot_Ctrl_RecordOk(at) != 0U) && (at->confirmed == 0U) &&
+            (at->slot == rec->slot) && (at->size == rec->size) &&
+            (at->crc == rec->crc) && (at->seq == rec->seq))
+        {
+            return HAL_OK;
+        }
+        if (Flash_If_IsErased((uint32_t)at, sizeof(Boot_RecordTypeDef)) != 0U)
+        {
+            return Boot_Ctrl_WriteConfirmed(at, rec);
+        }
+    }
+
+    return HAL_ERROR;
+}
+
+/**
+  * @brief  Write a copy of @p rec at @p at, tried and confirmed.
+  */
+static HAL_StatusTypeDef Boot_Ctrl_WriteConfirmed(const Boot_RecordTypeDef *at,
+                                                  const Boot_RecordTypeDef *rec)
+{
+    if ((Boot_Ctrl_Write(at, rec->slot, rec->size, rec->crc, rec->seq) != HAL_OK) ||
+        (Flash_If_ProgramWord((uint32_t)&at->tried, 0U) != HAL_OK) ||
+        (Flash_If_ProgramWord((uint32_t)&at->confirmed, 0U) != HAL_OK))
+    {
+        return HAL_ERROR;
+    }
+
+    return HAL_OK;
+}
+
+static HAL_StatusTypeDef Boot_Ctrl_Write(const Boot_RecordTypeDef *at, uint32_t slot,
+                                         uint32_t size, uint32_t crc, uint32_t seq)
+{
+    uint32_t words[6];
+
+    words[0] = BOOT_RECORD_MAGIC;
+    words[1] = slot;
+    words[2] = size;
+    words[3] = crc;
+    words[4] = seq;
+    words[5] = ~(words[0] ^ slot ^ size ^ crc ^ seq);
+
+    /* tried / confirmed stay erased */
+    return Flash_If_Program((uint32_t)at, words, 6U);
+}
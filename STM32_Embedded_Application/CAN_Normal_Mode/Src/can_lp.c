@@ -0,0 +1,212 @@
+/* Includes ------------------------------------------------------------------*/
+#include "can_lp.h"
+#include "log.h"
+#include "trace.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define CAN_LP_EXTI_LINE        EXTI_IMR_MR11           /* PA11, CAN1_RX     */
+#define CAN_LP_SLAK_TIMEOUT_MS  10U
+
+/* Private variables ---------------------------------------------------------*/
+extern CAN_HandleTypeDef hcan1;
+extern void SystemClock_Config(void);
+
+static volatile uint32_t gWoken;
+static uint32_t gWakeups;
+static uint32_t gLastLost;
+static uint32_t gReportPending;
+
+/* Private function prototypes -----------------------------------------------*/
+static HAL_StatusTypeDef CAN_Lp_SleepCan(void);
+static void              CAN_Lp_Report(void);
+
+/* -------------------------------------------------------------------------- */
+/*                               Public API                                   */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Route EXTI11 to PA11 (masked until CAN_Lp_Enter()) and enable
+  *         automatic wake-up.  Call while bxCAN is still in init mode.
+  */
+void CAN_Lp_Init(void)
+{
+    __HAL_RCC_SYSCFG_CLK_ENABLE();
+    SYSCFG->EXTICR[2] &= ~SYSCFG_EXTICR3_EXTI11;        /* port A            */
+
+    EXTI->IMR  &= ~CAN_LP_EXTI_LINE;
+    EXTI->EMR  &= ~CAN_LP_EXTI_LINE;
+    EXTI->RTSR &= ~CAN_LP_EXTI_LINE;
+    EXTI->FTSR |= CAN_LP_EXTI_LINE;
+
+    HAL_NVIC_EnableIRQ(EXTI15_10_IRQn);
+
+    hcan1.Init.AutoWakeUp = ENABLE;
+    CAN1->MCR |= CAN_MCR_AWUM;
+}
+
+/**
+  * @brief  Sleep until the bus becomes active again.  Returns with the
+  *         clocks restored and bxCAN back in normal mode (or immediately,
+  *         if a transmission is pending or bxCAN refuses to sleep).
+  */
+void CAN_Lp_Enter(void)
+{
+    if (HAL_CAN_GetTxMailboxesFreeLevel(&hcan1) != 3U)
+    {
+        return;
+    }
+
+    gWoken = 0U;
+
+#ifdef CAN_LP_USE_SLEEP
+    /* bxCAN wakes on SOF by itself and raises WKUI */
+    __HAL_CAN_ENABLE_IT(&hcan1, CAN_IT_WAKEUP);
+    if (CAN_Lp_SleepCan() != HAL_OK)
+    {
+        __HAL_CAN_DISABLE_IT(&hcan1, CAN_IT_WAKEUP);
+        return;
+    }
+
+    HAL_SuspendTick();
+    TRACE_POWER(TRACE_PWR_SLEEP, 0U);
+    while (gWoken == 0U)
+    {
+        /* Other interrupts (TIM6, button) wake the core too */
+        HAL_PWR_EnterSLEEPMode(PWR_MAINREGULATOR_ON, PWR_SLEEPENTRY_WFI);
+    }
+    TRACE_POWER(TRACE_PWR_RUN, 0U);
+    HAL_ResumeTick();
+
+    __HAL_CAN_DISABLE_IT(&hcan1, CAN_IT_WAKEUP);
+#else
+    /* No resync on the HSI clock: wake bxCAN explicitly after the PLL */
+    CAN1->MCR &= ~CAN_MCR_AWUM;
+    if (CAN_Lp_SleepCan() != HAL_OK)
+    {
+        CAN1->MCR |= CAN_MCR_AWUM;
+        return;
+    }
+
+    EXTI->PR   = CAN_LP_EXTI_LINE;
+    EXTI->IMR |= CAN_LP_EXTI_LINE;
+
+    /* The log DMA and USART2 stop with the clocks: drain first */
+    Log_Flush();
+
+    HAL_SuspendTick();
+    TRACE_POWER(TRACE_PWR_STOP, 0U);
+    HAL_PWR_EnterSTOPMode(PWR_LOWPOWERREGULATOR_ON, PWR_STOPENTRY_WFI);
+
+    /* Back on HSI: PLL first, then the CAN bit timing is valid again */
+    SystemClock_Config();
+    HAL_ResumeTick();
+    TRACE_POWER(TRACE_PWR_RUN, 0U);
+
+    EXTI->IMR &= ~CAN_LP_EXTI_LINE;
+    (void)HAL_CAN_WakeUp(&hcan1);
+    CAN1->MCR |= CAN_MCR_AWUM;
+#endif
+
+    gWakeups++;
+    gReportPending = 1U;
+}
+
+/**
+  * @brief  Consume bench frames: answer the first one after each wake-up.
+  * @retval 1 if the frame belonged to the loss benchmark
+  */
+uint32_t CAN_Lp_HandleFrame(const CAN_Rx_FrameTypeDef *frame)
+{
+    if ((frame->ide != CAN_ID_STD) || (frame->id != CAN_LP_BENCH_ID) || (frame->dlc < 2U))
+    {
+        return 0U;
+    }
+
+    if (gReportPending != 0U)
+    {
+        gReportPending = 0U;
+        gLastLost = (uint32_t)frame->data[0] | ((uint32_t)frame->data[1] << 8);
+        CAN_Lp_Report();
+    }
+
+    return 1U;
+}
+
+/**
+  * @brief  EXTI11: bus activity on CAN1_RX while in STOP.
+  */
+void CAN_Lp_WakeIRQHandler(void)
+{
+    EXTI->PR   = CAN_LP_EXTI_LINE;
+    EXTI->IMR &= ~CAN_LP_EXTI_LINE;
+    gWoken = 1U;
+}
+
+void CAN_Lp_GetStats(CAN_Lp_StatsTypeDef *stats)
+{
+    stats->wakeups  = gWakeups;
+    stats->lastLost = gLastLost;
+    stats->awakeMs  = HAL_GetTick();
+}
+
+/* WKUI from the SCE line (HAL_CAN_IRQHandler), SLEEP variant */
+void HAL_CAN_WakeUpFromRxMsgCallback(CAN_HandleTypeDef *hcan)
+{
+    (void)hcan;
+    gWoken = 1U;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                               Local helpers                                */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Request bxCAN SLEEP and wait for SLAK.  bxCAN finishes a frame
+  *         in progress first.
+  */
+static HAL_StatusTypeDef CAN_Lp_SleepCan(void)
+{
+    uint32_t start = HAL_GetTick();
+
+    if (HAL_CAN_RequestSleep(&hcan1) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    while (HAL_CAN_IsSleepActive(&hcan1) == 0U)
+    {
+        if ((HAL_GetTick() - start) > CAN_LP_SLAK_TIMEOUT_MS)
+        {
+            (void)HAL_CAN_WakeUp(&hcan1);
+            return HAL_TIMEOUT;
+        }
+    }
+
+    return HAL_OK;
+}
+
+static void CAN_Lp_Report(void)
+{
+    CAN_TxHeaderTypeDef txHeader;
+    uint32_t txMailbox;
+    uint32_t awake = HAL_GetTick();
+    uint8_t data[8];
+
+    memset(&txHeader, 0, sizeof(txHeader));
+    txHeader.StdId = CAN_LP_REPORT_ID;
+    txHeader.IDE   = CAN_ID_STD;
+    txHeader.RTR   = CAN_RTR_DATA;
+    txHeader.DLC   = 8U;
+
+    data[0] = (uint8_t)gLastLost;
+    data[1] = (uint8_t)(gLastLost >> 8);
+    data[2] = (uint8_t)gWakeups;
+    data[3] = (uint8_t)(gWakeups >> 8);
+    data[4] = (uint8_t)awake;
+    data[5] = (uint8_t)(awake >> 8);
+    data[6] = (uint8_t)(awake >> 16);
+    data[7] = (uint8_t)(awake >> 24);
+
+    (void)HAL_CAN_AddTxMessage(&hcan1, &txHeader, data, &txMailbox);
+}
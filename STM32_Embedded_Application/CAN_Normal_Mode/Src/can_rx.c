@@ -0,0 +1,101 @@
+/* Includes ------------------------------------------------------------------*/
+#include "can_rx.h"
+
+/* Private variables ---------------------------------------------------------*/
+static CAN_Rx_FrameTypeDef gRing[CAN_RX_RING_SIZE];
+static volatile uint32_t   gHead;       /* written by the ISR only           */
+static volatile uint32_t   gTail;       /* written by the main loop only     */
+static volatile uint32_t   gDropped;    /* ring full or hardware overrun     */
+
+/* -------------------------------------------------------------------------- */
+/*                               Public API                                   */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Move every pending FIFO0 message into the ring buffer.
+  *         Called from CAN1_RX0_IRQHandler; runs from SRAM.
+  */
+__RAM_FUNC void CAN_Rx_IRQHandler(void)
+{
+    CAN_FIFOMailBox_TypeDef *mb = &CAN1->sFIFOMailBox[0];
+    CAN_Rx_FrameTypeDef *frame;
+    uint32_t rir;
+    uint32_t rdtr;
+    uint32_t rdlr;
+    uint32_t rdhr;
+    uint32_t head;
+
+    while ((CAN1->RF0R & CAN_RF0R_FMP0) != 0U)
+    {
+        rir  = mb->RIR;
+        rdtr = mb->RDTR;
+        rdlr = mb->RDLR;
+        rdhr = mb->RDHR;
+
+        /* Release the output mailbox */
+        CAN1->RF0R = CAN_RF0R_RFOM0;
+
+        head = gHead;
+        if ((head - gTail) >= CAN_RX_RING_SIZE)
+        {
+            gDropped++;
+            continue;
+        }
+
+        frame = &gRing[head & (CAN_RX_RING_SIZE - 1U)];
+
+        frame->ide = (uint8_t)(rir & CAN_RI0R_IDE);
+        frame->rtr = (uint8_t)(rir & CAN_RI0R_RTR);
+        frame->id  = (frame->ide != 0U) ? (rir >> CAN_RI0R_EXID_Pos)
+                                        : (rir >> CAN_RI0R_STID_Pos);
+        frame->dlc       = (uint8_t)(rdtr & CAN_RDT0R_DLC);
+        frame->filter    = (uint8_t)((rdtr & CAN_RDT0R_FMI) >> CAN_RDT0R_FMI_Pos);
+        frame->timestamp = (uint16_t)(rdtr >> CAN_RDT0R_TIME_Pos);
+
+        frame->data[0] = (uint8_t)rdlr;
+        frame->data[1] = (uint8_t)(rdlr >> 8);
+        frame->data[2] = (uint8_t)(rdlr >> 16);
+        frame->data[3] = (uint8_t)(rdlr >> 24);
+        frame->data[4] = (uint8_t)rdhr;
+        frame->data[5] = (uint8_t)(rdhr >> 8);
+        frame->data[6] = (uint8_t)(rdhr >> 16);
+        frame->data[7] = (uint8_t)(rdhr >> 24);
+
+        /* Publish only after the slot is complete */
+        __DMB();
+        gHead = head + 1U;
+    }
+
+    /* A frame was lost in hardware: FIFO was full when a fourth arrived */
+    if ((CAN1->RF0R & CAN_RF0R_FOVR0) != 0U)
+    {
+        CAN1->RF0R = CAN_RF0R_FOVR0 | CAN_RF0R_FULL0;
+        gDropped++;
+    }
+}
+
+/**
+  * @brief  Take the oldest received frame.
+  * @retval 1 if @p frame was filled, 0 if the ring is empty
+  */
+FASTCODE uint32_t CAN_Rx_Pop(CAN_Rx_FrameTypeDef *frame)
+{
+    uint32_t tail = gTail;
+
+    if (tail == gHead)
+    {
+        return 0U;
+    }
+
+    __DMB();
+    *frame = gRing[tail & (CAN_RX_RING_SIZE - 1U)];
+    __DMB();
+    gTail = tail + 1U;
+
+    return 1U;
+}
+
+uint32_t CAN_Rx_GetDropped(void)
+{
+    return gDropped;
+}
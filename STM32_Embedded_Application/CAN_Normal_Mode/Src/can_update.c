@@ -0,0 +1,275 @@
+/* Includes ------------------------------------------------------------------*/
+#include "can_update.h"
+#include "boot_ctrl.h"
+#include "flash_if.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define CAN_UPD_CMD_START       0x01U
+#define CAN_UPD_CMD_ABORT       0x03U
+#define CAN_UPD_CMD_REBOOT      0x04U
+#define CAN_UPD_CMD_STATUS      0x05U
+
+#define CAN_UPD_RSP_START       0x81U
+#define CAN_UPD_RSP_ACK         0x82U
+#define CAN_UPD_RSP_NACK        0x83U
+#define CAN_UPD_RSP_DONE        0x84U
+#define CAN_UPD_RSP_STATUS      0x85U
+
+#define CAN_UPD_TX_TIMEOUT_MS   10U
+
+/* Private variables ---------------------------------------------------------*/
+extern CAN_HandleTypeDef hcan1;
+
+static CAN_Upd_StateTypeDef gState = CAN_UPD_IDLE;
+static uint32_t gSlot;
+static uint32_t gBase;
+static uint32_t gSize;
+static uint32_t gCrc;
+static uint32_t gNext;                  /* next expected frame index          */
+static uint32_t gFrames;                /* total frames in the image          */
+static uint32_t gNackFor = 0xFFFFFFFFUL;/* gap already reported at this index */
+
+/* Private function prototypes -----------------------------------------------*/
+static void CAN_Upd_Command(const CAN_Rx_FrameTypeDef *frame);
+static void CAN_Upd_Start(const uint8_t *data);
+static void CAN_Upd_Data(const CAN_Rx_FrameTypeDef *frame);
+static void CAN_Upd_Finish(void);
+static void CAN_Upd_Respond(uint8_t rsp, uint8_t status, uint32_t value, uint8_t arg0, uint8_t arg1);
+
+/* -------------------------------------------------------------------------- */
+/*                               Public API                                   */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Consume update traffic.
+  * @retval 1 if the frame belonged to the update protocol
+  */
+FASTCODE uint32_t CAN_Upd_HandleFrame(const CAN_Rx_FrameTypeDef *frame)
+{
+    if (frame->ide != CAN_ID_STD)
+    {
+        return 0U;
+    }
+
+    if ((frame->id & ~0xFFU) == CAN_UPD_DATA_ID_BASE)
+    {
+        CAN_Upd_Data(frame);
+        return 1U;
+    }
+
+    if ((frame->id == CAN_UPD_CMD_ID) && (frame->dlc > 0U))
+    {
+        CAN_Upd_Command(frame);
+        return 1U;
+    }
+
+    return 0U;
+}
+
+CAN_Upd_StateTypeDef CAN_Upd_GetState(void)
+{
+    return gState;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                              Local helpers                                 */
+/* -------------------------------------------------------------------------- */
+
+static void CAN_Upd_Command(const CAN_Rx_FrameTypeDef *frame)
+{
+    switch (frame->data[0])
+    {
+    case CAN_UPD_CMD_START:
+        CAN_Upd_Start(frame->data);
+        break;
+
+    case CAN_UPD_CMD_ABORT:
+        gState = CAN_UPD_IDLE;
+        CAN_Upd_Respond(CAN_UPD_RSP_START, CAN_UPD_OK, 0U, 0U, 0U);
+        break;
+
+    case CAN_UPD_CMD_REBOOT:
+        if (gState == CAN_UPD_DONE)
+        {
+            /* Let the last response leave the mailbox */
+            HAL_Delay(CAN_UPD_TX_TIMEOUT_MS);
+            NVIC_SystemReset();
+        }
+        CAN_Upd_Respond(CAN_UPD_RSP_STATUS, (uint8_t)gState, gNext, 0U, 0U);
+        break;
+
+    case CAN_UPD_CMD_STATUS:
+        CAN_Upd_Respond(CAN_UPD_RSP_STATUS, (uint8_t)gState, gNext, 0U, 0U);
+        break;
+
+    default:
+        break;
+    }
+}
+
+/**
+  * @brief  Validate the request and erase the inactive slot.  The host waits
+  *         for the response, so nothing arrives during the erase.
+  */
+static void CAN_Upd_Start(const uint8_t *data)
+{
+    uint32_t running = Boot_Ctrl_RunningSlot();
+    uint32_t sector;
+    uint32_t last;
+
+    gSize = (uint32_t)data[1] | ((uint32_t)data[2] << 8) | ((uint32_t)data[3] << 16);
+    gCrc  = (uint32_t)data[4] | ((uint32_t)data[5] << 8) |
+            ((uint32_t)data[6] << 16) | ((uint32_t)data[7] << 24);
+
+    if (running == BOOT_SLOT_NONE)
+    {
+        /* Standalone build: code spans both slots */
+        gState = CAN_UPD_FAILED;
+        CAN_Upd_Respond(CAN_UPD_RSP_START, CAN_UPD_ERR_NO_SLOT, 0U, 0U, 0U);
+        return;
+    }
+
+    if ((gSize == 0U) || (gSize > Boot_Ctrl_ImageMax()))
+    {
+        gState = CAN_UPD_FAILED;
+        CAN_Upd_Respond(CAN_UPD_RSP_START, CAN_UPD_ERR_SIZE, 0U, 0U, 0U);
+        return;
+    }
+
+    gSlot   = (running == BOOT_SLOT_A) ? BOOT_SLOT_B : BOOT_SLOT_A;
+    gBase   = Boot_Ctrl_SlotAddr(gSlot);
+    gFrames = (gSize + 7U) / 8U;
+    gNext   = 0U;
+    gNackFor = 0xFFFFFFFFUL;
+
+    /* The whole slot, trailer included: a record staged there for the
+     * previous image must not outlive it */
+    last = Flash_If_GetSector(gBase + Boot_Ctrl_SlotSize() - 1U);
+    for (sector = Flash_If_GetSector(gBase); sector <= last; sector++)
+    {
+        if (Flash_If_EraseSector(sector) != HAL_OK)
+        {
+            gState = CAN_UPD_FAILED;
+            CAN_Upd_Respond(CAN_UPD_RSP_START, CAN_UPD_ERR_FLASH, 0U, 0U, 0U);
+            return;
+        }
+    }
+
+    gState = CAN_UPD_RECEIVING;
+    CAN_Upd_Respond(CAN_UPD_RSP_START, CAN_UPD_OK, gSlot,
+                    (uint8_t)CAN_UPD_WINDOW, (uint8_t)CAN_UPD_ACK_EVERY);
+}
+
+static FASTCODE void CAN_Upd_Data(const CAN_Rx_FrameTypeDef *frame)
+{
+    uint32_t words[2];
+    uint32_t offset;
+    uint32_t len;
+    uint8_t  ahead;
+
+    if (gState != CAN_UPD_RECEIVING)
+    {
+        return;
+    }
+
+    ahead = (uint8_t)((frame->id & 0xFFU) - (gNext & 0xFFU));
+    if (ahead != 0U)
+    {
+        /* ahead < 128: frames were lost in between (ring or FIFO overrun);
+         * otherwise a stale retransmission, ignored */
+        if ((ahead < 128U) && (gNackFor != gNext))
+        {
+            gNackFor = gNext;
+            CAN_Upd_Respond(CAN_UPD_RSP_NACK, CAN_UPD_OK, gNext, 0U, 0U);
+        }
+        return;
+    }
+
+    offset = gNext * 8U;
+    len    = ((gSize - offset) < 8U) ? (gSize - offset) : 8U;
+    if (frame->dlc < len)
+    {
+        return;
+    }
+
+    memset(words, 0xFF, sizeof(words));
+    memcpy(words, frame->data, len);
+
+    if (Flash_If_Program(gBase + offset, words, (len + 3U) / 4U) != HAL_OK)
+    {
+        gState = CAN_UPD_FAILED;
+        CAN_Upd_Respond(CAN_UPD_RSP_DONE, CAN_UPD_ERR_FLASH, gNext, 0U, 0U);
+        return;
+    }
+
+    gNext++;
+
+    if (gNext == gFrames)
+    {
+        CAN_Upd_Finish();
+    }
+    else if ((gNext % CAN_UPD_ACK_EVERY) == 0U)
+    {
+        CAN_Upd_Respond(CAN_UPD_RSP_ACK, CAN_UPD_OK, gNext, 0U, 0U);
+    }
+}
+
+/**
+  * @brief  Check the written image with the CRC unit and hand it to the
+  *         bootloader.  It is started on the next reset.
+  */
+static void CAN_Upd_Finish(void)
+{
+    uint32_t crc = Boot_Ctrl_ImageCrc(gSlot, gSize);
+
+    if (crc != gCrc)
+    {
+        gState = CAN_UPD_FAILED;
+        CAN_Upd_Respond(CAN_UPD_RSP_DONE, CAN_UPD_ERR_CRC, crc, 0U, 0U);
+        return;
+    }
+
+    if (Boot_Ctrl_Append(gSlot, gSize, gCrc) != HAL_OK)
+    {
+        gState = CAN_UPD_FAILED;
+        CAN_Upd_Respond(CAN_UPD_RSP_DONE, CAN_UPD_ERR_FLASH, crc, 0U, 0U);
+        return;
+    }
+
+    gState = CAN_UPD_DONE;
+    CAN_Upd_Respond(CAN_UPD_RSP_DONE, CAN_UPD_OK, crc, 0U, 0U);
+}
+
+static void CAN_Upd_Respond(uint8_t rsp, uint8_t status, uint32_t value, uint8_t arg0, uint8_t arg1)
+{
+    CAN_TxHeaderTypeDef txHeader;
+    uint32_t txMailbox;
+    uint32_t tickstart = HAL_GetTick();
+    uint8_t data[8];
+
+    memset(&txHeader, 0, sizeof(txHeader));
+    txHeader.StdId = CAN_UPD_RSP_ID;
+    txHeader.IDE   = CAN_ID_STD;
+    txHeader.RTR   = CAN_RTR_DATA;
+    txHeader.DLC   = 8U;
+
+    data[0] = rsp;
+    data[1] = status;
+    data[2] = (uint8_t)value;
+    data[3] = (uint8_t)(value >> 8);
+    data[4] = (uint8_t)(value >> 16);
+    data[5] = (uint8_t)(value >> 24);
+    data[6] = arg0;
+    data[7] = arg1;
+
+    while (HAL_CAN_GetTxMailboxesFreeLevel(&hcan1) == 0U)
+    {
+        if ((HAL_GetTick() - tickstart) > CAN_UPD_TX_TIMEOUT_MS)
+        {
+            return;
+        }
+    }
+
+    (void)HAL_CAN_AddTxMessage(&hcan1, &txHeader, data, &txMailbox);
+}
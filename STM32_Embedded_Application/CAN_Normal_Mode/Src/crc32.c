@@ -0,0 +1,32 @@
+/* Includes ------------------------------------------------------------------*/
+#include "crc32.h"
+
+/**
+  * @brief  Enable the CRC unit and load the initial value.
+  */
+void CRC32_Reset(void)
+{
+    __HAL_RCC_CRC_CLK_ENABLE();
+    CRC->CR = CRC_CR_RESET;
+}
+
+/**
+  * @brief  Feed more words into the running CRC and return its value.
+  */
+uint32_t CRC32_Accumulate(const uint32_t *words, uint32_t count)
+{
+    uint32_t i;
+
+    for (i = 0U; i < count; i++)
+    {
+        CRC->DR = words[i];
+    }
+
+    return CRC->DR;
+}
+
+uint32_t CRC32_Compute(const uint32_t *words, uint32_t count)
+{
+    CRC32_Reset();
+    return CRC32_Accumulate(words, count);
+}
@@ -0,0 +1,227 @@
+/* Includes ------------------------------------------------------------------*/
+#include "flash_if.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define FLASH_IF_SMALL_END      0x08010000UL   /* end of the 16 KB sectors  */
+#define FLASH_IF_MID_END        0x08020000UL   /* end of the 64 KB sector   */
+
+#define FLASH_IF_ERROR_FLAGS    (FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR | \
+                                 FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR | FLASH_FLAG_PGSERR)
+
+#define FLASH_IF_SR_ERRORS      (FLASH_SR_SOP | FLASH_SR_WRPERR | FLASH_SR_PGAERR | \
+                                 FLASH_SR_PGPERR | FLASH_SR_PGSERR)
+
+/* 16 system exceptions + 97 peripheral IRQs, table aligned to 512 bytes */
+#define FLASH_IF_VECTOR_COUNT   113U
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t gRamVectors[FLASH_IF_VECTOR_COUNT] __attribute__((aligned(512)));
+
+/* Private function prototypes -----------------------------------------------*/
+static HAL_StatusTypeDef Flash_If_RamWait(void);
+static HAL_StatusTypeDef Flash_If_RamErase(uint32_t sector);
+static HAL_StatusTypeDef Flash_If_RamProgram(uint32_t addr, const uint32_t *words, uint32_t count);
+
+/* -------------------------------------------------------------------------- */
+/*                               Public API                                   */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Sector number containing @p addr.
+  */
+uint32_t Flash_If_GetSector(uint32_t addr)
+{
+    if (addr < FLASH_IF_SMALL_END)
+    {
+        return (addr - FLASH_IF_BASE) / 0x4000U;
+    }
+    if (addr < FLASH_IF_MID_END)
+    {
+        return 4U;
+    }
+    return 5U + ((addr - FLASH_IF_MID_END) / 0x20000U);
+}
+
+uint32_t Flash_If_GetSectorSize(uint32_t sector)
+{
+    if (sector < 4U)
+    {
+        return 0x4000U;
+    }
+    return (sector == 4U) ? 0x10000U : 0x20000U;
+}
+
+/**
+  * @brief  Move the vector table to SRAM so that exception entry does not
+  *         fetch from flash while it is busy.  Call once before any write.
+  */
+void Flash_If_Init(void)
+{
+    const uint32_t *src = (const uint32_t *)SCB->VTOR;
+    uint32_t i;
+
+    for (i = 0U; i < FLASH_IF_VECTOR_COUNT; i++)
+    {
+        gRamVectors[i] = src[i];
+    }
+
+    __disable_irq();
+    SCB->VTOR = (uint32_t)gRamVectors;
+    __DSB();
+    __enable_irq();
+}
+
+/**
+  * @brief  Erase one sector.  The CPU keeps running from SRAM for the
+  *         duration of the erase (typ. 250 ms for 16 KB, up to 2 s for
+  *         128 KB); only RAM-resident ISRs are served meanwhile.
+  */
+HAL_StatusTypeDef Flash_If_EraseSector(uint32_t sector)
+{
+    HAL_StatusTypeDef status;
+    uint32_t basepri = __get_BASEPRI();
+
+    HAL_FLASH_Unlock();
+    __HAL_FLASH_CLEAR_FLAG(FLASH_IF_ERROR_FLAGS);
+
+    __set_BASEPRI(FLASH_IF_BASEPRI << (8U - __NVIC_PRIO_BITS));
+    status = Flash_If_RamErase(sector);
+    __set_BASEPRI(basepri);
+
+    HAL_FLASH_Lock();
+
+    /* Stale lines of the erased sector may still sit in the data cache */
+    __HAL_FLASH_DATA_CACHE_DISABLE();
+    __HAL_FLASH_DATA_CACHE_RESET();
+    __HAL_FLASH_DATA_CACHE_ENABLE();
+
+    return status;
+}
+
+/**
+  * @brief  Program @p count words starting at word-aligned @p addr.
+  */
+HAL_StatusTypeDef Flash_If_Program(uint32_t addr, const uint32_t *words, uint32_t count)
+{
+    HAL_StatusTypeDef status;
+    uint32_t basepri = __get_BASEPRI();
+
+    HAL_FLASH_Unlock();
+    __HAL_FLASH_CLEAR_FLAG(FLASH_IF_ERROR_FLAGS);
+
+    __set_BASEPRI(FLASH_IF_BASEPRI << (8U - __NVIC_PRIO_BITS));
+    status = Flash_If_RamProgram(addr, words, count);
+    __set_BASEPRI(basepri);
+
+    HAL_FLASH_Lock();
+
+    return status;
+}
+
+HAL_StatusTypeDef Flash_If_ProgramWord(uint32_t addr, uint32_t word)
+{
+    return Flash_If_Program(addr, &word, 1U);
+}
+
+/**
+  * @brief  Non-zero if [addr, addr + len) reads as erased.
+  */
+uint32_t Flash_If_IsErased(uint32_t addr, uint32_t len)
+{
+    const volatile uint32_t *p = (const volatile uint32_t *)addr;
+    uint32_t i;
+
+    for (i = 0U; i < (len / 4U); i++)
+    {
+        if (p[i] != FLASH_IF_ERASED_WORD)
+        {
+            return 0U;
+        }
+    }
+
+    return 1U;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                 RAM-resident hot loops (.RamFunc section)                  */
+/* -------------------------------------------------------------------------- */
+/*
+ * Everything between setting STRT/PG and BSY clearing must run from SRAM:
+ * any instruction or literal fetch from the flash bank would stall the core
+ * until the operation completes.  Keep these free of HAL calls and of
+ * constant tables (which would land in .rodata).
+ */
+
+/**
+  * @brief  RAM copy of the weak HAL tick: SysTick runs at priority 0, above
+  *         BASEPRI, so it has to be fetchable during an erase.
+  */
+__RAM_FUNC void HAL_IncTick(void)
+{
+    uwTick += uwTickFreq;
+}
+
+static __RAM_FUNC HAL_StatusTypeDef Flash_If_RamWait(void)
+{
+    uint32_t sr;
+
+    while ((FLASH->SR & FLASH_SR_BSY) != 0U)
+    {
+    }
+
+    sr = FLASH->SR & FLASH_IF_SR_ERRORS;
+    if (sr != 0U)
+    {
+        FLASH->SR = sr;
+        return HAL_ERROR;
+    }
+
+    return HAL_OK;
+}
+
+static __RAM_FUNC HAL_StatusTypeDef Flash_If_RamErase(uint32_t sector)
+{
+    HAL_StatusTypeDef status;
+
+    FLASH->CR &= ~(FLASH_CR_PSIZE | FLASH_CR_SNB);
+    FLASH->CR |= FLASH_PSIZE_WORD | FLASH_CR_SER | (sector << FLASH_CR_SNB_Pos);
+    FLASH->CR |= FLASH_CR_STRT;
+
+    status = Flash_If_RamWait();
+
+    FLASH->CR &= ~(FLASH_CR_SER | FLASH_CR_SNB);
+
+    return status;
+}
+
+static __RAM_FUNC HAL_StatusTypeDef Flash_If_RamProgram(uint32_t addr, const uint32_t *words,
+                                                        uint32_t count)
+{
+    HAL_StatusTypeDef status = HAL_OK;
+    volatile uint32_t *dst = (volatile uint32_t *)addr;
+    uint32_t word;
+    uint32_t i;
+
+    FLASH->CR &= ~FLASH_CR_PSIZE;
+    FLASH->CR |= FLASH_PSIZE_WORD | FLASH_CR_PG;
+
+    for (i = 0U; (i < count) && (status == HAL_OK); i++)
+    {
+        /* Source may itself be flash (compaction): read it while not busy */
+        word   = words[i];
+        dst[i] = word;
+        __DSB();
+
+        status = Flash_If_RamWait();
+
+        /* Read back: catches words that were not erased beforehand */
+        if ((status == HAL_OK) && (dst[i] != word))
+        {
+            status = HAL_ERROR;
+        }
+    }
+
+    FLASH->CR &= ~FLASH_CR_PG;
+
+    return status;
+}
@@ -6,25 +6,65 @@
  */
 
 #include "main_app.h"
+#include "can_rx.h"
+#include "jitter.h"
+#include "can_lp.h"
+#include "uart_rx.h"
+#include "log.h"
+#include "trace.h"
+#include "crash_dump.h"
 
 extern CAN_HandleTypeDef hcan1;
 extern TIM_HandleTypeDef htimer6;
 extern void CAN1_Tx(uint8_t remote);
 
+/**
+  * @brief This function handles Hard fault interrupt.
+  */
+void HardFault_Handler(void)
+{
+	CRASH_DUMP_CAPTURE();
+}
+
+/**
+  * @brief This function handles Memory management fault.
+  */
+void MemManage_Handler(void)
+{
+	CRASH_DUMP_CAPTURE();
+}
+
+/**
+  * @brief This function handles Pre-fetch fault, memory access fault.
+  */
+void BusFault_Handler(void)
+{
+	CRASH_DUMP_CAPTURE();
+}
+
+/**
+  * @brief This function handles Undefined instruction or illegal state.
+  */
+void UsageFault_Handler(void)
+{
+	CRASH_DUMP_CAPTURE();
+}
+
 /**
   * @brief System Clock Configuration
   * @retval None
   */
-void SysTick_Handler (void)
+__RAM_FUNC void SysTick_Handler (void)
 {
+	/* Runs from SRAM so the tick keeps counting during flash writes;
+	 * HAL_SYSTICK_IRQHandler() only calls an unused weak callback */
 	HAL_IncTick();
-	HAL_SYSTICK_IRQHandler();
 }
 
 /**
   * @brief This function handles CAN_TX interrupts.
   */
-void CAN1_TX_IRQHandler(void)
+FASTCODE void CAN1_TX_IRQHandler(void)
 {
 	HAL_CAN_IRQHandler(&hcan1);
 }
@@ -32,15 +72,17 @@ void CAN1_TX_IRQHandler(void)
 /**
   * @brief This function handles CAN_RX0 interrupts.
   */
-void CAN1_RX0_IRQHandler(void)
+__RAM_FUNC void CAN1_RX0_IRQHandler(void)
 {
-	HAL_CAN_IRQHandler(&hcan1);
+	TRACE_ISR_ENTER();
+	CAN_Rx_IRQHandler();
+	TRACE_ISR_EXIT();
 }
 
 /**
   * @brief This function handles CAN SCE interrupt.
   */
-void CAN1_SCE_IRQHandler(void)
+FASTCODE void CAN1_SCE_IRQHandler(void)
 {
 	HAL_CAN_IRQHandler(&hcan1);
 }
@@ -48,9 +90,11 @@ void CAN1_SCE_IRQHandler(void)
 /**
   * @brief This function handles Timer 6 interrupt and DAC underrun interrupts.
   */
-void TIM6_DAC_IRQHandler(void)
+FASTCODE void TIM6_DAC_IRQHandler(void)
 {
+	TRACE_ISR_ENTER();
 	HAL_TIM_IRQHandler(&htimer6);
+	TRACE_ISR_EXIT();
 }
 
 /**
@@ -58,8 +102,53 @@ void TIM6_DAC_IRQHandler(void)
   */
 void EXTI15_10_IRQHandler(void)
 {
-	HAL_TIM_Base_Start_IT(&htimer6);
-	HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_13);
+	TRACE_ISR_ENTER();
+
+	/* Line 11: CAN1_RX activity while in STOP (can_lp.c) */
+	if ((EXTI->PR & EXTI_PR_PR11) != 0U)
+	{
+		CAN_Lp_WakeIRQHandler();
+	}
+
+	if ((EXTI->PR & EXTI_PR_PR13) != 0U)
+	{
+		HAL_TIM_Base_Start_IT(&htimer6);
+		HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_13);
+	}
+
+	TRACE_ISR_EXIT();
 }
 
+/**
+  * @brief This function handles USART2 global interrupt (IDLE line).
+  */
+__RAM_FUNC void USART2_IRQHandler(void)
+{
+	UART_Rx_IRQHandler();
+}
 
+/**
+  * @brief This function handles DMA1 stream5 global interrupt (USART2 RX).
+  */
+__RAM_FUNC void DMA1_Stream5_IRQHandler(void)
+{
+	UART_Rx_IRQHandler();
+}
+
+/**
+  * @brief This function handles DMA1 stream6 global interrupt (USART2 TX).
+  */
+void DMA1_Stream6_IRQHandler(void)
+{
+	Log_TxIRQHandler();
+}
+
+#ifdef JITTER_PROBE
+/**
+  * @brief This function handles Timer 7 interrupt (latency probe).
+  */
+FASTCODE void TIM7_IRQHandler(void)
+{
+	Jitter_IRQHandler();
+}
+#endif
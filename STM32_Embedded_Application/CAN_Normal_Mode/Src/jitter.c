@@ -0,0 +1,88 @@
+/* Includes ------------------------------------------------------------------*/
+#include "jitter.h"
+#include "timer_clock.h"
+
+/* Private variables ---------------------------------------------------------*/
+static volatile uint32_t gSamples;
+static volatile uint32_t gMin = 0xFFFFFFFFUL;
+static volatile uint32_t gMax;
+static volatile uint32_t gSum;
+static uint32_t gTimerClock;
+
+/* -------------------------------------------------------------------------- */
+/*                               Public API                                   */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Start TIM7 at JITTER_RATE_HZ with its update interrupt enabled.
+  */
+void Jitter_Init(void)
+{
+    gTimerClock = Timer_Clock_Get(TIM7);
+
+    __HAL_RCC_TIM7_CLK_ENABLE();
+
+    TIM7->CR1  = 0U;
+    TIM7->PSC  = 0U;
+    TIM7->ARR  = (gTimerClock / JITTER_RATE_HZ) - 1U;
+    TIM7->EGR  = TIM_EGR_UG;
+    TIM7->SR   = 0U;
+    TIM7->DIER = TIM_DIER_UIE;
+
+    Jitter_Reset();
+
+    HAL_NVIC_SetPriority(TIM7_IRQn, JITTER_IRQ_PRIORITY, 0U);
+    HAL_NVIC_EnableIRQ(TIM7_IRQn);
+
+    TIM7->CR1 = TIM_CR1_CEN;
+}
+
+void Jitter_Reset(void)
+{
+    __disable_irq();
+    gSamples = 0U;
+    gMin     = 0xFFFFFFFFUL;
+    gMax     = 0U;
+    gSum     = 0U;
+    __enable_irq();
+}
+
+void Jitter_GetStats(Jitter_StatsTypeDef *stats)
+{
+    __disable_irq();
+    stats->samples   = gSamples;
+    stats->minTicks  = (gSamples != 0U) ? gMin : 0U;
+    stats->maxTicks  = gMax;
+    stats->meanTicks = (gSamples != 0U) ? (gSum / gSamples) : 0U;
+    __enable_irq();
+
+    stats->timerHz = gTimerClock;
+}
+
+/**
+  * @brief  Update interrupt.  Reads the counter before anything else.
+  */
+FASTCODE void Jitter_IRQHandler(void)
+{
+    uint32_t ticks = TIM7->CNT;
+
+    TIM7->SR = 0U;
+
+    if (ticks < gMin)
+    {
+        gMin = ticks;
+    }
+    if (ticks > gMax)
+    {
+        gMax = ticks;
+    }
+
+    /* 64k samples of at most ARR ticks each cannot overflow the sum */
+    if (gSamples >= 0x10000UL)
+    {
+        gSamples = 0U;
+        gSum     = 0U;
+    }
+    gSum += ticks;
+    gSamples++;
+}
@@ -0,0 +1,694 @@
+/* Includes ------------------------------------------------------------------*/
+#include "kvstore.h"
+#include "flash_if.h"
+#include "crc32.h"
+#include <stddef.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define KV_MAGIC                0x4B565331UL    /* "KVS1" */
+#define KV_STATE_VALID          0x00000000UL    /* COPYING while still erased */
+
+#define KV_HDR_SIZE             16U
+#define KV_REC_HDR_SIZE         8U
+#define KV_TOMBSTONE            0x8000U
+#define KV_LEN_MASK             0x7FFFU
+
+#define KV_INDEX_SIZE           64U             /* power of two > KV_MAX_KEYS */
+#define KV_COPY_PER_STEP        4U              /* records per KV_Idle() call */
+
+/* Background compaction once the sector is this full and at least a
+ * quarter of it is dead */
+#define KV_COMPACT_USED_PCT     75U
+
+#define KV_ALIGN4(n)            (((n) + 3U) & ~3U)
+#define KV_REC_SIZE(len)        (KV_REC_HDR_SIZE + KV_ALIGN4(len))
+
+/* Private types -------------------------------------------------------------*/
+typedef struct
+{
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t state;
+    uint32_t reserved;
+} KV_SectorHdrTypeDef;
+
+typedef enum
+{
+    KV_SECTOR_BLANK = 0,
+    KV_SECTOR_COPYING,
+    KV_SECTOR_VALID,
+    KV_SECTOR_GARBAGE
+} KV_SectorStateTypeDef;
+
+typedef struct
+{
+    uint16_t key;
+    uint16_t len;
+    uint32_t addr;
+} KV_IndexEntryTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+extern uint32_t _skvstore;
+extern uint32_t _ekvstore;
+
+static KV_IndexEntryTypeDef gIndex[KV_INDEX_SIZE];
+static uint32_t gKeys;
+
+static uint32_t gSectorSize;
+static uint32_t gActive;            /* base address of the active sector     */
+static uint32_t gOther;
+static uint32_t gWritePos;
+static uint32_t gSeq;
+static uint32_t gLiveBytes;
+static uint32_t gOtherDirty;        /* other sector still needs an erase     */
+static uint32_t gTorn;
+
+/* Incremental compaction */
+static uint32_t gCompacting;
+static uint32_t gCopySlot;
+static uint32_t gCopyPos;
+
+/* Private function prototypes -----------------------------------------------*/
+static KV_SectorStateTypeDef KV_SectorState(uint32_t base);
+static HAL_StatusTypeDef     KV_Format(uint32_t base, uint32_t seq, uint32_t valid);
+static void                  KV_Scan(void);
+static HAL_StatusTypeDef     KV_WriteRecord(uint16_t key, uint16_t lenField,
+                                            const uint8_t *value, uint16_t len);
+static uint32_t              KV_RecordCrc(uint32_t word0, const uint8_t *value, uint16_t len);
+static HAL_StatusTypeDef     KV_CompactStart(void);
+static HAL_StatusTypeDef     KV_CompactStep(uint32_t maxRecords);
+static HAL_StatusTypeDef     KV_CompactFinish(void);
+static HAL_StatusTypeDef     KV_CompactNow(void);
+static int32_t               KV_IndexFind(uint16_t key);
+static HAL_StatusTypeDef     KV_IndexSet(uint16_t key, uint16_t len, uint32_t addr);
+static void                  KV_IndexRemove(uint16_t key);
+
+/* -------------------------------------------------------------------------- */
+/*                               Public API                                   */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Pick the valid sector with the newest sequence number and rebuild
+  *         the index from its log.  Formats the store on first use.
+  */
+HAL_StatusTypeDef KV_Init(void)
+{
+    uint32_t base0 = (uint32_t)&_skvstore;
+    uint32_t base1;
+    KV_SectorStateTypeDef st0;
+    KV_SectorStateTypeDef st1;
+    uint32_t seq0;
+    uint32_t seq1;
+
+    gSectorSize = ((uint32_t)&_ekvstore - base0) / 2U;
+    base1       = base0 + gSectorSize;
+
+    st0  = KV_SectorState(base0);
+    st1  = KV_SectorState(base1);
+    seq0 = ((const KV_SectorHdrTypeDef *)base0)->seq;
+    seq1 = ((const KV_SectorHdrTypeDef *)base1)->seq;
+
+    gCompacting = 0U;
+    gTorn       = 0U;
+
+    if ((st0 == KV_SECTOR_VALID) &&
+        ((st1 != KV_SECTOR_VALID) || ((int32_t)(seq0 - seq1) > 0)))
+    {
+        gActive = base0;
+        gOther  = base1;
+        gSeq    = seq0;
+    }
+    else if (st1 == KV_SECTOR_VALID)
+    {
+        gActive = base1;
+        gOther  = base0;
+        gSeq    = seq1;
+    }
+    else
+    {
+        /* Nothing valid: first use or wiped */
+        gActive = base0;
+        gOther  = base1;
+        gSeq    = 1U;
+        if (KV_Format(gActive, gSeq, 1U) != HAL_OK)
+        {
+            return HAL_ERROR;
+        }
+    }
+
+    /* An interrupted compaction or the previous generation: erase later */
+    gOtherDirty = (KV_SectorState(gOther) != KV_SECTOR_BLANK) ? 1U : 0U;
+
+    KV_Scan();
+
+    return HAL_OK;
+}
+
+/**
+  * @brief  Store @p len bytes under @p key, replacing any previous value.
+  *         Rewriting an identical value costs no flash write.
+  */
+HAL_StatusTypeDef KV_Put(uint16_t key, const void *value, uint16_t len)
+{
+    int32_t slot;
+    uint32_t size = KV_REC_SIZE(len);
+
+    if ((key == KV_KEY_INVALID) || (len > KV_MAX_VALUE_LEN))
+    {
+        return HAL_ERROR;
+    }
+
+    slot = KV_IndexFind(key);
+    if (slot >= 0)
+    {
+        if ((gIndex[slot].len == len) &&
+            (memcmp((const void *)(gIndex[slot].addr + KV_REC_HDR_SIZE), value, len) == 0))
+        {
+            return HAL_OK;
+        }
+    }
+    else if (gKeys >= KV_MAX_KEYS)
+    {
+        return HAL_ERROR;
+    }
+
+    /* The copy in progress must not miss this update */
+    if (gCompacting != 0U)
+    {
+        if (KV_CompactFinish() != HAL_OK)
+        {
+            return HAL_ERROR;
+        }
+    }
+
+    if ((gWritePos + size) > (gActive + gSectorSize))
+    {
+        if ((KV_CompactNow() != HAL_OK) ||
+            ((gWritePos + size) > (gActive + gSectorSize)))
+        {
+            return HAL_ERROR;
+        }
+    }
+
+    return KV_WriteRecord(key, len, (const uint8_t *)value, len);
+}
+
+/**
+  * @brief  Copy the value of @p key into @p value.
+  * @param  size: capacity of @p value
+  * @param  len:  set to the stored length (may be NULL)
+  * @retval HAL_ERROR if the key is missing or @p size is too small
+  */
+HAL_StatusTypeDef KV_Get(uint16_t key, void *value, uint16_t size, uint16_t *len)
+{
+    int32_t slot = KV_IndexFind(key);
+
+    if (slot < 0)
+    {
+        return HAL_ERROR;
+    }
+
+    if (len != NULL)
+    {
+        *len = gIndex[slot].len;
+    }
+
+    if (gIndex[slot].len > size)
+    {
+        return HAL_ERROR;
+    }
+
+    memcpy(value, (const void *)(gIndex[slot].addr + KV_REC_HDR_SIZE), gIndex[slot].len);
+
+    return HAL_OK;
+}
+
+/**
+  * @brief  Remove @p key by appending a tombstone record.
+  */
+HAL_StatusTypeDef KV_Delete(uint16_t key)
+{
+    if (KV_IndexFind(key) < 0)
+    {
+        return HAL_ERROR;
+    }
+
+    if (gCompacting != 0U)
+    {
+        if (KV_CompactFinish() != HAL_OK)
+        {
+            return HAL_ERROR;
+        }
+    }
+
+    if ((gWritePos + KV_REC_HDR_SIZE) > (gActive + gSectorSize))
+    {
+        if ((KV_CompactNow() != HAL_OK) ||
+            ((gWritePos + KV_REC_HDR_SIZE) > (gActive + gSectorSize)))
+        {
+            return HAL_ERROR;
+        }
+    }
+
+    return KV_WriteRecord(key, KV_TOMBSTONE, NULL, 0U);
+}
+
+/**
+  * @brief  Background housekeeping, one bounded step per call: erase the
+  *         spare sector, or copy a few records of a running compaction.
+  *         Call from the idle loop.
+  */
+void KV_Idle(void)
+{
+    uint32_t used = gWritePos - gActive;
+
+    /* Never while compacting: the spare sector is then the copy target */
+    if ((gOtherDirty != 0U) && (gCompacting == 0U))
+    {
+        if (Flash_If_EraseSector(Flash_If_GetSector(gOther)) == HAL_OK)
+        {
+            gOtherDirty = 0U;
+        }
+        return;
+    }
+
+    if (gCompacting == 0U)
+    {
+        if (((used * 100U) >= (gSectorSize * KV_COMPACT_USED_PCT)) &&
+            ((used - gLiveBytes) >= (gSectorSize / 4U)))
+        {
+            (void)KV_CompactStart();
+        }
+        return;
+    }
+
+    if (KV_CompactStep(KV_COPY_PER_STEP) != HAL_OK)
+    {
+        /* Give up this round; the half-written copy is erased next time */
+        gCompacting = 0U;
+        gOtherDirty = 1U;
+        KV_Scan();                  /* index pointed into the dead copy      */
+    }
+    else if (gCopySlot >= KV_INDEX_SIZE)
+    {
+        (void)KV_CompactFinish();
+    }
+}
+
+void KV_GetStats(KV_StatsTypeDef *stats)
+{
+    stats->keys        = gKeys;
+    stats->usedBytes   = gWritePos - gActive;
+    stats->liveBytes   = gLiveBytes + KV_HDR_SIZE;
+    stats->freeBytes   = (gActive + gSectorSize) - gWritePos;
+    stats->generation  = gSeq - 1U;
+    stats->tornRecords = gTorn;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                              Local helpers                                 */
+/* -------------------------------------------------------------------------- */
+
+static KV_SectorStateTypeDef KV_SectorState(uint32_t base)
+{
+    const KV_SectorHdrTypeDef *hdr = (const KV_SectorHdrTypeDef *)base;
+
+    if (hdr->magic == FLASH_IF_ERASED_WORD)
+    {
+        return Flash_If_IsErased(base, gSectorSize) ? KV_SECTOR_BLANK : KV_SECTOR_GARBAGE;
+    }
+    if (hdr->magic != KV_MAGIC)
+    {
+        return KV_SECTOR_GARBAGE;
+    }
+    if (hdr->state == KV_STATE_VALID)
+    {
+        return KV_SECTOR_VALID;
+    }
+    return (hdr->state == FLASH_IF_ERASED_WORD) ? KV_SECTOR_COPYING : KV_SECTOR_GARBAGE;
+}
+
+/**
+  * @brief  Erase (if needed) and write a sector header; the state word is
+  *         left erased (COPYING) unless @p valid is set.
+  */
+static HAL_StatusTypeDef KV_Format(uint32_t base, uint32_t seq, uint32_t valid)
+{
+    uint32_t hdr[2];
+
+    if (Flash_If_IsErased(base, gSectorSize) == 0U)
+    {
+        if (Flash_If_EraseSector(Flash_If_GetSector(base)) != HAL_OK)
+        {
+            return HAL_ERROR;
+        }
+    }
+
+    hdr[0] = KV_MAGIC;
+    hdr[1] = seq;
+    if (Flash_If_Program(base, hdr, 2U) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (valid != 0U)
+    {
+        return Flash_If_ProgramWord(base + offsetof(KV_SectorHdrTypeDef, state), KV_STATE_VALID);
+    }
+
+    return HAL_OK;
+}
+
+/**
+  * @brief  Replay the active log into the index.  Stops at the first erased
+  *         word or at a record that fails its checks; in the latter case the
+  *         sector is treated as full so nothing is ever programmed on top of
+  *         a partially written word.
+  */
+static void KV_Scan(void)
+{
+    uint32_t end = gActive + gSectorSize;
+    uint32_t pos = gActive + KV_HDR_SIZE;
+    uint32_t word0;
+    uint16_t key;
+    uint16_t lenField;
+    uint16_t len;
+    uint32_t size;
+    int32_t  slot;
+
+    memset(gIndex, 0xFF, sizeof(gIndex));
+    gKeys      = 0U;
+    gLiveBytes = 0U;
+
+    while ((pos + KV_REC_HDR_SIZE) <= end)
+    {
+        word0 = *(const uint32_t *)pos;
+        if (word0 == FLASH_IF_ERASED_WORD)
+        {
+            gWritePos = pos;
+            return;
+        }
+
+        key      = (uint16_t)word0;
+        lenField = (uint16_t)(word0 >> 16);
+        len      = lenField & KV_LEN_MASK;
+        size     = KV_REC_SIZE(len);
+
+        if ((key == KV_KEY_INVALID) || (len > KV_MAX_VALUE_LEN) || ((pos + size) > end) ||
+            (*(const uint32_t *)(pos + 4U) != KV_RecordCrc(word0, (const uint8_t *)(pos + KV_REC_HDR_SIZE), len)))
+        {
+            break;
+        }
+
+        slot = KV_IndexFind(key);
+        if (slot >= 0)
+        {
+            gLiveBytes -= KV_REC_SIZE(gIndex[slot].len);
+        }
+
+        if ((lenField & KV_TOMBSTONE) != 0U)
+        {
+            KV_IndexRemove(key);
+        }
+        else if (KV_IndexSet(key, len, pos) == HAL_OK)
+        {
+            gLiveBytes += size;
+        }
+
+        pos += size;
+    }
+
+    if (pos < end)
+    {
+        gTorn++;
+    }
+    gWritePos = end;
+}
+
+/**
+  * @brief  Append one record at gWritePos: header, value, CRC last.
+  */
+static HAL_StatusTypeDef KV_WriteRecord(uint16_t key, uint16_t lenField,
+                                        const uint8_t *value, uint16_t len)
+{
+    uint32_t addr  = gWritePos;
+    uint32_t word0 = (uint32_t)key | ((uint32_t)lenField << 16);
+    uint32_t crc   = KV_RecordCrc(word0, value, len);
+    uint32_t word;
+    uint32_t i;
+    int32_t  slot;
+    HAL_StatusTypeDef status;
+
+    /* Whatever happens from here on, this space is used */
+    gWritePos += KV_REC_SIZE(len);
+
+    status = Flash_If_ProgramWord(addr, word0);
+
+    for (i = 0U; (i < len) && (status == HAL_OK); i += 4U)
+    {
+        word = FLASH_IF_ERASED_WORD;
+        memcpy(&word, &value[i], ((len - i) < 4U) ? (len - i) : 4U);
+        status = Flash_If_ProgramWord(addr + KV_REC_HDR_SIZE + i, word);
+    }
+
+    if (status == HAL_OK)
+    {
+        status = Flash_If_ProgramWord(addr + 4U, crc);
+    }
+
+    if (status != HAL_OK)
+    {
+        /* The boot scan stops at this record; nothing may follow it */
+        gWritePos = gActive + gSectorSize;
+        return status;
+    }
+
+    slot = KV_IndexFind(key);
+    if (slot >= 0)
+    {
+        gLiveBytes -= KV_REC_SIZE(gIndex[slot].len);
+    }
+
+    if ((lenField & KV_TOMBSTONE) != 0U)
+    {
+        KV_IndexRemove(key);
+        return HAL_OK;
+    }
+
+    gLiveBytes += KV_REC_SIZE(len);
+    return KV_IndexSet(key, len, addr);
+}
+
+/**
+  * @brief  CRC over word 0 and the value padded with 0xFF to a whole word.
+  */
+static uint32_t KV_RecordCrc(uint32_t word0, const uint8_t *value, uint16_t len)
+{
+    uint32_t crc;
+    uint32_t word;
+    uint32_t i;
+
+    CRC32_Reset();
+    crc = CRC32_Accumulate(&word0, 1U);
+
+    for (i = 0U; i < len; i += 4U)
+    {
+        word = FLASH_IF_ERASED_WORD;
+        memcpy(&word, &value[i], ((len - i) < 4U) ? (len - i) : 4U);
+        crc = CRC32_Accumulate(&word, 1U);
+    }
+
+    return crc;
+}
+
+/**
+  * @brief  Open the spare sector as the next generation (state COPYING).
+  */
+static HAL_StatusTypeDef KV_CompactStart(void)
+{
+    if (gOtherDirty != 0U)
+    {
+        if (Flash_If_EraseSector(Flash_If_GetSector(gOther)) != HAL_OK)
+        {
+            return HAL_ERROR;
+        }
+        gOtherDirty = 0U;
+    }
+
+    if (KV_Format(gOther, gSeq + 1U, 0U) != HAL_OK)
+    {
+        gOtherDirty = 1U;
+        return HAL_ERROR;
+    }
+
+    gCompacting = 1U;
+    gCopySlot   = 0U;
+    gCopyPos    = gOther + KV_HDR_SIZE;
+
+    return HAL_OK;
+}
+
+/**
+  * @brief  Copy up to @p maxRecords live records verbatim, CRC included.
+  */
+static HAL_StatusTypeDef KV_CompactStep(uint32_t maxRecords)
+{
+    uint32_t size;
+
+    while ((gCopySlot < KV_INDEX_SIZE) && (maxRecords != 0U))
+    {
+        if (gIndex[gCopySlot].key != KV_KEY_INVALID)
+        {
+            size = KV_REC_SIZE(gIndex[gCopySlot].len);
+
+            if (Flash_If_Program(gCopyPos, (const uint32_t *)gIndex[gCopySlot].addr,
+                                 size / 4U) != HAL_OK)
+            {
+                return HAL_ERROR;
+            }
+
+            gIndex[gCopySlot].addr = gCopyPos;
+            gCopyPos += size;
+            maxRecords--;
+        }
+        gCopySlot++;
+    }
+
+    return HAL_OK;
+}
+
+/**
+  * @brief  Copy what is left, promote the new sector and retire the old one.
+  */
+static HAL_StatusTypeDef KV_CompactFinish(void)
+{
+    if (KV_CompactStep(KV_INDEX_SIZE) != HAL_OK)
+    {
+        gCompacting = 0U;
+        gOtherDirty = 1U;
+        KV_Scan();                  /* index pointed into the dead copy      */
+        return HAL_ERROR;
+    }
+
+    /* Commit point: from here on the new sector wins at boot */
+    if (Flash_If_ProgramWord(gOther + offsetof(KV_SectorHdrTypeDef, state),
+                             KV_STATE_VALID) != HAL_OK)
+    {
+        gCompacting = 0U;
+        gOtherDirty = 1U;
+        KV_Scan();
+        return HAL_ERROR;
+    }
+
+    gCompacting = 0U;
+    gSeq++;
+    gWritePos   = gCopyPos;
+    gLiveBytes  = gCopyPos - gOther - KV_HDR_SIZE;
+    gCopyPos    = gActive;
+    gActive     = gOther;
+    gOther      = gCopyPos;
+    gOtherDirty = 1U;               /* old generation, erased from KV_Idle() */
+
+    return HAL_OK;
+}
+
+static HAL_StatusTypeDef KV_CompactNow(void)
+{
+    if ((gCompacting == 0U) && (KV_CompactStart() != HAL_OK))
+    {
+        return HAL_ERROR;
+    }
+
+    return KV_CompactFinish();
+}
+
+/* ---------------------------- Hash index ---------------------------------- */
+
+static uint32_t KV_IndexHash(uint16_t key)
+{
+    /* Fibonacci hashing into KV_INDEX_SIZE (64) slots */
+    return (uint32_t)((uint32_t)key * 2654435761UL) >> 26;
+}
+
+static int32_t KV_IndexFind(uint16_t key)
+{
+    uint32_t slot = KV_IndexHash(key);
+    uint32_t n;
+
+    for (n = 0U; n < KV_INDEX_SIZE; n++)
+    {
+        if (gIndex[slot].key == key)
+        {
+            return (int32_t)slot;
+        }
+        if (gIndex[slot].key == KV_KEY_INVALID)
+        {
+            break;
+        }
+        slot = (slot + 1U) & (KV_INDEX_SIZE - 1U);
+    }
+
+    return -1;
+}
+
+static HAL_StatusTypeDef KV_IndexSet(uint16_t key, uint16_t len, uint32_t addr)
+{
+    uint32_t slot = KV_IndexHash(key);
+
+    while ((gIndex[slot].key != KV_KEY_INVALID) && (gIndex[slot].key != key))
+    {
+        slot = (slot + 1U) & (KV_INDEX_SIZE - 1U);
+    }
+
+    if (gIndex[slot].key == KV_KEY_INVALID)
+    {
+        if (gKeys >= KV_MAX_KEYS)
+        {
+            return HAL_ERROR;
+        }
+        gKeys++;
+    }
+
+    gIndex[slot].key  = key;
+    gIndex[slot].len  = len;
+    gIndex[slot].addr = addr;
+
+    return HAL_OK;
+}
+
+/**
+  * @brief  Linear-probing delete with backward shift, so lookups never need
+  *         tombstones in the index.
+  */
+static void KV_IndexRemove(uint16_t key)
+{
+    int32_t  found = KV_IndexFind(key);
+    uint32_t hole;
+    uint32_t next;
+    uint32_t home;
+
+    if (found < 0)
+    {
+        return;
+    }
+
+    hole = (uint32_t)found;
+    next = (hole + 1U) & (KV_INDEX_SIZE - 1U);
+
+    while (gIndex[next].key != KV_KEY_INVALID)
+    {
+        home = KV_IndexHash(gIndex[next].key);
+
+        /* Move the entry back if its home is not in (hole, next] */
+        if (((next - home) & (KV_INDEX_SIZE - 1U)) >= ((next - hole) & (KV_INDEX_SIZE - 1U)))
+        {
+            gIndex[hole] = gIndex[next];
+            hole = next;
+        }
+        next = (next + 1U) & (KV_INDEX_SIZE - 1U);
+    }
+
+    gIndex[hole].key = KV_KEY_INVALID;
+    gKeys--;
+}
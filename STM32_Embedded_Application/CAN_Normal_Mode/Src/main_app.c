@@ -1,6 +1,19 @@
 
 
 #include "main_app.h"
+#include "kvstore.h"
+#include "flash_if.h"
+#include "can_rx.h"
+#include "can_update.h"
+#include "boot_ctrl.h"
+#include "stack_mon.h"
+#include "jitter.h"
+#include "can_lp.h"
+#include "crash_dump.h"
+#include "uart_rx.h"
+#include "shell.h"
+#include "log.h"
+#include "trace.h"
 #include "stm32f4xx_hal.h"
 #include <string.h>
 #include <stdio.h>
@@ -9,14 +22,48 @@
 extern UART_HandleTypeDef huart2;
 extern CAN_HandleTypeDef  hcan1;
 
+/* Settings loaded from the key-value store */
+static uint32_t gBootCount;
+static uint32_t gTxId = CAN_APP_DEFAULT_TX_ID;
+static uint32_t gFilterId;                  /* bank 0, 0/0 accepts all       */
+static uint32_t gFilterMask;
+
+/* Tick of the last received frame, for the low-power idle timeout */
+static uint32_t gLastRxTick;
+
+/* Trace task ids (trace.h) */
+#define CAN_APP_TASK_FRAME      1U
+#define CAN_APP_TASK_SHELL      2U
+
 /* Local helpers */
 static void CAN_AppConfigFilter(void);
+static HAL_StatusTypeDef CAN_AppSetFilter(uint32_t bank, uint32_t id, uint32_t mask);
 static void CAN_AppSendInitialFrame(void);
+static void CAN_AppLoadSettings(void);
+static void CAN_AppHandleFrame(const CAN_Rx_FrameTypeDef *frame);
+static void CAN_AppReportStack(void);
+static void CAN_AppReportJitter(void);
+static HAL_StatusTypeDef CAN_AppCmdFilter(uint32_t argc, char *argv[]);
+static HAL_StatusTypeDef CAN_AppCmdTxId(uint32_t argc, char *argv[]);
+#ifdef TRACE_RECORDER
+static HAL_StatusTypeDef CAN_AppCmdTrace(uint32_t argc, char *argv[]);
+#endif
 
-/* Small UART print helper */
+/* Console commands, on top of the shell built-ins */
+static const Shell_CommandTypeDef gCommands[] =
+{
+    { "filter", "[<id> <mask>]  standard IDs, 0 0 accepts all", CAN_AppCmdFilter },
+    { "txid",   "[<id>]",                                        CAN_AppCmdTxId   },
+#ifdef TRACE_RECORDER
+    { "trace",  "",                                              CAN_AppCmdTrace  },
+#endif
+};
+
+/* Small UART print helper, also used from the CAN callbacks: queued on the
+ * log channel, never blocks in an ISR */
 static void CAN_AppPrint(const char *text)
 {
-    HAL_UART_Transmit(&huart2, (uint8_t *)text, strlen(text), HAL_MAX_DELAY);
+    (void)Log_Write(text, strlen(text));
 }
 
 /*
@@ -24,7 +71,27 @@ static void CAN_AppPrint(const char *text)
  */
 void CAN_AppInit(void)
 {
-    /* Configure basic filter: accept all IDs into FIFO0 */
+    /* Record left by a fault in the previous run, if any */
+    Crash_Dump_Report(&huart2);
+
+    /* From here on every USART2 byte goes through the log channel */
+    (void)Log_Init(&huart2);
+#ifdef LOG_BENCH
+    Log_Bench();
+#endif
+
+#ifdef TRACE_RECORDER
+    Trace_Init();
+    Trace_NameTask(CAN_APP_TASK_FRAME, "frame");
+    Trace_NameTask(CAN_APP_TASK_SHELL, "shell");
+#endif
+
+    /* Vector table to SRAM before the first flash write */
+    Flash_If_Init();
+
+    CAN_AppLoadSettings();
+
+    /* Application filter from the settings, service IDs always */
     CAN_AppConfigFilter();
 
     /* Enable some CAN interrupts: TX, RX FIFO0, Bus-off */
@@ -36,6 +103,11 @@ void CAN_AppInit(void)
         Error_Handler();
     }
 
+#ifdef CAN_LOW_POWER
+    /* AWUM and the PA11 wake-up line, while still in init mode */
+    CAN_Lp_Init();
+#endif
+
     /* Start CAN peripheral */
     if (HAL_CAN_Start(&hcan1) != HAL_OK)
     {
@@ -44,6 +116,25 @@ void CAN_AppInit(void)
 
     /* Send one test frame at startup */
     CAN_AppSendInitialFrame();
+
+    /* Up and talking: keep the bootloader from rolling this image back */
+    if (Boot_Ctrl_Confirm() != HAL_OK)
+    {
+        CAN_AppPrint("Boot confirm failed\r\n");
+    }
+
+#ifdef JITTER_PROBE
+    Jitter_Init();
+#endif
+
+    /* Command console on USART2 RX, received through flash writes too.
+     * Raised only now: Log_Init() gave the TX stream the old priority, and
+     * its handler runs from flash */
+    HAL_NVIC_SetPriority(USART2_IRQn, UART_RX_IRQ_PRIORITY, 0U);
+    if (UART_Rx_Start(&huart2) == HAL_OK)
+    {
+        Shell_Init(&huart2, gCommands, sizeof(gCommands) / sizeof(gCommands[0]));
+    }
 }
 
 /*
@@ -52,31 +143,181 @@ void CAN_AppInit(void)
  */
 void CAN_AppTask(void)
 {
-    /* In a real project you could blink an LED, check flags, etc. */
+    CAN_Rx_FrameTypeDef frame;
+
+    while (CAN_Rx_Pop(&frame) != 0U)
+    {
+        TRACE_TASK_BEGIN(CAN_APP_TASK_FRAME);
+        gLastRxTick = HAL_GetTick();
+
+        if ((CAN_Upd_HandleFrame(&frame) == 0U) && (CAN_Lp_HandleFrame(&frame) == 0U))
+        {
+            CAN_AppHandleFrame(&frame);
+        }
+        TRACE_TASK_END(CAN_APP_TASK_FRAME);
+    }
+
+    /* Erase / compact the settings store; CAN RX keeps running meanwhile */
+    KV_Idle();
+
+    CAN_AppReportStack();
+    CAN_AppReportJitter();
+
+    /* Traced only with input pending: idle polls would flood the ring */
+    if (UART_Rx_Available() != 0U)
+    {
+        TRACE_TASK_BEGIN(CAN_APP_TASK_SHELL);
+        (void)Shell_Process();
+        TRACE_TASK_END(CAN_APP_TASK_SHELL);
+    }
+
+#ifdef CAN_LOW_POWER
+    /* Bus quiet and no update in flight: sleep until the next SOF */
+    if (((HAL_GetTick() - gLastRxTick) >= CAN_LP_IDLE_MS) &&
+        (CAN_Upd_GetState() != CAN_UPD_RECEIVING))
+    {
+        CAN_Lp_Enter();
+        gLastRxTick = HAL_GetTick();
+    }
+#endif
 }
 
 /* -------------------- Local functions -------------------- */
 
+/*
+ * Bank 0: application filter (console "filter"), accepts all by default.
+ * Bank 1: service IDs 0x600-0x7FF, always on: update agent (0x600-0x6FF
+ * data, 0x7E0 commands) and the low-power bench on 0x7F0.
+ */
 static void CAN_AppConfigFilter(void)
+{
+    if ((CAN_AppSetFilter(0U, gFilterId, gFilterMask) != HAL_OK) ||
+        (CAN_AppSetFilter(1U, 0x600U, 0x600U) != HAL_OK))
+    {
+        Error_Handler();
+    }
+}
+
+/* One 32-bit ID/mask bank for standard IDs, into FIFO0 */
+static HAL_StatusTypeDef CAN_AppSetFilter(uint32_t bank, uint32_t id, uint32_t mask)
 {
     CAN_FilterTypeDef filter;
 
     memset(&filter, 0, sizeof(filter));
 
     filter.FilterActivation    = ENABLE;
-    filter.FilterBank          = 0;
+    filter.FilterBank          = bank;
     filter.FilterFIFOAssignment= CAN_RX_FIFO0;
-    filter.FilterIdHigh        = 0x0000;
+    filter.FilterIdHigh        = (id & 0x7FFU) << 5;
     filter.FilterIdLow         = 0x0000;
-    filter.FilterMaskIdHigh    = 0x0000;
+    filter.FilterMaskIdHigh    = (mask & 0x7FFU) << 5;
     filter.FilterMaskIdLow     = 0x0000;
     filter.FilterMode          = CAN_FILTERMODE_IDMASK;
     filter.FilterScale         = CAN_FILTERSCALE_32BIT;
+    /* Banks 0-13 to CAN1: 0 here would leave CAN1 without any bank */
+    filter.SlaveStartFilterBank = 14;
+
+    return HAL_CAN_ConfigFilter(&hcan1, &filter);
+}
+
+static void CAN_AppLoadSettings(void)
+{
+    char msg[64];
+    uint16_t txId;
+    uint16_t filter[2];
+    KV_StatsTypeDef stats;
 
-    if (HAL_CAN_ConfigFilter(&hcan1, &filter) != HAL_OK)
+    if (KV_Init() != HAL_OK)
     {
-        Error_Handler();
+        CAN_AppPrint("KV store init failed\r\n");
+        return;
+    }
+
+    if (KV_Get(KV_KEY_BOOT_COUNT, &gBootCount, sizeof(gBootCount), NULL) != HAL_OK)
+    {
+        gBootCount = 0U;
+    }
+    gBootCount++;
+    (void)KV_Put(KV_KEY_BOOT_COUNT, &gBootCount, sizeof(gBootCount));
+
+    if (KV_Get(KV_KEY_CAN_TX_ID, &txId, sizeof(txId), NULL) == HAL_OK)
+    {
+        gTxId = txId & 0x7FFU;
+    }
+
+    if (KV_Get(KV_KEY_CAN_FILTER, filter, sizeof(filter), NULL) == HAL_OK)
+    {
+        gFilterId   = filter[0] & 0x7FFU;
+        gFilterMask = filter[1] & 0x7FFU;
+    }
+
+    KV_GetStats(&stats);
+    snprintf(msg, sizeof(msg), "Boot #%lu, TX ID 0x%03lX, KV %lu/%lu B, torn %lu\r\n",
+             (unsigned long)gBootCount, (unsigned long)gTxId,
+             (unsigned long)stats.usedBytes,
+             (unsigned long)(stats.usedBytes + stats.freeBytes),
+             (unsigned long)stats.tornRecords);
+    CAN_AppPrint(msg);
+}
+
+/* Print the MSP high-water mark whenever it grows, checked once a second */
+static void CAN_AppReportStack(void)
+{
+    static uint32_t lastCheck;
+    static uint32_t lastHighWater;
+    Stack_Mon_StatsTypeDef stats;
+    char msg[64];
+
+    if ((HAL_GetTick() - lastCheck) < 1000U)
+    {
+        return;
+    }
+    lastCheck = HAL_GetTick();
+
+    Stack_Mon_GetStats(&stats);
+    if (stats.highWater <= lastHighWater)
+    {
+        return;
+    }
+    lastHighWater = stats.highWater;
+
+    snprintf(msg, sizeof(msg), "Stack high-water: %lu of %lu B reserved%s\r\n",
+             (unsigned long)stats.highWater, (unsigned long)stats.reserved,
+             (stats.highWater > stats.reserved) ? " (OVER)" : "");
+    CAN_AppPrint(msg);
+}
+
+/* TIM7 entry latency over the last 5 s, then start a new window */
+static void CAN_AppReportJitter(void)
+{
+#ifdef JITTER_PROBE
+    static uint32_t lastReport;
+    Jitter_StatsTypeDef stats;
+    uint32_t mhz;
+    char msg[96];
+
+    if ((HAL_GetTick() - lastReport) < 5000U)
+    {
+        return;
     }
+    lastReport = HAL_GetTick();
+
+    Jitter_GetStats(&stats);
+    Jitter_Reset();
+
+    mhz = stats.timerHz / 1000000U;
+    snprintf(msg, sizeof(msg), "IRQ latency (%s): min %lu max %lu mean %lu ns, jitter %lu ns\r\n",
+#ifdef FASTCODE_IN_RAM
+             "RAM",
+#else
+             "flash",
+#endif
+             (unsigned long)((stats.minTicks * 1000U) / mhz),
+             (unsigned long)((stats.maxTicks * 1000U) / mhz),
+             (unsigned long)((stats.meanTicks * 1000U) / mhz),
+             (unsigned long)(((stats.maxTicks - stats.minTicks) * 1000U) / mhz));
+    CAN_AppPrint(msg);
+#endif
 }
 
 static void CAN_AppSendInitialFrame(void)
@@ -88,7 +329,7 @@ static void CAN_AppSendInitialFrame(void)
     memset(&txHeader, 0, sizeof(txHeader));
 
     txHeader.DLC  = 5;
-    txHeader.StdId= 0x65D;
+    txHeader.StdId= gTxId;
     txHeader.IDE  = CAN_ID_STD;
     txHeader.RTR  = CAN_RTR_DATA;
 
@@ -104,44 +345,117 @@ static void CAN_AppSendInitialFrame(void)
 void HAL_CAN_TxMailbox0CompleteCallback(CAN_HandleTypeDef *hcan)
 {
     (void)hcan;
-    CAN_AppPrint("CAN TX complete: mailbox 0\r\n");
+    if (CAN_Upd_GetState() != CAN_UPD_RECEIVING)
+    {
+        CAN_AppPrint("CAN TX complete: mailbox 0\r\n");
+    }
 }
 
 /* TX mailbox 1 */
 void HAL_CAN_TxMailbox1CompleteCallback(CAN_HandleTypeDef *hcan)
 {
     (void)hcan;
-    CAN_AppPrint("CAN TX complete: mailbox 1\r\n");
+    if (CAN_Upd_GetState() != CAN_UPD_RECEIVING)
+    {
+        CAN_AppPrint("CAN TX complete: mailbox 1\r\n");
+    }
 }
 
 /* TX mailbox 2 */
 void HAL_CAN_TxMailbox2CompleteCallback(CAN_HandleTypeDef *hcan)
 {
     (void)hcan;
-    CAN_AppPrint("CAN TX complete: mailbox 2\r\n");
+    if (CAN_Upd_GetState() != CAN_UPD_RECEIVING)
+    {
+        CAN_AppPrint("CAN TX complete: mailbox 2\r\n");
+    }
 }
 
-/* RX FIFO0 pending */
-void HAL_CAN_RxFifo0MsgPendingCallback(CAN_HandleTypeDef *hcan)
+/* RX FIFO0 frame, drained from the RAM ring by CAN_AppTask() */
+static void CAN_AppHandleFrame(const CAN_Rx_FrameTypeDef *frame)
 {
-    CAN_RxHeaderTypeDef rxHeader;
     uint8_t payload[8];
     char text[64];
 
-    (void)hcan;
-
-    if (HAL_CAN_GetRxMessage(&hcan1, CAN_RX_FIFO0, &rxHeader, payload) != HAL_OK)
-    {
-        Error_Handler();
-    }
+    memcpy(payload, frame->data, sizeof(payload));
 
     /* Make sure the data is printable string (for demo only) */
-    payload[rxHeader.DLC < 8 ? rxHeader.DLC : 7] = '\0';
+    payload[frame->dlc < 8 ? frame->dlc : 7] = '\0';
 
     snprintf(text, sizeof(text), "CAN RX: %s\r\n", payload);
     CAN_AppPrint(text);
 }
 
+/* filter [<id> <mask>]: show or set the application filter, kept in the KV store */
+static HAL_StatusTypeDef CAN_AppCmdFilter(uint32_t argc, char *argv[])
+{
+    uint32_t id;
+    uint32_t mask;
+    uint16_t filter[2];
+
+    if (argc == 1U)
+    {
+        Shell_Printf("filter id 0x%03lX mask 0x%03lX\r\n",
+                     (unsigned long)gFilterId, (unsigned long)gFilterMask);
+        return HAL_OK;
+    }
+
+    if ((argc != 3U) || (Shell_ParseUint(argv[1], &id) == 0U) ||
+        (Shell_ParseUint(argv[2], &mask) == 0U) || (id > 0x7FFU) || (mask > 0x7FFU))
+    {
+        return HAL_ERROR;
+    }
+
+    if (CAN_AppSetFilter(0U, id, mask) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+    gFilterId   = id;
+    gFilterMask = mask;
+
+    filter[0] = (uint16_t)id;
+    filter[1] = (uint16_t)mask;
+    return KV_Put(KV_KEY_CAN_FILTER, filter, sizeof(filter));
+}
+
+/* txid [<id>]: show or set the TX identifier, kept in the KV store */
+static HAL_StatusTypeDef CAN_AppCmdTxId(uint32_t argc, char *argv[])
+{
+    uint32_t id;
+    uint16_t txId;
+
+    if (argc == 1U)
+    {
+        Shell_Printf("txid 0x%03lX\r\n", (unsigned long)gTxId);
+        return HAL_OK;
+    }
+
+    if ((argc != 2U) || (Shell_ParseUint(argv[1], &id) == 0U) || (id > 0x7FFU))
+    {
+        return HAL_ERROR;
+    }
+
+    gTxId = id;
+    txId  = (uint16_t)id;
+    return KV_Put(KV_KEY_CAN_TX_ID, &txId, sizeof(txId));
+}
+
+#ifdef TRACE_RECORDER
+/* trace: print the event ring for tools/trace2perfetto.py, then restart it */
+static HAL_StatusTypeDef CAN_AppCmdTrace(uint32_t argc, char *argv[])
+{
+    (void)argv;
+
+    if (argc != 1U)
+    {
+        return HAL_ERROR;
+    }
+
+    Trace_Dump();
+    return HAL_OK;
+}
+#endif
+
 /* Error callback */
 void HAL_CAN_ErrorCallback(CAN_HandleTypeDef *hcan)
 {
@@ -7,6 +7,7 @@
 
 
 #include "main_app.h"
+#include "can_rx.h"
 
 /**
   * @brief  Initialize the MSP.
@@ -81,7 +82,7 @@ void HAL_CAN_MspInit(CAN_HandleTypeDef *hcan)
   HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
 
   HAL_NVIC_SetPriority(CAN1_TX_IRQn,15,0);
-  HAL_NVIC_SetPriority(CAN1_RX0_IRQn,15,0);
+  HAL_NVIC_SetPriority(CAN1_RX0_IRQn,CAN_RX_IRQ_PRIORITY,0);
   HAL_NVIC_SetPriority(CAN1_RX1_IRQn,15,0);
   HAL_NVIC_SetPriority(CAN1_SCE_IRQn,15,0);
 
@@ -0,0 +1,37 @@
+/* Includes ------------------------------------------------------------------*/
+#include "stack_mon.h"
+
+/* Private variables ---------------------------------------------------------*/
+extern uint32_t _end;
+extern uint32_t _estack;
+extern uint32_t _Min_Stack_Size;
+
+/* -------------------------------------------------------------------------- */
+/*                               Public API                                   */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Deepest MSP use since reset, in bytes.  Scans up from the bottom
+  *         of the painted area; cost grows with the free RAM (~25k words on
+  *         this part), so call it from the idle loop, not from an ISR.
+  */
+uint32_t Stack_Mon_HighWater(void)
+{
+    const uint32_t *p   = (const uint32_t *)(((uint32_t)&_end + 7U) & ~7U);
+    const uint32_t *top = (const uint32_t *)&_estack;
+
+    while ((p < top) && (*p == STACK_MON_PATTERN))
+    {
+        p++;
+    }
+
+    return (uint32_t)top - (uint32_t)p;
+}
+
+void Stack_Mon_GetStats(Stack_Mon_StatsTypeDef *stats)
+{
+    stats->reserved  = (uint32_t)&_Min_Stack_Size;
+    stats->available = (uint32_t)&_estack - (uint32_t)&_end;
+    stats->highWater = Stack_Mon_HighWater();
+    stats->current   = (uint32_t)&_estack - __get_MSP();
+}
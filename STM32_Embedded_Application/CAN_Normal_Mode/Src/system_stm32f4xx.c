@@ -47,6 +47,7 @@
 
 
 #include "stm32f4xx.h"
+#include "stack_mon.h"
 
 #if !defined  (HSE_VALUE) 
   #define HSE_VALUE    ((uint32_t)25000000) /*!< Default value of the External oscillator in Hz */
@@ -172,6 +173,37 @@ void SystemInit(void)
     SCB->CPACR |= ((3UL << 10*2)|(3UL << 11*2));  /* set CP10 and CP11 Full Access */
   #endif
 
+  /* Stack painting for stack_mon.c: everything between the end of the heap
+     and the current SP (less a margin for this frame) gets the pattern.
+     Runs before .data/.bss init and touches neither. */
+  {
+    extern uint32_t _end;
+    uint32_t *p   = (uint32_t *)(((uint32_t)&_end + 7U) & ~7U);
+    uint32_t *top = (uint32_t *)(__get_MSP() - 64U);
+
+    while (p < top)
+    {
+      *p++ = STACK_MON_PATTERN;
+    }
+  }
+
+  /* Copy the .fastcode section (FASTCODE in main_app.h) to SRAM1.  Empty
+     unless built with FASTCODE_IN_RAM; load and run addresses match when
+     linked with STM32F446RETX_RAM.ld. */
+  {
+    extern uint32_t _sifastcode, _sfastcode, _efastcode;
+    const uint32_t *src = &_sifastcode;
+    uint32_t *dst       = &_sfastcode;
+
+    if (src != dst)
+    {
+      while (dst < &_efastcode)
+      {
+        *dst++ = *src++;
+      }
+    }
+  }
+
 #if defined (DATA_IN_ExtSRAM) || defined (DATA_IN_ExtSDRAM)
   SystemInit_ExtMemCtl(); 
 #endif /* DATA_IN_ExtSRAM || DATA_IN_ExtSDRAM */
@@ -0,0 +1,71 @@
+#ifndef CRASH_DUMP_H_
+#define CRASH_DUMP_H_
+
+#include "main_app.h"
+
+/*
+ * Post-mortem fault capture.
+ *
+ *   The generated HardFault, MemManage, BusFault and UsageFault handlers
+ *   in stm32f4xx_it.c call CRASH_DUMP_CAPTURE() from their first USER CODE
+ *   block; so do the ones in it.c, which the main_app.c builds link in its
+ *   place (both files define SysTick_Handler).  Crash_Dump_Capture() copies the exception frame, the fault
+ *   status registers and the first CRASH_DUMP_STACK_WORDS words above the
+ *   faulting SP into the .noinit section (NOINIT region in the linker
+ *   script), then resets.
+ *   That RAM is neither copied nor cleared by the startup code, so the
+ *   record is still there on the next boot, where Crash_Dump_Report()
+ *   prints it and clears it.
+ *
+ *   tools/crash_decode.py parses the "CRASH ..." lines from a console log,
+ *   decodes CFSR/HFSR and symbolises PC, LR and the stack words against
+ *   the ELF of the build that crashed.
+ *
+ *   With a debugger attached the handler halts on a breakpoint before the
+ *   reset, so the fault can also be inspected live.
+ */
+
+#define CRASH_DUMP_STACK_WORDS  64U
+
+#define CRASH_DUMP_FLAG_FPU     0x01U   /* extended frame, FP context stacked */
+#define CRASH_DUMP_FLAG_BAD_SP  0x02U   /* SP outside the stack, frame not read */
+#define CRASH_DUMP_FLAG_PSP     0x04U   /* faulted in thread mode on PSP      */
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t exception;         /* 3 HardFault, 4 MemManage, 5 BusFault, 6 Usage */
+    uint32_t flags;             /* CRASH_DUMP_FLAG_x                         */
+    uint32_t tick;              /* HAL tick at the fault                     */
+    uint32_t excReturn;         /* LR on exception entry                     */
+    uint32_t r0;
+    uint32_t r1;
+    uint32_t r2;
+    uint32_t r3;
+    uint32_t r12;
+    uint32_t lr;
+    uint32_t pc;
+    uint32_t xpsr;
+    uint32_t sp;                /* SP of the faulting code, frame popped     */
+    uint32_t cfsr;
+    uint32_t hfsr;
+    uint32_t mmfar;
+    uint32_t bfar;
+    uint32_t stackWords;        /* valid words in stack[], from sp upwards   */
+    uint32_t stack[CRASH_DUMP_STACK_WORDS];
+    uint32_t check;             /* over all the words above                  */
+} Crash_Dump_RecordTypeDef;
+
+/* Handler's CFA = MSP at exception entry, whatever its prologue pushed
+ * since; return address = EXC_RETURN */
+#define CRASH_DUMP_CAPTURE() \
+    Crash_Dump_Capture((const uint32_t *)__builtin_dwarf_cfa(), \
+                       (uint32_t)__builtin_return_address(0))
+
+void     Crash_Dump_Capture(const uint32_t *msp, uint32_t excReturn) __attribute__((noreturn));
+uint32_t Crash_Dump_Pending(void);
+uint32_t Crash_Dump_Get(Crash_Dump_RecordTypeDef *record);
+void     Crash_Dump_Report(UART_HandleTypeDef *huart);
+void     Crash_Dump_Clear(void);
+
+#endif /* CRASH_DUMP_H_ */
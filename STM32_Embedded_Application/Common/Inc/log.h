@@ -0,0 +1,76 @@
+#ifndef LOG_H_
+#define LOG_H_
+
+#include "main_app.h"
+
+/*
+ * Log channel: one API, two transports picked at build time.
+ *
+ * USART2 TX (default, log.c)
+ *
+ *   Log_Write() copies the bytes into a RAM ring and returns; DMA1 Stream6
+ *   (channel 4) drains the ring to the UART in the background, one
+ *   contiguous run per transfer, restarted from its transfer-complete
+ *   interrupt.  The CPU cost is a memcpy per call instead of a blocking
+ *   HAL call per byte.
+ *
+ *   In thread mode Log_Write() waits for room when the ring is full, so
+ *   nothing is lost.  In an ISR (or with interrupts masked) it cannot wait
+ *   for the drain: what does not fit is counted as dropped.  Log_TryWrite()
+ *   never waits.
+ *
+ *   Everything written to USART2 after Log_Init() must go through here:
+ *   a blocking HAL_UART_Transmit() would interleave with the DMA.  Call
+ *   Log_Flush() before STOP, STANDBY, a baud change or a blocking write.
+ *
+ * ITM / SWO (-DLOG_BACKEND_ITM, log_itm.c)
+ *
+ *   Text goes to stimulus port 0, Log_Event() records to port 1 and
+ *   Log_PcSampling() turns on DWT PC sample packets, all multiplexed on
+ *   the SWO pin (PB3) as NRZ at LOG_ITM_SWO_HZ; tools/swo_parse.py splits
+ *   a captured stream again.  A write is a few stores into the ITM FIFO,
+ *   waiting only while it is full, so it is safe in any context.  USART2
+ *   TX is left to the shell.  The SWO rate is derived from HCLK at
+ *   Log_Init(): call it again after a clock change.
+ *
+ * Both: newlib's _write() (printf, puts, stdout and stderr) is retargeted
+ * to Log_Write().  stdout stays line buffered, so printf reaches the
+ * channel once per line.  Build with -DLOG_BENCH for Log_Bench(): CPU cost
+ * and throughput of the old per-byte putchar path against the channel.
+ */
+
+#define LOG_RING_SIZE       2048U   /* UART: bytes, power of two */
+
+#ifndef LOG_ITM_SWO_HZ
+#define LOG_ITM_SWO_HZ      2000000U    /* ST-LINK/V2-1 maximum; V3 and J-Link go higher */
+#endif
+
+#define LOG_ITM_PORT_TEXT   0U      /* printf and Log_Write()                */
+#define LOG_ITM_PORT_EVENT  1U      /* Log_Event(): 1-byte id, 4-byte value  */
+
+typedef struct
+{
+    uint32_t written;               /* bytes accepted                        */
+    uint32_t dropped;               /* bytes refused: no room, no waiting    */
+    uint32_t transfers;             /* UART: DMA transfers started           */
+    uint32_t errors;                /* UART: DMA transfer errors             */
+    uint32_t maxUsed;               /* UART: ring high-water mark, bytes     */
+} Log_StatsTypeDef;
+
+HAL_StatusTypeDef Log_Init(UART_HandleTypeDef *huart);
+uint32_t          Log_Write(const void *data, uint32_t len);
+uint32_t          Log_TryWrite(const void *data, uint32_t len);
+void              Log_Event(uint8_t id, uint32_t value);
+void              Log_Flush(void);
+void              Log_TxIRQHandler(void);
+void              Log_GetStats(Log_StatsTypeDef *stats);
+
+#ifdef LOG_BACKEND_ITM
+void              Log_PcSampling(uint32_t cyclesPerSample);
+#endif
+
+#ifdef LOG_BENCH
+void              Log_Bench(void);
+#endif
+
+#endif /* LOG_H_ */
@@ -0,0 +1,48 @@
+#ifndef POOL_H_
+#define POOL_H_
+
+#include "main_app.h"
+
+/*
+ * Fixed-block pool allocator, replaces the newlib heap.
+ *
+ *   One free list per size class; a request is served from the smallest
+ *   class that fits, never split or coalesced, so malloc/free are O(1) and
+ *   cannot fragment.  Storage sits in the .pool section (NOLOAD, see the
+ *   linker scripts).  The free lists are lock-free LDREX/STREX stacks, so
+ *   allocating from an ISR is safe: exception entry and return clear the
+ *   exclusive monitor, hence an interrupted pop or push simply retries and
+ *   the ABA problem cannot occur on a single core.
+ *
+ *   malloc/free/calloc/realloc and the newlib _r variants are routed here;
+ *   _sbrk() in sysmem.c always fails, so nothing ever grows the heap.
+ *   Requests larger than the biggest class fail with NULL (newlib stdio then
+ *   falls back to unbuffered streams).
+ */
+
+/* X(block size in bytes (multiple of 8), block count), smallest first */
+#define POOL_CLASSES(X) \
+    X(16U,  32U)        \
+    X(32U,  16U)        \
+    X(64U,  16U)        \
+    X(128U,  8U)        \
+    X(256U,  4U)
+
+#define POOL_X_COUNT(size, blocks)  + 1U
+#define POOL_CLASS_COUNT            (0U POOL_CLASSES(POOL_X_COUNT))
+
+typedef struct
+{
+    uint32_t blockSize;
+    uint32_t blockCount;
+    uint32_t inUse;
+    uint32_t highWater;             /* max blocks in use since Pool_Init()   */
+    uint32_t failures;              /* requests sized for it that got NULL   */
+} Pool_StatsTypeDef;
+
+void  Pool_Init(void);
+void *Pool_Alloc(size_t size);
+void  Pool_Free(void *ptr);
+void  Pool_GetStats(uint32_t cls, Pool_StatsTypeDef *stats);
+
+#endif /* POOL_H_ */
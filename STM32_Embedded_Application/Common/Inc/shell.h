@@ -0,0 +1,35 @@
+#ifndef SHELL_H_
+#define SHELL_H_
+
+#include "main_app.h"
+
+/*
+ * Line-oriented command shell on the uart_rx.c stream.
+ *
+ *   Shell_Process() is polled from the main loop.  It drains the RX ring,
+ *   echoes, assembles a line (CR, LF or CRLF terminated, backspace edits),
+ *   splits it into at most SHELL_MAX_ARGS words and calls the handler of
+ *   the matching entry in the application's command table.  Every line is
+ *   answered with "OK" or "ERR ...", so a host script can pace itself.
+ *
+ *   Built in: help, baud <rate>, rxstats; pcsample <cycles> with the ITM
+ *   log backend.
+ */
+
+#define SHELL_LINE_MAX      96U
+#define SHELL_MAX_ARGS      8U
+
+typedef struct
+{
+    const char *name;
+    const char *usage;              /* arguments, shown by help and on error  */
+    HAL_StatusTypeDef (*handler)(uint32_t argc, char *argv[]);
+} Shell_CommandTypeDef;
+
+void     Shell_Init(UART_HandleTypeDef *huart, const Shell_CommandTypeDef *commands,
+                    uint32_t count);
+uint32_t Shell_Process(void);
+void     Shell_Printf(const char *format, ...) __attribute__((format(printf, 1, 2)));
+uint32_t Shell_ParseUint(const char *text, uint32_t *value);
+
+#endif /* SHELL_H_ */
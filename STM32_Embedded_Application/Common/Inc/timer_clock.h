@@ -0,0 +1,16 @@
+#ifndef TIMER_CLOCK_H_
+#define TIMER_CLOCK_H_
+
+#include "main_app.h"
+
+/*
+ * Kernel clock of a general-purpose or advanced timer.
+ *
+ *   The timers run at their APB clock when that bus prescaler is 1, and at
+ *   twice the APB clock otherwise (TIMPRE clear).  TIM1, TIM8 and TIM9-11
+ *   sit on APB2, the others on APB1.
+ */
+
+uint32_t Timer_Clock_Get(const TIM_TypeDef *tim);
+
+#endif /* TIMER_CLOCK_H_ */
@@ -0,0 +1,99 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include "main_app.h"
+
+/*
+ * Event trace recorder (TRACE_RECORDER in main_app.h).
+ *
+ *   Each event is 8 bytes in a RAM ring: the DWT cycle counter and a word
+ *   holding type, id and a 16-bit argument.  Recording is inline (about a
+ *   dozen instructions with interrupts masked for the slot claim), so it
+ *   also fits the __RAM_FUNC handlers that must not touch flash.  The ring
+ *   keeps the newest TRACE_RING_SIZE events.
+ *
+ *   ISR events carry the exception number from IPSR (IRQn + 16); task ids
+ *   are the application's, named with Trace_NameTask(); power events
+ *   carry a Trace_PowerTypeDef.  Trace_Dump() prints the ring on stdout
+ *   as "TRACE ..." lines; tools/trace2perfetto.py turns a console capture
+ *   into Chrome trace / Perfetto JSON.
+ *
+ *   The cycle counter stops in STOP and restarts from reset after
+ *   STANDBY: a STOP shows up as its entry and exit events back to back,
+ *   and a dump only covers the time since the last reset.
+ *
+ *   Without TRACE_RECORDER the macros compile to nothing.
+ */
+
+#define TRACE_RING_SIZE     1024U   /* events, power of two */
+#define TRACE_MAX_TASKS     16U
+
+typedef enum
+{
+    TRACE_EV_ISR_ENTER = 1,
+    TRACE_EV_ISR_EXIT,
+    TRACE_EV_TASK_BEGIN,
+    TRACE_EV_TASK_END,
+    TRACE_EV_POWER,                 /* id: Trace_PowerTypeDef                */
+    TRACE_EV_MARK                   /* instant, id and argument free         */
+} Trace_EventTypeDef;
+
+typedef enum
+{
+    TRACE_PWR_RUN = 0,
+    TRACE_PWR_SLEEP,
+    TRACE_PWR_STOP,
+    TRACE_PWR_STANDBY
+} Trace_PowerTypeDef;
+
+typedef struct
+{
+    uint32_t cycles;                /* DWT->CYCCNT                           */
+    uint32_t info;                  /* type << 24 | id << 16 | arg           */
+} Trace_RecordTypeDef;
+
+void Trace_Init(void);
+void Trace_NameTask(uint8_t id, const char *name);
+void Trace_Dump(void);
+
+#ifdef TRACE_RECORDER
+
+extern Trace_RecordTypeDef gTraceRing[TRACE_RING_SIZE];
+extern uint32_t            gTraceHead;
+extern volatile uint32_t   gTraceOn;
+
+__STATIC_FORCEINLINE void Trace_Record(uint32_t type, uint32_t id, uint32_t arg)
+{
+    uint32_t primask = __get_PRIMASK();
+    Trace_RecordTypeDef *rec;
+
+    if (gTraceOn != 0U)
+    {
+        __disable_irq();
+        rec = &gTraceRing[gTraceHead & (TRACE_RING_SIZE - 1U)];
+        gTraceHead++;
+        rec->cycles = DWT->CYCCNT;
+        rec->info   = (type << 24) | ((id & 0xFFU) << 16) | (arg & 0xFFFFU);
+        __set_PRIMASK(primask);
+    }
+}
+
+#define TRACE_ISR_ENTER()           Trace_Record(TRACE_EV_ISR_ENTER, __get_IPSR(), 0U)
+#define TRACE_ISR_EXIT()            Trace_Record(TRACE_EV_ISR_EXIT, __get_IPSR(), 0U)
+#define TRACE_TASK_BEGIN(id)        Trace_Record(TRACE_EV_TASK_BEGIN, (id), 0U)
+#define TRACE_TASK_END(id)          Trace_Record(TRACE_EV_TASK_END, (id), 0U)
+#define TRACE_POWER(state, arg)     Trace_Record(TRACE_EV_POWER, (state), (arg))
+#define TRACE_MARK(id, arg)         Trace_Record(TRACE_EV_MARK, (id), (arg))
+
+#else
+
+#define TRACE_ISR_ENTER()           ((void)0)
+#define TRACE_ISR_EXIT()            ((void)0)
+#define TRACE_TASK_BEGIN(id)        ((void)0)
+#define TRACE_TASK_END(id)          ((void)0)
+#define TRACE_POWER(state, arg)     ((void)0)
+#define TRACE_MARK(id, arg)         ((void)0)
+
+#endif /* TRACE_RECORDER */
+
+#endif /* TRACE_H_ */
@@ -0,0 +1,55 @@
+#ifndef UART_RX_H_
+#define UART_RX_H_
+
+#include "main_app.h"
+
+/*
+ * USART2 reception on circular DMA with idle-line detection.
+ *
+ *   DMA1 Stream5 (channel 4) writes every received byte into a ring in
+ *   SRAM2; the CPU takes no per-byte interrupt.  The DMA write position is
+ *   published to the reader on three events: the line going idle after a
+ *   frame (USART IDLE), and the DMA passing the middle and the end of the
+ *   ring (HT/TC), which bounds the backlog for long back-to-back streams.
+ *   The main loop copies bytes out with UART_Rx_Read(); _read() (stdin) is
+ *   served from the same ring.
+ *
+ *   At 2 Mbaud (200 kB/s) one ring is 10 ms of traffic: the interrupt may
+ *   be held off for up to half of that, and the reader must come back
+ *   within a ring.  A lapped reader skips to the newest half ring and the
+ *   skipped bytes are counted in dropped, never returned corrupted.  An
+ *   interrupt held off longer (both HT and TC pending) counts an overrun
+ *   and forces that resynchronisation, as whole laps may have been missed.
+ *
+ *   UART_Rx_IRQHandler() runs from SRAM.  A project that writes flash
+ *   (CAN_Normal_Mode) sets USART2 to UART_RX_IRQ_PRIORITY, above
+ *   FLASH_IF_BASEPRI, before UART_Rx_Start(), and puts its USART2 and
+ *   DMA1 Stream5 handlers in SRAM too: reception then carries on through
+ *   a sector erase.
+ *
+ *   2 Mbaud needs PCLK1 >= 32 MHz with 16x oversampling and is exact at
+ *   42 MHz (84 MHz SYSCLK).  UART_Rx_SetBaud() switches to 8x oversampling
+ *   above PCLK1 / 16.
+ */
+
+#define UART_RX_RING_SIZE       2048U   /* bytes, power of two             */
+#define UART_RX_BAUD_MIN        1200U
+#define UART_RX_IRQ_PRIORITY    3U      /* see above, < FLASH_IF_BASEPRI   */
+
+typedef struct
+{
+    uint32_t bytes;                 /* received since UART_Rx_Start()        */
+    uint32_t frames;                /* idle-line events                      */
+    uint32_t dropped;               /* overwritten before they were read     */
+    uint32_t overruns;              /* USART ORE, or the ISR lost a lap      */
+    uint32_t errors;                /* framing, noise and DMA transfer errors */
+} UART_Rx_StatsTypeDef;
+
+HAL_StatusTypeDef UART_Rx_Start(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef UART_Rx_SetBaud(uint32_t baud);
+void              UART_Rx_IRQHandler(void);
+uint32_t          UART_Rx_Available(void);
+uint32_t          UART_Rx_Read(uint8_t *dst, uint32_t size);
+void              UART_Rx_GetStats(UART_Rx_StatsTypeDef *stats);
+
+#endif /* UART_RX_H_ */
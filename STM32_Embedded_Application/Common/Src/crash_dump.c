@@ -0,0 +1,259 @@
+/* Includes ------------------------------------------------------------------*/
+#include "crash_dump.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define CRASH_DUMP_MAGIC        0xDEADC0DEUL
+#define CRASH_DUMP_CHECK_WORDS  (offsetof(Crash_Dump_RecordTypeDef, check) / 4U)
+
+#define CRASH_DUMP_FRAME_BYTES      0x20U   /* r0-r3, r12, lr, pc, xPSR       */
+#define CRASH_DUMP_FRAME_FPU_BYTES  0x68U   /* + s0-s15, FPSCR, reserved      */
+
+#define CRASH_DUMP_EXC_RETURN_PSP   0x04U
+#define CRASH_DUMP_EXC_RETURN_BASIC 0x10U   /* clear: FP context stacked      */
+#define CRASH_DUMP_XPSR_ALIGN       0x200U  /* SP was realigned to 8 on entry */
+
+#define CRASH_DUMP_LINE_WORDS   8U
+
+/* Private variables ---------------------------------------------------------*/
+extern uint32_t _estack;
+
+/* Not cleared at startup: holds the last fault across the reset */
+static Crash_Dump_RecordTypeDef gCrash __attribute__((section(".noinit")));
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t Crash_Dump_Check(const Crash_Dump_RecordTypeDef *record);
+static const char *Crash_Dump_Name(uint32_t exception);
+static void Crash_Dump_Print(UART_HandleTypeDef *huart, const char *text);
+
+/* -------------------------------------------------------------------------- */
+/*                               Fault entry                                  */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Fill the .noinit record and reset; see CRASH_DUMP_CAPTURE().
+  *         EXC_RETURN bit 2 tells whether the hardware frame went to PSP
+  *         or to MSP at @p msp.  The frame is only read when it lies inside
+  *         the stack: after a stack overflow or a corrupted SP, reading it
+  *         would fault again and lock the core up.
+  */
+void Crash_Dump_Capture(const uint32_t *msp, uint32_t excReturn)
+{
+    const uint32_t *frame = ((excReturn & CRASH_DUMP_EXC_RETURN_PSP) != 0U) ?
+                            (const uint32_t *)__get_PSP() : msp;
+    uint32_t addr = (uint32_t)frame;
+    uint32_t top  = (uint32_t)&_estack;
+    uint32_t frameBytes = CRASH_DUMP_FRAME_BYTES;
+    const uint32_t *sp;
+    uint32_t i;
+
+    gCrash.magic     = 0U;
+    gCrash.exception = __get_IPSR() & 0x1FFU;
+    gCrash.flags     = 0U;
+    gCrash.tick      = HAL_GetTick();
+    gCrash.excReturn = excReturn;
+    gCrash.cfsr      = SCB->CFSR;
+    gCrash.hfsr      = SCB->HFSR;
+    gCrash.mmfar     = SCB->MMFAR;
+    gCrash.bfar      = SCB->BFAR;
+
+    if ((excReturn & CRASH_DUMP_EXC_RETURN_BASIC) == 0U)
+    {
+        frameBytes    = CRASH_DUMP_FRAME_FPU_BYTES;
+        gCrash.flags |= CRASH_DUMP_FLAG_FPU;
+    }
+    if ((excReturn & CRASH_DUMP_EXC_RETURN_PSP) != 0U)
+    {
+        gCrash.flags |= CRASH_DUMP_FLAG_PSP;
+    }
+
+    if ((addr < SRAM1_BASE) || ((addr & 3U) != 0U) || (addr > (top - frameBytes)))
+    {
+        gCrash.flags     |= CRASH_DUMP_FLAG_BAD_SP;
+        gCrash.r0         = 0U;
+        gCrash.r1         = 0U;
+        gCrash.r2         = 0U;
+        gCrash.r3         = 0U;
+        gCrash.r12        = 0U;
+        gCrash.lr         = 0U;
+        gCrash.pc         = 0U;
+        gCrash.xpsr       = 0U;
+        gCrash.sp         = addr;
+        gCrash.stackWords = 0U;
+    }
+    else
+    {
+        gCrash.r0   = frame[0];
+        gCrash.r1   = frame[1];
+        gCrash.r2   = frame[2];
+        gCrash.r3   = frame[3];
+        gCrash.r12  = frame[4];
+        gCrash.lr   = frame[5];
+        gCrash.pc   = frame[6];
+        gCrash.xpsr = frame[7];
+
+        /* SP as the faulting code saw it */
+        gCrash.sp = addr + frameBytes;
+        if ((gCrash.xpsr & CRASH_DUMP_XPSR_ALIGN) != 0U)
+        {
+            gCrash.sp += 4U;
+        }
+
+        gCrash.stackWords = 0U;
+        if (gCrash.sp < top)
+        {
+            gCrash.stackWords = (top - gCrash.sp) / 4U;
+        }
+        if (gCrash.stackWords > CRASH_DUMP_STACK_WORDS)
+        {
+            gCrash.stackWords = CRASH_DUMP_STACK_WORDS;
+        }
+
+        sp = (const uint32_t *)gCrash.sp;
+        for (i = 0U; i < gCrash.stackWords; i++)
+        {
+            gCrash.stack[i] = sp[i];
+        }
+    }
+
+    gCrash.magic = CRASH_DUMP_MAGIC;
+    gCrash.check = Crash_Dump_Check(&gCrash);
+    __DSB();
+
+    /* Halt here first when a debugger is attached; BKPT without one would
+       escalate to a lockup */
+    if ((CoreDebug->DHCSR & CoreDebug_DHCSR_C_DEBUGEN_Msk) != 0U)
+    {
+        __BKPT(0);
+    }
+
+    NVIC_SystemReset();
+}
+
+/* -------------------------------------------------------------------------- */
+/*                               Public API                                   */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Non-zero if the previous run left a valid record.  SRAM comes up
+  *         random after power-on, hence the check word on top of the magic.
+  */
+uint32_t Crash_Dump_Pending(void)
+{
+    return ((gCrash.magic == CRASH_DUMP_MAGIC) &&
+            (gCrash.stackWords <= CRASH_DUMP_STACK_WORDS) &&
+            (gCrash.check == Crash_Dump_Check(&gCrash))) ? 1U : 0U;
+}
+
+/**
+  * @brief  Copy the pending record, if any.  Returns 0 when there is none.
+  */
+uint32_t Crash_Dump_Get(Crash_Dump_RecordTypeDef *record)
+{
+    if (Crash_Dump_Pending() == 0U)
+    {
+        return 0U;
+    }
+
+    memcpy(record, &gCrash, sizeof(*record));
+    return 1U;
+}
+
+/**
+  * @brief  Print the pending record as "CRASH ..." lines and clear it.
+  *         Call once at boot, after the UART is up; does nothing if the
+  *         previous reset was not caused by a fault.
+  */
+void Crash_Dump_Report(UART_HandleTypeDef *huart)
+{
+    char line[112];
+    uint32_t i;
+    uint32_t j;
+    int len;
+
+    if (Crash_Dump_Pending() == 0U)
+    {
+        return;
+    }
+
+    snprintf(line, sizeof(line), "CRASH exc=%lu (%s) flags=%02lx tick=%lu\r\n",
+             (unsigned long)gCrash.exception, Crash_Dump_Name(gCrash.exception),
+             (unsigned long)gCrash.flags, (unsigned long)gCrash.tick);
+    Crash_Dump_Print(huart, line);
+
+    snprintf(line, sizeof(line), "CRASH pc=%08lx lr=%08lx xpsr=%08lx sp=%08lx exc_return=%08lx\r\n",
+             (unsigned long)gCrash.pc, (unsigned long)gCrash.lr,
+             (unsigned long)gCrash.xpsr, (unsigned long)gCrash.sp,
+             (unsigned long)gCrash.excReturn);
+    Crash_Dump_Print(huart, line);
+
+    snprintf(line, sizeof(line), "CRASH r0=%08lx r1=%08lx r2=%08lx r3=%08lx r12=%08lx\r\n",
+             (unsigned long)gCrash.r0, (unsigned long)gCrash.r1,
+             (unsigned long)gCrash.r2, (unsigned long)gCrash.r3,
+             (unsigned long)gCrash.r12);
+    Crash_Dump_Print(huart, line);
+
+    snprintf(line, sizeof(line), "CRASH cfsr=%08lx hfsr=%08lx mmfar=%08lx bfar=%08lx\r\n",
+             (unsigned long)gCrash.cfsr, (unsigned long)gCrash.hfsr,
+             (unsigned long)gCrash.mmfar, (unsigned long)gCrash.bfar);
+    Crash_Dump_Print(huart, line);
+
+    for (i = 0U; i < gCrash.stackWords; i += CRASH_DUMP_LINE_WORDS)
+    {
+        len = snprintf(line, sizeof(line), "CRASH mem %08lx:",
+                       (unsigned long)(gCrash.sp + (i * 4U)));
+        for (j = i; (j < gCrash.stackWords) && (j < (i + CRASH_DUMP_LINE_WORDS)); j++)
+        {
+            len += snprintf(&line[len], sizeof(line) - (uint32_t)len, " %08lx",
+                            (unsigned long)gCrash.stack[j]);
+        }
+        snprintf(&line[len], sizeof(line) - (uint32_t)len, "\r\n");
+        Crash_Dump_Print(huart, line);
+    }
+
+    Crash_Dump_Print(huart, "CRASH end\r\n");
+
+    Crash_Dump_Clear();
+}
+
+void Crash_Dump_Clear(void)
+{
+    gCrash.magic = 0U;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                               Local helpers                                */
+/* -------------------------------------------------------------------------- */
+
+static uint32_t Crash_Dump_Check(const Crash_Dump_RecordTypeDef *record)
+{
+    const uint32_t *w = (const uint32_t *)record;
+    uint32_t sum = 0x5A5A5A5AUL;
+    uint32_t i;
+
+    for (i = 0U; i < CRASH_DUMP_CHECK_WORDS; i++)
+    {
+        sum = ((sum << 5) | (sum >> 27)) ^ w[i];
+    }
+
+    return sum;
+}
+
+static const char *Crash_Dump_Name(uint32_t exception)
+{
+    switch (exception)
+    {
+    case 3U: return "HardFault";
+    case 4U: return "MemManage";
+    case 5U: return "BusFault";
+    case 6U: return "UsageFault";
+    default: return "?";
+    }
+}
+
+static void Crash_Dump_Print(UART_HandleTypeDef *huart, const char *text)
+{
+    HAL_UART_Transmit(huart, (uint8_t *)text, (uint16_t)strlen(text), HAL_MAX_DELAY);
+}
@@ -0,0 +1,379 @@
+/* Includes ------------------------------------------------------------------*/
+#include "log.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifndef LOG_BACKEND_ITM
+
+/* Private defines -----------------------------------------------------------*/
+#define LOG_MASK                (LOG_RING_SIZE - 1U)
+#define LOG_COPY_MAX            64U     /* bytes per critical section        */
+
+#define LOG_DMA_STREAM          DMA1_Stream6
+#define LOG_DMA_IRQn            DMA1_Stream6_IRQn
+#define LOG_DMA_CHANNEL         (4U << DMA_SxCR_CHSEL_Pos)
+#define LOG_DMA_FLAGS           (DMA_HISR_TCIF6 | DMA_HISR_HTIF6 | DMA_HISR_TEIF6 | \
+                                 DMA_HISR_DMEIF6 | DMA_HISR_FEIF6)
+#define LOG_DMA_ERRORS          (DMA_HISR_TEIF6 | DMA_HISR_DMEIF6)
+
+#define LOG_BENCH_LINES         16U
+
+/* Private variables ---------------------------------------------------------*/
+/* Plain SRAM1, not DMA_BUFFER: the CPU writes every byte and the DMA reads
+   each one once at UART speed, so there is no contention worth moving for */
+static uint8_t gRing[LOG_RING_SIZE];
+
+static UART_HandleTypeDef *gHuart;
+static volatile uint32_t   gHead;       /* bytes written                     */
+static volatile uint32_t   gTail;       /* bytes handed to the UART          */
+static volatile uint32_t   gInFlight;   /* bytes in the running transfer     */
+static Log_StatsTypeDef    gStats;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t Log_Put(const uint8_t *src, uint32_t len);
+static void     Log_Start(void);
+static uint32_t Log_CanWait(void);
+
+/* -------------------------------------------------------------------------- */
+/*                               Public API                                   */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Attach the channel to @p huart (USART2 only: the DMA stream is
+  *         fixed).  The UART must already be initialised by HAL.  The DMA
+  *         interrupt gets the USART2 priority.
+  */
+HAL_StatusTypeDef Log_Init(UART_HandleTypeDef *huart)
+{
+    DMA_Stream_TypeDef *stream = LOG_DMA_STREAM;
+
+    if (huart->Instance != USART2)
+    {
+        return HAL_ERROR;
+    }
+
+    __HAL_RCC_DMA1_CLK_ENABLE();
+
+    stream->CR &= ~DMA_SxCR_EN;
+    while ((stream->CR & DMA_SxCR_EN) != 0U)
+    {
+    }
+    DMA1->HIFCR = LOG_DMA_FLAGS;
+
+    stream->PAR = (uint32_t)&huart->Instance->DR;
+    stream->FCR = 0U;                   /* direct mode, byte to byte */
+    stream->CR  = LOG_DMA_CHANNEL | DMA_SxCR_DIR_0 | DMA_SxCR_PL_0 |
+                  DMA_SxCR_MINC | DMA_SxCR_TCIE | DMA_SxCR_TEIE;
+
+    gHead     = 0U;
+    gTail     = 0U;
+    gInFlight = 0U;
+    memset(&gStats, 0, sizeof(gStats));
+    gHuart    = huart;
+
+    NVIC_SetPriority(LOG_DMA_IRQn, NVIC_GetPriority(USART2_IRQn));
+    NVIC_EnableIRQ(LOG_DMA_IRQn);
+
+    return HAL_OK;
+}
+
+/**
+  * @brief  Queue @p len bytes for transmission.  Waits for room in thread
+  *         mode; in an ISR or with interrupts masked it behaves like
+  *         Log_TryWrite().
+  * @retval Bytes queued.
+  */
+uint32_t Log_Write(const void *data, uint32_t len)
+{
+    const uint8_t *src = (const uint8_t *)data;
+    uint32_t done = 0U;
+
+    if ((gHuart == NULL) || (Log_CanWait() == 0U))
+    {
+        return Log_TryWrite(data, len);
+    }
+
+    while (done < len)
+    {
+        /* Zero while the ring is full: the DMA interrupt makes room */
+        done += Log_Put(&src[done], len - done);
+    }
+
+    return done;
+}
+
+/**
+  * @brief  Queue what fits of @p len bytes without waiting; the rest is
+  *         counted as dropped.
+  * @retval Bytes queued.
+  */
+uint32_t Log_TryWrite(const void *data, uint32_t len)
+{
+    const uint8_t *src = (const uint8_t *)data;
+    uint32_t done = 0U;
+    uint32_t count;
+    uint32_t primask;
+
+    if (gHuart != NULL)
+    {
+        do
+        {
+            count = Log_Put(&src[done], len - done);
+            done += count;
+        } while ((count != 0U) && (done < len));
+    }
+
+    if (done < len)
+    {
+        /* Log_Write() comes here with interrupts already masked */
+        primask = __get_PRIMASK();
+        __disable_irq();
+        gStats.dropped += len - done;
+        __set_PRIMASK(primask);
+    }
+
+    return done;
+}
+
+/**
+  * @brief  Binary event, as a text line on this transport.
+  */
+void Log_Event(uint8_t id, uint32_t value)
+{
+    char text[24];
+    int len;
+
+    len = snprintf(text, sizeof(text), "EVT %u %08lX\r\n", id, (unsigned long)value);
+    if (len > 0)
+    {
+        (void)Log_Write(text, (uint32_t)len);
+    }
+}
+
+/**
+  * @brief  Wait until everything queued has left the UART shift register.
+  *         Returns at once where it cannot wait (ISR, interrupts masked).
+  */
+void Log_Flush(void)
+{
+    if ((gHuart == NULL) || (Log_CanWait() == 0U))
+    {
+        return;
+    }
+
+    while (gTail != gHead)
+    {
+    }
+    while ((gHuart->Instance->SR & USART_SR_TC) == 0U)
+    {
+    }
+}
+
+/**
+  * @brief  DMA1 Stream6 interrupt: retire the finished run, start the next.
+  */
+void Log_TxIRQHandler(void)
+{
+    uint32_t hisr = DMA1->HISR & LOG_DMA_FLAGS;
+
+    DMA1->HIFCR = hisr;
+
+    if ((hisr & LOG_DMA_ERRORS) != 0U)
+    {
+        /* The run is lost; carry on with the next one */
+        gStats.errors++;
+        LOG_DMA_STREAM->CR &= ~DMA_SxCR_EN;
+        while ((LOG_DMA_STREAM->CR & DMA_SxCR_EN) != 0U)
+        {
+        }
+    }
+
+    if ((hisr & (DMA_HISR_TCIF6 | LOG_DMA_ERRORS)) != 0U)
+    {
+        gTail    += gInFlight;
+        gInFlight = 0U;
+        Log_Start();
+    }
+}
+
+void Log_GetStats(Log_StatsTypeDef *stats)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    memcpy(stats, &gStats, sizeof(*stats));
+    __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  newlib stdout/stderr: everything goes to the log channel.  The
+  *         full length is always reported, so newlib never retries bytes
+  *         dropped in an ISR.
+  */
+int _write(int file, char *ptr, int len)
+{
+    (void)file;
+
+    if (len > 0)
+    {
+        (void)Log_Write(ptr, (uint32_t)len);
+    }
+
+    return len;
+}
+
+#ifdef LOG_BENCH
+/**
+  * @brief  Send the same text through the old path (_write calling a
+  *         putchar that does one blocking HAL transmit per byte) and
+  *         through the channel, and print CPU cycles per line and wire
+  *         throughput of each.  The text fits the ring, so the channel's
+  *         CPU figure is the copy alone.
+  */
+void Log_Bench(void)
+{
+    static const char line[] = "log bench 0123456789 abcdefghijklmnopqrstuvwxyz ABCDEFGHIJ\r\n";
+    const uint32_t len   = sizeof(line) - 1U;
+    const uint32_t bytes = len * LOG_BENCH_LINES;
+    uint32_t perByteCycles;
+    uint32_t logCpuCycles;
+    uint32_t logCycles;
+    uint32_t start;
+    uint32_t i;
+    uint32_t j;
+
+    if (gHuart == NULL)
+    {
+        return;
+    }
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    Log_Flush();
+
+    start = DWT->CYCCNT;
+    for (i = 0U; i < LOG_BENCH_LINES; i++)
+    {
+        for (j = 0U; j < len; j++)
+        {
+            HAL_UART_Transmit(gHuart, (uint8_t *)&line[j], 1U, HAL_MAX_DELAY);
+        }
+    }
+    perByteCycles = DWT->CYCCNT - start;
+
+    start = DWT->CYCCNT;
+    for (i = 0U; i < LOG_BENCH_LINES; i++)
+    {
+        (void)Log_Write(line, len);
+    }
+    logCpuCycles = DWT->CYCCNT - start;
+    Log_Flush();
+    logCycles = DWT->CYCCNT - start;
+
+    printf("Log bench: %lu lines x %lu B at %lu baud\r\n",
+           (unsigned long)LOG_BENCH_LINES, (unsigned long)len,
+           (unsigned long)gHuart->Init.BaudRate);
+    printf("per-byte  cpu %7lu cyc/line  wire %6lu B/s\r\n",
+           (unsigned long)(perByteCycles / LOG_BENCH_LINES),
+           (unsigned long)(((uint64_t)bytes * SystemCoreClock) / perByteCycles));
+    printf("log DMA   cpu %7lu cyc/line  wire %6lu B/s\r\n",
+           (unsigned long)(logCpuCycles / LOG_BENCH_LINES),
+           (unsigned long)(((uint64_t)bytes * SystemCoreClock) / logCycles));
+}
+#endif
+
+/* -------------------------------------------------------------------------- */
+/*                               Local helpers                                */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Copy what fits, at most LOG_COPY_MAX bytes, with interrupts
+  *         masked (ISRs may log too), and start the DMA if it is idle.
+  */
+static uint32_t Log_Put(const uint8_t *src, uint32_t len)
+{
+    uint32_t primask = __get_PRIMASK();
+    uint32_t used;
+    uint32_t index;
+    uint32_t chunk;
+
+    if (len > LOG_COPY_MAX)
+    {
+        len = LOG_COPY_MAX;
+    }
+
+    __disable_irq();
+
+    used = gHead - gTail;
+    if (len > (LOG_RING_SIZE - used))
+    {
+        len = LOG_RING_SIZE - used;
+    }
+
+    index = gHead & LOG_MASK;
+    chunk = LOG_RING_SIZE - index;
+    if (chunk > len)
+    {
+        chunk = len;
+    }
+    memcpy(&gRing[index], src, chunk);
+    memcpy(gRing, &src[chunk], len - chunk);
+
+    gHead += len;
+    gStats.written += len;
+    if ((used + len) > gStats.maxUsed)
+    {
+        gStats.maxUsed = used + len;
+    }
+
+    Log_Start();
+
+    __set_PRIMASK(primask);
+
+    return len;
+}
+
+/**
+  * @brief  Start a transfer of the oldest contiguous run, if the stream is
+  *         idle.  Called with interrupts masked or from the DMA ISR.
+  */
+static void Log_Start(void)
+{
+    DMA_Stream_TypeDef *stream = LOG_DMA_STREAM;
+    uint32_t used = gHead - gTail;
+    uint32_t index = gTail & LOG_MASK;
+    uint32_t run;
+
+    if ((gInFlight != 0U) || (used == 0U))
+    {
+        return;
+    }
+
+    run = LOG_RING_SIZE - index;
+    if (run > used)
+    {
+        run = used;
+    }
+
+    DMA1->HIFCR  = LOG_DMA_FLAGS;
+    stream->M0AR = (uint32_t)&gRing[index];
+    stream->NDTR = run;
+    gInFlight    = run;
+    gStats.transfers++;
+
+    /* HAL_UART_Init() (baud change) clears DMAT: set it every time */
+    __HAL_UART_CLEAR_FLAG(gHuart, UART_FLAG_TC);
+    gHuart->Instance->CR3 |= USART_CR3_DMAT;
+    stream->CR |= DMA_SxCR_EN;
+}
+
+/**
+  * @brief  Waiting for the drain needs the DMA interrupt to run: not in an
+  *         ISR, not with interrupts masked.
+  */
+static uint32_t Log_CanWait(void)
+{
+    return ((__get_IPSR() == 0U) && (__get_PRIMASK() == 0U)) ? 1U : 0U;
+}
+
+#endif /* LOG_BACKEND_ITM */
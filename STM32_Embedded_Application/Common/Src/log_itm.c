@@ -0,0 +1,324 @@
+/* Includes ------------------------------------------------------------------*/
+#include "log.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef LOG_BACKEND_ITM
+
+/* Private defines -----------------------------------------------------------*/
+#define LOG_ITM_PORTS           ((1UL << LOG_ITM_PORT_TEXT) | (1UL << LOG_ITM_PORT_EVENT))
+#define LOG_ITM_LAR_KEY         0xC5ACCE55UL
+#define LOG_TPI_SPPR_NRZ        2U          /* asynchronous SWO, UART framing */
+
+#define LOG_BENCH_LINES         16U
+
+/* Private variables ---------------------------------------------------------*/
+static UART_HandleTypeDef *gHuart;          /* Log_Bench() comparison only   */
+static Log_StatsTypeDef    gStats;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t Log_Put(uint32_t port, const uint8_t *src, uint32_t len, uint32_t wait);
+static uint32_t Log_Enabled(uint32_t port);
+
+/* -------------------------------------------------------------------------- */
+/*                               Public API                                   */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Route ITM ports 0 and 1 to the SWO pin at LOG_ITM_SWO_HZ, from
+  *         the current HCLK.  @p huart is only kept for Log_Bench().  A
+  *         debugger with SWV enabled reprograms the same registers: its
+  *         SWO clock must match.
+  */
+HAL_StatusTypeDef Log_Init(UART_HandleTypeDef *huart)
+{
+    uint32_t hclk = HAL_RCC_GetHCLKFreq();
+
+    if (hclk < LOG_ITM_SWO_HZ)
+    {
+        return HAL_ERROR;
+    }
+    gHuart = huart;
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+
+    /* Asynchronous trace (TRACE_MODE 00) on TRACESWO, PB3 AF0 */
+    DBGMCU->CR = (DBGMCU->CR & ~DBGMCU_CR_TRACE_MODE) | DBGMCU_CR_TRACE_IOEN;
+
+    TPI->SPPR = LOG_TPI_SPPR_NRZ;
+    TPI->ACPR = (hclk / LOG_ITM_SWO_HZ) - 1U;
+    TPI->FFCR = TPI_FFCR_TrigIn_Msk;        /* formatter off: ITM stream as is */
+
+    ITM->LAR = LOG_ITM_LAR_KEY;
+    ITM->TCR = 0U;
+    while ((ITM->TCR & ITM_TCR_BUSY_Msk) != 0U)
+    {
+    }
+    ITM->TPR = 0U;
+    ITM->TER = LOG_ITM_PORTS;
+    ITM->TCR = (1UL << ITM_TCR_TraceBusID_Pos) | ITM_TCR_DWTENA_Msk |
+               ITM_TCR_SYNCENA_Msk | ITM_TCR_TSENA_Msk | ITM_TCR_ITMENA_Msk;
+
+    /* Sync packets every 2^24 cycles, so a capture can start mid-stream */
+    DWT->CTRL = (DWT->CTRL & ~DWT_CTRL_SYNCTAP_Msk) | (1UL << DWT_CTRL_SYNCTAP_Pos) |
+                DWT_CTRL_CYCCNTENA_Msk;
+
+    memset(&gStats, 0, sizeof(gStats));
+
+    return HAL_OK;
+}
+
+/**
+  * @brief  Text to port 0, waiting while the ITM FIFO is full (a few bit
+  *         times at most, in any context).
+  * @retval Bytes written.
+  */
+uint32_t Log_Write(const void *data, uint32_t len)
+{
+    uint32_t done = Log_Put(LOG_ITM_PORT_TEXT, (const uint8_t *)data, len, 1U);
+
+    gStats.dropped += len - done;
+    return done;
+}
+
+/**
+  * @brief  Text to port 0 while the FIFO has room; the rest is dropped.
+  * @retval Bytes written.
+  */
+uint32_t Log_TryWrite(const void *data, uint32_t len)
+{
+    uint32_t done = Log_Put(LOG_ITM_PORT_TEXT, (const uint8_t *)data, len, 0U);
+
+    gStats.dropped += len - done;
+    return done;
+}
+
+/**
+  * @brief  Binary event to port 1: a 1-byte id packet, then a 4-byte value
+  *         packet.  Interrupts are masked across both, so pairs from
+  *         different contexts never interleave.
+  */
+void Log_Event(uint8_t id, uint32_t value)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    if (Log_Enabled(LOG_ITM_PORT_EVENT) == 0U)
+    {
+        gStats.dropped += 5U;
+        return;
+    }
+
+    __disable_irq();
+    while (ITM->PORT[LOG_ITM_PORT_EVENT].u32 == 0U)
+    {
+    }
+    ITM->PORT[LOG_ITM_PORT_EVENT].u8 = id;
+    while (ITM->PORT[LOG_ITM_PORT_EVENT].u32 == 0U)
+    {
+    }
+    ITM->PORT[LOG_ITM_PORT_EVENT].u32 = value;
+    __set_PRIMASK(primask);
+
+    gStats.written += 5U;
+}
+
+/**
+  * @brief  DWT PC sample packets every @p cyclesPerSample CPU cycles
+  *         (rounded up to a multiple of 64 up to 1024, of 1024 up to
+  *         16384); 0 turns them off.  Each sample is 5 bytes on the wire:
+  *         at 2 MHz SWO, keep it above ~4000 cycles at 50 MHz or the ITM
+  *         overflows.
+  */
+void Log_PcSampling(uint32_t cyclesPerSample)
+{
+    uint32_t ctrl = DWT->CTRL & ~(DWT_CTRL_PCSAMPLENA_Msk | DWT_CTRL_CYCTAP_Msk |
+                                  DWT_CTRL_POSTINIT_Msk | DWT_CTRL_POSTPRESET_Msk);
+    uint32_t tap = 64U;
+    uint32_t reload;
+
+    /* POSTPRESET may only change with sampling off */
+    DWT->CTRL = ctrl;
+    if (cyclesPerSample == 0U)
+    {
+        return;
+    }
+
+    if (cyclesPerSample > (64U * 16U))
+    {
+        tap   = 1024U;
+        ctrl |= DWT_CTRL_CYCTAP_Msk;
+    }
+    reload = (cyclesPerSample + tap - 1U) / tap;
+    if (reload > 16U)
+    {
+        reload = 16U;
+    }
+
+    DWT->CTRL = ctrl | ((reload - 1U) << DWT_CTRL_POSTPRESET_Pos) |
+                DWT_CTRL_PCSAMPLENA_Msk | DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/**
+  * @brief  Wait until the ITM has emitted everything; the last bytes may
+  *         still be in the TPIU shift register.
+  */
+void Log_Flush(void)
+{
+    if (Log_Enabled(LOG_ITM_PORT_TEXT) == 0U)
+    {
+        return;
+    }
+
+    while ((ITM->TCR & ITM_TCR_BUSY_Msk) != 0U)
+    {
+    }
+}
+
+/**
+  * @brief  No DMA on this transport; kept so it.c is the same for both.
+  */
+void Log_TxIRQHandler(void)
+{
+}
+
+void Log_GetStats(Log_StatsTypeDef *stats)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    memcpy(stats, &gStats, sizeof(*stats));
+    __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  newlib stdout/stderr: everything goes to ITM port 0.
+  */
+int _write(int file, char *ptr, int len)
+{
+    (void)file;
+
+    if (len > 0)
+    {
+        (void)Log_Write(ptr, (uint32_t)len);
+    }
+
+    return len;
+}
+
+#ifdef LOG_BENCH
+/**
+  * @brief  Send the same text through the old path (one blocking HAL
+  *         transmit per byte on the UART) and through ITM port 0, and print
+  *         CPU cycles per line and throughput of each.  The ITM write waits
+  *         for its FIFO, so its CPU figure is also its wire time.
+  */
+void Log_Bench(void)
+{
+    static const char line[] = "log bench 0123456789 abcdefghijklmnopqrstuvwxyz ABCDEFGHIJ\r\n";
+    const uint32_t len   = sizeof(line) - 1U;
+    const uint32_t bytes = len * LOG_BENCH_LINES;
+    uint32_t perByteCycles = 0U;
+    uint32_t itmCycles;
+    uint32_t start;
+    uint32_t i;
+    uint32_t j;
+
+    if ((gHuart != NULL) && (gHuart->Instance != NULL))
+    {
+        start = DWT->CYCCNT;
+        for (i = 0U; i < LOG_BENCH_LINES; i++)
+        {
+            for (j = 0U; j < len; j++)
+            {
+                HAL_UART_Transmit(gHuart, (uint8_t *)&line[j], 1U, HAL_MAX_DELAY);
+            }
+        }
+        perByteCycles = DWT->CYCCNT - start;
+    }
+
+    Log_Flush();
+    start = DWT->CYCCNT;
+    for (i = 0U; i < LOG_BENCH_LINES; i++)
+    {
+        (void)Log_Write(line, len);
+    }
+    Log_Flush();
+    itmCycles = DWT->CYCCNT - start;
+
+    printf("Log bench: %lu lines x %lu B, SWO %lu Hz\r\n",
+           (unsigned long)LOG_BENCH_LINES, (unsigned long)len,
+           (unsigned long)LOG_ITM_SWO_HZ);
+    if (perByteCycles != 0U)
+    {
+        printf("per-byte  cpu %7lu cyc/line  wire %6lu B/s\r\n",
+               (unsigned long)(perByteCycles / LOG_BENCH_LINES),
+               (unsigned long)(((uint64_t)bytes * SystemCoreClock) / perByteCycles));
+    }
+    printf("ITM       cpu %7lu cyc/line  wire %6lu B/s\r\n",
+           (unsigned long)(itmCycles / LOG_BENCH_LINES),
+           (unsigned long)(((uint64_t)bytes * SystemCoreClock) / itmCycles));
+}
+#endif
+
+/* -------------------------------------------------------------------------- */
+/*                               Local helpers                                */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Write @p len bytes to stimulus @p port, a word at a time where
+  *         possible.  Each FIFO check and its store are done with interrupts
+  *         masked: a store to a full FIFO is silently lost.
+  */
+static uint32_t Log_Put(uint32_t port, const uint8_t *src, uint32_t len, uint32_t wait)
+{
+    uint32_t primask = __get_PRIMASK();
+    uint32_t done = 0U;
+    uint32_t word;
+
+    if (Log_Enabled(port) == 0U)
+    {
+        return 0U;
+    }
+
+    while (done < len)
+    {
+        __disable_irq();
+        if (ITM->PORT[port].u32 == 0U)
+        {
+            __set_PRIMASK(primask);
+            if (wait == 0U)
+            {
+                break;
+            }
+            continue;
+        }
+
+        if ((len - done) >= 4U)
+        {
+            memcpy(&word, &src[done], sizeof(word));
+            ITM->PORT[port].u32 = word;
+            done += 4U;
+        }
+        else
+        {
+            ITM->PORT[port].u8 = src[done];
+            done++;
+        }
+        __set_PRIMASK(primask);
+    }
+
+    gStats.written += done;
+    return done;
+}
+
+/**
+  * @brief  Stimulus @p port is usable: ITM on (not reset by a debugger
+  *         session) and the port enabled.
+  */
+static uint32_t Log_Enabled(uint32_t port)
+{
+    return (((ITM->TCR & ITM_TCR_ITMENA_Msk) != 0U) &&
+            ((ITM->TER & (1UL << port)) != 0U)) ? 1U : 0U;
+}
+
+#endif /* LOG_BACKEND_ITM */
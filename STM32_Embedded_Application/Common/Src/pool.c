@@ -0,0 +1,291 @@
+/* Includes ------------------------------------------------------------------*/
+#include "pool.h"
+#include <string.h>
+#include <errno.h>
+#include <reent.h>
+
+/* Private types -------------------------------------------------------------*/
+typedef struct Pool_Block
+{
+    struct Pool_Block *next;
+} Pool_BlockTypeDef;
+
+typedef struct
+{
+    volatile uint32_t head;         /* Pool_BlockTypeDef *, LDREX/STREX      */
+    volatile uint32_t inUse;
+    volatile uint32_t highWater;
+    volatile uint32_t failures;
+    uint32_t          start;
+    uint32_t          end;
+    uint32_t          blockSize;
+} Pool_ClassTypeDef;
+
+/* Private defines -----------------------------------------------------------*/
+#define POOL_X_SIZE(size, blocks)   (size),
+#define POOL_X_BLOCKS(size, blocks) (blocks),
+#define POOL_X_BYTES(size, blocks)  + ((size) * (blocks))
+
+#define POOL_BYTES                  (0U POOL_CLASSES(POOL_X_BYTES))
+
+/* Private variables ---------------------------------------------------------*/
+static const uint16_t gClassSize[POOL_CLASS_COUNT]   = { POOL_CLASSES(POOL_X_SIZE) };
+static const uint16_t gClassBlocks[POOL_CLASS_COUNT] = { POOL_CLASSES(POOL_X_BLOCKS) };
+
+static uint8_t gPoolMem[POOL_BYTES] __attribute__((section(".pool"), aligned(8)));
+static Pool_ClassTypeDef gClass[POOL_CLASS_COUNT];
+
+/* Private function prototypes -----------------------------------------------*/
+static void     *Pool_Pop(Pool_ClassTypeDef *cls);
+static void      Pool_Push(Pool_ClassTypeDef *cls, void *ptr);
+static void      Pool_Add(volatile uint32_t *value, int32_t delta);
+static void      Pool_Max(volatile uint32_t *value, uint32_t candidate);
+static int32_t   Pool_ClassOf(const void *ptr);
+
+/* -------------------------------------------------------------------------- */
+/*                               Public API                                   */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Carve .pool into the size classes and thread the free lists.
+  *         Called first thing in main(), before any interrupt is enabled or
+  *         anything can allocate.
+  */
+void Pool_Init(void)
+{
+    uint32_t addr = (uint32_t)gPoolMem;
+    uint32_t cls;
+    uint32_t i;
+
+    for (cls = 0U; cls < POOL_CLASS_COUNT; cls++)
+    {
+        gClass[cls].blockSize = gClassSize[cls];
+        gClass[cls].start     = addr;
+        gClass[cls].head      = 0U;
+        gClass[cls].inUse     = 0U;
+        gClass[cls].highWater = 0U;
+        gClass[cls].failures  = 0U;
+
+        /* Push in reverse so the lowest block is handed out first */
+        addr += (uint32_t)gClassSize[cls] * gClassBlocks[cls];
+        gClass[cls].end = addr;
+        for (i = gClassBlocks[cls]; i > 0U; i--)
+        {
+            ((Pool_BlockTypeDef *)(gClass[cls].start + ((i - 1U) * gClassSize[cls])))->next =
+                (Pool_BlockTypeDef *)gClass[cls].head;
+            gClass[cls].head = gClass[cls].start + ((i - 1U) * gClassSize[cls]);
+        }
+    }
+}
+
+/**
+  * @brief  Block from the smallest class with room for @p size; falls
+  *         through to larger classes when one is exhausted.
+  */
+void *Pool_Alloc(size_t size)
+{
+    void *ptr;
+    uint32_t cls;
+
+    for (cls = 0U; cls < POOL_CLASS_COUNT; cls++)
+    {
+        if (size > gClass[cls].blockSize)
+        {
+            continue;
+        }
+
+        ptr = Pool_Pop(&gClass[cls]);
+        if (ptr != NULL)
+        {
+            Pool_Add(&gClass[cls].inUse, 1);
+            Pool_Max(&gClass[cls].highWater, gClass[cls].inUse);
+            return ptr;
+        }
+    }
+
+    /* Charged to the smallest class that fits, or the largest if none does */
+    for (cls = 0U; (cls < (POOL_CLASS_COUNT - 1U)) && (size > gClass[cls].blockSize); cls++)
+    {
+    }
+    Pool_Add(&gClass[cls].failures, 1);
+
+    return NULL;
+}
+
+void Pool_Free(void *ptr)
+{
+    int32_t cls = Pool_ClassOf(ptr);
+
+    if (cls < 0)
+    {
+        return;
+    }
+
+    /* Count down first: an ISR may pop the block as soon as it is pushed,
+     * and inUse must never exceed the class size */
+    Pool_Add(&gClass[cls].inUse, -1);
+    Pool_Push(&gClass[cls], ptr);
+}
+
+void Pool_GetStats(uint32_t cls, Pool_StatsTypeDef *stats)
+{
+    stats->blockSize  = gClass[cls].blockSize;
+    stats->blockCount = gClassBlocks[cls];
+    stats->inUse      = gClass[cls].inUse;
+    stats->highWater  = gClass[cls].highWater;
+    stats->failures   = gClass[cls].failures;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                              Local helpers                                 */
+/* -------------------------------------------------------------------------- */
+
+static void *Pool_Pop(Pool_ClassTypeDef *cls)
+{
+    uint32_t head;
+    uint32_t next;
+
+    do
+    {
+        head = __LDREXW(&cls->head);
+        if (head == 0U)
+        {
+            __CLREX();
+            return NULL;
+        }
+        next = (uint32_t)((Pool_BlockTypeDef *)head)->next;
+    } while (__STREXW(next, &cls->head) != 0U);
+
+    return (void *)head;
+}
+
+static void Pool_Push(Pool_ClassTypeDef *cls, void *ptr)
+{
+    uint32_t head;
+
+    do
+    {
+        head = __LDREXW(&cls->head);
+        ((Pool_BlockTypeDef *)ptr)->next = (Pool_BlockTypeDef *)head;
+    } while (__STREXW((uint32_t)ptr, &cls->head) != 0U);
+}
+
+static void Pool_Add(volatile uint32_t *value, int32_t delta)
+{
+    do
+    {
+    } while (__STREXW(__LDREXW(value) + (uint32_t)delta, value) != 0U);
+}
+
+static void Pool_Max(volatile uint32_t *value, uint32_t candidate)
+{
+    uint32_t current;
+
+    do
+    {
+        current = __LDREXW(value);
+        if (current >= candidate)
+        {
+            __CLREX();
+            return;
+        }
+    } while (__STREXW(candidate, value) != 0U);
+}
+
+static int32_t Pool_ClassOf(const void *ptr)
+{
+    uint32_t addr = (uint32_t)ptr;
+    uint32_t cls;
+
+    for (cls = 0U; cls < POOL_CLASS_COUNT; cls++)
+    {
+        if ((addr >= gClass[cls].start) && (addr < gClass[cls].end))
+        {
+            return (int32_t)cls;
+        }
+    }
+
+    return -1;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                               newlib hooks                                 */
+/* -------------------------------------------------------------------------- */
+
+void *_malloc_r(struct _reent *r, size_t size)
+{
+    void *ptr = Pool_Alloc(size);
+
+    if (ptr == NULL)
+    {
+        r->_errno = ENOMEM;
+    }
+    return ptr;
+}
+
+void _free_r(struct _reent *r, void *ptr)
+{
+    (void)r;
+    Pool_Free(ptr);
+}
+
+void *_calloc_r(struct _reent *r, size_t n, size_t size)
+{
+    void *ptr;
+
+    if ((size != 0U) && (n > (0xFFFFFFFFUL / size)))
+    {
+        r->_errno = ENOMEM;
+        return NULL;
+    }
+
+    ptr = _malloc_r(r, n * size);
+    if (ptr != NULL)
+    {
+        memset(ptr, 0, n * size);
+    }
+    return ptr;
+}
+
+void *_realloc_r(struct _reent *r, void *ptr, size_t size)
+{
+    int32_t cls = Pool_ClassOf(ptr);
+    void *fresh;
+
+    if (cls < 0)
+    {
+        return _malloc_r(r, size);
+    }
+    if (size <= gClass[cls].blockSize)
+    {
+        return ptr;
+    }
+
+    fresh = _malloc_r(r, size);
+    if (fresh != NULL)
+    {
+        memcpy(fresh, ptr, gClass[cls].blockSize);
+        Pool_Free(ptr);
+    }
+    return fresh;
+}
+
+void *malloc(size_t size)
+{
+    return _malloc_r(_REENT, size);
+}
+
+void free(void *ptr)
+{
+    Pool_Free(ptr);
+}
+
+void *calloc(size_t n, size_t size)
+{
+    return _calloc_r(_REENT, n, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    return _realloc_r(_REENT, ptr, size);
+}
@@ -0,0 +1,344 @@
+/* Includes ------------------------------------------------------------------*/
+#include "shell.h"
+#include "uart_rx.h"
+#include "log.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define SHELL_CHUNK         64U
+
+/* Private variables ---------------------------------------------------------*/
+static UART_HandleTypeDef         *gHuart;
+static const Shell_CommandTypeDef *gCommands;
+static uint32_t                    gCommandCount;
+
+static char     gLine[SHELL_LINE_MAX];
+static uint32_t gLineLen;
+static uint32_t gLineTooLong;
+static uint8_t  gLastChar;
+static uint32_t gPendingBaud;       /* applied once the OK has gone out   */
+
+/* Private function prototypes -----------------------------------------------*/
+static void Shell_Write(const char *text, uint32_t len);
+static void Shell_Execute(char *line);
+static HAL_StatusTypeDef Shell_CmdHelp(uint32_t argc, char *argv[]);
+static HAL_StatusTypeDef Shell_CmdBaud(uint32_t argc, char *argv[]);
+static HAL_StatusTypeDef Shell_CmdRxStats(uint32_t argc, char *argv[]);
+#ifdef LOG_BACKEND_ITM
+static HAL_StatusTypeDef Shell_CmdPcSample(uint32_t argc, char *argv[]);
+#endif
+
+static const Shell_CommandTypeDef gBuiltins[] =
+{
+    { "help",    "",       Shell_CmdHelp    },
+    { "baud",    "<rate>", Shell_CmdBaud    },
+    { "rxstats", "",       Shell_CmdRxStats },
+#ifdef LOG_BACKEND_ITM
+    { "pcsample", "<cycles>  0 = off", Shell_CmdPcSample },
+#endif
+};
+
+/* -------------------------------------------------------------------------- */
+/*                               Public API                                   */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Attach the shell to @p huart and to the command table.
+  *         UART_Rx_Start() and Log_Init() must have been called on the same
+  *         UART: replies go out through the log channel.
+  */
+void Shell_Init(UART_HandleTypeDef *huart, const Shell_CommandTypeDef *commands,
+                uint32_t count)
+{
+    gHuart        = huart;
+    gCommands     = commands;
+    gCommandCount = count;
+    gLineLen      = 0U;
+    gLineTooLong  = 0U;
+    gLastChar     = 0U;
+    gPendingBaud  = 0U;
+}
+
+/**
+  * @brief  Consume everything received so far and run complete lines.
+  *         Returns the number of lines run, so callers can tell an active
+  *         session from an idle one.
+  */
+uint32_t Shell_Process(void)
+{
+    uint8_t chunk[SHELL_CHUNK];
+    char echo[SHELL_CHUNK * 3U];
+    uint32_t echoLen;
+    uint32_t lines = 0U;
+    uint32_t count;
+    uint32_t i;
+    uint8_t c;
+
+    while ((count = UART_Rx_Read(chunk, sizeof(chunk))) != 0U)
+    {
+        echoLen = 0U;
+
+        for (i = 0U; i < count; i++)
+        {
+            c = chunk[i];
+
+            if ((c == '\r') || (c == '\n'))
+            {
+                /* CRLF is one line end, not an empty line after it */
+                if ((c == '\n') && (gLastChar == '\r'))
+                {
+                    gLastChar = c;
+                    continue;
+                }
+                gLastChar = c;
+
+                echo[echoLen++] = '\r';
+                echo[echoLen++] = '\n';
+                Shell_Write(echo, echoLen);
+                echoLen = 0U;
+
+                gLine[gLineLen] = '\0';
+                if (gLineTooLong != 0U)
+                {
+                    Shell_Printf("ERR line too long\r\n");
+                }
+                else
+                {
+                    Shell_Execute(gLine);
+                }
+                gLineLen     = 0U;
+                gLineTooLong = 0U;
+                lines++;
+
+                if (gPendingBaud != 0U)
+                {
+                    /* Restarts reception: the rest of this chunk is stale */
+                    Log_Flush();
+                    (void)UART_Rx_SetBaud(gPendingBaud);
+                    gPendingBaud = 0U;
+                    break;
+                }
+                continue;
+            }
+            gLastChar = c;
+
+            if ((c == '\b') || (c == 0x7FU))
+            {
+                if (gLineLen > 0U)
+                {
+                    gLineLen--;
+                    echo[echoLen++] = '\b';
+                    echo[echoLen++] = ' ';
+                    echo[echoLen++] = '\b';
+                }
+            }
+            else if ((c >= 0x20U) && (c < 0x7FU))
+            {
+                if (gLineLen < (SHELL_LINE_MAX - 1U))
+                {
+                    gLine[gLineLen++] = (char)c;
+                    echo[echoLen++]   = (char)c;
+                }
+                else
+                {
+                    gLineTooLong = 1U;
+                }
+            }
+        }
+
+        Shell_Write(echo, echoLen);
+    }
+
+    return lines;
+}
+
+/**
+  * @brief  Formatted reply on the shell UART (waits for room in the log
+  *         ring, not for the UART).
+  */
+void Shell_Printf(const char *format, ...)
+{
+    char text[128];
+    va_list args;
+    int len;
+
+    va_start(args, format);
+    len = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+
+    if (len > 0)
+    {
+        Shell_Write(text, strlen(text));
+    }
+}
+
+/**
+  * @brief  Parse a decimal or 0x-prefixed hex number.  Returns 0 if @p text
+  *         is not entirely a number.
+  */
+uint32_t Shell_ParseUint(const char *text, uint32_t *value)
+{
+    char *end;
+
+    if ((text == NULL) || (*text == '\0') || (*text == '-'))
+    {
+        return 0U;
+    }
+
+    *value = (uint32_t)strtoul(text, &end, 0);
+
+    return (*end == '\0') ? 1U : 0U;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                               Local helpers                                */
+/* -------------------------------------------------------------------------- */
+
+static void Shell_Write(const char *text, uint32_t len)
+{
+    if ((gHuart != NULL) && (len > 0U))
+    {
+#ifdef LOG_BACKEND_ITM
+        /* The log goes to SWO; the console stays on the UART */
+        HAL_UART_Transmit(gHuart, (uint8_t *)text, (uint16_t)len, HAL_MAX_DELAY);
+#else
+        (void)Log_Write(text, len);
+#endif
+    }
+}
+
+/**
+  * @brief  Split @p line into words in place and dispatch; built-ins first.
+  */
+static void Shell_Execute(char *line)
+{
+    char *argv[SHELL_MAX_ARGS];
+    const Shell_CommandTypeDef *cmd = NULL;
+    uint32_t argc = 0U;
+    uint32_t i;
+    char *p = line;
+
+    while (*p != '\0')
+    {
+        while (*p == ' ')
+        {
+            *p++ = '\0';
+        }
+        if (*p == '\0')
+        {
+            break;
+        }
+        if (argc == SHELL_MAX_ARGS)
+        {
+            Shell_Printf("ERR too many arguments\r\n");
+            return;
+        }
+        argv[argc++] = p;
+        while ((*p != ' ') && (*p != '\0'))
+        {
+            p++;
+        }
+    }
+
+    if (argc == 0U)
+    {
+        return;
+    }
+
+    for (i = 0U; (i < (sizeof(gBuiltins) / sizeof(gBuiltins[0]))) && (cmd == NULL); i++)
+    {
+        if (strcmp(argv[0], gBuiltins[i].name) == 0)
+        {
+            cmd = &gBuiltins[i];
+        }
+    }
+    for (i = 0U; (i < gCommandCount) && (cmd == NULL); i++)
+    {
+        if (strcmp(argv[0], gCommands[i].name) == 0)
+        {
+            cmd = &gCommands[i];
+        }
+    }
+
+    if (cmd == NULL)
+    {
+        Shell_Printf("ERR unknown command '%s', try help\r\n", argv[0]);
+    }
+    else if (cmd->handler(argc, argv) == HAL_OK)
+    {
+        Shell_Printf("OK\r\n");
+    }
+    else
+    {
+        Shell_Printf("ERR usage: %s %s\r\n", cmd->name, cmd->usage);
+    }
+}
+
+static HAL_StatusTypeDef Shell_CmdHelp(uint32_t argc, char *argv[])
+{
+    uint32_t i;
+
+    (void)argc;
+    (void)argv;
+
+    for (i = 0U; i < (sizeof(gBuiltins) / sizeof(gBuiltins[0])); i++)
+    {
+        Shell_Printf("  %-10s %s\r\n", gBuiltins[i].name, gBuiltins[i].usage);
+    }
+    for (i = 0U; i < gCommandCount; i++)
+    {
+        Shell_Printf("  %-10s %s\r\n", gCommands[i].name, gCommands[i].usage);
+    }
+
+    return HAL_OK;
+}
+
+/* Deferred: the OK still goes out at the old rate */
+static HAL_StatusTypeDef Shell_CmdBaud(uint32_t argc, char *argv[])
+{
+    uint32_t baud;
+
+    if ((argc != 2U) || (Shell_ParseUint(argv[1], &baud) == 0U) ||
+        (baud < UART_RX_BAUD_MIN) || (baud > (HAL_RCC_GetPCLK1Freq() / 8U)))
+    {
+        return HAL_ERROR;
+    }
+
+    gPendingBaud = baud;
+    return HAL_OK;
+}
+
+static HAL_StatusTypeDef Shell_CmdRxStats(uint32_t argc, char *argv[])
+{
+    UART_Rx_StatsTypeDef stats;
+
+    (void)argc;
+    (void)argv;
+
+    UART_Rx_GetStats(&stats);
+    Shell_Printf("rx %lu B, %lu frames, dropped %lu, overruns %lu, errors %lu\r\n",
+                 (unsigned long)stats.bytes, (unsigned long)stats.frames,
+                 (unsigned long)stats.dropped, (unsigned long)stats.overruns,
+                 (unsigned long)stats.errors);
+
+    return HAL_OK;
+}
+
+#ifdef LOG_BACKEND_ITM
+/* DWT PC sampling on SWO, for a statistical profile (tools/swo_parse.py) */
+static HAL_StatusTypeDef Shell_CmdPcSample(uint32_t argc, char *argv[])
+{
+    uint32_t cycles;
+
+    if ((argc != 2U) || (Shell_ParseUint(argv[1], &cycles) == 0U))
+    {
+        return HAL_ERROR;
+    }
+
+    Log_PcSampling(cycles);
+    return HAL_OK;
+}
+#endif
@@ -0,0 +1,34 @@
+/* Includes ------------------------------------------------------------------*/
+#include "timer_clock.h"
+
+/* -------------------------------------------------------------------------- */
+/*                               Public API                                   */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Counter clock of @p tim before its own prescaler, in Hz, for the
+  *         clock tree as it is now.
+  */
+uint32_t Timer_Clock_Get(const TIM_TypeDef *tim)
+{
+    uint32_t pclk;
+
+    if ((uint32_t)tim >= APB2PERIPH_BASE)
+    {
+        pclk = HAL_RCC_GetPCLK2Freq();
+        if ((RCC->CFGR & RCC_CFGR_PPRE2) != RCC_CFGR_PPRE2_DIV1)
+        {
+            pclk *= 2U;
+        }
+    }
+    else
+    {
+        pclk = HAL_RCC_GetPCLK1Freq();
+        if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_CFGR_PPRE1_DIV1)
+        {
+            pclk *= 2U;
+        }
+    }
+
+    return pclk;
+}
@@ -0,0 +1,89 @@
+/* Includes ------------------------------------------------------------------*/
+#include "trace.h"
+#include <stdio.h>
+
+#ifdef TRACE_RECORDER
+
+/* Private variables ---------------------------------------------------------*/
+Trace_RecordTypeDef gTraceRing[TRACE_RING_SIZE];
+uint32_t            gTraceHead;         /* events recorded, free running     */
+volatile uint32_t   gTraceOn;
+
+static const char *gTaskNames[TRACE_MAX_TASKS];
+static uint32_t    gCostCycles;         /* one Trace_Record(), measured      */
+
+/* -------------------------------------------------------------------------- */
+/*                               Public API                                   */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Start the cycle counter, measure the cost of one event and start
+  *         recording into an empty ring.  Call again after a clock change:
+  *         the dump converts cycles with the current SystemCoreClock.
+  */
+void Trace_Init(void)
+{
+    uint32_t start;
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    gTraceOn = 1U;
+    start = DWT->CYCCNT;
+    Trace_Record(TRACE_EV_MARK, 0U, 0U);
+    gCostCycles = DWT->CYCCNT - start;
+
+    gTraceHead = 0U;
+}
+
+/**
+  * @brief  Name task @p id in the dump; @p name must stay valid.
+  */
+void Trace_NameTask(uint8_t id, const char *name)
+{
+    if (id < TRACE_MAX_TASKS)
+    {
+        gTaskNames[id] = name;
+    }
+}
+
+/**
+  * @brief  Print the ring, oldest event first, then empty it.  Recording is
+  *         paused meanwhile, so the dump is one consistent window.
+  */
+void Trace_Dump(void)
+{
+    const Trace_RecordTypeDef *rec;
+    uint32_t head;
+    uint32_t count;
+    uint32_t i;
+
+    gTraceOn = 0U;
+    head  = gTraceHead;
+    count = (head < TRACE_RING_SIZE) ? head : TRACE_RING_SIZE;
+
+    printf("TRACE begin hz=%lu count=%lu lost=%lu cost=%lu\r\n",
+           (unsigned long)SystemCoreClock, (unsigned long)count,
+           (unsigned long)(head - count), (unsigned long)gCostCycles);
+
+    for (i = 0U; i < TRACE_MAX_TASKS; i++)
+    {
+        if (gTaskNames[i] != NULL)
+        {
+            printf("TRACE task %lu %s\r\n", (unsigned long)i, gTaskNames[i]);
+        }
+    }
+
+    for (i = head - count; i != head; i++)
+    {
+        rec = &gTraceRing[i & (TRACE_RING_SIZE - 1U)];
+        printf("TRACE %08lX %08lX\r\n", (unsigned long)rec->cycles, (unsigned long)rec->info);
+    }
+
+    printf("TRACE end\r\n");
+
+    gTraceHead = 0U;
+    gTraceOn   = 1U;
+}
+
+#endif /* TRACE_RECORDER */
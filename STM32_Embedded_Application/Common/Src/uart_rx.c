@@ -0,0 +1,289 @@
+/* Includes ------------------------------------------------------------------*/
+#include "uart_rx.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define UART_RX_MASK            (UART_RX_RING_SIZE - 1U)
+
+#define UART_RX_DMA_STREAM      DMA1_Stream5
+#define UART_RX_DMA_IRQn        DMA1_Stream5_IRQn
+#define UART_RX_DMA_CHANNEL     (4U << DMA_SxCR_CHSEL_Pos)
+#define UART_RX_DMA_FLAGS       (DMA_HISR_TCIF5 | DMA_HISR_HTIF5 | DMA_HISR_TEIF5 | \
+                                 DMA_HISR_DMEIF5 | DMA_HISR_FEIF5)
+#define UART_RX_DMA_ERRORS      (DMA_HISR_TEIF5 | DMA_HISR_DMEIF5)
+#define UART_RX_DMA_HALVES      (DMA_HISR_HTIF5 | DMA_HISR_TCIF5)
+
+/* Private variables ---------------------------------------------------------*/
+/* Written by DMA only */
+static uint8_t gRing[UART_RX_RING_SIZE] DMA_BUFFER;
+
+static UART_HandleTypeDef  *gHuart;
+static volatile uint32_t    gHead;      /* bytes published, ISR only         */
+static uint32_t             gTail;      /* bytes consumed, main loop only    */
+static uint32_t             gLastPos;   /* ring index at the last ISR        */
+static volatile UART_Rx_StatsTypeDef gStats;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t UART_Rx_WriteCount(void);
+
+/* -------------------------------------------------------------------------- */
+/*                               Public API                                   */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Start circular DMA reception on @p huart (USART2 only: the DMA
+  *         stream is fixed).  The UART must already be initialised by HAL;
+  *         the receiver is enabled here whatever Init.Mode says.  The DMA
+  *         interrupt gets the USART2 priority, as both share the state.
+  */
+HAL_StatusTypeDef UART_Rx_Start(UART_HandleTypeDef *huart)
+{
+    DMA_Stream_TypeDef *stream = UART_RX_DMA_STREAM;
+    USART_TypeDef *uart = huart->Instance;
+
+    if (uart != USART2)
+    {
+        return HAL_ERROR;
+    }
+    gHuart = huart;
+
+    __HAL_RCC_DMA1_CLK_ENABLE();
+
+    uart->CR1 &= ~USART_CR1_IDLEIE;
+    uart->CR3 &= ~USART_CR3_DMAR;
+
+    stream->CR &= ~DMA_SxCR_EN;
+    while ((stream->CR & DMA_SxCR_EN) != 0U)
+    {
+    }
+    DMA1->HIFCR = UART_RX_DMA_FLAGS;
+
+    stream->PAR  = (uint32_t)&uart->DR;
+    stream->M0AR = (uint32_t)gRing;
+    stream->NDTR = UART_RX_RING_SIZE;
+    stream->FCR  = 0U;                  /* direct mode, byte to byte */
+    stream->CR   = UART_RX_DMA_CHANNEL | DMA_SxCR_PL_1 | DMA_SxCR_MINC |
+                   DMA_SxCR_CIRC | DMA_SxCR_HTIE | DMA_SxCR_TCIE | DMA_SxCR_TEIE;
+
+    gHead    = 0U;
+    gTail    = 0U;
+    gLastPos = 0U;
+    memset((void *)&gStats, 0, sizeof(gStats));
+
+    /* Drop anything latched before the DMA was ready (SR then DR read) */
+    (void)uart->SR;
+    (void)uart->DR;
+
+    stream->CR |= DMA_SxCR_EN;
+    uart->CR3  |= USART_CR3_DMAR;
+    uart->CR1  |= USART_CR1_RE | USART_CR1_IDLEIE;
+
+    NVIC_SetPriority(UART_RX_DMA_IRQn, NVIC_GetPriority(USART2_IRQn));
+    NVIC_EnableIRQ(UART_RX_DMA_IRQn);
+    NVIC_EnableIRQ(USART2_IRQn);
+
+    return HAL_OK;
+}
+
+/**
+  * @brief  Change the baud rate and restart reception; unread bytes are
+  *         discarded.  Waits for the transmitter to finish first, so a
+  *         reply sent at the old rate goes out intact.
+  */
+HAL_StatusTypeDef UART_Rx_SetBaud(uint32_t baud)
+{
+    uint32_t pclk = HAL_RCC_GetPCLK1Freq();
+
+    if ((gHuart == NULL) || (baud < UART_RX_BAUD_MIN) || (baud > (pclk / 8U)))
+    {
+        return HAL_ERROR;
+    }
+
+    while ((gHuart->Instance->SR & USART_SR_TC) == 0U)
+    {
+    }
+
+    gHuart->Init.BaudRate     = baud;
+    gHuart->Init.OverSampling = (baud > (pclk / 16U)) ? UART_OVERSAMPLING_8
+                                                      : UART_OVERSAMPLING_16;
+    if (HAL_UART_Init(gHuart) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    return UART_Rx_Start(gHuart);
+}
+
+/**
+  * @brief  Publish what the DMA wrote since the last call.  Called from
+  *         USART2_IRQHandler (IDLE) and DMA1_Stream5_IRQHandler (HT/TC).
+  *         In SRAM, so it can run during flash operations.
+  */
+__RAM_FUNC void UART_Rx_IRQHandler(void)
+{
+    USART_TypeDef *uart = USART2;
+    uint32_t sr   = uart->SR;
+    uint32_t hisr = DMA1->HISR & UART_RX_DMA_FLAGS;
+    uint32_t pos;
+    uint32_t delta;
+    uint32_t half;
+
+    if (hisr != 0U)
+    {
+        DMA1->HIFCR = hisr;
+        if ((hisr & UART_RX_DMA_ERRORS) != 0U)
+        {
+            gStats.errors++;
+        }
+    }
+
+    if ((sr & (USART_SR_IDLE | USART_SR_ORE | USART_SR_NE | USART_SR_FE)) != 0U)
+    {
+        /* SR then DR read clears them.  RXNE is clear at IDLE, so this does
+           not take a byte away from the DMA; after ORE one is lost anyway */
+        (void)uart->DR;
+
+        if ((sr & USART_SR_IDLE) != 0U)
+        {
+            gStats.frames++;
+        }
+        if ((sr & USART_SR_ORE) != 0U)
+        {
+            gStats.overruns++;
+        }
+        if ((sr & (USART_SR_NE | USART_SR_FE)) != 0U)
+        {
+            gStats.errors++;
+        }
+    }
+
+    /* Read after the flags were cleared: a boundary crossed from here on
+       raises a flag again */
+    pos   = (UART_RX_RING_SIZE - UART_RX_DMA_STREAM->NDTR) & UART_RX_MASK;
+    delta = (pos - gLastPos) & UART_RX_MASK;
+
+    /* delta cannot see whole laps.  HT and TC both pending mean this
+       handler was held off for at least half a ring, so laps may be hidden
+       in it; a single flag must match the half the DMA is now writing.
+       Either way the backlog is declared one ring longer: the reader then
+       finds itself lapped and resynchronises (UART_Rx_Read) */
+    half = (pos >= (UART_RX_RING_SIZE / 2U)) ? DMA_HISR_HTIF5 : DMA_HISR_TCIF5;
+    if (((hisr & UART_RX_DMA_HALVES) == UART_RX_DMA_HALVES) ||
+        (((hisr & UART_RX_DMA_HALVES) != 0U) && ((hisr & half) == 0U) &&
+         ((DMA1->HISR & UART_RX_DMA_HALVES) == 0U)))
+    {
+        gStats.overruns++;
+        delta += UART_RX_RING_SIZE;
+    }
+
+    gLastPos      = pos;
+    gHead        += delta;
+    gStats.bytes += delta;
+}
+
+/**
+  * @brief  Bytes ready for UART_Rx_Read().
+  */
+uint32_t UART_Rx_Available(void)
+{
+    return gHead - gTail;
+}
+
+/**
+  * @brief  Copy up to @p size received bytes to @p dst.  The DMA keeps
+  *         writing during the copy, so the write count is checked again
+  *         afterwards: if it lapped the copied range, the copy is thrown
+  *         away and the reader resynchronises on the newest half ring.
+  */
+uint32_t UART_Rx_Read(uint8_t *dst, uint32_t size)
+{
+    uint32_t head = gHead;
+    uint32_t tail = gTail;
+    uint32_t count = head - tail;
+    uint32_t index;
+    uint32_t chunk;
+    uint32_t written;
+
+    if (count > size)
+    {
+        count = size;
+    }
+
+    index = tail & UART_RX_MASK;
+    chunk = UART_RX_RING_SIZE - index;
+    if (chunk > count)
+    {
+        chunk = count;
+    }
+    memcpy(dst, &gRing[index], chunk);
+    memcpy(&dst[chunk], gRing, count - chunk);
+
+    written = UART_Rx_WriteCount();
+    if ((written - tail) > UART_RX_RING_SIZE)
+    {
+        gTail = written - (UART_RX_RING_SIZE / 2U);
+        if ((int32_t)(gTail - head) > 0)
+        {
+            gTail = head;
+        }
+        gStats.dropped += gTail - tail;
+        return 0U;
+    }
+
+    gTail = tail + count;
+    return count;
+}
+
+void UART_Rx_GetStats(UART_Rx_StatsTypeDef *stats)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    memcpy(stats, (const void *)&gStats, sizeof(*stats));
+    __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  newlib stdin: blocks until at least one byte is there, then
+  *         returns what is buffered, up to @p len.
+  */
+int _read(int file, char *ptr, int len)
+{
+    uint32_t count;
+
+    (void)file;
+
+    if ((gHuart == NULL) || (len <= 0))
+    {
+        return 0;
+    }
+
+    do
+    {
+        count = UART_Rx_Read((uint8_t *)ptr, (uint32_t)len);
+    } while (count == 0U);
+
+    return (int)count;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                               Local helpers                                */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Bytes written by the DMA so far, including those not yet
+  *         published by the ISR.
+  */
+static uint32_t UART_Rx_WriteCount(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    uint32_t pos;
+    uint32_t count;
+
+    __disable_irq();
+    pos   = (UART_RX_RING_SIZE - UART_RX_DMA_STREAM->NDTR) & UART_RX_MASK;
+    count = gHead + ((pos - gLastPos) & UART_RX_MASK);
+    __set_PRIMASK(primask);
+
+    return count;
+}
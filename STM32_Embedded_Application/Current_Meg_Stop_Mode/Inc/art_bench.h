@@ -0,0 +1,51 @@
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __ART_BENCH_H
+#define __ART_BENCH_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include "main.h"
+
+/*
+ * ART accelerator / prefetch / flash latency benchmark (ART_BENCHMARK in
+ * pwr_modes.h).
+ *
+ *   A fixed CPU workload (flash data reads, branchy sort, calls) runs for
+ *   ART_BENCH_DWELL_MS under every combination of
+ *     - SYSCLK        16 MHz (HSI), 84 MHz and 180 MHz (PLL from HSI)
+ *     - LATENCY       from the minimum for the supply range up to 7 WS
+ *     - PRFTEN/ICEN/DCEN   all 8 combinations
+ *   The DWT cycle counter gives cycles per iteration.  The marker pin is
+ *   high for the whole dwell, so an ammeter on the IDD jumper can be
+ *   triggered on it.  At the end the results are printed on USART2 (ST-LINK
+ *   VCP, 115200 8N1) as CSV, one line per dwell in marker order.
+ *   tools/art_bench_report.py merges them with the measured currents into
+ *   uA/MHz and nJ per iteration.
+ */
+
+#define ART_BENCH_DWELL_MS      1000u
+#define ART_BENCH_GAP_MS        200u    /* marker low between dwells         */
+#define ART_BENCH_MAX_LATENCY   7u
+
+#define ART_BENCH_MARKER_PORT   GPIOA
+#define ART_BENCH_MARKER_PIN    GPIO_Pin_8
+
+typedef struct
+{
+  uint8_t  mhz;
+  uint8_t  latency;                 /* flash wait states                      */
+  uint8_t  prefetch;
+  uint8_t  icache;
+  uint8_t  dcache;
+  uint32_t cyclesX100;              /* cycles per iteration x 100             */
+} ArtBench_ResultTypeDef;
+
+void ArtBench_Run(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ART_BENCH_H */
@@ -0,0 +1,112 @@
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CLK_MGR_H
+#define __CLK_MGR_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include "stm32f4xx.h"
+
+/*
+ * Reference-counted peripheral clock gating.
+ *
+ *   Every driver acquires the clocks it uses and releases them when done.
+ *   The enable bit in RCC_xxxENR is set on the first acquire and cleared
+ *   on the last release.  Clocks acquired with CLK_MGR_SLEEP are also
+ *   counted for RCC_xxxLPENR; they keep running in SLEEP, and every other
+ *   managed LPENR bit is cleared.  (LPENR is all ones after reset.)
+ *
+ *   ClkMgr_EnterLowPower() is called on every low-power entry.  It
+ *   rewrites the enable registers from the counts, so a clock that was
+ *   switched on behind the manager's back is gated too.  Bits not listed
+ *   in CLK_MGR_CLOCKS are left alone.
+ *
+ *   FLITF, SRAM1 and SRAM2 only have an LPENR bit.  Acquire them with
+ *   CLK_MGR_SLEEP when DMA must reach flash or SRAM during SLEEP.
+ */
+
+/* X(name, bus, bit position, LPENR only) */
+#define CLK_MGR_CLOCKS(X)                                                     \
+  X(GPIOA,  CLK_MGR_AHB1, RCC_AHB1ENR_GPIOAEN_Pos,      0u)                   \
+  X(GPIOB,  CLK_MGR_AHB1, RCC_AHB1ENR_GPIOBEN_Pos,      0u)                   \
+  X(GPIOC,  CLK_MGR_AHB1, RCC_AHB1ENR_GPIOCEN_Pos,      0u)                   \
+  X(GPIOD,  CLK_MGR_AHB1, RCC_AHB1ENR_GPIODEN_Pos,      0u)                   \
+  X(GPIOE,  CLK_MGR_AHB1, RCC_AHB1ENR_GPIOEEN_Pos,      0u)                   \
+  X(GPIOF,  CLK_MGR_AHB1, RCC_AHB1ENR_GPIOFEN_Pos,      0u)                   \
+  X(GPIOG,  CLK_MGR_AHB1, RCC_AHB1ENR_GPIOGEN_Pos,      0u)                   \
+  X(GPIOH,  CLK_MGR_AHB1, RCC_AHB1ENR_GPIOHEN_Pos,      0u)                   \
+  X(CRC,    CLK_MGR_AHB1, RCC_AHB1ENR_CRCEN_Pos,        0u)                   \
+  X(BKPSRAM,CLK_MGR_AHB1, RCC_AHB1ENR_BKPSRAMEN_Pos,    0u)                   \
+  X(DMA1,   CLK_MGR_AHB1, RCC_AHB1ENR_DMA1EN_Pos,       0u)                   \
+  X(DMA2,   CLK_MGR_AHB1, RCC_AHB1ENR_DMA2EN_Pos,       0u)                   \
+  X(FLITF,  CLK_MGR_AHB1, RCC_AHB1LPENR_FLITFLPEN_Pos,  1u)                   \
+  X(SRAM1,  CLK_MGR_AHB1, RCC_AHB1LPENR_SRAM1LPEN_Pos,  1u)                   \
+  X(SRAM2,  CLK_MGR_AHB1, RCC_AHB1LPENR_SRAM2LPEN_Pos,  1u)                   \
+  X(OTGFS,  CLK_MGR_AHB2, RCC_AHB2ENR_OTGFSEN_Pos,      0u)                   \
+  X(TIM2,   CLK_MGR_APB1, RCC_APB1ENR_TIM2EN_Pos,       0u)                   \
+  X(TIM3,   CLK_MGR_APB1, RCC_APB1ENR_TIM3EN_Pos,       0u)                   \
+  X(TIM4,   CLK_MGR_APB1, RCC_APB1ENR_TIM4EN_Pos,       0u)                   \
+  X(TIM5,   CLK_MGR_APB1, RCC_APB1ENR_TIM5EN_Pos,       0u)                   \
+  X(TIM6,   CLK_MGR_APB1, RCC_APB1ENR_TIM6EN_Pos,       0u)                   \
+  X(TIM7,   CLK_MGR_APB1, RCC_APB1ENR_TIM7EN_Pos,       0u)                   \
+  X(WWDG,   CLK_MGR_APB1, RCC_APB1ENR_WWDGEN_Pos,       0u)                   \
+  X(SPI2,   CLK_MGR_APB1, RCC_APB1ENR_SPI2EN_Pos,       0u)                   \
+  X(SPI3,   CLK_MGR_APB1, RCC_APB1ENR_SPI3EN_Pos,       0u)                   \
+  X(USART2, CLK_MGR_APB1, RCC_APB1ENR_USART2EN_Pos,     0u)                   \
+  X(USART3, CLK_MGR_APB1, RCC_APB1ENR_USART3EN_Pos,     0u)                   \
+  X(UART4,  CLK_MGR_APB1, RCC_APB1ENR_UART4EN_Pos,      0u)                   \
+  X(UART5,  CLK_MGR_APB1, RCC_APB1ENR_UART5EN_Pos,      0u)                   \
+  X(I2C1,   CLK_MGR_APB1, RCC_APB1ENR_I2C1EN_Pos,       0u)                   \
+  X(I2C2,   CLK_MGR_APB1, RCC_APB1ENR_I2C2EN_Pos,       0u)                   \
+  X(I2C3,   CLK_MGR_APB1, RCC_APB1ENR_I2C3EN_Pos,       0u)                   \
+  X(CAN1,   CLK_MGR_APB1, RCC_APB1ENR_CAN1EN_Pos,       0u)                   \
+  X(CAN2,   CLK_MGR_APB1, RCC_APB1ENR_CAN2EN_Pos,       0u)                   \
+  X(PWR,    CLK_MGR_APB1, RCC_APB1ENR_PWREN_Pos,        0u)                   \
+  X(DAC,    CLK_MGR_APB1, RCC_APB1ENR_DACEN_Pos,        0u)                   \
+  X(TIM1,   CLK_MGR_APB2, RCC_APB2ENR_TIM1EN_Pos,       0u)                   \
+  X(TIM8,   CLK_MGR_APB2, RCC_APB2ENR_TIM8EN_Pos,       0u)                   \
+  X(USART1, CLK_MGR_APB2, RCC_APB2ENR_USART1EN_Pos,     0u)                   \
+  X(USART6, CLK_MGR_APB2, RCC_APB2ENR_USART6EN_Pos,     0u)                   \
+  X(ADC1,   CLK_MGR_APB2, RCC_APB2ENR_ADC1EN_Pos,       0u)                   \
+  X(ADC2,   CLK_MGR_APB2, RCC_APB2ENR_ADC2EN_Pos,       0u)                   \
+  X(ADC3,   CLK_MGR_APB2, RCC_APB2ENR_ADC3EN_Pos,       0u)                   \
+  X(SPI1,   CLK_MGR_APB2, RCC_APB2ENR_SPI1EN_Pos,       0u)                   \
+  X(SYSCFG, CLK_MGR_APB2, RCC_APB2ENR_SYSCFGEN_Pos,     0u)                   \
+  X(TIM9,   CLK_MGR_APB2, RCC_APB2ENR_TIM9EN_Pos,       0u)                   \
+  X(TIM10,  CLK_MGR_APB2, RCC_APB2ENR_TIM10EN_Pos,      0u)                   \
+  X(TIM11,  CLK_MGR_APB2, RCC_APB2ENR_TIM11EN_Pos,      0u)
+
+typedef enum
+{
+  CLK_MGR_AHB1 = 0,
+  CLK_MGR_AHB2,
+  CLK_MGR_AHB3,
+  CLK_MGR_APB1,
+  CLK_MGR_APB2,
+  CLK_MGR_BUS_COUNT
+} ClkMgr_BusTypeDef;
+
+#define CLK_MGR_ENUM(name, bus, bit, lpOnly)  CLK_##name,
+typedef enum
+{
+  CLK_MGR_CLOCKS(CLK_MGR_ENUM)
+  CLK_MGR_COUNT
+} ClkMgr_IdTypeDef;
+#undef CLK_MGR_ENUM
+
+/* Acquire / release flags */
+#define CLK_MGR_RUN             0x0u    /* clocked in RUN only                */
+#define CLK_MGR_SLEEP           0x1u    /* also clocked in SLEEP (LPENR)      */
+
+void     ClkMgr_Init(void);
+void     ClkMgr_Acquire(ClkMgr_IdTypeDef id, uint32_t flags);
+void     ClkMgr_Release(ClkMgr_IdTypeDef id, uint32_t flags);
+uint32_t ClkMgr_IsHeld(ClkMgr_IdTypeDef id);
+void     ClkMgr_EnterLowPower(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CLK_MGR_H */
@@ -0,0 +1,63 @@
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __GPIO_CTX_H
+#define __GPIO_CTX_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include "stm32f4xx.h"
+
+/*
+ * GPIO context save / restore around STOP.
+ *
+ *   GpioCtx_EnterLowPower() snapshots MODER, OTYPER, OSPEEDR, PUPDR, ODR
+ *   and AFR of GPIOA..GPIOH.  It then switches every pin that is not in
+ *   the port's keep mask to analog with one MODER write per port.  Analog
+ *   mode disconnects the input Schmitt trigger and the pull resistors, so
+ *   no other register needs to change.
+ *
+ *   GpioCtx_Restore() writes the snapshot back, MODER last, so outputs
+ *   come back at their previous level and alternate functions are set
+ *   before the pins are reconnected.
+ *
+ *   Keep wake-up inputs and anything that must drive a level during STOP
+ *   (GpioCtx_Keep).  Port clocks are taken from clk_mgr only for the
+ *   duration of each call.
+ */
+
+#define GPIO_CTX_PORT_COUNT     8u      /* GPIOA..GPIOH                      */
+
+/* Index of a port for GpioCtx_Keep() */
+#define GPIO_CTX_PORT_A         0u
+#define GPIO_CTX_PORT_B         1u
+#define GPIO_CTX_PORT_C         2u
+#define GPIO_CTX_PORT_D         3u
+#define GPIO_CTX_PORT_E         4u
+#define GPIO_CTX_PORT_F         5u
+#define GPIO_CTX_PORT_G         6u
+#define GPIO_CTX_PORT_H         7u
+
+/* Keep SWDIO / SWCLK (PA13, PA14) so a debugger stays attached in STOP */
+/* #define GPIO_CTX_KEEP_SWD */
+
+typedef struct
+{
+  uint32_t moder;
+  uint32_t otyper;
+  uint32_t ospeedr;
+  uint32_t pupdr;
+  uint32_t odr;
+  uint32_t afr[2];
+} GpioCtx_PortTypeDef;
+
+void GpioCtx_Init(void);
+void GpioCtx_Keep(uint32_t port, uint16_t pins);
+void GpioCtx_EnterLowPower(void);
+void GpioCtx_Restore(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __GPIO_CTX_H */
@@ -12,7 +12,6 @@
 /* Exported functions ------------------------------------------------------- */
 void ButtonPinInt_configuration(void);
 void WaitUser_PushBotton (void);
-void GPIO_AnalogConfig (void);
 void Measure_Stop (void);
 void Delay(__IO uint32_t nTime);
 
@@ -9,14 +9,28 @@
 #include "main.h"
 /*************************** ART accelerator configuration*********************/
 
-/* Uncomment the macros to enable ART with or without prefetch buffer */
+/* Uncomment the macros to enable ART with or without prefetch buffer.
+   Applied at start-up by PWR_FlashAccelConfig(); with neither defined the
+   flash runs with instruction/data caches and prefetch off. */
 
-/*Enable ART*/
+/*Enable ART (instruction and data caches)*/
  // #define ART_Enable
 
 /*Enbale prefetch when ART is enabled */
  // #define  Prefetch_Enable
 
+/* Uncomment to build the ART/prefetch/latency benchmark (art_bench.h)
+   instead of the STOP mode measurements */
+ // #define ART_BENCHMARK
+
+/* Uncomment to loop in STOP and wake on USART2 RX (uart_wake.h); the host
+   commands the node with tools/uart_wake_bench.py */
+ // #define UART_WAKE
+
+/* STOP sub-mode used by the UART_WAKE loop; its wake-up time bounds the
+   usable baud rate */
+#define UART_WAKE_STOP_ENTRY()  PWR_StopLowPwrRegFlashPwrDown()
+
 /********************* Power supply selection *********************************/
 
 /* Uncomment the macros to select 3,3 V or 1,8 V as power supply */
@@ -36,6 +50,11 @@
 //#define StopLowPwrRegUnderDriveFlashPwrDown
 
 
+/***************************** Run mode  **************************************/
+
+/* Flash accelerator as selected by ART_Enable / Prefetch_Enable */
+void PWR_FlashAccelConfig (void);
+
 /***************************** STOP mode  *************************************/
 
 /* Stop mode, Main Regulator with Flash Stop */
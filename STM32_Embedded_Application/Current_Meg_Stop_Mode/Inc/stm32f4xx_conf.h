@@ -7,7 +7,7 @@
 /* #include "stm32f4xx_adc.h" */
 /* #include "stm32f4xx_crc.h" */
 #include "stm32f4xx_dbgmcu.h"
-/* #include "stm32f4xx_dma.h" */
+#include "stm32f4xx_dma.h"
 #include "stm32f4xx_exti.h"
 #include "stm32f4xx_flash.h"
 #include "stm32f4xx_gpio.h"
@@ -20,7 +20,7 @@
 /* #include "stm32f4xx_spi.h" */
 #include "stm32f4xx_syscfg.h"
 /* #include "stm32f4xx_tim.h" */
-/* #include "stm32f4xx_usart.h" */
+#include "stm32f4xx_usart.h"
 /* #include "stm32f4xx_wwdg.h" */
 #include "misc.h" /* High level functions for NVIC and SysTick (add-on to CMSIS functions) */
 
@@ -0,0 +1,58 @@
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __UART_WAKE_H
+#define __UART_WAKE_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include "stm32f4xx.h"
+
+/*
+ * Wake-on-serial for STOP (UART_WAKE in pwr_modes.h).
+ *
+ *   USART2 on PA2 (TX) / PA3 (RX), the ST-LINK virtual COM port.  Before
+ *   STOP, UartWake_Arm() turns PA3 into a plain input with EXTI line 3 on
+ *   the falling edge.  The falling edge of the first start bit wakes the
+ *   core, which resumes on HSI, the clock the baud rate is set up for:
+ *   the demo leaves the PLL for HSI with undivided APB buses before
+ *   UartWake_Init(), and STOP keeps the prescalers, so PCLK1 is 16 MHz in
+ *   the wake handler and after Mode_Exit() alike.
+ *   The EXTI handler then hands PA3 back to the USART and enables the
+ *   receiver.  From then on bytes go through DMA1 Stream5 Channel 4 into a
+ *   circular buffer while the rest of the system is still being restored.
+ *
+ *   The byte whose start bit woke the node cannot be received.  Hosts
+ *   therefore send UART_WAKE_CHAR (0xFF) first.  It is low only during the
+ *   start bit, so the receiver can be switched on at any point of it and
+ *   still sync on the next start bit.  The first real frame is kept if
+ *   wake-up plus UartWake_IRQHandler() take less than 10 bit times.
+ *   tools/uart_wake_bench.py measures the highest baud rate at which that
+ *   holds.
+ */
+
+#define UART_WAKE_BAUD          115200u
+#define UART_WAKE_CHAR          0xFFu
+#define UART_WAKE_RX_SIZE       256u    /* circular DMA buffer, bytes        */
+
+typedef struct
+{
+  uint32_t wakes;                   /* EXTI wake-ups on PA3                   */
+  uint32_t readyCycles;             /* handler entry -> receiver on, last     */
+  uint32_t readyCyclesMax;
+  uint32_t baud;
+} UartWake_StatsTypeDef;
+
+void     UartWake_Init(uint32_t baud);
+void     UartWake_SetBaud(uint32_t baud);
+void     UartWake_Arm(void);
+uint32_t UartWake_Read(uint8_t *dst, uint32_t size);
+void     UartWake_Write(const char *text);
+void     UartWake_GetStats(UartWake_StatsTypeDef *stats);
+void     UartWake_IRQHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __UART_WAKE_H */
@@ -0,0 +1,368 @@
+/**
+  ******************************************************************************
+  * @file    art_bench.c
+  * @brief   ART accelerator / prefetch / flash latency A/B benchmark
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+
+#include "stm32f4xx.h"
+#include "pwr_modes.h"
+#include "art_bench.h"
+#include "clk_mgr.h"
+
+#ifdef ART_BENCHMARK
+
+/* Private defines -----------------------------------------------------------*/
+#define HSI_MHZ             16u
+
+/* Wait states per frequency step (RM0390, "Number of wait states according
+ * to CPU clock frequency"); 180 MHz needs over-drive and VDD >= 2.7 V */
+#if defined VDD3_3
+#define MHZ_PER_WS          30u
+#define PLL_MHZ_HIGH        180u
+#else
+#define MHZ_PER_WS          20u
+#define PLL_MHZ_HIGH        144u
+#endif
+
+#define FREQ_COUNT          3u
+#define ACR_COMBOS          8u      /* PRFTEN, ICEN, DCEN                     */
+#define MAX_RESULTS         (FREQ_COUNT * (ART_BENCH_MAX_LATENCY + 1u) * ACR_COMBOS)
+
+#define SORT_LEN            32u
+#define SCAN_WORDS          512u    /* 2 KB of flash, larger than D-cache     */
+
+/* Private variables ---------------------------------------------------------*/
+static const uint8_t gFreqMhz[FREQ_COUNT] = { HSI_MHZ, 84u, PLL_MHZ_HIGH };
+
+static ArtBench_ResultTypeDef gResults[MAX_RESULTS];
+static uint32_t gResultCount;
+static uint32_t gSortBuf[SORT_LEN];
+static uint32_t gSeed = 1u;
+static volatile uint32_t gSink;
+
+/* Private function prototypes -----------------------------------------------*/
+static void     ArtBench_IoInit(void);
+static void     ArtBench_SetClock(uint32_t mhz);
+static void     ArtBench_SetAcr(uint32_t latency, uint32_t combo);
+static uint32_t ArtBench_Dwell(uint32_t mhz);
+static void     ArtBench_Wait(uint32_t mhz, uint32_t ms);
+static void     ArtBench_Print(const char *text);
+static void     ArtBench_Workload(void);
+static uint32_t ArtBench_ScanFlash(uint32_t acc) __attribute__((noinline));
+static uint32_t ArtBench_Sort(void) __attribute__((noinline));
+static uint32_t ArtBench_Mix(uint32_t a, uint32_t b) __attribute__((noinline));
+
+/* -------------------------------------------------------------------------- */
+/*                               Public API                                   */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Run every clock / latency / accelerator combination, then print
+  *         the results.  Starts after a push on the user button so the
+  *         ammeter can be armed first.
+  */
+void ArtBench_Run(void)
+{
+  ArtBench_ResultTypeDef *r;
+  char line[64];
+  uint32_t f;
+  uint32_t ws;
+  uint32_t minWs;
+  uint32_t combo;
+  uint32_t i;
+
+  ClkMgr_Acquire(CLK_GPIOA, CLK_MGR_RUN);
+  ClkMgr_Acquire(CLK_USART2, CLK_MGR_RUN);
+  ArtBench_IoInit();
+
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  ArtBench_Print("ART benchmark: press the user button to start\r\n");
+  WaitUser_PushBotton();
+
+  gResultCount = 0u;
+  for (f = 0u; f < FREQ_COUNT; f++)
+  {
+    ArtBench_SetClock(gFreqMhz[f]);
+    minWs = (gFreqMhz[f] - 1u) / MHZ_PER_WS;
+
+    for (ws = minWs; ws <= ART_BENCH_MAX_LATENCY; ws++)
+    {
+      for (combo = 0u; combo < ACR_COMBOS; combo++)
+      {
+        ArtBench_SetAcr(ws, combo);
+
+        r = &gResults[gResultCount++];
+        r->mhz        = gFreqMhz[f];
+        r->latency    = (uint8_t)ws;
+        r->prefetch   = (uint8_t)((combo >> 0) & 1u);
+        r->icache     = (uint8_t)((combo >> 1) & 1u);
+        r->dcache     = (uint8_t)((combo >> 2) & 1u);
+        r->cyclesX100 = ArtBench_Dwell(gFreqMhz[f]);
+
+        ArtBench_Wait(gFreqMhz[f], ART_BENCH_GAP_MS);
+      }
+    }
+  }
+
+  /* Report at HSI with the reset-default accelerator setting */
+  ArtBench_SetClock(HSI_MHZ);
+  ArtBench_SetAcr(0u, 7u);
+  ArtBench_IoInit();
+
+  ArtBench_Print("idx,mhz,ws,prften,icen,dcen,cycles_per_iter\r\n");
+  for (i = 0u; i < gResultCount; i++)
+  {
+    r = &gResults[i];
+    snprintf(line, sizeof(line), "%lu,%u,%u,%u,%u,%u,%lu.%02lu\r\n",
+             (unsigned long)i, r->mhz, r->latency, r->prefetch, r->icache, r->dcache,
+             (unsigned long)(r->cyclesX100 / 100u), (unsigned long)(r->cyclesX100 % 100u));
+    ArtBench_Print(line);
+  }
+  ArtBench_Print("done\r\n");
+
+  ClkMgr_Release(CLK_USART2, CLK_MGR_RUN);
+  ClkMgr_Release(CLK_GPIOA, CLK_MGR_RUN);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                               Local helpers                                */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Marker pin and USART2 TX (PA2, AF7) at 115200 baud.  Clocks are
+  *         held by ArtBench_Run().
+  */
+static void ArtBench_IoInit(void)
+{
+  GPIO_InitTypeDef  gpio;
+  USART_InitTypeDef usart;
+
+  gpio.GPIO_Pin   = ART_BENCH_MARKER_PIN;
+  gpio.GPIO_Mode  = GPIO_Mode_OUT;
+  gpio.GPIO_OType = GPIO_OType_PP;
+  gpio.GPIO_PuPd  = GPIO_PuPd_NOPULL;
+  gpio.GPIO_Speed = GPIO_Speed_2MHz;
+  GPIO_Init(ART_BENCH_MARKER_PORT, &gpio);
+  GPIO_ResetBits(ART_BENCH_MARKER_PORT, ART_BENCH_MARKER_PIN);
+
+  GPIO_PinAFConfig(GPIOA, GPIO_PinSource2, GPIO_AF_USART2);
+  gpio.GPIO_Pin  = GPIO_Pin_2;
+  gpio.GPIO_Mode = GPIO_Mode_AF;
+  GPIO_Init(GPIOA, &gpio);
+
+  USART_StructInit(&usart);
+  usart.USART_BaudRate = 115200u;
+  usart.USART_Mode     = USART_Mode_Tx;
+  USART_Init(USART2, &usart);
+  USART_Cmd(USART2, ENABLE);
+}
+
+/**
+  * @brief  Switch SYSCLK to HSI, or to the PLL at @p mhz (HSI / 8 * N / 2).
+  *         Flash latency is at its maximum while the clock changes.
+  */
+static void ArtBench_SetClock(uint32_t mhz)
+{
+  FLASH->ACR = (FLASH->ACR & ~FLASH_ACR_LATENCY) | FLASH_ACR_LATENCY_7WS;
+
+  RCC_SYSCLKConfig(RCC_SYSCLKSource_HSI);
+  while (RCC_GetSYSCLKSource() != 0x00)
+  {
+  }
+  RCC_PLLCmd(DISABLE);
+  PWR_OverDriveSWCmd(DISABLE);
+  PWR_OverDriveCmd(DISABLE);
+
+  RCC_HCLKConfig(RCC_SYSCLK_Div1);
+  RCC_PCLK1Config(RCC_HCLK_Div1);
+  RCC_PCLK2Config(RCC_HCLK_Div1);
+
+  if (mhz == HSI_MHZ)
+  {
+    return;
+  }
+
+  /* APB1 <= 45 MHz, APB2 <= 90 MHz */
+  RCC_PCLK1Config(RCC_HCLK_Div4);
+  RCC_PCLK2Config(RCC_HCLK_Div2);
+
+  PWR_MainRegulatorModeConfig(PWR_Regulator_Voltage_Scale1);
+  RCC_PLLConfig(RCC_PLLSource_HSI, 8u, mhz, 2u, 7u, 2u);
+  RCC_PLLCmd(ENABLE);
+  while (RCC_GetFlagStatus(RCC_FLAG_PLLRDY) == RESET)
+  {
+  }
+
+  if (mhz > 168u)
+  {
+    PWR_OverDriveCmd(ENABLE);
+    while (PWR_GetFlagStatus(PWR_FLAG_ODRDY) == RESET)
+    {
+    }
+    PWR_OverDriveSWCmd(ENABLE);
+    while (PWR_GetFlagStatus(PWR_FLAG_ODSWRDY) == RESET)
+    {
+    }
+  }
+
+  RCC_SYSCLKConfig(RCC_SYSCLKSource_PLLCLK);
+  while (RCC_GetSYSCLKSource() != 0x08)
+  {
+  }
+}
+
+/**
+  * @brief  Apply @p latency and the accelerator bits of @p combo (bit 0
+  *         PRFTEN, bit 1 ICEN, bit 2 DCEN).  Both caches are flushed so
+  *         every dwell starts cold.
+  */
+static void ArtBench_SetAcr(uint32_t latency, uint32_t combo)
+{
+  uint32_t acr = latency;
+
+  FLASH->ACR &= ~(FLASH_ACR_ICEN | FLASH_ACR_DCEN);
+  FLASH->ACR |= FLASH_ACR_ICRST | FLASH_ACR_DCRST;
+  FLASH->ACR &= ~(FLASH_ACR_ICRST | FLASH_ACR_DCRST);
+
+  if ((combo & 1u) != 0u)
+  {
+    acr |= FLASH_ACR_PRFTEN;
+  }
+  if ((combo & 2u) != 0u)
+  {
+    acr |= FLASH_ACR_ICEN;
+  }
+  if ((combo & 4u) != 0u)
+  {
+    acr |= FLASH_ACR_DCEN;
+  }
+
+  FLASH->ACR = acr;
+  while ((FLASH->ACR & FLASH_ACR_LATENCY) != latency)
+  {
+  }
+}
+
+/**
+  * @brief  Run the workload for ART_BENCH_DWELL_MS with the marker high.
+  * @retval cycles per iteration x 100
+  */
+static uint32_t ArtBench_Dwell(uint32_t mhz)
+{
+  uint32_t budget = mhz * 1000u * ART_BENCH_DWELL_MS;
+  uint32_t iterations = 0u;
+  uint32_t elapsed;
+  uint32_t start;
+
+  GPIO_SetBits(ART_BENCH_MARKER_PORT, ART_BENCH_MARKER_PIN);
+
+  start = DWT->CYCCNT;
+  do
+  {
+    ArtBench_Workload();
+    iterations++;
+    elapsed = DWT->CYCCNT - start;
+  } while (elapsed < budget);
+
+  GPIO_ResetBits(ART_BENCH_MARKER_PORT, ART_BENCH_MARKER_PIN);
+
+  return (uint32_t)(((uint64_t)elapsed * 100u) / iterations);
+}
+
+static void ArtBench_Wait(uint32_t mhz, uint32_t ms)
+{
+  uint32_t start = DWT->CYCCNT;
+
+  while ((DWT->CYCCNT - start) < (mhz * 1000u * ms))
+  {
+  }
+}
+
+static void ArtBench_Print(const char *text)
+{
+  while (*text != '\0')
+  {
+    while (USART_GetFlagStatus(USART2, USART_FLAG_TXE) == RESET)
+    {
+    }
+    USART_SendData(USART2, (uint16_t)*text++);
+  }
+  while (USART_GetFlagStatus(USART2, USART_FLAG_TC) == RESET)
+  {
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                  Workload                                  */
+/* -------------------------------------------------------------------------- */
+/*
+ * One iteration: a streaming read over 2 KB of flash (data path, D-cache
+ * misses, prefetch), an insertion sort of 32 pseudo-random words (branches,
+ * I-cache) and a chain of non-inlined calls (literal pools, branch targets).
+ */
+
+static void ArtBench_Workload(void)
+{
+  uint32_t acc;
+
+  acc = ArtBench_ScanFlash(gSeed);
+  acc = ArtBench_Mix(acc, ArtBench_Sort());
+  gSink = acc;
+}
+
+static uint32_t ArtBench_ScanFlash(uint32_t acc)
+{
+  const uint32_t *p = (const uint32_t *)FLASH_BASE;
+  uint32_t i;
+
+  for (i = 0u; i < SCAN_WORDS; i++)
+  {
+    acc = ((acc << 5) | (acc >> 27)) ^ p[i];
+  }
+
+  return acc;
+}
+
+static uint32_t ArtBench_Sort(void)
+{
+  uint32_t i;
+  uint32_t j;
+  uint32_t key;
+
+  for (i = 0u; i < SORT_LEN; i++)
+  {
+    gSeed = (gSeed * 1664525u) + 1013904223u;
+    gSortBuf[i] = gSeed >> 8;
+  }
+
+  for (i = 1u; i < SORT_LEN; i++)
+  {
+    key = gSortBuf[i];
+    for (j = i; (j > 0u) && (gSortBuf[j - 1u] > key); j--)
+    {
+      gSortBuf[j] = gSortBuf[j - 1u];
+    }
+    gSortBuf[j] = key;
+  }
+
+  return gSortBuf[SORT_LEN / 2u];
+}
+
+static uint32_t ArtBench_Mix(uint32_t a, uint32_t b)
+{
+  switch (a & 3u)
+  {
+    case 0u:  return a + b;
+    case 1u:  return a ^ (b << 3);
+    case 2u:  return (a * 0x9E3779B1u) ^ b;
+    default:  return a - (b >> 2);
+  }
+}
+
+#endif /* ART_BENCHMARK */
@@ -0,0 +1,158 @@
+/**
+  ******************************************************************************
+  * @file    clk_mgr.c
+  * @brief   Reference-counted peripheral clock gating (RCC ENR / LPENR)
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "clk_mgr.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  uint8_t bus;
+  uint8_t bit;
+  uint8_t lpOnly;
+} ClkMgr_EntryTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+#define CLK_MGR_ENTRY(name, bus, bit, lpOnly)  { (bus), (bit), (lpOnly) },
+static const ClkMgr_EntryTypeDef gEntries[CLK_MGR_COUNT] =
+{
+  CLK_MGR_CLOCKS(CLK_MGR_ENTRY)
+};
+#undef CLK_MGR_ENTRY
+
+static volatile uint32_t * const gEnr[CLK_MGR_BUS_COUNT] =
+{
+  &RCC->AHB1ENR, &RCC->AHB2ENR, &RCC->AHB3ENR, &RCC->APB1ENR, &RCC->APB2ENR
+};
+
+static volatile uint32_t * const gLpEnr[CLK_MGR_BUS_COUNT] =
+{
+  &RCC->AHB1LPENR, &RCC->AHB2LPENR, &RCC->AHB3LPENR, &RCC->APB1LPENR, &RCC->APB2LPENR
+};
+
+static uint8_t  gRunCount[CLK_MGR_COUNT];
+static uint8_t  gSleepCount[CLK_MGR_COUNT];
+
+static uint32_t gManaged[CLK_MGR_BUS_COUNT];     /* ENR bits owned here       */
+static uint32_t gManagedLp[CLK_MGR_BUS_COUNT];   /* LPENR bits owned here     */
+static uint32_t gRunMask[CLK_MGR_BUS_COUNT];
+static uint32_t gSleepMask[CLK_MGR_BUS_COUNT];
+
+/* -------------------------------------------------------------------------- */
+/*                               Public API                                   */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Take ownership of the listed clocks: gate all of them in RUN and
+  *         in SLEEP.  Call once at start-up, before any driver init.
+  */
+void ClkMgr_Init(void)
+{
+  uint32_t i;
+
+  for (i = 0u; i < CLK_MGR_BUS_COUNT; i++)
+  {
+    gManaged[i]   = 0u;
+    gManagedLp[i] = 0u;
+    gRunMask[i]   = 0u;
+    gSleepMask[i] = 0u;
+  }
+
+  for (i = 0u; i < CLK_MGR_COUNT; i++)
+  {
+    gRunCount[i]   = 0u;
+    gSleepCount[i] = 0u;
+
+    if (gEntries[i].lpOnly == 0u)
+    {
+      gManaged[gEntries[i].bus] |= (1uL << gEntries[i].bit);
+    }
+    gManagedLp[gEntries[i].bus] |= (1uL << gEntries[i].bit);
+  }
+
+  ClkMgr_EnterLowPower();
+}
+
+/**
+  * @brief  Take a reference on @p id.  The clock is running on return.
+  * @param  flags  CLK_MGR_RUN, or CLK_MGR_SLEEP to keep it in SLEEP too
+  */
+void ClkMgr_Acquire(ClkMgr_IdTypeDef id, uint32_t flags)
+{
+  const ClkMgr_EntryTypeDef *e = &gEntries[id];
+  uint32_t mask = 1uL << e->bit;
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+
+  if ((gRunCount[id]++ == 0u) && (e->lpOnly == 0u))
+  {
+    gRunMask[e->bus] |= mask;
+    *gEnr[e->bus] |= mask;
+    (void)*gEnr[e->bus];            /* delay after an RCC clock enable       */
+  }
+
+  if (((flags & CLK_MGR_SLEEP) != 0u) && (gSleepCount[id]++ == 0u))
+  {
+    gSleepMask[e->bus] |= mask;
+    *gLpEnr[e->bus] |= mask;
+  }
+
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Drop a reference taken with the same @p flags.  The clock is
+  *         gated when the last reference goes.
+  */
+void ClkMgr_Release(ClkMgr_IdTypeDef id, uint32_t flags)
+{
+  const ClkMgr_EntryTypeDef *e = &gEntries[id];
+  uint32_t mask = 1uL << e->bit;
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+
+  if (((flags & CLK_MGR_SLEEP) != 0u) && (gSleepCount[id] != 0u) && (--gSleepCount[id] == 0u))
+  {
+    gSleepMask[e->bus] &= ~mask;
+    *gLpEnr[e->bus] &= ~mask;
+  }
+
+  if ((gRunCount[id] != 0u) && (--gRunCount[id] == 0u) && (e->lpOnly == 0u))
+  {
+    gRunMask[e->bus] &= ~mask;
+    *gEnr[e->bus] &= ~mask;
+  }
+
+  __set_PRIMASK(primask);
+}
+
+uint32_t ClkMgr_IsHeld(ClkMgr_IdTypeDef id)
+{
+  return (gRunCount[id] != 0u) ? 1u : 0u;
+}
+
+/**
+  * @brief  Low-power entry: gate every managed clock that nobody holds and
+  *         limit SLEEP clocks to the CLK_MGR_SLEEP references.
+  */
+void ClkMgr_EnterLowPower(void)
+{
+  uint32_t primask = __get_PRIMASK();
+  uint32_t i;
+
+  __disable_irq();
+
+  for (i = 0u; i < CLK_MGR_BUS_COUNT; i++)
+  {
+    *gEnr[i]   = (*gEnr[i]   & ~gManaged[i])   | gRunMask[i];
+    *gLpEnr[i] = (*gLpEnr[i] & ~gManagedLp[i]) | gSleepMask[i];
+  }
+
+  __set_PRIMASK(primask);
+}
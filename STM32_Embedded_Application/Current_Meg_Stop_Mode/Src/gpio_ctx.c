@@ -0,0 +1,154 @@
+/**
+  ******************************************************************************
+  * @file    gpio_ctx.c
+  * @brief   GPIO context save / restore around STOP
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "gpio_ctx.h"
+#include "clk_mgr.h"
+
+/* Private variables ---------------------------------------------------------*/
+static GPIO_TypeDef * const gPorts[GPIO_CTX_PORT_COUNT] =
+{
+  GPIOA, GPIOB, GPIOC, GPIOD, GPIOE, GPIOF, GPIOG, GPIOH
+};
+
+static GpioCtx_PortTypeDef gSaved[GPIO_CTX_PORT_COUNT];
+static uint16_t gKeep[GPIO_CTX_PORT_COUNT];
+static uint8_t  gValid;
+
+/* Private function prototypes -----------------------------------------------*/
+static void     GpioCtx_Clocks(uint32_t on);
+static uint32_t GpioCtx_Spread(uint16_t pins);
+
+/* -------------------------------------------------------------------------- */
+/*                               Public API                                   */
+/* -------------------------------------------------------------------------- */
+
+void GpioCtx_Init(void)
+{
+  uint32_t i;
+
+  for (i = 0u; i < GPIO_CTX_PORT_COUNT; i++)
+  {
+    gKeep[i] = 0u;
+  }
+  gValid = 0u;
+
+#if defined GPIO_CTX_KEEP_SWD
+  gKeep[GPIO_CTX_PORT_A] = GPIO_Pin_13 | GPIO_Pin_14;
+#endif
+}
+
+/**
+  * @brief  Leave @p pins of @p port untouched in STOP.
+  */
+void GpioCtx_Keep(uint32_t port, uint16_t pins)
+{
+  gKeep[port] |= pins;
+}
+
+/**
+  * @brief  Snapshot all ports, then set every pin outside the keep masks
+  *         to analog: one MODER write per port.
+  */
+void GpioCtx_EnterLowPower(void)
+{
+  GPIO_TypeDef *gpio;
+  GpioCtx_PortTypeDef *s;
+  uint32_t i;
+
+  GpioCtx_Clocks(1u);
+
+  for (i = 0u; i < GPIO_CTX_PORT_COUNT; i++)
+  {
+    gpio = gPorts[i];
+    s    = &gSaved[i];
+
+    s->moder   = gpio->MODER;
+    s->otyper  = gpio->OTYPER;
+    s->ospeedr = gpio->OSPEEDR;
+    s->pupdr   = gpio->PUPDR;
+    s->odr     = gpio->ODR;
+    s->afr[0]  = gpio->AFR[0];
+    s->afr[1]  = gpio->AFR[1];
+
+    /* Analog is 0b11: set both MODER bits of every pin not kept */
+    gpio->MODER = s->moder | ~GpioCtx_Spread(gKeep[i]);
+  }
+  gValid = 1u;
+
+  GpioCtx_Clocks(0u);
+}
+
+/**
+  * @brief  Put every port back as it was at GpioCtx_EnterLowPower().
+  */
+void GpioCtx_Restore(void)
+{
+  GPIO_TypeDef *gpio;
+  const GpioCtx_PortTypeDef *s;
+  uint32_t i;
+
+  if (gValid == 0u)
+  {
+    return;
+  }
+
+  GpioCtx_Clocks(1u);
+
+  for (i = 0u; i < GPIO_CTX_PORT_COUNT; i++)
+  {
+    gpio = gPorts[i];
+    s    = &gSaved[i];
+
+    gpio->ODR     = s->odr;
+    gpio->AFR[0]  = s->afr[0];
+    gpio->AFR[1]  = s->afr[1];
+    gpio->OTYPER  = s->otyper;
+    gpio->OSPEEDR = s->ospeedr;
+    gpio->PUPDR   = s->pupdr;
+    gpio->MODER   = s->moder;
+  }
+  gValid = 0u;
+
+  GpioCtx_Clocks(0u);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                               Local helpers                                */
+/* -------------------------------------------------------------------------- */
+
+static void GpioCtx_Clocks(uint32_t on)
+{
+  uint32_t i;
+
+  for (i = 0u; i < GPIO_CTX_PORT_COUNT; i++)
+  {
+    if (on != 0u)
+    {
+      ClkMgr_Acquire((ClkMgr_IdTypeDef)(CLK_GPIOA + i), CLK_MGR_RUN);
+    }
+    else
+    {
+      ClkMgr_Release((ClkMgr_IdTypeDef)(CLK_GPIOA + i), CLK_MGR_RUN);
+    }
+  }
+}
+
+/**
+  * @brief  One bit per pin -> two bits per pin (pin n -> bits 2n, 2n+1).
+  */
+static uint32_t GpioCtx_Spread(uint16_t pins)
+{
+  uint32_t x = pins;
+
+  x = (x | (x << 8)) & 0x00FF00FFu;
+  x = (x | (x << 4)) & 0x0F0F0F0Fu;
+  x = (x | (x << 2)) & 0x33333333u;
+  x = (x | (x << 1)) & 0x55555555u;
+
+  return x | (x << 1);
+}
@@ -10,8 +10,16 @@
   */
 
 /* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "main.h"
 #include "pwr_modes.h"
+#include "art_bench.h"
+#include "clk_mgr.h"
+#include "gpio_ctx.h"
+#include "uart_wake.h"
 
 /* Global state -------------------------------------------------------------*/
 __IO uint32_t uwCounter        = 0x00;
@@ -19,8 +27,13 @@ __IO uint8_t  UserButtonStatus = RESET;
 
 /* Local functions ----------------------------------------------------------*/
 static void Mode_Exit(void);
+static void Clock_RunOnHsi(void);
 static void LedsConfig(void);
 static void LowPowerDemo_Init(void);
+#if defined UART_WAKE
+static void Measure_UartWake(void);
+static void UartWake_HandleCommand(void);
+#endif
 
 /**
   * @brief  Application entry point.
@@ -31,8 +44,16 @@ int main(void)
   /* Basic initialization for the low-power demo */
   LowPowerDemo_Init();
 
+#if defined ART_BENCHMARK
+  /* Cycles and current for every ART / prefetch / latency setting */
+  ArtBench_Run();
+#elif defined UART_WAKE
+  /* Sleep in STOP, wake and answer on USART2 */
+  Measure_UartWake();
+#else
   /* Execute the selected STOP mode scenarios */
   Measure_Stop();
+#endif
 
   /* Application remains here; device will enter/exit STOP through callbacks */
   while (1)
@@ -49,14 +70,25 @@ int main(void)
   */
 static void LowPowerDemo_Init(void)
 {
-  /* Enable PWR APB1 clock */
-  RCC_APB1PeriphClockCmd(RCC_APB1Periph_PWR, ENABLE);
+  /* Gate every peripheral clock, then take the ones this demo keeps:
+   * PWR for the low-power modes, GPIOA for the LED */
+  ClkMgr_Init();
+  ClkMgr_Acquire(CLK_PWR, CLK_MGR_RUN);
+  ClkMgr_Acquire(CLK_GPIOA, CLK_MGR_RUN);
+
+  /* Flash accelerator as selected in pwr_modes.h */
+  PWR_FlashAccelConfig();
 
   /* LED used as a simple status indicator */
   LedsConfig();
 
   /* Configure user button as external interrupt (wakeup source) */
   ButtonPinInt_configuration();
+
+  /* The button is the STOP wake-up source: keep PC13 out of the analog
+   * switch-over, every other pin is parked and restored per STOP cycle */
+  GpioCtx_Init();
+  GpioCtx_Keep(GPIO_CTX_PORT_C, GPIO_Pin_13);
 }
 
 /**
@@ -69,7 +101,7 @@ void Measure_Stop(void)
 
   /* Wait for user action, then enter STOP (main regulator, Flash in STOP) */
   WaitUser_PushBotton();
-  GPIO_AnalogConfig();
+  GpioCtx_EnterLowPower();
   PWR_StopMainRegFlashStop();
   Mode_Exit();
   UserButtonStatus = RESET;
@@ -80,7 +112,7 @@ void Measure_Stop(void)
 
   /* STOP with main regulator and Flash in deep power-down */
   WaitUser_PushBotton();
-  GPIO_AnalogConfig();
+  GpioCtx_EnterLowPower();
   PWR_StopMainRegFlashPwrDown();
   Mode_Exit();
   UserButtonStatus = RESET;
@@ -91,7 +123,7 @@ void Measure_Stop(void)
 
   /* STOP with low-power regulator, Flash kept in STOP */
   WaitUser_PushBotton();
-  GPIO_AnalogConfig();
+  GpioCtx_EnterLowPower();
   PWR_StopLowPwrRegFlashStop();
   Mode_Exit();
   UserButtonStatus = RESET;
@@ -102,8 +134,8 @@ void Measure_Stop(void)
 
   /* STOP with low-power regulator and Flash in deep power-down */
   WaitUser_PushBotton();
-  /* Optional: configure GPIO as analog here if needed */
-  GPIO_AnalogConfig();
+  /* Unused pins to analog; the snapshot is restored in Mode_Exit() */
+  GpioCtx_EnterLowPower();
   PWR_StopLowPwrRegFlashPwrDown();
   Mode_Exit();
   UserButtonStatus = RESET;
@@ -114,7 +146,7 @@ void Measure_Stop(void)
 
   /* STOP with main regulator in under-drive mode and Flash power-down */
   WaitUser_PushBotton();
-  GPIO_AnalogConfig();
+  GpioCtx_EnterLowPower();
   PWR_StopMainRegUnderDriveFlashPwrDown();
   Mode_Exit();
   UserButtonStatus = RESET;
@@ -125,7 +157,7 @@ void Measure_Stop(void)
 
   /* STOP with low-power regulator in under-drive and Flash power-down */
   WaitUser_PushBotton();
-  GPIO_AnalogConfig();
+  GpioCtx_EnterLowPower();
   PWR_StopLowPwrRegUnderDriveFlashPwrDown();
   Mode_Exit();
   UserButtonStatus = RESET;
@@ -133,45 +165,98 @@ void Measure_Stop(void)
 #endif /* StopLowPwrRegUnderDriveFlashPwrDown */
 }
 
+#if defined UART_WAKE
 /**
-  * @brief  Put all GPIOs in analog mode to minimize current consumption.
+  * @brief  STOP / wake-on-serial loop.  Each wake-up handles one command
+  *         line from the host, replies, and goes back to STOP.
   */
-void GPIO_AnalogConfig(void)
+static void Measure_UartWake(void)
 {
-  GPIO_InitTypeDef gpio;
+  /* Same clock tree as after every wake-up: BRR stays right throughout */
+  Clock_RunOnHsi();
+  UartWake_Init(UART_WAKE_BAUD);
 
-  /* Enable all GPIO ports clocks */
-  RCC_AHB1PeriphClockCmd(
-      RCC_AHB1Periph_GPIOA | RCC_AHB1Periph_GPIOB |
-      RCC_AHB1Periph_GPIOC | RCC_AHB1Periph_GPIOD |
-      RCC_AHB1Periph_GPIOE | RCC_AHB1Periph_GPIOH,
-      ENABLE);
+  /* TX keeps driving idle-high, RX is handed to EXTI by UartWake_Arm() */
+  GpioCtx_Keep(GPIO_CTX_PORT_A, GPIO_Pin_2 | GPIO_Pin_3);
 
-  RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_GPIOF | RCC_AHB1Periph_GPIOG, ENABLE);
+  while (1)
+  {
+    GpioCtx_EnterLowPower();
+    UartWake_Arm();
+    UART_WAKE_STOP_ENTRY();
+    Mode_Exit();
 
-  gpio.GPIO_Mode  = GPIO_Mode_AN;
-  gpio.GPIO_Speed = GPIO_Speed_50MHz;
-  gpio.GPIO_PuPd  = GPIO_PuPd_NOPULL;
-  gpio.GPIO_Pin   = GPIO_Pin_All;
+    UartWake_HandleCommand();
+  }
+}
 
-  GPIO_Init(GPIOA, &gpio);
-  GPIO_Init(GPIOB, &gpio);
-  GPIO_Init(GPIOC, &gpio);
-  GPIO_Init(GPIOD, &gpio);
-  GPIO_Init(GPIOE, &gpio);
-  GPIO_Init(GPIOF, &gpio);
-  GPIO_Init(GPIOG, &gpio);
-  GPIO_Init(GPIOH, &gpio);
-
-  /* Disable clocks again once configuration is done */
-  RCC_AHB1PeriphClockCmd(
-      RCC_AHB1Periph_GPIOA | RCC_AHB1Periph_GPIOB |
-      RCC_AHB1Periph_GPIOC | RCC_AHB1Periph_GPIOD |
-      RCC_AHB1Periph_GPIOE | RCC_AHB1Periph_GPIOH,
-      DISABLE);
-
-  RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_GPIOF | RCC_AHB1Periph_GPIOG, DISABLE);
+/**
+  * @brief  Collect one line (wake characters and noise before it dropped)
+  *         for up to 50 ms and execute it:
+  *           PING         -> PONG <wakes> <ready cycles> <max ready cycles>
+  *           BAUD <rate>  -> OK, then switch to <rate>
+  *         Nothing is sent back if the line was lost, which is what the
+  *         host counts as a failed wake-up.
+  */
+static void UartWake_HandleCommand(void)
+{
+  UartWake_StatsTypeDef stats;
+  char line[32];
+  char reply[64];
+  uint32_t len = 0u;
+  uint32_t start = DWT->CYCCNT;
+  uint32_t baud;
+  uint32_t complete = 0u;
+  uint8_t c;
+
+  while ((complete == 0u) && ((DWT->CYCCNT - start) < (HSI_VALUE / 20u)))
+  {
+    if (UartWake_Read(&c, 1u) == 0u)
+    {
+      continue;
+    }
+    if (c == '\n')
+    {
+      complete = 1u;
+    }
+    else if ((c >= ' ') && (c < 0x7Fu) && (len < (sizeof(line) - 1u)))
+    {
+      line[len++] = (char)c;
+    }
+  }
+  line[len] = '\0';
+
+  if (complete == 0u)
+  {
+    return;
+  }
+
+  if (strcmp(line, "PING") == 0)
+  {
+    UartWake_GetStats(&stats);
+    snprintf(reply, sizeof(reply), "PONG %lu %lu %lu\n", (unsigned long)stats.wakes,
+             (unsigned long)stats.readyCycles, (unsigned long)stats.readyCyclesMax);
+    UartWake_Write(reply);
+  }
+  else if (strncmp(line, "BAUD ", 5u) == 0)
+  {
+    baud = (uint32_t)strtoul(&line[5], NULL, 10);
+    if ((baud >= 1200u) && (baud <= 2000000u))
+    {
+      UartWake_Write("OK\n");
+      UartWake_SetBaud(baud);
+    }
+    else
+    {
+      UartWake_Write("ERR\n");
+    }
+  }
+  else
+  {
+    UartWake_Write("ERR\n");
+  }
 }
+#endif /* UART_WAKE */
 
 /**
   * @brief  Configure LED (PA5 on NUCLEO-F446RE) as push-pull output.
@@ -180,9 +265,7 @@ static void LedsConfig(void)
 {
   GPIO_InitTypeDef gpio;
 
-  /* Enable port A clock */
-  RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_GPIOA, ENABLE);
-
+  /* Port A clock is held from LowPowerDemo_Init() */
   gpio.GPIO_Pin   = GPIO_Pin_5;
   gpio.GPIO_Mode  = GPIO_Mode_OUT;
   gpio.GPIO_OType = GPIO_OType_PP;
@@ -204,9 +287,10 @@ void ButtonPinInt_configuration(void)
   EXTI_InitTypeDef  exti;
   NVIC_InitTypeDef  nvic;
 
-  /* Enable GPIOC and SYSCFG clocks */
-  RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_GPIOC, ENABLE);
-  RCC_APB2PeriphClockCmd(RCC_APB2Periph_SYSCFG, ENABLE);
+  /* GPIOC and SYSCFG clocks are only needed while configuring: the EXTI
+   * input path and the EXTICR setting work with both gated */
+  ClkMgr_Acquire(CLK_GPIOC, CLK_MGR_RUN);
+  ClkMgr_Acquire(CLK_SYSCFG, CLK_MGR_RUN);
 
   /* PC13 as input */
   gpio.GPIO_Pin   = GPIO_Pin_13;
@@ -227,6 +311,9 @@ void ButtonPinInt_configuration(void)
   exti.EXTI_LineCmd = ENABLE;
   EXTI_Init(&exti);
 
+  ClkMgr_Release(CLK_SYSCFG, CLK_MGR_RUN);
+  ClkMgr_Release(CLK_GPIOC, CLK_MGR_RUN);
+
   /* Configure NVIC for EXTI15_10_IRQn */
   nvic.NVIC_IRQChannel = EXTI15_10_IRQn;
   nvic.NVIC_IRQChannelPreemptionPriority = 0;
@@ -259,9 +346,23 @@ void WaitUser_PushBotton(void)
   * @brief  Reconfigure the system after exiting STOP mode.
   *         - Reset RCC configuration
   *         - Switch system clock back to HSI
-  *         - Re-enable PWR and I/O used in the demo
+  *         - Restore the GPIO state saved before STOP
   */
 static void Mode_Exit(void)
+{
+  Clock_RunOnHsi();
+
+  /* Every pin back as the application left it (LED included); EXTI and
+   * NVIC settings of the button are retained in STOP */
+  GpioCtx_Restore();
+}
+
+/**
+  * @brief  HSI as SYSCLK, PLL off, AHB and APB prescalers at /1.  STOP
+  *         keeps the prescalers, so once this has run the core wakes up
+  *         with the same 16 MHz PCLK1 it has after Mode_Exit().
+  */
+static void Clock_RunOnHsi(void)
 {
   /* Reset RCC to default reset state */
   RCC_DeInit();
@@ -282,13 +383,6 @@ static void Mode_Exit(void)
   {
     /* wait until switch is complete */
   }
-
-  /* Re-enable PWR clock */
-  RCC_APB1PeriphClockCmd(RCC_APB1Periph_PWR, ENABLE);
-
-  /* Re-initialize LED and button EXTI configuration */
-  LedsConfig();
-  ButtonPinInt_configuration();
 }
 
 /**
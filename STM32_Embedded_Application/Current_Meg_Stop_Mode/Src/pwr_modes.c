@@ -15,6 +15,7 @@
 #include "stm32f4xx.h"
 #include "pwr_modes.h"
 #include "main.h"
+#include "clk_mgr.h"
 
 /* Private defines -----------------------------------------------------------*/
 #define WakeupCounter       0xA000u
@@ -28,31 +29,28 @@ GPIO_InitTypeDef GPIO_InitStructure;
 static void PWR_PrepareForStopMode(void);
 
 /**
-  * @brief  Disable clocks for almost all AHBx/APBx peripherals.
-  *         Can be used to reduce dynamic power before entering low-power mode.
+  * @brief  Configure the flash ART accelerator from the ART_Enable and
+  *         Prefetch_Enable selections in pwr_modes.h.
   */
-void DisableAllAHBxAPBxPeriClocks(void)
+void PWR_FlashAccelConfig(void)
 {
-  /* Clear all enable bits in clock control registers.
-   * For details see RM (RCC section). */
-  RCC->AHB1ENR &= ~(0xFFFFFFFFu);
-  RCC->AHB2ENR &= ~(0xFFFFFFFFu);
-  RCC->AHB3ENR &= ~(0xFFFFFFFFu);
-  RCC->APB1ENR &= ~(0xFFFFFFFFu);
-  RCC->APB2ENR &= ~(0xFFFFFFFFu);
-}
-
-/**
-  * @brief  Restore a useful default clock configuration for AHBx/APBx domains.
-  *         Values are taken from the original example and may be adapted.
-  */
-void EnableAllAHBxAPBxPeriClocks(void)
-{
-  RCC->AHB1ENR |= 0x606410FFu;
-  RCC->AHB2ENR |= ((1u << 0) | (1u << 7));
-  RCC->AHB3ENR |= 0x00000003u;
-  RCC->APB1ENR |= 0x3FFFC9FFu;
-  RCC->APB2ENR |= 0x00C77F66u;
+  /* Caches must be disabled while they are reset */
+  FLASH_InstructionCacheCmd(DISABLE);
+  FLASH_DataCacheCmd(DISABLE);
+  FLASH_InstructionCacheReset();
+  FLASH_DataCacheReset();
+
+#if defined ART_Enable
+  FLASH_InstructionCacheCmd(ENABLE);
+  FLASH_DataCacheCmd(ENABLE);
+#if defined Prefetch_Enable
+  FLASH_PrefetchBufferCmd(ENABLE);
+#else
+  FLASH_PrefetchBufferCmd(DISABLE);
+#endif /* Prefetch_Enable */
+#else
+  FLASH_PrefetchBufferCmd(DISABLE);
+#endif /* ART_Enable */
 }
 
 /* -------------------------------------------------------------------------- */
@@ -63,6 +61,7 @@ void EnableAllAHBxAPBxPeriClocks(void)
   * @brief Common preparation used by all STOP mode variants.
   *        - Clear wakeup flag
   *        - Configure button / wakeup source
+  *        - Gate every peripheral clock nobody holds
   */
 static void PWR_PrepareForStopMode(void)
 {
@@ -71,6 +70,9 @@ static void PWR_PrepareForStopMode(void)
 
   /* Configure the button EXTI as wakeup source */
   ButtonPinInt_configuration();
+
+  /* Only clocks with a reference survive; they stay gated after wake */
+  ClkMgr_EnterLowPower();
 }
 
 /**
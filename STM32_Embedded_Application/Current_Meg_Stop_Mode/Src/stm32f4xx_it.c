@@ -1,5 +1,6 @@
 /* Includes ------------------------------------------------------------------*/
 #include "stm32f4xx_it.h"
+#include "uart_wake.h"
 
 /** @addtogroup STM32F4xx current consumption
   * @{
@@ -122,6 +123,17 @@ void EXTI15_10_IRQHandler(void)
   }
 }
 
+/**
+  * @brief  This function handles EXTI Line 3 interrupt (USART2 RX on PA3,
+  *         wake-on-serial).
+  * @param  None
+  * @retval None
+  */
+void EXTI3_IRQHandler(void)
+{
+  UartWake_IRQHandler();
+}
+
 /**
   * @brief  This function handles RTC Auto wake-up interrupt request.
   * @param  None
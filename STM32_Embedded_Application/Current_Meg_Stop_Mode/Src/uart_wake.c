@@ -0,0 +1,200 @@
+/**
+  ******************************************************************************
+  * @file    uart_wake.c
+  * @brief   USART2 wake-on-serial from STOP with circular DMA reception
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "uart_wake.h"
+#include "clk_mgr.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define RX_PIN_POS          3u                          /* PA3               */
+#define RX_MODER_MASK       (3uL << (2u * RX_PIN_POS))
+#define RX_MODER_AF         (2uL << (2u * RX_PIN_POS))
+
+#define RX_DMA_STREAM       DMA1_Stream5
+#define RX_DMA_CHANNEL      DMA_Channel_4
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t  gRxBuf[UART_WAKE_RX_SIZE] __attribute__((aligned(4)));
+static uint32_t gTail;
+static UartWake_StatsTypeDef gStats;
+
+/* -------------------------------------------------------------------------- */
+/*                               Public API                                   */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  USART2 8N1 at @p baud, RX into the circular DMA buffer, EXTI3
+  *         prepared for PA3.  Clocks stay held for the wake path.
+  */
+void UartWake_Init(uint32_t baud)
+{
+  GPIO_InitTypeDef gpio;
+  EXTI_InitTypeDef exti;
+  NVIC_InitTypeDef nvic;
+  DMA_InitTypeDef  dma;
+
+  ClkMgr_Acquire(CLK_GPIOA, CLK_MGR_RUN);
+  ClkMgr_Acquire(CLK_USART2, CLK_MGR_RUN);
+  ClkMgr_Acquire(CLK_DMA1, CLK_MGR_RUN);
+
+  /* PA2 TX, PA3 RX; pull-up keeps RX idle-high while the host is absent */
+  GPIO_PinAFConfig(GPIOA, GPIO_PinSource2, GPIO_AF_USART2);
+  GPIO_PinAFConfig(GPIOA, GPIO_PinSource3, GPIO_AF_USART2);
+  gpio.GPIO_Pin   = GPIO_Pin_2 | GPIO_Pin_3;
+  gpio.GPIO_Mode  = GPIO_Mode_AF;
+  gpio.GPIO_OType = GPIO_OType_PP;
+  gpio.GPIO_PuPd  = GPIO_PuPd_UP;
+  gpio.GPIO_Speed = GPIO_Speed_2MHz;
+  GPIO_Init(GPIOA, &gpio);
+
+  /* DMA1 Stream5 Channel4: USART2_RX, circular, byte wide */
+  DMA_DeInit(RX_DMA_STREAM);
+  DMA_StructInit(&dma);
+  dma.DMA_Channel            = RX_DMA_CHANNEL;
+  dma.DMA_PeripheralBaseAddr = (uint32_t)&USART2->DR;
+  dma.DMA_Memory0BaseAddr    = (uint32_t)gRxBuf;
+  dma.DMA_DIR                = DMA_DIR_PeripheralToMemory;
+  dma.DMA_BufferSize         = UART_WAKE_RX_SIZE;
+  dma.DMA_MemoryInc          = DMA_MemoryInc_Enable;
+  dma.DMA_Mode               = DMA_Mode_Circular;
+  dma.DMA_Priority           = DMA_Priority_High;
+  DMA_Init(RX_DMA_STREAM, &dma);
+  DMA_Cmd(RX_DMA_STREAM, ENABLE);
+  gTail = 0u;
+
+  UartWake_SetBaud(baud);
+
+  /* EXTI line 3 routed to PA3; unmasked only while armed */
+  ClkMgr_Acquire(CLK_SYSCFG, CLK_MGR_RUN);
+  SYSCFG_EXTILineConfig(EXTI_PortSourceGPIOA, EXTI_PinSource3);
+  ClkMgr_Release(CLK_SYSCFG, CLK_MGR_RUN);
+
+  exti.EXTI_Line    = EXTI_Line3;
+  exti.EXTI_Mode    = EXTI_Mode_Interrupt;
+  exti.EXTI_Trigger = EXTI_Trigger_Falling;
+  exti.EXTI_LineCmd = DISABLE;
+  EXTI_Init(&exti);
+
+  nvic.NVIC_IRQChannel                   = EXTI3_IRQn;
+  nvic.NVIC_IRQChannelPreemptionPriority = 0;
+  nvic.NVIC_IRQChannelSubPriority        = 0;
+  nvic.NVIC_IRQChannelCmd                = ENABLE;
+  NVIC_Init(&nvic);
+
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/**
+  * @brief  Change the baud rate.  BRR is computed for the current PCLK1,
+  *         so the clock tree must already be the one used after STOP:
+  *         Measure_UartWake() switches to HSI before UartWake_Init().
+  */
+void UartWake_SetBaud(uint32_t baud)
+{
+  USART_InitTypeDef usart;
+
+  USART_Cmd(USART2, DISABLE);
+
+  /* Oversampling by 8 doubles the reachable rate on a 16 MHz clock */
+  USART_OverSampling8Cmd(USART2, (baud > 1000000u) ? ENABLE : DISABLE);
+
+  USART_StructInit(&usart);
+  usart.USART_BaudRate = baud;
+  usart.USART_Mode     = USART_Mode_Tx | USART_Mode_Rx;
+  USART_Init(USART2, &usart);
+
+  USART_DMACmd(USART2, USART_DMAReq_Rx, ENABLE);
+  USART_Cmd(USART2, ENABLE);
+
+  gStats.baud = baud;
+}
+
+/**
+  * @brief  Prepare for STOP: receiver off, PA3 as input with EXTI3 on the
+  *         falling edge.  Call after GpioCtx_EnterLowPower(), right before
+  *         entering STOP.
+  */
+void UartWake_Arm(void)
+{
+  /* Let a reply in progress finish */
+  while (USART_GetFlagStatus(USART2, USART_FLAG_TC) == RESET)
+  {
+  }
+
+  USART2->CR1 &= ~USART_CR1_RE;
+  GPIOA->MODER &= ~RX_MODER_MASK;
+
+  EXTI->PR   = EXTI_PR_PR3;
+  EXTI->IMR |= EXTI_IMR_MR3;
+}
+
+/**
+  * @brief  Copy up to @p size received bytes out of the DMA ring.
+  * @retval number of bytes copied
+  */
+uint32_t UartWake_Read(uint8_t *dst, uint32_t size)
+{
+  uint32_t head = UART_WAKE_RX_SIZE - DMA_GetCurrDataCounter(RX_DMA_STREAM);
+  uint32_t n = 0u;
+
+  if (head >= UART_WAKE_RX_SIZE)
+  {
+    head = 0u;
+  }
+
+  while ((gTail != head) && (n < size))
+  {
+    dst[n++] = gRxBuf[gTail];
+    gTail = (gTail + 1u) % UART_WAKE_RX_SIZE;
+  }
+
+  return n;
+}
+
+void UartWake_Write(const char *text)
+{
+  while (*text != '\0')
+  {
+    while (USART_GetFlagStatus(USART2, USART_FLAG_TXE) == RESET)
+    {
+    }
+    USART_SendData(USART2, (uint16_t)*text++);
+  }
+  while (USART_GetFlagStatus(USART2, USART_FLAG_TC) == RESET)
+  {
+  }
+}
+
+void UartWake_GetStats(UartWake_StatsTypeDef *stats)
+{
+  *stats = gStats;
+}
+
+/**
+  * @brief  EXTI3: first start bit after STOP.  Straight register writes;
+  *         every cycle here comes out of the wake character's 9 idle bits.
+  */
+void UartWake_IRQHandler(void)
+{
+  uint32_t start = DWT->CYCCNT;
+  uint32_t cycles;
+
+  GPIOA->MODER = (GPIOA->MODER & ~RX_MODER_MASK) | RX_MODER_AF;
+  USART2->CR1 |= USART_CR1_RE;
+
+  EXTI->IMR &= ~EXTI_IMR_MR3;
+  EXTI->PR   = EXTI_PR_PR3;
+
+  cycles = DWT->CYCCNT - start;
+  gStats.wakes++;
+  gStats.readyCycles = cycles;
+  if (cycles > gStats.readyCyclesMax)
+  {
+    gStats.readyCyclesMax = cycles;
+  }
+}
@@ -0,0 +1,44 @@
+#ifndef CAPTURE_H_
+#define CAPTURE_H_
+
+#include "stm32f4xx_hal.h"
+
+/*
+ * Input-capture measurement engine.
+ *
+ *   TIM5 runs in PWM-input mode on PA1 (TIM5_CH2):
+ *     CH2 (direct, rising)    -> period
+ *     CH1 (indirect, falling) -> high time
+ *   The counter is reset on every rising edge, so each capture already is a
+ *   period / pulse width in timer ticks.  The CH2 capture request drives a
+ *   two-word DMA burst (CCR1, CCR2) on DMA1 Stream4 Channel6: at the rising
+ *   edge that closes a cycle CCR1 still holds that cycle's falling edge, so
+ *   every ring entry pairs a period with its own high time.  The stream runs
+ *   in circular mode and interrupts the CPU only at half/full transfer;
+ *   Capture_Process() drains the ring in batches from thread context.
+ */
+
+/* Ring length in captures, i.e. high/period pairs (must be even) */
+#define CAPTURE_BUF_LEN      512U
+
+typedef struct
+{
+    uint32_t edges;          /* periods accumulated in this batch          */
+    uint32_t overruns;       /* ring laps lost because Process ran too late */
+    uint32_t periodMin;      /* ticks                                       */
+    uint32_t periodMax;      /* ticks                                       */
+    float    freqHz;         /* mean input frequency                        */
+    float    dutyPct;        /* mean duty cycle                             */
+    float    jitterRmsNs;    /* standard deviation of the period            */
+    float    jitterPkPkNs;   /* periodMax - periodMin                       */
+} Capture_StatsTypeDef;
+
+extern TIM_HandleTypeDef gTim5Handle;
+extern DMA_HandleTypeDef gDmaTim5Ch2Handle;
+
+void Capture_Init(void);
+void Capture_Start(void);
+void Capture_Process(void);
+void Capture_GetStats(Capture_StatsTypeDef *stats);
+
+#endif /* CAPTURE_H_ */
@@ -0,0 +1,27 @@
+#ifndef DMA_BENCH_H_
+#define DMA_BENCH_H_
+
+#include "stm32f4xx_hal.h"
+
+/*
+ * Bus-matrix contention benchmark (build with -DDMA_BENCH).
+ *
+ *   A fixed CPU workload (read-modify-write over a table in SRAM1) is timed
+ *   with the DWT cycle counter while DMA2 Stream0 copies memory-to-memory
+ *   back to back, 4-beat word bursts:
+ *     - CPU alone                       baseline
+ *     - DMA buffers in SRAM1 (.bss)     shares the CPU's SRAM port
+ *     - DMA buffers in SRAM2 (DMA_BUFFER)
+ *   For each run it reports CPU cycles and DMA throughput.
+ */
+
+typedef struct
+{
+    uint32_t cpuCycles;             /* for the fixed CPU workload            */
+    uint32_t dmaBytes;              /* copied by DMA meanwhile               */
+    uint32_t dmaKBps;               /* DMA throughput                        */
+} DMA_Bench_ResultTypeDef;
+
+void DMA_Bench_Run(UART_HandleTypeDef *huart);
+
+#endif /* DMA_BENCH_H_ */
@@ -10,4 +10,9 @@
 #define TRUE  1
 #define FALSE 0
 
+/* Buffers only touched by DMA (and read back by the CPU in bulk): SRAM2,
+ * .dma_buffer section, not zeroed at startup.  16-byte aligned so 4-beat
+ * word bursts never cross a 1 KB boundary mid-burst. */
+#define DMA_BUFFER  __attribute__((section(".dma_buffer"), aligned(16)))
+
 #endif /* MAIN_H_ */
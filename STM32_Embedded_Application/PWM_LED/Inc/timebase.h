@@ -0,0 +1,27 @@
+#ifndef TIMEBASE_H_
+#define TIMEBASE_H_
+
+#include "stm32f4xx_hal.h"
+
+/*
+ * 64-bit free-running timebase.
+ *
+ *   TIM1 (16-bit, master) counts the timer kernel clock and emits TRGO on
+ *   every update event.  TIM2 (32-bit, slave in EXTERNAL1 mode on ITR0)
+ *   counts those overflows.  TIM2 update interrupts extend the result by a
+ *   further 16 bits in software:
+ *
+ *     [63:48] software wrap count   [47:16] TIM2->CNT   [15:0] TIM1->CNT
+ *
+ *   Timebase_Now() is lock-free and may be called from thread and ISR
+ *   context at any priority.
+ */
+
+void     Timebase_Init(TIM_HandleTypeDef *slave);
+uint64_t Timebase_Now(void);
+uint32_t Timebase_Now32(void);
+uint32_t Timebase_GetFreq(void);
+uint64_t Timebase_TicksToUs(uint64_t ticks);
+void     Timebase_IRQHandler(void);
+
+#endif /* TIMEBASE_H_ */
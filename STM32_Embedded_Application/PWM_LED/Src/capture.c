@@ -0,0 +1,307 @@
+/* Includes ------------------------------------------------------------------*/
+#include "capture.h"
+#include "main_app.h"
+#include "main.h"
+#include "timer_clock.h"
+#include <string.h>
+#include <math.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define CAPTURE_HALF_LEN     (CAPTURE_BUF_LEN / 2U)
+
+/* Private variables ---------------------------------------------------------*/
+TIM_HandleTypeDef gTim5Handle;
+DMA_HandleTypeDef gDmaTim5Ch2Handle;
+
+/* One DMA burst per rising edge, in TIM5 register order (CCR1, CCR2) */
+typedef struct
+{
+    uint32_t high;
+    uint32_t period;
+} Capture_PairTypeDef;
+
+/* Filled by DMA only, kept in SRAM2 off the CPU's SRAM1 port */
+static Capture_PairTypeDef gPairBuf[CAPTURE_BUF_LEN] DMA_BUFFER;
+
+/* Half transfers completed on the capture stream (written from ISR) */
+static volatile uint32_t gHalfLaps;
+
+/* Consumer side, thread context only */
+static uint32_t gConsumed;
+static uint32_t gDiscard;
+static uint32_t gTimerClock;
+
+/* Running batch accumulators.  Periods are accumulated as deviations from
+ * the first period of the batch so the squared sum stays well inside 64 bits
+ * even for slow tachometer inputs. */
+static struct
+{
+    uint32_t count;
+    uint32_t overruns;
+    uint32_t ref;
+    uint32_t min;
+    uint32_t max;
+    int64_t  sumDev;
+    uint64_t sumDevSq;
+    uint64_t sumHigh;
+} gBatch;
+
+/* Private function prototypes -----------------------------------------------*/
+static void     Capture_ResetBatch(void);
+static uint32_t Capture_Produced(void);
+
+/* -------------------------------------------------------------------------- */
+/*                               Public API                                   */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Configure TIM5 for PWM-input capture on TI2.
+  *         DMA streams and pins are set up in HAL_TIM_IC_MspInit (msp.c).
+  */
+void Capture_Init(void)
+{
+    TIM_IC_InitTypeDef    icCfg;
+    TIM_SlaveConfigTypeDef slaveCfg;
+
+    gTim5Handle.Instance               = TIM5;
+    gTim5Handle.Init.Prescaler         = 0U;
+    gTim5Handle.Init.CounterMode       = TIM_COUNTERMODE_UP;
+    gTim5Handle.Init.Period            = 0xFFFFFFFFU;
+    gTim5Handle.Init.ClockDivision     = TIM_CLOCKDIVISION_DIV1;
+    gTim5Handle.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+
+    if (HAL_TIM_IC_Init(&gTim5Handle) != HAL_OK)
+    {
+        Error_Handler();
+    }
+
+    /* CH2: rising edge on TI2 -> period */
+    memset(&icCfg, 0, sizeof(icCfg));
+    icCfg.ICPolarity  = TIM_ICPOLARITY_RISING;
+    icCfg.ICSelection = TIM_ICSELECTION_DIRECTTI;
+    icCfg.ICPrescaler = TIM_ICPSC_DIV1;
+    icCfg.ICFilter    = 0U;
+
+    if (HAL_TIM_IC_ConfigChannel(&gTim5Handle, &icCfg, TIM_CHANNEL_2) != HAL_OK)
+    {
+        Error_Handler();
+    }
+
+    /* CH1: falling edge on TI2 -> high time */
+    icCfg.ICPolarity  = TIM_ICPOLARITY_FALLING;
+    icCfg.ICSelection = TIM_ICSELECTION_INDIRECTTI;
+
+    if (HAL_TIM_IC_ConfigChannel(&gTim5Handle, &icCfg, TIM_CHANNEL_1) != HAL_OK)
+    {
+        Error_Handler();
+    }
+
+    /* Every rising edge restarts the counter */
+    memset(&slaveCfg, 0, sizeof(slaveCfg));
+    slaveCfg.SlaveMode        = TIM_SLAVEMODE_RESET;
+    slaveCfg.InputTrigger     = TIM_TS_TI2FP2;
+    slaveCfg.TriggerPolarity  = TIM_TRIGGERPOLARITY_RISING;
+    slaveCfg.TriggerPrescaler = TIM_TRIGGERPRESCALER_DIV1;
+    slaveCfg.TriggerFilter    = 0U;
+
+    if (HAL_TIM_SlaveConfigSynchro(&gTim5Handle, &slaveCfg) != HAL_OK)
+    {
+        Error_Handler();
+    }
+
+    gTimerClock = Timer_Clock_Get(TIM5);
+}
+
+/**
+  * @brief  Start the circular DMA capture and enable both channels.
+  */
+void Capture_Start(void)
+{
+    gHalfLaps = 0U;
+    gConsumed = 0U;
+    Capture_ResetBatch();
+
+    /* The first period is measured from the timer start, not from an edge,
+     * and CCR1 has not latched a falling edge of that cycle yet */
+    gDiscard = 1U;
+
+    /* Burst on the period edge so CCR1 is read before the next falling edge
+     * can overwrite it; DataLength counts words, two per capture */
+    if (HAL_TIM_DMABurst_MultiReadStart(&gTim5Handle, TIM_DMABASE_CCR1, TIM_DMA_CC2,
+                                        (uint32_t *)gPairBuf,
+                                        TIM_DMABURSTLENGTH_2TRANSFERS,
+                                        CAPTURE_BUF_LEN * 2U) != HAL_OK)
+    {
+        Error_Handler();
+    }
+
+    if (HAL_TIM_IC_Start(&gTim5Handle, TIM_CHANNEL_1) != HAL_OK)
+    {
+        Error_Handler();
+    }
+
+    if (HAL_TIM_IC_Start(&gTim5Handle, TIM_CHANNEL_2) != HAL_OK)
+    {
+        Error_Handler();
+    }
+}
+
+/**
+  * @brief  Fold all captures written by DMA since the last call into the
+  *         running batch.  Call at least once per CAPTURE_BUF_LEN edges.
+  */
+void Capture_Process(void)
+{
+    uint32_t produced = Capture_Produced();
+    uint32_t pending  = produced - gConsumed;
+    uint32_t idx;
+    uint32_t high;
+    uint32_t period;
+    int32_t  dev;
+
+    if (pending > (CAPTURE_BUF_LEN - 1U))
+    {
+        /* DMA lapped the reader: drop everything but the last half ring */
+        gBatch.overruns++;
+        gConsumed = produced - CAPTURE_HALF_LEN;
+        pending   = CAPTURE_HALF_LEN;
+    }
+
+    while (pending-- != 0U)
+    {
+        idx    = gConsumed % CAPTURE_BUF_LEN;
+        high   = gPairBuf[idx].high;
+        period = gPairBuf[idx].period;
+        gConsumed++;
+
+        if (gDiscard != 0U)
+        {
+            gDiscard--;
+            continue;
+        }
+
+        if (gBatch.count == 0U)
+        {
+            gBatch.ref = period;
+            gBatch.min = period;
+            gBatch.max = period;
+        }
+
+        if (period < gBatch.min)
+        {
+            gBatch.min = period;
+        }
+        if (period > gBatch.max)
+        {
+            gBatch.max = period;
+        }
+
+        dev = (int32_t)(period - gBatch.ref);
+        gBatch.sumDev   += dev;
+        gBatch.sumDevSq += (uint64_t)((int64_t)dev * dev);
+        gBatch.sumHigh  += high;
+        gBatch.count++;
+    }
+}
+
+/**
+  * @brief  Return statistics for the batch collected so far and start a new one.
+  */
+void Capture_GetStats(Capture_StatsTypeDef *stats)
+{
+    float n;
+    float meanDev;
+    float meanPeriod;
+    float variance;
+    float nsPerTick;
+
+    Capture_Process();
+
+    memset(stats, 0, sizeof(*stats));
+    stats->edges    = gBatch.count;
+    stats->overruns = gBatch.overruns;
+
+    if (gBatch.count != 0U)
+    {
+        n          = (float)gBatch.count;
+        meanDev    = (float)gBatch.sumDev / n;
+        meanPeriod = (float)gBatch.ref + meanDev;
+        variance   = ((float)gBatch.sumDevSq / n) - (meanDev * meanDev);
+        nsPerTick  = 1.0e9f / (float)gTimerClock;
+
+        stats->periodMin    = gBatch.min;
+        stats->periodMax    = gBatch.max;
+        stats->freqHz       = (float)gTimerClock / meanPeriod;
+        stats->dutyPct      = 100.0f * ((float)gBatch.sumHigh / n) / meanPeriod;
+        stats->jitterRmsNs  = sqrtf((variance > 0.0f) ? variance : 0.0f) * nsPerTick;
+        stats->jitterPkPkNs = (float)(gBatch.max - gBatch.min) * nsPerTick;
+    }
+
+    Capture_ResetBatch();
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                Callbacks                                   */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Half of the capture ring has been filled.
+  */
+void HAL_TIM_IC_CaptureHalfCpltCallback(TIM_HandleTypeDef *htim)
+{
+    if ((htim->Instance == TIM5) && (htim->Channel == HAL_TIM_ACTIVE_CHANNEL_2))
+    {
+        gHalfLaps++;
+    }
+}
+
+/**
+  * @brief  The capture ring wrapped around.
+  */
+void HAL_TIM_IC_CaptureCallback(TIM_HandleTypeDef *htim)
+{
+    if ((htim->Instance == TIM5) && (htim->Channel == HAL_TIM_ACTIVE_CHANNEL_2))
+    {
+        gHalfLaps++;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/*                              Local helpers                                 */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Total number of captures written by DMA since Capture_Start().
+  * @note   NDTR counts words; a pair is only counted once both words of its
+  *         burst have landed.  The DMA write position may already be in the
+  *         next half before its half-transfer interrupt has run; the half-lap
+  *         count is corrected for that so the result never goes backwards.
+  */
+static uint32_t Capture_Produced(void)
+{
+    uint32_t laps;
+    uint32_t pos;
+
+    do
+    {
+        laps = gHalfLaps;
+        pos  = ((CAPTURE_BUF_LEN * 2U) - __HAL_DMA_GET_COUNTER(&gDmaTim5Ch2Handle)) / 2U;
+    } while (laps != gHalfLaps);
+
+    if (pos == CAPTURE_BUF_LEN)
+    {
+        pos = 0U;
+    }
+
+    if ((pos / CAPTURE_HALF_LEN) != (laps & 1U))
+    {
+        laps++;
+    }
+
+    return (laps * CAPTURE_HALF_LEN) + (pos % CAPTURE_HALF_LEN);
+}
+
+static void Capture_ResetBatch(void)
+{
+    memset(&gBatch, 0, sizeof(gBatch));
+}
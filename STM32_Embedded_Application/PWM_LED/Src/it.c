@@ -1,7 +1,43 @@
 #include "main_app.h"
+#include "capture.h"
+#include "uart_rx.h"
+#include "log.h"
+#include "crash_dump.h"
 
 extern TIM_HandleTypeDef htimer2;
 
+/**
+  * @brief This function handles Hard fault interrupt.
+  */
+void HardFault_Handler(void)
+{
+	CRASH_DUMP_CAPTURE();
+}
+
+/**
+  * @brief This function handles Memory management fault.
+  */
+void MemManage_Handler(void)
+{
+	CRASH_DUMP_CAPTURE();
+}
+
+/**
+  * @brief This function handles Pre-fetch fault, memory access fault.
+  */
+void BusFault_Handler(void)
+{
+	CRASH_DUMP_CAPTURE();
+}
+
+/**
+  * @brief This function handles Undefined instruction or illegal state.
+  */
+void UsageFault_Handler(void)
+{
+	CRASH_DUMP_CAPTURE();
+}
+
 /**
   * @brief This function handles System tick timer.
   */
@@ -19,4 +55,34 @@ void TIM2_IRQHandler(void)
 	HAL_TIM_IRQHandler(&htimer2);
 }
 
+/**
+  * @brief  This function handles DMA1 Stream4 (TIM5_CH2 capture) interrupt.
+  */
+void DMA1_Stream4_IRQHandler(void)
+{
+	HAL_DMA_IRQHandler(&gDmaTim5Ch2Handle);
+}
+
+/**
+  * @brief  This function handles USART2 interrupt (RX idle line, errors).
+  */
+void USART2_IRQHandler(void)
+{
+	UART_Rx_IRQHandler();
+}
 
+/**
+  * @brief  This function handles DMA1 Stream5 (USART2 RX) interrupt.
+  */
+void DMA1_Stream5_IRQHandler(void)
+{
+	UART_Rx_IRQHandler();
+}
+
+/**
+  * @brief  This function handles DMA1 Stream6 (USART2 TX, log channel) interrupt.
+  */
+void DMA1_Stream6_IRQHandler(void)
+{
+	Log_TxIRQHandler();
+}
@@ -3,7 +3,8 @@
 
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
-
+#include "timebase.h"
+#include "pool.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -50,6 +51,7 @@ static void MX_TIM2_Init(void);
 int main(void)
 {
   /* USER CODE BEGIN 1 */
+  Pool_Init();
 
   /* USER CODE END 1 */
 
@@ -74,6 +76,8 @@ int main(void)
   MX_USART2_UART_Init();
   MX_TIM2_Init();
   /* USER CODE BEGIN 2 */
+  /* Chain TIM1 into the ITR0-slaved TIM2 to form the 64-bit timebase */
+  Timebase_Init(&htim2);
 
   /* USER CODE END 2 */
 
@@ -1,27 +1,58 @@
 /* Includes ------------------------------------------------------------------*/
 #include "stm32f4xx_hal.h"
 #include "main_app.h"
+#include "main.h"
+#include "capture.h"
+#include "dma_bench.h"
+#include "crash_dump.h"
+#include "uart_rx.h"
+#include "shell.h"
+#include "log.h"
+#include "pool.h"
 #include <string.h>
+#include <stdio.h>
 
 /* Private function prototypes ----------------------------------------------*/
 static void GPIO_Init(void);
 static void TIMER2_Init(void);
 static void UART2_Init(void);
 static void SystemClock_Config_HSE(uint8_t clock_freq);
-static void Error_handler(void);
+static void PWM_AppReportCapture(void);
+static uint32_t PWM_AppStep(void);
+static HAL_StatusTypeDef PWM_AppCmdPwm(uint32_t argc, char *argv[]);
+
+/* Private typedefs ----------------------------------------------------------*/
+typedef enum
+{
+    PWM_PROFILE_BREATHE = 0,        /* ramp up and down, one step per ms     */
+    PWM_PROFILE_FIXED               /* constant duty                         */
+} PWM_ProfileTypeDef;
 
 /* Private variables ---------------------------------------------------------*/
 TIM_HandleTypeDef gTim2Handle;
 UART_HandleTypeDef gUart2Handle;
 
+static PWM_ProfileTypeDef gProfile = PWM_PROFILE_BREATHE;
+static uint16_t gDuty;
+static uint16_t gDutyStep = 20U;
+static uint8_t  gRising = 1U;
+
+/* Console commands, on top of the shell built-ins */
+static const Shell_CommandTypeDef gCommands[] =
+{
+    { "pwm", "breathe [<step>] | duty <0-100>", PWM_AppCmdPwm },
+};
+
 /* -------------------------------------------------------------------------- */
 /*                                  main                                      */
 /* -------------------------------------------------------------------------- */
 
 int main(void)
 {
-    uint16_t duty = 0;
-    const uint16_t dutyStep = 20U;
+    uint32_t lastReport;
+
+    /* Before anything can reach malloc() */
+    Pool_Init();
 
     /* HAL & clock configuration */
     HAL_Init();
@@ -32,31 +63,158 @@ int main(void)
     UART2_Init();
     TIMER2_Init();
 
+    /* Record left by a fault in the previous run, if any */
+    Crash_Dump_Report(&gUart2Handle);
+
+#ifdef DMA_BENCH
+    /* SRAM1 vs SRAM2 DMA buffer placement, before capture DMA starts */
+    DMA_Bench_Run(&gUart2Handle);
+#endif
+
+    /* From here on every USART2 byte goes through the log channel */
+    (void)Log_Init(&gUart2Handle);
+#ifdef LOG_BENCH
+    Log_Bench();
+#endif
+
     /* Start PWM output on TIM2 channel 1 */
     if (HAL_TIM_PWM_Start(&gTim2Handle, TIM_CHANNEL_1) != HAL_OK)
     {
-        Error_handler();
+        Error_Handler();
     }
 
-    /* LED breathing effect using PWM duty cycle */
+    /* Measure the signal on PA1 (jumper PA0 -> PA1 to measure our own PWM) */
+    Capture_Init();
+    Capture_Start();
+
+    /* Command console on USART2 RX */
+    if (UART_Rx_Start(&gUart2Handle) == HAL_OK)
+    {
+        Shell_Init(&gUart2Handle, gCommands, sizeof(gCommands) / sizeof(gCommands[0]));
+    }
+
+    /* LED breathing effect using PWM duty cycle, or a fixed duty */
+    lastReport = HAL_GetTick();
     while (1)
     {
-        /* Increase brightness */
-        while (duty < gTim2Handle.Init.Period)
+        /* One capture report per breathing cycle, once a second when fixed */
+        if ((PWM_AppStep() != 0U) ||
+            ((gProfile == PWM_PROFILE_FIXED) && ((HAL_GetTick() - lastReport) >= 1000U)))
+        {
+            PWM_AppReportCapture();
+            lastReport = HAL_GetTick();
+        }
+
+        Capture_Process();
+        (void)Shell_Process();
+        HAL_Delay(1);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/*                          Duty profile                                      */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Advance the duty profile by one step (1 ms).
+  * @retval 1 when a breathing cycle has just ended, else 0.
+  */
+static uint32_t PWM_AppStep(void)
+{
+    uint16_t period = (uint16_t)gTim2Handle.Init.Period;
+
+    if (gProfile != PWM_PROFILE_BREATHE)
+    {
+        return 0U;
+    }
+
+    if (gRising != 0U)
+    {
+        gDuty = (gDuty < (period - gDutyStep)) ? (uint16_t)(gDuty + gDutyStep) : period;
+        gRising = (gDuty < period) ? 1U : 0U;
+    }
+    else
+    {
+        gDuty = (gDuty > gDutyStep) ? (uint16_t)(gDuty - gDutyStep) : 0U;
+        gRising = (gDuty == 0U) ? 1U : 0U;
+    }
+    __HAL_TIM_SET_COMPARE(&gTim2Handle, TIM_CHANNEL_1, gDuty);
+
+    return ((gRising != 0U) && (gDuty == 0U)) ? 1U : 0U;
+}
+
+/**
+  * @brief  pwm breathe [<step>] | pwm duty <0-100>
+  */
+static HAL_StatusTypeDef PWM_AppCmdPwm(uint32_t argc, char *argv[])
+{
+    uint32_t value;
+    uint32_t period = gTim2Handle.Init.Period;
+
+    if ((argc >= 2U) && (strcmp(argv[1], "breathe") == 0))
+    {
+        if (argc == 3U)
         {
-            duty = (uint16_t)(duty + dutyStep);
-            __HAL_TIM_SET_COMPARE(&gTim2Handle, TIM_CHANNEL_1, duty);
-            HAL_Delay(1);
+            if ((Shell_ParseUint(argv[2], &value) == 0U) || (value == 0U) ||
+                (value > (period / 2U)))
+            {
+                return HAL_ERROR;
+            }
+            gDutyStep = (uint16_t)value;
+        }
+        else if (argc != 2U)
+        {
+            return HAL_ERROR;
         }
 
-        /* Decrease brightness */
-        while (duty > 0U)
+        gDuty    = 0U;
+        gRising  = 1U;
+        gProfile = PWM_PROFILE_BREATHE;
+        return HAL_OK;
+    }
+
+    if ((argc == 3U) && (strcmp(argv[1], "duty") == 0))
+    {
+        if ((Shell_ParseUint(argv[2], &value) == 0U) || (value > 100U))
         {
-            duty = (uint16_t)(duty - dutyStep);
-            __HAL_TIM_SET_COMPARE(&gTim2Handle, TIM_CHANNEL_1, duty);
-            HAL_Delay(1);
+            return HAL_ERROR;
         }
+
+        gProfile = PWM_PROFILE_FIXED;
+        gDuty    = (uint16_t)(((period + 1U) * value) / 100U);
+        __HAL_TIM_SET_COMPARE(&gTim2Handle, TIM_CHANNEL_1, gDuty);
+        return HAL_OK;
     }
+
+    return HAL_ERROR;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                          Capture reporting                                 */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Print the statistics of the last capture batch over UART2.
+  */
+static void PWM_AppReportCapture(void)
+{
+    Capture_StatsTypeDef stats;
+    uint32_t dutyPermille;
+
+    Capture_GetStats(&stats);
+
+    /* Integer formatting only: newlib-nano printf has no float support */
+    dutyPermille = (uint32_t)(stats.dutyPct * 10.0f);
+
+    /* stdout goes to the log channel (log.c): no wait for the UART */
+    printf("IC: n=%lu f=%luHz duty=%lu.%lu%% jit=%luns rms %luns pp ovr=%lu\r\n",
+           (unsigned long)stats.edges,
+           (unsigned long)stats.freqHz,
+           (unsigned long)(dutyPermille / 10U),
+           (unsigned long)(dutyPermille % 10U),
+           (unsigned long)stats.jitterRmsNs,
+           (unsigned long)stats.jitterPkPkNs,
+           (unsigned long)stats.overruns);
 }
 
 /* -------------------------------------------------------------------------- */
@@ -143,12 +301,12 @@ static void SystemClock_Config_HSE(uint8_t clock_freq)
 
     if (HAL_RCC_OscConfig(&oscCfg) != HAL_OK)
     {
-        Error_handler();
+        Error_Handler();
     }
 
     if (HAL_RCC_ClockConfig(&clkCfg, flashLatency) != HAL_OK)
     {
-        Error_handler();
+        Error_Handler();
     }
 
     /* Configure Systick for 1 ms tick */
@@ -196,7 +354,7 @@ static void UART2_Init(void)
 
     if (HAL_UART_Init(&gUart2Handle) != HAL_OK)
     {
-        Error_handler();
+        Error_Handler();
     }
 }
 
@@ -214,7 +372,7 @@ static void TIMER2_Init(void)
 
     if (HAL_TIM_PWM_Init(&gTim2Handle) != HAL_OK)
     {
-        Error_handler();
+        Error_Handler();
     }
 
     memset(&tim2PwmCfg, 0, sizeof(tim2PwmCfg));
@@ -226,7 +384,7 @@ static void TIMER2_Init(void)
                                   &tim2PwmCfg,
                                   TIM_CHANNEL_1) != HAL_OK)
     {
-        Error_handler();
+        Error_Handler();
     }
 }
 
@@ -234,7 +392,11 @@ static void TIMER2_Init(void)
 /*                               Error handler                                */
 /* -------------------------------------------------------------------------- */
 
-static void Error_handler(void)
+/**
+  * @brief  Also called by the modules shared with the CubeMX build
+  *         (main.h), which has its own in main.c.
+  */
+void Error_Handler(void)
 {
     /* Stay here if something went wrong during initialization */
     while (1)
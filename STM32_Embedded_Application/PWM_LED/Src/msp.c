@@ -1,4 +1,5 @@
 #include "main_app.h"
+#include "capture.h"
 
 /**
   * @brief  Initialize the MSP.
@@ -49,6 +50,53 @@ void HAL_TIM_PWM_MspInit(TIM_HandleTypeDef *htim)
   HAL_NVIC_EnableIRQ(TIM2_IRQn);
 }
 
+/**
+  * @brief  Initializes the TIM Input Capture MSP.
+  * @param  htim TIM IC handle
+  * @retval None
+  */
+void HAL_TIM_IC_MspInit(TIM_HandleTypeDef *htim)
+{
+  GPIO_InitTypeDef tim5IC_gpio;
+
+  //1. enable the clocks for TIM5, GPIOA and DMA1
+  __HAL_RCC_TIM5_CLK_ENABLE();
+  __HAL_RCC_GPIOA_CLK_ENABLE();
+  __HAL_RCC_DMA1_CLK_ENABLE();
+
+  //2. PA1 --> TIM5_CH2 (measured signal)
+  tim5IC_gpio.Pin = GPIO_PIN_1;
+  tim5IC_gpio.Mode = GPIO_MODE_AF_PP;
+  tim5IC_gpio.Pull = GPIO_NOPULL;
+  tim5IC_gpio.Speed = GPIO_SPEED_FREQ_LOW;
+  tim5IC_gpio.Alternate = GPIO_AF2_TIM5;
+  HAL_GPIO_Init(GPIOA, &tim5IC_gpio);
+
+  //3. circular word DMA on the TIM5_CH2 request (DMA1 Stream4 Ch6); each
+  //   request bursts CCR1 and CCR2 out through TIM5->DMAR
+  gDmaTim5Ch2Handle.Instance = DMA1_Stream4;
+  gDmaTim5Ch2Handle.Init.Channel = DMA_CHANNEL_6;
+  gDmaTim5Ch2Handle.Init.Direction = DMA_PERIPH_TO_MEMORY;
+  gDmaTim5Ch2Handle.Init.PeriphInc = DMA_PINC_DISABLE;
+  gDmaTim5Ch2Handle.Init.MemInc = DMA_MINC_ENABLE;
+  gDmaTim5Ch2Handle.Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+  gDmaTim5Ch2Handle.Init.MemDataAlignment = DMA_MDATAALIGN_WORD;
+  gDmaTim5Ch2Handle.Init.Mode = DMA_CIRCULAR;
+  gDmaTim5Ch2Handle.Init.Priority = DMA_PRIORITY_HIGH;
+  gDmaTim5Ch2Handle.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+  if (HAL_DMA_Init(&gDmaTim5Ch2Handle) != HAL_OK)
+  {
+    while (1)
+    {
+    }
+  }
+  __HAL_LINKDMA(htim, hdma[TIM_DMA_ID_CC2], gDmaTim5Ch2Handle);
+
+  //4. nvic settings: the stream interrupts twice per ring
+  HAL_NVIC_SetPriority(DMA1_Stream4_IRQn,14,0);
+  HAL_NVIC_EnableIRQ(DMA1_Stream4_IRQn);
+}
+
 /**
   * @brief  UART MSP Init.
   * @param  huart  Pointer to a UART_HandleTypeDef structure that contains
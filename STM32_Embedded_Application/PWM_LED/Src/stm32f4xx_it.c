@@ -3,6 +3,8 @@
 #include "stm32f4xx_it.h"
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "timebase.h"
+#include "crash_dump.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -65,7 +67,7 @@ void NMI_Handler(void)
 void HardFault_Handler(void)
 {
   /* USER CODE BEGIN HardFault_IRQn 0 */
-
+  CRASH_DUMP_CAPTURE();
   /* USER CODE END HardFault_IRQn 0 */
   while (1)
   {
@@ -80,7 +82,7 @@ void HardFault_Handler(void)
 void MemManage_Handler(void)
 {
   /* USER CODE BEGIN MemoryManagement_IRQn 0 */
-
+  CRASH_DUMP_CAPTURE();
   /* USER CODE END MemoryManagement_IRQn 0 */
   while (1)
   {
@@ -95,7 +97,7 @@ void MemManage_Handler(void)
 void BusFault_Handler(void)
 {
   /* USER CODE BEGIN BusFault_IRQn 0 */
-
+  CRASH_DUMP_CAPTURE();
   /* USER CODE END BusFault_IRQn 0 */
   while (1)
   {
@@ -110,7 +112,7 @@ void BusFault_Handler(void)
 void UsageFault_Handler(void)
 {
   /* USER CODE BEGIN UsageFault_IRQn 0 */
-
+  CRASH_DUMP_CAPTURE();
   /* USER CODE END UsageFault_IRQn 0 */
   while (1)
   {
@@ -179,6 +181,16 @@ void SysTick_Handler(void)
 /* please refer to the startup file (startup_stm32f4xx.s).                    */
 /******************************************************************************/
 
+/**
+  * @brief This function handles TIM2 global interrupt.
+  */
+void TIM2_IRQHandler(void)
+{
+  /* USER CODE BEGIN TIM2_IRQn 0 */
+  Timebase_IRQHandler();
+  /* USER CODE END TIM2_IRQn 0 */
+}
+
 /* USER CODE BEGIN 1 */
 
 /* USER CODE END 1 */
@@ -0,0 +1,170 @@
+/* Includes ------------------------------------------------------------------*/
+#include "timebase.h"
+#include "timer_clock.h"
+#include "main.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+
+/* TIM2 increments a few kernel clocks after TIM1 wraps (trigger input
+ * resynchronisation).  A TIM1 value inside this window is re-read so the
+ * upper half can never lag the lower half. */
+#define TIMEBASE_SYNC_GUARD   8U
+
+/* Private variables ---------------------------------------------------------*/
+static TIM_HandleTypeDef  gTim1Handle;
+static TIM_HandleTypeDef *gSlaveHandle;
+static volatile uint32_t  gWraps;
+static uint32_t           gTickFreq;
+
+/* -------------------------------------------------------------------------- */
+/*                               Public API                                   */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Configure TIM1 as master prescaler and start the TIM1 -> TIM2 chain.
+  * @param  slave: TIM2 handle already configured by MX_TIM2_Init()
+  *                (EXTERNAL1 slave mode, ITR0 trigger, 32-bit period).
+  */
+void Timebase_Init(TIM_HandleTypeDef *slave)
+{
+    TIM_MasterConfigTypeDef masterCfg;
+
+    gSlaveHandle = slave;
+    gWraps       = 0U;
+
+    /* TIM1 is not part of the CubeMX configuration: its clock is enabled
+     * here rather than in the generated HAL_TIM_Base_MspInit() */
+    __HAL_RCC_TIM1_CLK_ENABLE();
+
+    gTim1Handle.Instance               = TIM1;
+    gTim1Handle.Init.Prescaler         = 0U;
+    gTim1Handle.Init.CounterMode       = TIM_COUNTERMODE_UP;
+    gTim1Handle.Init.Period            = 0xFFFFU;
+    gTim1Handle.Init.ClockDivision     = TIM_CLOCKDIVISION_DIV1;
+    gTim1Handle.Init.RepetitionCounter = 0U;
+    gTim1Handle.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+
+    if (HAL_TIM_Base_Init(&gTim1Handle) != HAL_OK)
+    {
+        Error_Handler();
+    }
+
+    /* Every TIM1 overflow clocks TIM2 once through ITR0 */
+    memset(&masterCfg, 0, sizeof(masterCfg));
+    masterCfg.MasterOutputTrigger = TIM_TRGO_UPDATE;
+    masterCfg.MasterSlaveMode     = TIM_MASTERSLAVEMODE_DISABLE;
+
+    if (HAL_TIMEx_MasterConfigSynchronization(&gTim1Handle, &masterCfg) != HAL_OK)
+    {
+        Error_Handler();
+    }
+
+    gTickFreq = Timer_Clock_Get(TIM1);
+
+    /* Start the slave first so the very first master overflow is counted */
+    __HAL_TIM_SET_COUNTER(gSlaveHandle, 0U);
+    __HAL_TIM_SET_COUNTER(&gTim1Handle, 0U);
+
+    /* HAL_TIM_Base_Init() sets UIF through UG: not a wrap */
+    __HAL_TIM_CLEAR_FLAG(gSlaveHandle, TIM_FLAG_UPDATE);
+
+    if (HAL_TIM_Base_Start_IT(gSlaveHandle) != HAL_OK)
+    {
+        Error_Handler();
+    }
+
+    if (HAL_TIM_Base_Start(&gTim1Handle) != HAL_OK)
+    {
+        Error_Handler();
+    }
+}
+
+/**
+  * @brief  Return the full 64-bit timestamp in timer ticks.
+  * @note   Lock-free: the halves are re-read until they are coherent, and a
+  *         TIM2 wrap whose interrupt has not been serviced yet (caller
+  *         running at higher priority, or with IRQs masked) is accounted
+  *         for through the pending update flag.
+  */
+uint64_t Timebase_Now(void)
+{
+    uint32_t wraps;
+    uint32_t hi;
+    uint32_t lo;
+    uint32_t pending;
+
+    do
+    {
+        wraps   = gWraps;
+        hi      = TIM2->CNT;
+        lo      = TIM1->CNT;
+        pending = TIM2->SR & TIM_SR_UIF;
+    } while ((hi != TIM2->CNT) ||
+             (wraps != gWraps) ||
+             (lo < TIMEBASE_SYNC_GUARD));
+
+    /* Flag set while TIM2 already restarted from zero: wrap not yet counted */
+    if ((pending != 0U) && (hi < 0x80000000U))
+    {
+        wraps++;
+    }
+
+    return ((uint64_t)wraps << 48) | ((uint64_t)hi << 16) | (uint64_t)lo;
+}
+
+/**
+  * @brief  Return the low 32 bits of the timestamp.
+  *         Cheaper than Timebase_Now() for short interval measurements.
+  */
+uint32_t Timebase_Now32(void)
+{
+    uint32_t hi;
+    uint32_t lo;
+
+    do
+    {
+        hi = TIM2->CNT;
+        lo = TIM1->CNT;
+    } while ((hi != TIM2->CNT) || (lo < TIMEBASE_SYNC_GUARD));
+
+    return (hi << 16) | lo;
+}
+
+/**
+  * @brief  Tick frequency of the timebase in Hz.
+  */
+uint32_t Timebase_GetFreq(void)
+{
+    return gTickFreq;
+}
+
+/**
+  * @brief  Convert a tick count into microseconds without 64-bit overflow.
+  */
+uint64_t Timebase_TicksToUs(uint64_t ticks)
+{
+    uint64_t seconds = ticks / gTickFreq;
+    uint64_t rest    = ticks % gTickFreq;
+
+    return (seconds * 1000000ULL) + ((rest * 1000000ULL) / gTickFreq);
+}
+
+/**
+  * @brief  TIM2 update handler: extend the counter by 16 bits.
+  *         Called from TIM2_IRQHandler.
+  */
+void Timebase_IRQHandler(void)
+{
+    uint32_t primask;
+
+    if ((TIM2->SR & TIM_SR_UIF) != 0U)
+    {
+        /* Counter and flag must change together for readers that preempt */
+        primask = __get_PRIMASK();
+        __disable_irq();
+        gWraps++;
+        TIM2->SR = ~TIM_SR_UIF;
+        __set_PRIMASK(primask);
+    }
+}
@@ -11,4 +11,41 @@
 #define TRUE  1
 #define FALSE 0
 
+/* Buffers only touched by DMA (and read back by the CPU in bulk): SRAM2,
+ * .dma_buffer section, not zeroed at startup.  16-byte aligned so 4-beat
+ * word bursts never cross a 1 KB boundary mid-burst. */
+#define DMA_BUFFER  __attribute__((section(".dma_buffer"), aligned(16)))
+
+/* RTC backup registers (RTC_BKP_DRx index, 20 x 32 bit, kept in STANDBY) */
+#define BKP_REG_WARM_BOOT       0U      /* warm-boot marker                  */
+#define BKP_REG_CALIB           1U      /* last measured LSE error, ppb      */
+#define BKP_REG_BOOT_US         2U      /* last wake: reset -> useful code   */
+#define BKP_REG_BOOT_MAX_US     3U      /* worst warm wake so far            */
+#define BKP_REG_SCHED_HDR       4U      /* scheduler: magic | count | crc8   */
+#define BKP_REG_SCHED_BASE      5U      /* scheduler: base epoch             */
+#define BKP_REG_SCHED_SLOT0     6U      /* scheduler: slots DR6..DR19        */
+#define BKP_REG_NUM             20U
+
+#define WARM_BOOT_MAGIC         0x57A4B007UL
+
+/* Latency-critical code: ISRs and their fast paths.  With FASTCODE_IN_RAM
+ * (the RAM build profile) it goes to the .fastcode section, which SystemInit()
+ * copies to SRAM1, so it runs without flash wait states or ART misses.
+ * Without it, FASTCODE is empty and the code stays in flash. */
+/* #define FASTCODE_IN_RAM */
+#ifdef FASTCODE_IN_RAM
+#define FASTCODE    __attribute__((section(".fastcode"), noinline))
+#else
+#define FASTCODE
+#endif
+
+/* Calibrate LSE against a GPS 1 PPS on PA1 instead of the HSE clock */
+/* #define RTC_CALIB_USE_PPS */
+
+/* Print HAL vs direct-register RTC read cost in cycles at start-up */
+/* #define RTC_EPOCH_BENCHMARK */
+
+/* Event trace of ISRs, tasks and STANDBY (trace.h), dumped before STANDBY */
+/* #define TRACE_RECORDER */
+
 #endif /* MAIN_H_ */
@@ -0,0 +1,61 @@
+#ifndef RETAIN_H_
+#define RETAIN_H_
+
+#include "main_app.h"
+
+/*
+ * Application state retained in the 4 KB backup SRAM.
+ *
+ *   The block lives in the NOLOAD .bkpsram section (see the linker
+ *   scripts) and is kept alive in STANDBY by the backup regulator.  It
+ *   carries a magic/version/size header and a hardware CRC32 over the
+ *   whole block.  Retain_Init() validates it on boot and falls back to
+ *   defaults.  Every update reseals the CRC with interrupts masked, so
+ *   the block survives any reset taken while awake (watchdog, fault,
+ *   NRST) as well as STANDBY; only a reset inside an update's few
+ *   microseconds can still cost the block.
+ *
+ *   A version change discards the old contents: bump RETAIN_VERSION
+ *   whenever Retain_DataTypeDef changes layout.
+ */
+
+#define RETAIN_VERSION      1U
+#define RETAIN_LOG_LEN      16U
+
+#define RETAIN_SECTION      __attribute__((section(".bkpsram")))
+
+typedef enum
+{
+    RETAIN_CNT_COLD_BOOTS = 0,
+    RETAIN_CNT_WARM_WAKES,
+    RETAIN_CNT_PIN_WAKES,
+    RETAIN_CNT_EVENTS,
+    RETAIN_CNT_CALIB_RUNS,
+    RETAIN_CNT_NUM
+} Retain_CounterTypeDef;
+
+typedef struct
+{
+    uint32_t epoch;
+    uint8_t  id;
+    uint8_t  reserved[3];
+} Retain_LogEntryTypeDef;
+
+typedef enum
+{
+    RETAIN_FRESH = 0,       /* no valid block, defaults loaded               */
+    RETAIN_RESTORED,        /* block restored from backup SRAM               */
+    RETAIN_CORRUPT          /* header matched but the CRC did not            */
+} Retain_StatusTypeDef;
+
+Retain_StatusTypeDef Retain_Init(void);
+void                 Retain_Clear(void);
+
+uint32_t Retain_GetCounter(Retain_CounterTypeDef cnt);
+void     Retain_IncCounter(Retain_CounterTypeDef cnt);
+
+void     Retain_LogEvent(uint8_t id, uint32_t epoch);
+uint32_t Retain_GetLogCount(void);
+HAL_StatusTypeDef Retain_GetLogEntry(uint32_t age, Retain_LogEntryTypeDef *entry);
+
+#endif /* RETAIN_H_ */
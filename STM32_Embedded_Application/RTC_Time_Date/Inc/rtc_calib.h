@@ -0,0 +1,52 @@
+#ifndef RTC_CALIB_H_
+#define RTC_CALIB_H_
+
+#include "main_app.h"
+
+/*
+ * RTC smooth calibration service.
+ *
+ *   TIM5 CH4 is remapped to LSE (TIM5_OR.TI4_RMP) and timestamps every
+ *   8th LSE edge with the timer clock.  The reference is either the HSE
+ *   derived timer clock itself or, with RTC_CALIB_USE_PPS, a GPS 1 PPS
+ *   pulse on PA1 (TIM5 CH2) that calibrates the timer clock on the fly.
+ *   The measured LSE error is turned into CALP/CALM for a 32 s smooth
+ *   calibration cycle (0.954 ppm per CALM step, -487..+488 ppm).
+ *
+ *   The raw LSE is measured, so the result does not depend on the CALR
+ *   value already in effect and can simply be reapplied periodically.
+ */
+
+#define RTC_CALIB_LSE_HZ        32768U
+#define RTC_CALIB_EVENT_ID      0xC0U          /* rtc_sched event id          */
+#define RTC_CALIB_INTERVAL_S    86400UL        /* re-measure once per day     */
+
+#ifdef RTC_CALIB_USE_PPS
+#define RTC_CALIB_WINDOW_S      32U            /* PPS pulses per measurement  */
+#define RTC_CALIB_REF_PPB       0U             /* PPS long-term accuracy      */
+#define RTC_CALIB_PPS_JITTER_NS 100U           /* per-pulse jitter, receiver  */
+#else
+#define RTC_CALIB_WINDOW_S      8U
+#define RTC_CALIB_REF_PPB       20000U         /* HSE crystal tolerance       */
+#endif
+
+typedef struct
+{
+    int32_t  lseErrPpb;     /* measured LSE error, + means LSE runs fast      */
+    uint32_t calp;          /* applied CALP (0/1)                             */
+    uint32_t calm;          /* applied CALM (0..511)                          */
+    int32_t  residualPpb;   /* lseErrPpb minus the applied correction         */
+
+    /* Error budget, worst case, all in ppb */
+    uint32_t refPpb;        /* reference: HSE tolerance or PPS jitter/window  */
+    uint32_t measPpb;       /* +-1 timer tick on each of the two intervals    */
+    uint32_t budgetPpb;     /* refPpb + measPpb + |residualPpb|               */
+    uint32_t budgetMsDay;   /* budgetPpb expressed as ms per day              */
+} RTC_Calib_ResultTypeDef;
+
+HAL_StatusTypeDef RTC_Calib_Measure(RTC_Calib_ResultTypeDef *res);
+HAL_StatusTypeDef RTC_Calib_Apply(RTC_HandleTypeDef *hrtc, RTC_Calib_ResultTypeDef *res);
+HAL_StatusTypeDef RTC_Calib_Run(RTC_HandleTypeDef *hrtc, RTC_Calib_ResultTypeDef *res);
+int32_t           RTC_Calib_GetLastErrPpb(RTC_HandleTypeDef *hrtc);
+
+#endif /* RTC_CALIB_H_ */
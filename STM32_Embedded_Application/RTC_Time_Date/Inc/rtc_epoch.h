@@ -0,0 +1,29 @@
+#ifndef RTC_EPOCH_H_
+#define RTC_EPOCH_H_
+
+#include "main_app.h"
+
+/*
+ * Direct-register RTC calendar <-> Unix epoch conversion (2000..2099).
+ *
+ *   RTC_Epoch_FromRegs / RTC_Epoch_ToRegs are pure functions on raw TR/DR
+ *   values, so they can be checked on a host against the C library.
+ *   RTC_Epoch_Read / RTC_Epoch_Set replace the HAL_RTC_GetTime+GetDate and
+ *   HAL_RTC_SetTime+SetDate pairs.
+ */
+
+#define RTC_EPOCH_MIN   946684800UL    /* 2000-01-01T00:00:00Z */
+#define RTC_EPOCH_MAX   4102444799UL   /* 2099-12-31T23:59:59Z */
+
+uint32_t          RTC_Epoch_FromRegs(uint32_t tr, uint32_t dr, uint32_t hour12);
+void              RTC_Epoch_ToRegs(uint32_t epoch, uint32_t hour12,
+                                   uint32_t *tr, uint32_t *dr);
+uint32_t          RTC_Epoch_Read(void);
+HAL_StatusTypeDef RTC_Epoch_Set(RTC_HandleTypeDef *hrtc, uint32_t epoch);
+
+#ifdef RTC_EPOCH_BENCHMARK
+void RTC_Epoch_Benchmark(RTC_HandleTypeDef *hrtc, uint32_t iterations,
+                         uint32_t *halCycles, uint32_t *directCycles);
+#endif
+
+#endif /* RTC_EPOCH_H_ */
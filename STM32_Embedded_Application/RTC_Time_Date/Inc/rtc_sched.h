@@ -0,0 +1,35 @@
+#ifndef RTC_SCHED_H_
+#define RTC_SCHED_H_
+
+#include "main_app.h"
+
+/*
+ * RTC alarm event scheduler.
+ *
+ *   Events (absolute epoch seconds + 8-bit id) are kept sorted by time.
+ *   Alarm A is armed for the nearest event and Alarm B for the one after it,
+ *   so the device can sit in STANDBY between sparse events.  The queue is
+ *   mirrored into the RTC backup registers (see BKP_REG_SCHED_* in
+ *   main_app.h) as a base epoch plus 24-bit offsets, and restored by
+ *   RTC_Sched_Init() after a STANDBY wakeup.
+ */
+
+#define RTC_SCHED_MAX_EVENTS    (BKP_REG_NUM - BKP_REG_SCHED_SLOT0)
+
+/* Largest spread between the first and the last queued event (~194 days) */
+#define RTC_SCHED_HORIZON_S     0x00FFFFFFUL
+
+uint32_t          RTC_Sched_Init(RTC_HandleTypeDef *hrtc);
+HAL_StatusTypeDef RTC_Sched_Add(uint32_t epoch, uint8_t id);
+HAL_StatusTypeDef RTC_Sched_Cancel(uint8_t id);
+uint32_t          RTC_Sched_Process(void);
+uint32_t          RTC_Sched_Count(void);
+uint32_t          RTC_Sched_Contains(uint8_t id);
+HAL_StatusTypeDef RTC_Sched_Next(uint32_t *epoch, uint8_t *id);
+uint32_t          RTC_Sched_IsPending(void);
+void              RTC_Sched_AlarmIRQHandler(void);
+
+/* Called from RTC_Sched_Process() for every due event; weak, override it */
+void RTC_Sched_EventCallback(uint8_t id, uint32_t epoch);
+
+#endif /* RTC_SCHED_H_ */
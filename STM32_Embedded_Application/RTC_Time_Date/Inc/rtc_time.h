@@ -0,0 +1,21 @@
+#ifndef RTC_TIME_H_
+#define RTC_TIME_H_
+
+#include "stm32f4xx_hal.h"
+
+/*
+ * Sub-second RTC time API.
+ *
+ *   Reads TR/DR/SSR directly with the shadow registers bypassed (BYPSHAD),
+ *   so no RSF synchronisation is needed after a wakeup.  The calendar is
+ *   converted to seconds only when TR/DR change; every other read is a
+ *   consistency check plus one multiply for the sub-second part.
+ */
+
+void     RTC_Time_Init(RTC_HandleTypeDef *hrtc);
+uint64_t RTC_Time_GetEpochMs(void);
+uint64_t RTC_Time_GetEpochUs(void);
+uint64_t RTC_Time_GetMonotonicUs(void);
+uint32_t RTC_Time_GetResolutionUs(void);
+
+#endif /* RTC_TIME_H_ */
@@ -1,9 +1,46 @@
 #include "main_app.h"
+#include "rtc_sched.h"
+#include "uart_rx.h"
+#include "log.h"
+#include "trace.h"
+#include "crash_dump.h"
+
+/**
+  * @brief This function handles Hard fault interrupt.
+  */
+void HardFault_Handler(void)
+{
+	CRASH_DUMP_CAPTURE();
+}
+
+/**
+  * @brief This function handles Memory management fault.
+  */
+void MemManage_Handler(void)
+{
+	CRASH_DUMP_CAPTURE();
+}
+
+/**
+  * @brief This function handles Pre-fetch fault, memory access fault.
+  */
+void BusFault_Handler(void)
+{
+	CRASH_DUMP_CAPTURE();
+}
+
+/**
+  * @brief This function handles Undefined instruction or illegal state.
+  */
+void UsageFault_Handler(void)
+{
+	CRASH_DUMP_CAPTURE();
+}
 
 /**
   * @brief This function handles System tick timer.
   */
-void SysTick_Handler (void)
+FASTCODE void SysTick_Handler (void)
 {
 	HAL_IncTick();
 	HAL_SYSTICK_IRQHandler();
@@ -14,6 +51,41 @@ void SysTick_Handler (void)
   */
 void EXTI15_10_IRQHandler(void)
 {
+	TRACE_ISR_ENTER();
 	HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_13);
+	TRACE_ISR_EXIT();
 }
 
+/**
+  * @brief This function handles RTC Alarm A/B interrupts through EXTI line 17.
+  */
+FASTCODE void RTC_Alarm_IRQHandler(void)
+{
+	TRACE_ISR_ENTER();
+	RTC_Sched_AlarmIRQHandler();
+	TRACE_ISR_EXIT();
+}
+
+/**
+  * @brief This function handles USART2 interrupt (RX idle line, errors).
+  */
+void USART2_IRQHandler(void)
+{
+	UART_Rx_IRQHandler();
+}
+
+/**
+  * @brief This function handles DMA1 Stream5 (USART2 RX) interrupt.
+  */
+void DMA1_Stream5_IRQHandler(void)
+{
+	UART_Rx_IRQHandler();
+}
+
+/**
+  * @brief This function handles DMA1 Stream6 (USART2 TX, log channel) interrupt.
+  */
+void DMA1_Stream6_IRQHandler(void)
+{
+	Log_TxIRQHandler();
+}
@@ -5,41 +5,100 @@
 
 #include "stm32f4xx_hal.h"
 #include "main_app.h"
+#include "rtc_time.h"
+#include "rtc_epoch.h"
+#include "rtc_sched.h"
+#include "rtc_calib.h"
+#include "retain.h"
+#include "crash_dump.h"
+#include "uart_rx.h"
+#include "shell.h"
+#include "log.h"
+#include "pool.h"
+#include "trace.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define RTC_SHELL_IDLE_MS       30000U  /* console closes after this quiet */
+
+/* Trace task ids (trace.h) */
+#define RTC_TRACE_TASK_SHELL    1U
+#define RTC_TRACE_TASK_SCHED    2U
+#define RTC_TRACE_TASK_CALIB    3U
 
 /* Private function prototypes -----------------------------------------------*/
 static void GPIO_Init(void);
 static void UART2_Init(void);
-static void RTC_Init(void);
+static void RTC_Init(uint32_t warm);
 static void RTC_CalendarConfig(void);
 static void SystemClock_Config_HSE(uint8_t clock_freq);
+static void RTC_AppScheduleDemo(void);
+static void RTC_AppCalibrate(void);
+static uint32_t RTC_AppIsWarmBoot(void);
+static void RTC_AppStampBoot(void);
+static void RTC_AppConsoleUp(void);
+static void RTC_AppReportRetained(void);
+static void RTC_AppShell(void);
+static void RTC_AppPrintNow(uint64_t epochMs);
+static void RTC_AppServiceButton(void);
+static HAL_StatusTypeDef RTC_AppCmdTime(uint32_t argc, char *argv[]);
+static HAL_StatusTypeDef RTC_AppCmdDate(uint32_t argc, char *argv[]);
+static HAL_StatusTypeDef RTC_AppCmdNow(uint32_t argc, char *argv[]);
+static HAL_StatusTypeDef RTC_AppCmdExit(uint32_t argc, char *argv[]);
+#ifdef TRACE_RECORDER
+static HAL_StatusTypeDef RTC_AppCmdTrace(uint32_t argc, char *argv[]);
+#endif
 static void RTC_AppError(void);
 static void rtc_uart_printf(const char *format, ...);
 static const char *rtc_get_weekday_name(uint8_t index);
+static uint8_t rtc_get_weekday(uint32_t year, uint32_t month, uint32_t day);
 
 /* Private variables ---------------------------------------------------------*/
 UART_HandleTypeDef gUart2Handle;
 RTC_HandleTypeDef  gRtcHandle;
 
+static uint32_t gWarmBoot;
+static uint32_t gConsoleUp;
+static uint32_t gBootCycles;
+static uint32_t gBootUs;
+static Retain_StatusTypeDef gRetainStatus;
+static uint32_t gShellExit;
+
+/* Button press seen by the EXTI callback, printed from thread context */
+static volatile uint32_t gButtonPending;
+static uint64_t          gButtonEpochMs;
+
+/* Console commands, on top of the shell built-ins */
+static const Shell_CommandTypeDef gCommands[] =
+{
+    { "time",  "<hh:mm:ss>  24 h",  RTC_AppCmdTime  },
+    { "date",  "<dd> <mm> <yy>",    RTC_AppCmdDate  },
+    { "now",   "",                  RTC_AppCmdNow   },
+    { "exit",  "",                  RTC_AppCmdExit  },
+#ifdef TRACE_RECORDER
+    { "trace", "",                  RTC_AppCmdTrace },
+#endif
+};
+
 /* -------------------------------------------------------------------------- */
 /*                              helper functions                              */
 /* -------------------------------------------------------------------------- */
 
 /**
-  * @brief  Simple printf-style helper that sends text over UART2.
+  * @brief  Simple printf-style helper that sends text over UART2, through
+  *         the log channel.
   */
 static void rtc_uart_printf(const char *format, ...)
 {
     char buffer[80];
     va_list args;
 
+    RTC_AppConsoleUp();
+
     va_start(args, format);
     vsnprintf(buffer, sizeof(buffer), format, args);
     va_end(args);
 
-    HAL_UART_Transmit(&gUart2Handle,
-                      (uint8_t *)buffer,
-                      strlen(buffer),
-                      HAL_MAX_DELAY);
+    (void)Log_Write(buffer, strlen(buffer));
 }
 
 /**
@@ -61,33 +120,118 @@ static const char *rtc_get_weekday_name(uint8_t index)
     return names[index - 1];
 }
 
+/**
+  * @brief  Weekday of a Gregorian date, 1 (Monday) .. 7 (Sunday) as the RTC
+  *         encodes it.
+  */
+static uint8_t rtc_get_weekday(uint32_t year, uint32_t month, uint32_t day)
+{
+    static const uint8_t offsets[] = { 0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4 };
+    uint32_t wd;
+
+    if (month < 3U)
+    {
+        year--;
+    }
+    wd = (year + (year / 4U) - (year / 100U) + (year / 400U) +
+          offsets[month - 1U] + day) % 7U;
+
+    return (wd == 0U) ? 7U : (uint8_t)wd;
+}
+
 /* -------------------------------------------------------------------------- */
 /*                                   main                                     */
 /* -------------------------------------------------------------------------- */
 
 int main(void)
 {
-    HAL_Init();
+    uint32_t pinWake = 0U;
 
+    /* Before anything can reach malloc() */
+    Pool_Init();
+
+    HAL_Init();
     GPIO_Init();
-    SystemClock_Config_HSE(SYS_CLOCK_FREQ_50_MHZ);
-    UART2_Init();
-    RTC_Init();
 
-    rtc_uart_printf("RTC standby example started\r\n");
+    /* Wake from STANDBY with the backup domain intact: the RTC keeps
+     * running, so neither HAL_RTC_Init (init mode stops the calendar)
+     * nor the LSE start-up in HAL_RTC_MspInit are needed.  The PLL and
+     * UART are brought up lazily by RTC_AppConsoleUp(). */
+    gWarmBoot = RTC_AppIsWarmBoot();
+
+    RTC_Init(gWarmBoot);
+    RTC_Time_Init(&gRtcHandle);
+    RTC_Sched_Init(&gRtcHandle);
+    gRetainStatus = Retain_Init();
+
+    RTC_AppStampBoot();
+
+    /* The previous run ended in a fault: print the record before anything
+     * else can fault again.  Not kept across STANDBY (SRAM is lost). */
+    if (Crash_Dump_Pending() != 0U)
+    {
+        RTC_AppConsoleUp();
+        Log_Flush();
+        Crash_Dump_Report(&gUart2Handle);
+    }
+
+    if (gWarmBoot != 0U)
+    {
+        /* WUF is also set by the RTC alarm: only a pin wake is interactive */
+        pinWake = ((__HAL_PWR_GET_FLAG(PWR_FLAG_WU) != RESET) &&
+                   (RTC_Sched_IsPending() == 0U)) ? 1U : 0U;
+    }
+    __HAL_PWR_CLEAR_FLAG(PWR_FLAG_SB);
+    __HAL_PWR_CLEAR_FLAG(PWR_FLAG_WU);
+
+    Retain_IncCounter((gWarmBoot != 0U) ? RETAIN_CNT_WARM_WAKES : RETAIN_CNT_COLD_BOOTS);
 
-    /* Check if we are returning from STANDBY */
-    if (__HAL_PWR_GET_FLAG(PWR_FLAG_SB) != RESET)
+    if (gWarmBoot == 0U)
+    {
+        HAL_RTCEx_BKUPWrite(&gRtcHandle, BKP_REG_WARM_BOOT, WARM_BOOT_MAGIC);
+        rtc_uart_printf("RTC standby example started, retained state %s\r\n",
+                        (gRetainStatus == RETAIN_RESTORED) ? "restored" :
+                        (gRetainStatus == RETAIN_CORRUPT)  ? "corrupt, reset" : "fresh");
+    }
+    else if (pinWake != 0U)
     {
-        /* Clear standby & wakeup flags */
-        __HAL_PWR_CLEAR_FLAG(PWR_FLAG_SB);
-        __HAL_PWR_CLEAR_FLAG(PWR_FLAG_WU);
+        Retain_IncCounter(RETAIN_CNT_PIN_WAKES);
 
         rtc_uart_printf("System woke up from STANDBY mode\r\n");
 
-        /* Simulate EXTI callback to print current date/time */
-        HAL_GPIO_EXTI_Callback(0);
+        RTC_AppPrintNow(RTC_Time_GetEpochMs());
+        RTC_AppReportRetained();
+    }
+
+    /* Interactive wakes get a console to set the clock; alarm wakes stay
+     * quiet.  Before the scheduler, so events see the corrected time. */
+    if ((gWarmBoot == 0U) || (pinWake != 0U))
+    {
+        RTC_AppShell();
+    }
+
+#ifdef RTC_EPOCH_BENCHMARK
+    {
+        uint32_t halCycles;
+        uint32_t directCycles;
+
+        RTC_Epoch_Benchmark(&gRtcHandle, 1000U, &halCycles, &directCycles);
+        rtc_uart_printf("RTC read: HAL %lu cyc, direct %lu cyc\r\n",
+                        (unsigned long)halCycles, (unsigned long)directCycles);
+    }
+#endif
+
+    /* Run events that fell due in STANDBY; keep the demo queue non-empty so
+     * the next alarm brings us back */
+    TRACE_TASK_BEGIN(RTC_TRACE_TASK_SCHED);
+    RTC_Sched_Process();
+    TRACE_TASK_END(RTC_TRACE_TASK_SCHED);
+    if (RTC_Sched_Contains(RTC_CALIB_EVENT_ID) == 0U)
+    {
+        /* Power-up: calibrate now, then once per RTC_CALIB_INTERVAL_S */
+        RTC_AppCalibrate();
     }
+    RTC_AppScheduleDemo();
 
     /* Optionally configure date/time once */
     /* RTC_CalendarConfig(); */
@@ -95,7 +239,24 @@ int main(void)
     /* Enable Wakeup pin 1 */
     HAL_PWR_EnableWakeUpPin(PWR_WAKEUP_PIN1);
 
-    rtc_uart_printf("Entering STANDBY mode now\r\n");
+    /* A press after the shell closed */
+    RTC_AppServiceButton();
+
+    if (gConsoleUp != 0U)
+    {
+        rtc_uart_printf("Entering STANDBY mode now\r\n");
+#ifdef TRACE_RECORDER
+        /* Neither the ring nor CYCCNT survives STANDBY: dump this run now */
+        TRACE_POWER(TRACE_PWR_STANDBY, 0U);
+        Trace_Dump();
+#endif
+    }
+
+    /* A stale WUF would wake us up again immediately */
+    __HAL_PWR_CLEAR_FLAG(PWR_FLAG_WU);
+
+    /* Queued console output would be lost with the clocks */
+    Log_Flush();
 
     /* Enter STANDBY; execution will continue from reset on wakeup */
     HAL_PWR_EnterSTANDBYMode();
@@ -208,7 +369,11 @@ static void SystemClock_Config_HSE(uint8_t clock_freq)
 /*                             RTC configuration                              */
 /* -------------------------------------------------------------------------- */
 
-static void RTC_Init(void)
+/**
+  * @brief  Set up the RTC handle.  On a warm boot the peripheral is already
+  *         configured and running, so only the handle state is restored.
+  */
+static void RTC_Init(uint32_t warm)
 {
     gRtcHandle.Instance = RTC;
     gRtcHandle.Init.HourFormat     = RTC_HOURFORMAT_12;
@@ -218,6 +383,13 @@ static void RTC_Init(void)
     gRtcHandle.Init.OutPutPolarity = RTC_OUTPUT_POLARITY_LOW;
     gRtcHandle.Init.OutPutType     = RTC_OUTPUT_TYPE_OPENDRAIN;
 
+    if (warm != 0U)
+    {
+        gRtcHandle.Lock  = HAL_UNLOCKED;
+        gRtcHandle.State = HAL_RTC_STATE_READY;
+        return;
+    }
+
     if (HAL_RTC_Init(&gRtcHandle) != HAL_OK)
     {
         RTC_AppError();
@@ -291,7 +463,7 @@ static void UART2_Init(void)
     gUart2Handle.Init.StopBits   = UART_STOPBITS_1;
     gUart2Handle.Init.Parity     = UART_PARITY_NONE;
     gUart2Handle.Init.HwFlowCtl  = UART_HWCONTROL_NONE;
-    gUart2Handle.Init.Mode       = UART_MODE_TX;
+    gUart2Handle.Init.Mode       = UART_MODE_TX_RX;
 
     if (HAL_UART_Init(&gUart2Handle) != HAL_OK)
     {
@@ -304,23 +476,45 @@ static void UART2_Init(void)
 /* -------------------------------------------------------------------------- */
 
 /**
-  * @brief  EXTI line detection callback.
-  *         Prints current time and date using RTC values.
+  * @brief  EXTI line detection callback: timestamps the button press.  The
+  *         console may be down (clocks, UART, log), so the time and date are
+  *         printed from the main loop by RTC_AppServiceButton().
   */
 void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+    (void)GPIO_Pin;
+
+    /* The cheap, precise timestamp, taken at the press */
+    gButtonEpochMs = RTC_Time_GetEpochMs();
+    gButtonPending = 1U;
+}
+
+/**
+  * @brief  Print the current time and date using RTC values, along with
+  *         @p epochMs.  Thread context only: may bring the console up.
+  */
+static void RTC_AppPrintNow(uint64_t epochMs)
 {
     RTC_TimeTypeDef timeNow;
     RTC_DateTypeDef dateNow;
-
-    (void)GPIO_Pin;
+    uint32_t subMs;
 
     HAL_RTC_GetTime(&gRtcHandle, &timeNow, RTC_FORMAT_BIN);
     HAL_RTC_GetDate(&gRtcHandle, &dateNow, RTC_FORMAT_BIN);
 
-    rtc_uart_printf("Time : %02d:%02d:%02d\r\n",
+    /* SubSeconds counts down from SecondFraction (= SynchPrediv) */
+    subMs = ((timeNow.SecondFraction - timeNow.SubSeconds) * 1000U) /
+            (timeNow.SecondFraction + 1U);
+
+    rtc_uart_printf("Time : %02d:%02d:%02d.%03lu\r\n",
                     timeNow.Hours,
                     timeNow.Minutes,
-                    timeNow.Seconds);
+                    timeNow.Seconds,
+                    (unsigned long)subMs);
+
+    rtc_uart_printf("Epoch: %lu.%03lu s\r\n",
+                    (unsigned long)(epochMs / 1000U),
+                    (unsigned long)(epochMs % 1000U));
 
     rtc_uart_printf("Date : %02d-%02d-%02d  <%s>\r\n",
                     dateNow.Month,
@@ -329,6 +523,328 @@ void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
                     rtc_get_weekday_name(dateNow.WeekDay));
 }
 
+/**
+  * @brief  Print the button press the EXTI callback recorded, if any.
+  */
+static void RTC_AppServiceButton(void)
+{
+    uint32_t primask;
+    uint64_t epochMs;
+
+    if (gButtonPending == 0U)
+    {
+        return;
+    }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    epochMs        = gButtonEpochMs;
+    gButtonPending = 0U;
+    __set_PRIMASK(primask);
+
+    RTC_AppPrintNow(epochMs);
+}
+
+/**
+  * @brief  RTC scheduler event callback, runs in thread context.
+  */
+void RTC_Sched_EventCallback(uint8_t id, uint32_t epoch)
+{
+    Retain_IncCounter(RETAIN_CNT_EVENTS);
+    Retain_LogEvent(id, epoch);
+
+    if (id == RTC_CALIB_EVENT_ID)
+    {
+        RTC_AppCalibrate();
+        return;
+    }
+
+    rtc_uart_printf("Event %u due at %lu, now %lu\r\n",
+                    id, (unsigned long)epoch, (unsigned long)RTC_Epoch_Read());
+}
+
+/* -------------------------------------------------------------------------- */
+/*                               Boot path                                    */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  True when leaving STANDBY with an RTC that this firmware already
+  *         configured (backup domain not reset in between).
+  */
+static uint32_t RTC_AppIsWarmBoot(void)
+{
+    __HAL_RCC_PWR_CLK_ENABLE();
+
+    gRtcHandle.Instance = RTC;
+
+    return ((__HAL_PWR_GET_FLAG(PWR_FLAG_SB) != RESET) &&
+            ((RCC->BDCR & RCC_BDCR_RTCEN) != 0U) &&
+            ((RTC->ISR & RTC_ISR_INITS) != 0U) &&
+            (HAL_RTCEx_BKUPRead(&gRtcHandle, BKP_REG_WARM_BOOT) == WARM_BOOT_MAGIC)) ? 1U : 0U;
+}
+
+/**
+  * @brief  Record the time from reset to the first application-specific
+  *         instruction.  CYCCNT is started in SystemInit(); we still run on
+  *         HSI here, so SystemCoreClock is exact.
+  */
+static void RTC_AppStampBoot(void)
+{
+    gBootCycles = DWT->CYCCNT;
+    gBootUs     = gBootCycles / (SystemCoreClock / 1000000U);
+
+    HAL_RTCEx_BKUPWrite(&gRtcHandle, BKP_REG_BOOT_US, gBootUs);
+    if ((gWarmBoot != 0U) &&
+        (gBootUs > HAL_RTCEx_BKUPRead(&gRtcHandle, BKP_REG_BOOT_MAX_US)))
+    {
+        HAL_RTCEx_BKUPWrite(&gRtcHandle, BKP_REG_BOOT_MAX_US, gBootUs);
+    }
+}
+
+/**
+  * @brief  Lock the PLL and open UART2 on first use only; quiet wakes stay
+  *         on HSI and go straight back to STANDBY.
+  */
+static void RTC_AppConsoleUp(void)
+{
+    if (gConsoleUp != 0U)
+    {
+        return;
+    }
+    gConsoleUp = 1U;
+
+    SystemClock_Config_HSE(SYS_CLOCK_FREQ_50_MHZ);
+    UART2_Init();
+    (void)Log_Init(&gUart2Handle);
+
+#ifdef TRACE_RECORDER
+    /* Only from here: the dump converts cycles at one clock */
+    Trace_Init();
+    Trace_NameTask(RTC_TRACE_TASK_SHELL, "shell");
+    Trace_NameTask(RTC_TRACE_TASK_SCHED, "sched");
+    Trace_NameTask(RTC_TRACE_TASK_CALIB, "calib");
+#endif
+
+    rtc_uart_printf("Boot: %lu cyc, %lu us (%s), worst warm %lu us\r\n",
+                    (unsigned long)gBootCycles, (unsigned long)gBootUs,
+                    (gWarmBoot != 0U) ? "warm" : "cold",
+                    (unsigned long)HAL_RTCEx_BKUPRead(&gRtcHandle, BKP_REG_BOOT_MAX_US));
+}
+
+/* -------------------------------------------------------------------------- */
+/*                              Event schedule                                */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Queue a few sparse demo events once the schedule has run dry.
+  *         The queue lives in the backup registers, so it is only seeded
+  *         after power-up or once every event has fired.
+  */
+static void RTC_AppScheduleDemo(void)
+{
+    uint32_t now = RTC_Epoch_Read();
+    uint32_t next;
+    uint8_t  id;
+
+    if ((RTC_Sched_Contains(1U) == 0U) && (RTC_Sched_Contains(2U) == 0U) &&
+        (RTC_Sched_Contains(3U) == 0U))
+    {
+        RTC_Sched_Add(now + 20U, 1U);
+        RTC_Sched_Add(now + 60U, 2U);
+        RTC_Sched_Add(now + 300U, 3U);
+    }
+
+    /* Report only if something else already needed the console */
+    if ((gConsoleUp != 0U) && (RTC_Sched_Next(&next, &id) == HAL_OK))
+    {
+        rtc_uart_printf("%lu events queued, next #%u in %lu s\r\n",
+                        (unsigned long)RTC_Sched_Count(), id,
+                        (unsigned long)(next - now));
+    }
+}
+
+/**
+  * @brief  Measure LSE, apply smooth calibration, report the error budget and
+  *         queue the next run.
+  */
+static void RTC_AppCalibrate(void)
+{
+    RTC_Calib_ResultTypeDef res;
+    HAL_StatusTypeDef status;
+
+    /* HSI is only good to 1 %: the reference has to be the HSE PLL */
+    RTC_AppConsoleUp();
+
+    TRACE_TASK_BEGIN(RTC_TRACE_TASK_CALIB);
+    status = RTC_Calib_Run(&gRtcHandle, &res);
+    TRACE_TASK_END(RTC_TRACE_TASK_CALIB);
+    Retain_IncCounter(RETAIN_CNT_CALIB_RUNS);
+    if (status == HAL_OK)
+    {
+        rtc_uart_printf("Calib: LSE %ld ppb, CALP %lu CALM %lu, residual %ld ppb\r\n",
+                        (long)res.lseErrPpb, (unsigned long)res.calp,
+                        (unsigned long)res.calm, (long)res.residualPpb);
+        rtc_uart_printf("Budget: ref %lu + meas %lu + step %lu = %lu ppb, %lu ms/day\r\n",
+                        (unsigned long)res.refPpb, (unsigned long)res.measPpb,
+                        (unsigned long)(res.budgetPpb - res.refPpb - res.measPpb),
+                        (unsigned long)res.budgetPpb, (unsigned long)res.budgetMsDay);
+    }
+    else
+    {
+        rtc_uart_printf("Calib failed (%d), keeping LSE %ld ppb\r\n",
+                        status, (long)RTC_Calib_GetLastErrPpb(&gRtcHandle));
+    }
+
+    RTC_Sched_Add(RTC_Epoch_Read() + RTC_CALIB_INTERVAL_S, RTC_CALIB_EVENT_ID);
+}
+
+/**
+  * @brief  Print the state carried across STANDBY in backup SRAM.
+  */
+static void RTC_AppReportRetained(void)
+{
+    Retain_LogEntryTypeDef entry;
+
+    rtc_uart_printf("Wakes: %lu warm, %lu pin, %lu cold boots\r\n",
+                    (unsigned long)Retain_GetCounter(RETAIN_CNT_WARM_WAKES),
+                    (unsigned long)Retain_GetCounter(RETAIN_CNT_PIN_WAKES),
+                    (unsigned long)Retain_GetCounter(RETAIN_CNT_COLD_BOOTS));
+    rtc_uart_printf("Events: %lu, calibrations: %lu\r\n",
+                    (unsigned long)Retain_GetCounter(RETAIN_CNT_EVENTS),
+                    (unsigned long)Retain_GetCounter(RETAIN_CNT_CALIB_RUNS));
+
+    if (Retain_GetLogEntry(0U, &entry) == HAL_OK)
+    {
+        rtc_uart_printf("Last event #%u at %lu\r\n",
+                        entry.id, (unsigned long)entry.epoch);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/*                               Console                                      */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Serve console commands until RTC_SHELL_IDLE_MS pass without input
+  *         or "exit".  Sleeps between interrupts (tick, RX idle line).
+  */
+static void RTC_AppShell(void)
+{
+    uint32_t lastActive;
+
+    RTC_AppConsoleUp();
+    if (UART_Rx_Start(&gUart2Handle) != HAL_OK)
+    {
+        return;
+    }
+    Shell_Init(&gUart2Handle, gCommands, sizeof(gCommands) / sizeof(gCommands[0]));
+
+    rtc_uart_printf("Console: help for commands, STANDBY after %lu s idle\r\n",
+                    (unsigned long)(RTC_SHELL_IDLE_MS / 1000U));
+
+    gShellExit = 0U;
+    lastActive = HAL_GetTick();
+    while ((gShellExit == 0U) && ((HAL_GetTick() - lastActive) < RTC_SHELL_IDLE_MS))
+    {
+        /* A half-typed line counts as activity too */
+        if (UART_Rx_Available() != 0U)
+        {
+            lastActive = HAL_GetTick();
+            TRACE_TASK_BEGIN(RTC_TRACE_TASK_SHELL);
+            (void)Shell_Process();
+            TRACE_TASK_END(RTC_TRACE_TASK_SHELL);
+        }
+        RTC_AppServiceButton();
+        __WFI();
+    }
+}
+
+/* time hh:mm:ss (24 h; the calendar runs in 12 h mode) */
+static HAL_StatusTypeDef RTC_AppCmdTime(uint32_t argc, char *argv[])
+{
+    RTC_TimeTypeDef timeCfg;
+    unsigned int hours;
+    unsigned int minutes;
+    unsigned int seconds;
+    char tail;
+
+    if ((argc != 2U) ||
+        (sscanf(argv[1], "%u:%u:%u%c", &hours, &minutes, &seconds, &tail) != 3) ||
+        (hours > 23U) || (minutes > 59U) || (seconds > 59U))
+    {
+        return HAL_ERROR;
+    }
+
+    memset(&timeCfg, 0, sizeof(timeCfg));
+    timeCfg.Hours      = (uint8_t)(((hours % 12U) == 0U) ? 12U : (hours % 12U));
+    timeCfg.Minutes    = (uint8_t)minutes;
+    timeCfg.Seconds    = (uint8_t)seconds;
+    timeCfg.TimeFormat = (hours >= 12U) ? RTC_HOURFORMAT12_PM : RTC_HOURFORMAT12_AM;
+
+    return HAL_RTC_SetTime(&gRtcHandle, &timeCfg, RTC_FORMAT_BIN);
+}
+
+/* date dd mm yy (20yy); the weekday is derived */
+static HAL_StatusTypeDef RTC_AppCmdDate(uint32_t argc, char *argv[])
+{
+    static const uint8_t monthDays[] = { 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    RTC_DateTypeDef dateCfg;
+    uint32_t day;
+    uint32_t month;
+    uint32_t year;
+
+    if ((argc != 4U) || (Shell_ParseUint(argv[1], &day) == 0U) ||
+        (Shell_ParseUint(argv[2], &month) == 0U) || (Shell_ParseUint(argv[3], &year) == 0U) ||
+        (month < 1U) || (month > 12U) || (year > 99U) ||
+        (day < 1U) || (day > monthDays[month - 1U]) ||
+        ((month == 2U) && (day == 29U) && ((year % 4U) != 0U)))
+    {
+        return HAL_ERROR;
+    }
+
+    memset(&dateCfg, 0, sizeof(dateCfg));
+    dateCfg.Date    = (uint8_t)day;
+    dateCfg.Month   = (uint8_t)month;
+    dateCfg.Year    = (uint8_t)year;
+    dateCfg.WeekDay = rtc_get_weekday(2000U + year, month, day);
+
+    return HAL_RTC_SetDate(&gRtcHandle, &dateCfg, RTC_FORMAT_BIN);
+}
+
+static HAL_StatusTypeDef RTC_AppCmdNow(uint32_t argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    RTC_AppPrintNow(RTC_Time_GetEpochMs());
+    return HAL_OK;
+}
+
+static HAL_StatusTypeDef RTC_AppCmdExit(uint32_t argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    gShellExit = 1U;
+    return HAL_OK;
+}
+
+#ifdef TRACE_RECORDER
+/* trace: print the event ring for tools/trace2perfetto.py, then restart it */
+static HAL_StatusTypeDef RTC_AppCmdTrace(uint32_t argc, char *argv[])
+{
+    (void)argv;
+
+    if (argc != 1U)
+    {
+        return HAL_ERROR;
+    }
+
+    Trace_Dump();
+    return HAL_OK;
+}
+#endif
+
 /* -------------------------------------------------------------------------- */
 /*                             Error handling                                 */
 /* -------------------------------------------------------------------------- */
@@ -0,0 +1,185 @@
+/* Includes ------------------------------------------------------------------*/
+#include "retain.h"
+#include <string.h>
+#include <stddef.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define RETAIN_MAGIC        0x52544E31UL       /* "RTN1" */
+
+/* Private types -------------------------------------------------------------*/
+typedef struct
+{
+    uint32_t               counters[RETAIN_CNT_NUM];
+    uint32_t               logHead;            /* next entry to write        */
+    uint32_t               logCount;
+    Retain_LogEntryTypeDef log[RETAIN_LOG_LEN];
+} Retain_DataTypeDef;
+
+typedef struct
+{
+    uint32_t           magic;
+    uint16_t           version;
+    uint16_t           size;                   /* sizeof(Retain_BlockTypeDef) */
+    Retain_DataTypeDef data;
+    uint32_t           crc;                    /* CRC32 over all fields above */
+} Retain_BlockTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static Retain_BlockTypeDef gRetain RETAIN_SECTION;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t Retain_Crc(void);
+static void     Retain_Seal(void);
+
+/* -------------------------------------------------------------------------- */
+/*                               Public API                                   */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Power the backup SRAM and validate the retained block.
+  *         The header is checked first so a foreign or old-layout block is
+  *         rejected without running the CRC.
+  */
+Retain_StatusTypeDef Retain_Init(void)
+{
+    __HAL_RCC_PWR_CLK_ENABLE();
+    HAL_PWR_EnableBkUpAccess();
+    __HAL_RCC_BKPSRAM_CLK_ENABLE();
+
+    /* BRE lives in the backup domain: after a warm wake it is still on */
+    if ((PWR->CSR & PWR_CSR_BRR) == 0U)
+    {
+        if (HAL_PWREx_EnableBkUpReg() != HAL_OK)
+        {
+            /* Without the regulator nothing survives STANDBY, but the
+             * block still works as plain RAM for this run */
+            Retain_Clear();
+            return RETAIN_FRESH;
+        }
+    }
+
+    if ((gRetain.magic != RETAIN_MAGIC) ||
+        (gRetain.version != RETAIN_VERSION) ||
+        (gRetain.size != sizeof(gRetain)))
+    {
+        Retain_Clear();
+        return RETAIN_FRESH;
+    }
+
+    if (gRetain.crc != Retain_Crc())
+    {
+        Retain_Clear();
+        return RETAIN_CORRUPT;
+    }
+
+    return RETAIN_RESTORED;
+}
+
+/**
+  * @brief  Reset to defaults and seal.
+  */
+void Retain_Clear(void)
+{
+    memset(&gRetain, 0, sizeof(gRetain));
+    gRetain.magic   = RETAIN_MAGIC;
+    gRetain.version = RETAIN_VERSION;
+    gRetain.size    = (uint16_t)sizeof(gRetain);
+    gRetain.crc     = Retain_Crc();
+}
+
+uint32_t Retain_GetCounter(Retain_CounterTypeDef cnt)
+{
+    return (cnt < RETAIN_CNT_NUM) ? gRetain.data.counters[cnt] : 0U;
+}
+
+void Retain_IncCounter(Retain_CounterTypeDef cnt)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    if (cnt < RETAIN_CNT_NUM)
+    {
+        __disable_irq();
+        gRetain.data.counters[cnt]++;
+        Retain_Seal();
+        __set_PRIMASK(primask);
+    }
+}
+
+/**
+  * @brief  Append to the event log, overwriting the oldest entry when full.
+  */
+void Retain_LogEvent(uint8_t id, uint32_t epoch)
+{
+    uint32_t primask = __get_PRIMASK();
+    Retain_LogEntryTypeDef *entry;
+
+    __disable_irq();
+
+    entry        = &gRetain.data.log[gRetain.data.logHead];
+    entry->epoch = epoch;
+    entry->id    = id;
+
+    gRetain.data.logHead = (gRetain.data.logHead + 1U) % RETAIN_LOG_LEN;
+    if (gRetain.data.logCount < RETAIN_LOG_LEN)
+    {
+        gRetain.data.logCount++;
+    }
+
+    Retain_Seal();
+    __set_PRIMASK(primask);
+}
+
+uint32_t Retain_GetLogCount(void)
+{
+    return gRetain.data.logCount;
+}
+
+/**
+  * @brief  Read a logged event.
+  * @param  age: 0 = newest, Retain_GetLogCount() - 1 = oldest
+  */
+HAL_StatusTypeDef Retain_GetLogEntry(uint32_t age, Retain_LogEntryTypeDef *entry)
+{
+    if (age >= gRetain.data.logCount)
+    {
+        return HAL_ERROR;
+    }
+
+    *entry = gRetain.data.log[(gRetain.data.logHead + RETAIN_LOG_LEN - 1U - age) % RETAIN_LOG_LEN];
+
+    return HAL_OK;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                              Local helpers                                 */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  CRC32 (Ethernet polynomial) of everything but the crc field,
+  *         using the CRC unit directly; HAL CRC is not part of this project.
+  */
+static uint32_t Retain_Crc(void)
+{
+    const uint32_t *word = (const uint32_t *)&gRetain;
+    uint32_t words = offsetof(Retain_BlockTypeDef, crc) / sizeof(uint32_t);
+    uint32_t i;
+
+    __HAL_RCC_CRC_CLK_ENABLE();
+    CRC->CR = CRC_CR_RESET;
+
+    for (i = 0U; i < words; i++)
+    {
+        CRC->DR = word[i];
+    }
+
+    return CRC->DR;
+}
+
+/**
+  * @brief  Reseal after an update.  Called with interrupts masked, so no
+  *         other update or user of the CRC unit can interleave.
+  */
+static void Retain_Seal(void)
+{
+    gRetain.crc = Retain_Crc();
+}
@@ -0,0 +1,268 @@
+/* Includes ------------------------------------------------------------------*/
+#include "rtc_calib.h"
+#include "timer_clock.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define RTC_CALIB_LSE_PSC       8U              /* IC4PSC = /8                */
+#define RTC_CALIB_CYCLE_PULSES  1048576LL       /* 2^20 RTCCLK per 32 s cycle */
+#define RTC_CALIB_PPB           1000000000LL
+
+/* Private function prototypes -----------------------------------------------*/
+static void     RTC_Calib_TimerStart(void);
+static void     RTC_Calib_TimerStop(void);
+static int64_t  RTC_Calib_DivRound(int64_t num, int64_t den);
+
+/* -------------------------------------------------------------------------- */
+/*                               Public API                                   */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Measure the raw LSE frequency error against the reference.
+  *         Blocks for about RTC_CALIB_WINDOW_S seconds with TIM5 polled.
+  * @retval HAL_ERROR on a missed LSE capture, HAL_TIMEOUT if LSE or the
+  *         PPS input stay silent.
+  */
+HAL_StatusTypeDef RTC_Calib_Measure(RTC_Calib_ResultTypeDef *res)
+{
+    uint32_t timeout   = (RTC_CALIB_WINDOW_S * 1000U) + 2000U;
+    uint32_t tickstart;
+    uint32_t lseFirst  = 0U;
+    uint32_t lseLast   = 0U;
+    uint32_t lseEdges  = 0U;
+    uint32_t refTicks  = 0U;
+    uint32_t lseTicks;
+    int64_t  cycles;
+    int64_t  den;
+    int64_t  diff;
+#ifdef RTC_CALIB_USE_PPS
+    uint32_t ppsFirst  = 0U;
+    uint32_t ppsPulses = 0U;
+#else
+    uint32_t lseTarget = (RTC_CALIB_WINDOW_S * RTC_CALIB_LSE_HZ) / RTC_CALIB_LSE_PSC;
+#endif
+
+    RTC_Calib_TimerStart();
+    tickstart = HAL_GetTick();
+
+    for (;;)
+    {
+        if ((HAL_GetTick() - tickstart) > timeout)
+        {
+            RTC_Calib_TimerStop();
+            return HAL_TIMEOUT;
+        }
+
+        if ((TIM5->SR & TIM_SR_CC4OF) != 0U)
+        {
+            /* Polling fell behind an LSE edge: the edge count is wrong */
+            RTC_Calib_TimerStop();
+            return HAL_ERROR;
+        }
+
+#ifdef RTC_CALIB_USE_PPS
+        if ((TIM5->SR & TIM_SR_CC2IF) != 0U)
+        {
+            if (ppsPulses == 0U)
+            {
+                ppsFirst = TIM5->CCR2;
+            }
+            else
+            {
+                refTicks = TIM5->CCR2 - ppsFirst;
+            }
+            ppsPulses++;
+        }
+#endif
+
+        if ((TIM5->SR & TIM_SR_CC4IF) != 0U)
+        {
+            /* Reading CCR4 clears CC4IF */
+            lseLast = TIM5->CCR4;
+            if (lseEdges == 0U)
+            {
+                lseFirst = lseLast;
+            }
+            lseEdges++;
+        }
+
+#ifdef RTC_CALIB_USE_PPS
+        /* Start counting LSE at the first pulse, stop at the last one */
+        if (ppsPulses == 0U)
+        {
+            lseEdges = 0U;
+        }
+        else if (ppsPulses > RTC_CALIB_WINDOW_S)
+        {
+            break;
+        }
+#else
+        if (lseEdges > lseTarget)
+        {
+            break;
+        }
+#endif
+    }
+
+    RTC_Calib_TimerStop();
+
+#ifdef RTC_CALIB_USE_PPS
+    /* The PPS interval is the true length of the window in timer ticks */
+    res->refPpb = (uint32_t)((2ULL * RTC_CALIB_PPS_JITTER_NS) / RTC_CALIB_WINDOW_S);
+    res->measPpb = (uint32_t)(RTC_CALIB_PPB / refTicks);
+#else
+    refTicks    = Timer_Clock_Get(TIM5) * RTC_CALIB_WINDOW_S;
+    res->refPpb = RTC_CALIB_REF_PPB;
+    res->measPpb = 0U;
+#endif
+
+    lseTicks = lseLast - lseFirst;
+    cycles   = (int64_t)(lseEdges - 1U) * RTC_CALIB_LSE_PSC;
+
+    if ((lseTicks == 0U) || (refTicks == 0U) || (cycles <= 0))
+    {
+        return HAL_ERROR;
+    }
+
+    /* fLSE / 32768 - 1 = (cycles * refTicks - lseTicks * window * 32768) /
+     *                    (lseTicks * window * 32768) */
+    den  = (int64_t)lseTicks * RTC_CALIB_WINDOW_S * RTC_CALIB_LSE_HZ;
+    diff = (cycles * (int64_t)refTicks) - den;
+
+    res->lseErrPpb = (int32_t)RTC_Calib_DivRound(diff * 1000000LL, den / 1000LL);
+    res->measPpb  += (uint32_t)(RTC_CALIB_PPB / lseTicks);
+
+    return HAL_OK;
+}
+
+/**
+  * @brief  Program CALP/CALM for the error in @p res and complete its error
+  *         budget.  The raw error is kept in BKP_REG_CALIB for reporting.
+  */
+HAL_StatusTypeDef RTC_Calib_Apply(RTC_HandleTypeDef *hrtc, RTC_Calib_ResultTypeDef *res)
+{
+    HAL_StatusTypeDef status;
+    int64_t pulses;
+    int64_t added;
+    int64_t corrPpb;
+
+    /* Pulses to add per 2^20 RTCCLK cycles to cancel the error */
+    pulses = RTC_Calib_DivRound(-(int64_t)res->lseErrPpb * RTC_CALIB_CYCLE_PULSES,
+                                RTC_CALIB_PPB);
+
+    if (pulses > 0)
+    {
+        /* CALP inserts 512 pulses, CALM takes the surplus back out */
+        if (pulses > 512)
+        {
+            pulses = 512;
+        }
+        res->calp = 1U;
+        res->calm = (uint32_t)(512 - pulses);
+    }
+    else
+    {
+        if (pulses < -511)
+        {
+            pulses = -511;
+        }
+        res->calp = 0U;
+        res->calm = (uint32_t)(-pulses);
+    }
+
+    /* fCAL = fRTC * (1 + (512 * CALP - CALM) / (2^20 + CALM - 512 * CALP)) */
+    added   = (512 * (int64_t)res->calp) - (int64_t)res->calm;
+    corrPpb = RTC_Calib_DivRound(added * RTC_CALIB_PPB, RTC_CALIB_CYCLE_PULSES - added);
+
+    res->residualPpb = res->lseErrPpb + (int32_t)corrPpb;
+    res->budgetPpb   = res->refPpb + res->measPpb +
+                       (uint32_t)((res->residualPpb < 0) ? -res->residualPpb : res->residualPpb);
+    res->budgetMsDay = (uint32_t)(((uint64_t)res->budgetPpb * 86400ULL) / 1000000ULL);
+
+    status = HAL_RTCEx_SetSmoothCalib(hrtc, RTC_SMOOTHCALIB_PERIOD_32SEC,
+                                      (res->calp != 0U) ? RTC_SMOOTHCALIB_PLUSPULSES_SET :
+                                                          RTC_SMOOTHCALIB_PLUSPULSES_RESET,
+                                      res->calm);
+    if (status == HAL_OK)
+    {
+        HAL_RTCEx_BKUPWrite(hrtc, BKP_REG_CALIB, (uint32_t)res->lseErrPpb);
+    }
+
+    return status;
+}
+
+/**
+  * @brief  Measure and apply in one go.
+  */
+HAL_StatusTypeDef RTC_Calib_Run(RTC_HandleTypeDef *hrtc, RTC_Calib_ResultTypeDef *res)
+{
+    HAL_StatusTypeDef status = RTC_Calib_Measure(res);
+
+    if (status != HAL_OK)
+    {
+        return status;
+    }
+
+    return RTC_Calib_Apply(hrtc, res);
+}
+
+/**
+  * @brief  LSE error measured by the last successful RTC_Calib_Apply().
+  */
+int32_t RTC_Calib_GetLastErrPpb(RTC_HandleTypeDef *hrtc)
+{
+    return (int32_t)HAL_RTCEx_BKUPRead(hrtc, BKP_REG_CALIB);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                              Local helpers                                 */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Free-running 32-bit TIM5, CH4 <- LSE / 8, CH2 <- PPS on PA1.
+  *         HAL TIM is not part of this project, so registers are used.
+  */
+static void RTC_Calib_TimerStart(void)
+{
+#ifdef RTC_CALIB_USE_PPS
+    GPIO_InitTypeDef ppsCfg;
+
+    __HAL_RCC_GPIOA_CLK_ENABLE();
+
+    ppsCfg.Pin       = GPIO_PIN_1;
+    ppsCfg.Mode      = GPIO_MODE_AF_PP;
+    ppsCfg.Pull      = GPIO_PULLDOWN;
+    ppsCfg.Speed     = GPIO_SPEED_FREQ_LOW;
+    ppsCfg.Alternate = GPIO_AF2_TIM5;
+    HAL_GPIO_Init(GPIOA, &ppsCfg);
+#endif
+
+    __HAL_RCC_TIM5_CLK_ENABLE();
+
+    TIM5->CR1  = 0U;
+    TIM5->PSC  = 0U;
+    TIM5->ARR  = 0xFFFFFFFFU;
+    TIM5->OR   = TIM_OR_TI4_RMP_1;                          /* TI4 <- LSE       */
+    TIM5->CCMR2 = TIM_CCMR2_CC4S_0 | TIM_CCMR2_IC4PSC;      /* IC4 = TI4, /8    */
+    TIM5->CCER  = TIM_CCER_CC4E;
+#ifdef RTC_CALIB_USE_PPS
+    TIM5->CCMR1 = TIM_CCMR1_CC2S_0 | (0x3U << TIM_CCMR1_IC2F_Pos);  /* IC2 = TI2 */
+    TIM5->CCER |= TIM_CCER_CC2E;
+#endif
+    TIM5->EGR  = TIM_EGR_UG;
+    TIM5->SR   = 0U;
+    TIM5->CR1  = TIM_CR1_CEN;
+}
+
+static void RTC_Calib_TimerStop(void)
+{
+    TIM5->CR1  = 0U;
+    TIM5->CCER = 0U;
+    TIM5->OR   = 0U;
+    __HAL_RCC_TIM5_CLK_DISABLE();
+}
+
+static int64_t RTC_Calib_DivRound(int64_t num, int64_t den)
+{
+    return ((num < 0) == (den < 0)) ? ((num + (den / 2)) / den) :
+                                      ((num - (den / 2)) / den);
+}
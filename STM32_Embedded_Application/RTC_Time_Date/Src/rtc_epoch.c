@@ -0,0 +1,223 @@
+/* Includes ------------------------------------------------------------------*/
+#include "rtc_epoch.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define RTC_EPOCH_DAY_SECONDS    86400UL
+#define RTC_EPOCH_QUAD_DAYS      1461UL        /* 4 years, first one leap */
+#define RTC_EPOCH_INIT_TIMEOUT   1000U         /* ms, same as the HAL     */
+
+/* 2000-01-01 was a Saturday; RTC weekday encoding is Monday = 1 */
+#define RTC_EPOCH_WEEKDAY_OFFSET 5U
+
+/* Branch-free packed BCD <-> binary for values 0..99 */
+#define BCD2BIN(b)   ((uint32_t)(b) - 6U * ((uint32_t)(b) >> 4))
+#define BIN2BCD(v)   ((((uint32_t)(v) / 10U) << 4) | ((uint32_t)(v) % 10U))
+
+/* Private variables ---------------------------------------------------------*/
+
+/* Days before month 1..12 (index 0 unused) plus the year length, per leap */
+static const uint16_t gDaysBeforeMonth[2][14] =
+{
+    { 0, 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334, 365 },
+    { 0, 0, 31, 60, 91, 121, 152, 182, 213, 244, 274, 305, 335, 366 }
+};
+
+/* -------------------------------------------------------------------------- */
+/*                            Pure conversions                                */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Convert raw RTC TR/DR register values to Unix seconds.
+  * @param  tr, dr: register values (reserved bits are ignored)
+  * @param  hour12: non-zero when RTC_CR.FMT selects the AM/PM format
+  */
+uint32_t RTC_Epoch_FromRegs(uint32_t tr, uint32_t dr, uint32_t hour12)
+{
+    uint32_t year   = BCD2BIN((dr >> 16) & 0xFFU);
+    uint32_t month  = BCD2BIN((dr >> 8) & 0x1FU);
+    uint32_t date   = BCD2BIN(dr & 0x3FU);
+    uint32_t hours  = BCD2BIN((tr >> 16) & 0x3FU);
+    uint32_t mins   = BCD2BIN((tr >> 8) & 0x7FU);
+    uint32_t secs   = BCD2BIN(tr & 0x7FU);
+    uint32_t leap   = ((year & 3U) == 0U) ? 1U : 0U;
+    uint32_t days;
+
+    if (hour12 != 0U)
+    {
+        /* 12 AM is midnight, 12 PM is noon */
+        hours = (hours % 12U) + (((tr & RTC_TR_PM) != 0U) ? 12U : 0U);
+    }
+
+    /* Within 2000..2099 every fourth year, starting with 2000, is a leap year */
+    days = (year * 365U) + ((year + 3U) >> 2) +
+           gDaysBeforeMonth[leap][month] + date - 1U;
+
+    return RTC_EPOCH_MIN + (days * RTC_EPOCH_DAY_SECONDS) +
+           (hours * 3600U) + (mins * 60U) + secs;
+}
+
+/**
+  * @brief  Convert Unix seconds to raw RTC TR/DR register values.
+  *         The weekday field of DR is filled in as well.
+  * @param  epoch:  RTC_EPOCH_MIN..RTC_EPOCH_MAX
+  * @param  hour12: non-zero to encode the hour in AM/PM format
+  */
+void RTC_Epoch_ToRegs(uint32_t epoch, uint32_t hour12, uint32_t *tr, uint32_t *dr)
+{
+    uint32_t offset = epoch - RTC_EPOCH_MIN;
+    uint32_t days   = offset / RTC_EPOCH_DAY_SECONDS;
+    uint32_t sod    = offset % RTC_EPOCH_DAY_SECONDS;
+    uint32_t quad   = days / RTC_EPOCH_QUAD_DAYS;
+    uint32_t rem    = days % RTC_EPOCH_QUAD_DAYS;
+    uint32_t yearInQuad;
+    uint32_t doy;
+    uint32_t leap;
+    uint32_t month;
+    uint32_t hours;
+    uint32_t pm = 0U;
+
+    /* First year of each quad has 366 days */
+    yearInQuad = (rem < 366U) ? 0U : ((rem - 1U) / 365U);
+    doy        = (yearInQuad == 0U) ? rem : (rem - 1U - (yearInQuad * 365U));
+    leap       = (yearInQuad == 0U) ? 1U : 0U;
+
+    /* doy / 32 never overshoots and undershoots by at most one month */
+    month = (doy >> 5) + 1U;
+    if (doy >= gDaysBeforeMonth[leap][month + 1U])
+    {
+        month++;
+    }
+
+    hours = sod / 3600U;
+    if (hour12 != 0U)
+    {
+        pm    = (hours >= 12U) ? RTC_TR_PM : 0U;
+        hours = hours % 12U;
+        hours = (hours == 0U) ? 12U : hours;
+    }
+
+    *tr = pm |
+          (BIN2BCD(hours) << 16) |
+          (BIN2BCD((sod / 60U) % 60U) << 8) |
+          BIN2BCD(sod % 60U);
+
+    *dr = (BIN2BCD((quad * 4U) + yearInQuad) << 16) |
+          ((((days + RTC_EPOCH_WEEKDAY_OFFSET) % 7U) + 1U) << RTC_DR_WDU_Pos) |
+          (BIN2BCD(month) << 8) |
+          BIN2BCD(doy - gDaysBeforeMonth[leap][month] + 1U);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                            Register access                                 */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Read the calendar straight from TR/DR and return Unix seconds.
+  * @note   Works with and without BYPSHAD: TR is re-read so a carry between
+  *         the TR and DR reads is detected.  Without BYPSHAD that last TR
+  *         read locks the shadow registers until DR is read, so DR is read
+  *         once more; otherwise the next HAL_RTC_GetTime/GetDate would
+  *         return the frozen values.
+  */
+uint32_t RTC_Epoch_Read(void)
+{
+    uint32_t tr;
+    uint32_t dr;
+
+    do
+    {
+        tr = RTC->TR;
+        dr = RTC->DR;
+    } while (tr != RTC->TR);
+    (void)RTC->DR;
+
+    return RTC_Epoch_FromRegs(tr, dr, RTC->CR & RTC_CR_FMT);
+}
+
+/**
+  * @brief  Program the calendar from Unix seconds through init mode.
+  */
+HAL_StatusTypeDef RTC_Epoch_Set(RTC_HandleTypeDef *hrtc, uint32_t epoch)
+{
+    uint32_t tr;
+    uint32_t dr;
+    uint32_t tickstart;
+
+    if ((epoch < RTC_EPOCH_MIN) || (epoch > RTC_EPOCH_MAX))
+    {
+        return HAL_ERROR;
+    }
+
+    RTC_Epoch_ToRegs(epoch, hrtc->Instance->CR & RTC_CR_FMT, &tr, &dr);
+
+    __HAL_RTC_WRITEPROTECTION_DISABLE(hrtc);
+
+    /* Enter init mode: the calendar stops until INIT is cleared again */
+    hrtc->Instance->ISR |= RTC_ISR_INIT;
+    tickstart = HAL_GetTick();
+    while ((hrtc->Instance->ISR & RTC_ISR_INITF) == 0U)
+    {
+        if ((HAL_GetTick() - tickstart) > RTC_EPOCH_INIT_TIMEOUT)
+        {
+            __HAL_RTC_WRITEPROTECTION_ENABLE(hrtc);
+            return HAL_TIMEOUT;
+        }
+    }
+
+    hrtc->Instance->TR = tr;
+    hrtc->Instance->DR = dr;
+
+    hrtc->Instance->ISR &= ~RTC_ISR_INIT;
+
+    __HAL_RTC_WRITEPROTECTION_ENABLE(hrtc);
+
+    /* Shadow registers are stale until the next RSF unless bypassed */
+    if ((hrtc->Instance->CR & RTC_CR_BYPSHAD) == 0U)
+    {
+        return HAL_RTC_WaitForSynchro(hrtc);
+    }
+
+    return HAL_OK;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                               Benchmark                                    */
+/* -------------------------------------------------------------------------- */
+
+#ifdef RTC_EPOCH_BENCHMARK
+/**
+  * @brief  Measure the average cost of one calendar read in CPU cycles:
+  *         HAL_RTC_GetTime + HAL_RTC_GetDate versus RTC_Epoch_Read().
+  */
+void RTC_Epoch_Benchmark(RTC_HandleTypeDef *hrtc, uint32_t iterations,
+                         uint32_t *halCycles, uint32_t *directCycles)
+{
+    RTC_TimeTypeDef timeNow;
+    RTC_DateTypeDef dateNow;
+    volatile uint32_t sink = 0U;
+    uint32_t start;
+    uint32_t i;
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0U;
+    DWT->CTRL  |= DWT_CTRL_CYCCNTENA_Msk;
+
+    start = DWT->CYCCNT;
+    for (i = 0U; i < iterations; i++)
+    {
+        HAL_RTC_GetTime(hrtc, &timeNow, RTC_FORMAT_BIN);
+        HAL_RTC_GetDate(hrtc, &dateNow, RTC_FORMAT_BIN);
+        sink += timeNow.Seconds;
+    }
+    *halCycles = (DWT->CYCCNT - start) / iterations;
+
+    start = DWT->CYCCNT;
+    for (i = 0U; i < iterations; i++)
+    {
+        sink += RTC_Epoch_Read();
+    }
+    *directCycles = (DWT->CYCCNT - start) / iterations;
+
+    (void)sink;
+}
+#endif /* RTC_EPOCH_BENCHMARK */
@@ -0,0 +1,431 @@
+/* Includes ------------------------------------------------------------------*/
+#include "rtc_sched.h"
+#include "rtc_epoch.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define RTC_SCHED_MAGIC         0x5C4DU
+#define RTC_SCHED_WF_TIMEOUT    1000U      /* ms, same as the HAL             */
+
+/* Alarms compare day-of-month + time, so they alias after a month: never
+ * arm further ahead than this, just wake up and re-arm. */
+#define RTC_SCHED_MAX_ALARM_S   (27UL * 86400UL)
+
+#define RTC_SCHED_ALARM_A       0U
+#define RTC_SCHED_ALARM_B       1U
+
+/* Private types -------------------------------------------------------------*/
+typedef struct
+{
+    uint32_t epoch;
+    uint8_t  id;
+} RTC_Sched_EventTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static RTC_HandleTypeDef     *gSchedRtc;
+static RTC_Sched_EventTypeDef gQueue[RTC_SCHED_MAX_EVENTS];   /* sorted by epoch */
+static uint32_t               gCount;
+static volatile uint32_t      gAlarmPending;
+
+/* Private function prototypes -----------------------------------------------*/
+static void              RTC_Sched_Load(void);
+static void              RTC_Sched_Save(void);
+static void              RTC_Sched_Arm(uint32_t now);
+static HAL_StatusTypeDef RTC_Sched_ArmAlarm(uint32_t alarm, uint32_t epoch, uint32_t now);
+static uint8_t           RTC_Sched_Crc8(uint8_t crc, uint32_t word);
+
+/* -------------------------------------------------------------------------- */
+/*                               Public API                                   */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Restore the queue from the backup registers and re-arm the alarms.
+  * @param  hrtc: RTC handle already initialised by HAL_RTC_Init().
+  * @retval Number of events restored.
+  */
+uint32_t RTC_Sched_Init(RTC_HandleTypeDef *hrtc)
+{
+    gSchedRtc = hrtc;
+
+    __HAL_RCC_PWR_CLK_ENABLE();
+    HAL_PWR_EnableBkUpAccess();
+
+    /* Woken up by an alarm: the flags are still set from before STANDBY */
+    gAlarmPending = ((RTC->ISR & (RTC_ISR_ALRAF | RTC_ISR_ALRBF)) != 0U) ? 1U : 0U;
+    __HAL_RTC_ALARM_CLEAR_FLAG(hrtc, RTC_FLAG_ALRAF);
+    __HAL_RTC_ALARM_CLEAR_FLAG(hrtc, RTC_FLAG_ALRBF);
+
+    /* Alarm interrupts reach the NVIC through EXTI line 17 */
+    __HAL_RTC_ALARM_EXTI_ENABLE_IT();
+    __HAL_RTC_ALARM_EXTI_ENABLE_RISING_EDGE();
+    __HAL_RTC_ALARM_EXTI_CLEAR_FLAG();
+    HAL_NVIC_SetPriority(RTC_Alarm_IRQn, 14, 0);
+    HAL_NVIC_EnableIRQ(RTC_Alarm_IRQn);
+
+    RTC_Sched_Load();
+    RTC_Sched_Arm(RTC_Epoch_Read());
+
+    return gCount;
+}
+
+/**
+  * @brief  Queue an event.  Events with the same time fire in insertion order.
+  * @retval HAL_ERROR if the queue is full or the event is outside the
+  *         RTC range or the RTC_SCHED_HORIZON_S window of the queue.
+  */
+HAL_StatusTypeDef RTC_Sched_Add(uint32_t epoch, uint8_t id)
+{
+    uint32_t lo;
+    uint32_t hi;
+    uint32_t pos;
+
+    if ((epoch < RTC_EPOCH_MIN) || (epoch > RTC_EPOCH_MAX) ||
+        (gCount >= RTC_SCHED_MAX_EVENTS))
+    {
+        return HAL_ERROR;
+    }
+
+    if (gCount != 0U)
+    {
+        lo = (epoch < gQueue[0].epoch) ? epoch : gQueue[0].epoch;
+        hi = (epoch > gQueue[gCount - 1U].epoch) ? epoch : gQueue[gCount - 1U].epoch;
+        if ((hi - lo) > RTC_SCHED_HORIZON_S)
+        {
+            return HAL_ERROR;
+        }
+    }
+
+    pos = gCount;
+    while ((pos != 0U) && (gQueue[pos - 1U].epoch > epoch))
+    {
+        gQueue[pos] = gQueue[pos - 1U];
+        pos--;
+    }
+    gQueue[pos].epoch = epoch;
+    gQueue[pos].id    = id;
+    gCount++;
+
+    RTC_Sched_Save();
+    if (pos < 2U)
+    {
+        RTC_Sched_Arm(RTC_Epoch_Read());
+    }
+
+    return HAL_OK;
+}
+
+/**
+  * @brief  Remove every queued event with the given id.
+  */
+HAL_StatusTypeDef RTC_Sched_Cancel(uint8_t id)
+{
+    uint32_t src;
+    uint32_t dst = 0U;
+
+    for (src = 0U; src < gCount; src++)
+    {
+        if (gQueue[src].id != id)
+        {
+            gQueue[dst++] = gQueue[src];
+        }
+    }
+
+    if (dst == gCount)
+    {
+        return HAL_ERROR;
+    }
+
+    gCount = dst;
+    RTC_Sched_Save();
+    RTC_Sched_Arm(RTC_Epoch_Read());
+
+    return HAL_OK;
+}
+
+/**
+  * @brief  Dispatch every due event through RTC_Sched_EventCallback(), then
+  *         persist the queue and re-arm the alarms.  Call after each wakeup.
+  * @retval Number of events dispatched.
+  */
+FASTCODE uint32_t RTC_Sched_Process(void)
+{
+    RTC_Sched_EventTypeDef ev;
+    uint32_t dispatched = 0U;
+    uint32_t now;
+    uint32_t i;
+
+    gAlarmPending = 0U;
+    __HAL_RTC_ALARM_CLEAR_FLAG(gSchedRtc, RTC_FLAG_ALRAF);
+    __HAL_RTC_ALARM_CLEAR_FLAG(gSchedRtc, RTC_FLAG_ALRBF);
+
+    now = RTC_Epoch_Read();
+
+    for (;;)
+    {
+        while ((gCount != 0U) && (gQueue[0].epoch <= now))
+        {
+            ev = gQueue[0];
+            for (i = 1U; i < gCount; i++)
+            {
+                gQueue[i - 1U] = gQueue[i];
+            }
+            gCount--;
+            dispatched++;
+
+            /* The callback may queue new events (e.g. periodic ones) */
+            RTC_Sched_EventCallback(ev.id, ev.epoch);
+        }
+
+        if (dispatched != 0U)
+        {
+            RTC_Sched_Save();
+        }
+        RTC_Sched_Arm(now);
+
+        /* An event that fell due while arming would never match its alarm */
+        now = RTC_Epoch_Read();
+        if ((gCount == 0U) || (gQueue[0].epoch > now))
+        {
+            break;
+        }
+    }
+
+    return dispatched;
+}
+
+uint32_t RTC_Sched_Count(void)
+{
+    return gCount;
+}
+
+/**
+  * @brief  Non-zero if an event with the given id is queued.
+  */
+uint32_t RTC_Sched_Contains(uint8_t id)
+{
+    uint32_t i;
+
+    for (i = 0U; i < gCount; i++)
+    {
+        if (gQueue[i].id == id)
+        {
+            return 1U;
+        }
+    }
+
+    return 0U;
+}
+
+/**
+  * @brief  Time and id of the nearest queued event.
+  */
+HAL_StatusTypeDef RTC_Sched_Next(uint32_t *epoch, uint8_t *id)
+{
+    if (gCount == 0U)
+    {
+        return HAL_ERROR;
+    }
+
+    *epoch = gQueue[0].epoch;
+    *id    = gQueue[0].id;
+
+    return HAL_OK;
+}
+
+/**
+  * @brief  Non-zero once an alarm fired since the last RTC_Sched_Process().
+  */
+uint32_t RTC_Sched_IsPending(void)
+{
+    return gAlarmPending;
+}
+
+/**
+  * @brief  Called from RTC_Alarm_IRQHandler.  Only flags the wakeup; events
+  *         are dispatched in thread context by RTC_Sched_Process().
+  */
+FASTCODE void RTC_Sched_AlarmIRQHandler(void)
+{
+    if ((RTC->ISR & (RTC_ISR_ALRAF | RTC_ISR_ALRBF)) != 0U)
+    {
+        __HAL_RTC_ALARM_CLEAR_FLAG(gSchedRtc, RTC_FLAG_ALRAF);
+        __HAL_RTC_ALARM_CLEAR_FLAG(gSchedRtc, RTC_FLAG_ALRBF);
+        gAlarmPending = 1U;
+    }
+
+    __HAL_RTC_ALARM_EXTI_CLEAR_FLAG();
+}
+
+__weak void RTC_Sched_EventCallback(uint8_t id, uint32_t epoch)
+{
+    (void)id;
+    (void)epoch;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                              Local helpers                                 */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Rebuild the queue from the backup registers; an invalid image
+  *         (first power-up, backup domain reset) leaves it empty.
+  */
+static void RTC_Sched_Load(void)
+{
+    uint32_t hdr   = HAL_RTCEx_BKUPRead(gSchedRtc, BKP_REG_SCHED_HDR);
+    uint32_t base  = HAL_RTCEx_BKUPRead(gSchedRtc, BKP_REG_SCHED_BASE);
+    uint32_t count = (hdr >> 8) & 0xFFU;
+    uint32_t slot;
+    uint8_t  crc;
+    uint32_t i;
+
+    gCount = 0U;
+
+    if (((hdr >> 16) != RTC_SCHED_MAGIC) || (count > RTC_SCHED_MAX_EVENTS))
+    {
+        return;
+    }
+
+    crc = RTC_Sched_Crc8(0U, base);
+    crc = RTC_Sched_Crc8(crc, count);
+    for (i = 0U; i < count; i++)
+    {
+        slot = HAL_RTCEx_BKUPRead(gSchedRtc, BKP_REG_SCHED_SLOT0 + i);
+        crc  = RTC_Sched_Crc8(crc, slot);
+
+        gQueue[i].epoch = base + (slot >> 8);
+        gQueue[i].id    = (uint8_t)slot;
+    }
+
+    if (crc == (uint8_t)hdr)
+    {
+        gCount = count;
+    }
+}
+
+/**
+  * @brief  Mirror the queue into the backup registers as the first event's
+  *         epoch plus 24-bit offsets.  The header is invalidated first and
+  *         written last, so a reset in between loses the queue cleanly.
+  */
+static void RTC_Sched_Save(void)
+{
+    uint32_t base = (gCount != 0U) ? gQueue[0].epoch : 0U;
+    uint32_t slot;
+    uint8_t  crc;
+    uint32_t i;
+
+    HAL_RTCEx_BKUPWrite(gSchedRtc, BKP_REG_SCHED_HDR, 0U);
+    HAL_RTCEx_BKUPWrite(gSchedRtc, BKP_REG_SCHED_BASE, base);
+
+    crc = RTC_Sched_Crc8(0U, base);
+    crc = RTC_Sched_Crc8(crc, gCount);
+    for (i = 0U; i < gCount; i++)
+    {
+        slot = ((gQueue[i].epoch - base) << 8) | gQueue[i].id;
+        crc  = RTC_Sched_Crc8(crc, slot);
+        HAL_RTCEx_BKUPWrite(gSchedRtc, BKP_REG_SCHED_SLOT0 + i, slot);
+    }
+
+    HAL_RTCEx_BKUPWrite(gSchedRtc, BKP_REG_SCHED_HDR,
+                        (RTC_SCHED_MAGIC << 16) | (gCount << 8) | crc);
+}
+
+/**
+  * @brief  Alarm A -> nearest event, Alarm B -> the one after it.
+  */
+static FASTCODE void RTC_Sched_Arm(uint32_t now)
+{
+    HAL_StatusTypeDef status;
+
+    __HAL_RTC_WRITEPROTECTION_DISABLE(gSchedRtc);
+
+    status = RTC_Sched_ArmAlarm(RTC_SCHED_ALARM_A,
+                                (gCount > 0U) ? gQueue[0].epoch : 0U, now);
+    if (status == HAL_OK)
+    {
+        status = RTC_Sched_ArmAlarm(RTC_SCHED_ALARM_B,
+                                    (gCount > 1U) ? gQueue[1].epoch : 0U, now);
+    }
+
+    __HAL_RTC_WRITEPROTECTION_ENABLE(gSchedRtc);
+
+    (void)status;
+}
+
+/**
+  * @brief  Program one alarm directly through ALRMxR; epoch 0 disables it.
+  *         Write protection must already be lifted.
+  */
+static HAL_StatusTypeDef RTC_Sched_ArmAlarm(uint32_t alarm, uint32_t epoch, uint32_t now)
+{
+    uint32_t enableBits = (alarm == RTC_SCHED_ALARM_A) ?
+                          (RTC_CR_ALRAE | RTC_CR_ALRAIE) : (RTC_CR_ALRBE | RTC_CR_ALRBIE);
+    uint32_t writeFlag  = (alarm == RTC_SCHED_ALARM_A) ? RTC_ISR_ALRAWF : RTC_ISR_ALRBWF;
+    uint32_t tr;
+    uint32_t dr;
+    uint32_t tickstart;
+
+    RTC->CR &= ~enableBits;
+
+    if (epoch == 0U)
+    {
+        return HAL_OK;
+    }
+
+    if (epoch <= now)
+    {
+        epoch = now + 1U;
+    }
+    else if ((epoch - now) > RTC_SCHED_MAX_ALARM_S)
+    {
+        epoch = now + RTC_SCHED_MAX_ALARM_S;
+    }
+
+    tickstart = HAL_GetTick();
+    while ((RTC->ISR & writeFlag) == 0U)
+    {
+        if ((HAL_GetTick() - tickstart) > RTC_SCHED_WF_TIMEOUT)
+        {
+            return HAL_TIMEOUT;
+        }
+    }
+
+    /* ALRMxR has the TR layout plus the day of month in bits 29:24; all
+     * MSKx bits clear -> date, hours, minutes and seconds must match. */
+    RTC_Epoch_ToRegs(epoch, RTC->CR & RTC_CR_FMT, &tr, &dr);
+
+    if (alarm == RTC_SCHED_ALARM_A)
+    {
+        RTC->ALRMAR   = tr | ((dr & (RTC_DR_DT | RTC_DR_DU)) << 24);
+        RTC->ALRMASSR = 0U;
+    }
+    else
+    {
+        RTC->ALRMBR   = tr | ((dr & (RTC_DR_DT | RTC_DR_DU)) << 24);
+        RTC->ALRMBSSR = 0U;
+    }
+
+    RTC->CR |= enableBits;
+
+    return HAL_OK;
+}
+
+/**
+  * @brief  CRC-8 (poly 0x07) over the four bytes of @p word, LSB first.
+  */
+static uint8_t RTC_Sched_Crc8(uint8_t crc, uint32_t word)
+{
+    uint32_t i;
+    uint32_t bit;
+
+    for (i = 0U; i < 4U; i++)
+    {
+        crc ^= (uint8_t)(word >> (8U * i));
+        for (bit = 0U; bit < 8U; bit++)
+        {
+            crc = (uint8_t)(((crc & 0x80U) != 0U) ? ((crc << 1) ^ 0x07U) : (crc << 1));
+        }
+    }
+
+    return crc;
+}
@@ -0,0 +1,155 @@
+/* Includes ------------------------------------------------------------------*/
+#include "rtc_time.h"
+#include "rtc_epoch.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define RTC_TIME_FRAC_SHIFT     16U
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t gPredivS;          /* SynchPrediv, SSR counts down from it    */
+static uint32_t gUsPerTickQ16;     /* 1e6 / (PREDIV_S + 1) in Q16             */
+
+/* Last converted calendar value */
+static uint32_t gCachedTr = 0xFFFFFFFFU;
+static uint32_t gCachedDr = 0xFFFFFFFFU;
+static uint32_t gCachedSec;        /* epoch seconds for gCachedTr/gCachedDr   */
+
+static uint64_t gLastMonotonicUs;
+
+/* Private function prototypes -----------------------------------------------*/
+static void     RTC_Time_ReadRaw(uint32_t *tr, uint32_t *dr, uint32_t *ssr);
+
+/* -------------------------------------------------------------------------- */
+/*                               Public API                                   */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Enable shadow-register bypass and latch the synchronous prescaler.
+  * @param  hrtc: RTC handle already initialised by HAL_RTC_Init().
+  */
+void RTC_Time_Init(RTC_HandleTypeDef *hrtc)
+{
+    __HAL_RTC_WRITEPROTECTION_DISABLE(hrtc);
+    hrtc->Instance->CR |= RTC_CR_BYPSHAD;
+    __HAL_RTC_WRITEPROTECTION_ENABLE(hrtc);
+
+    gPredivS      = hrtc->Instance->PRER & RTC_PRER_PREDIV_S;
+    gUsPerTickQ16 = (uint32_t)((1000000ULL << RTC_TIME_FRAC_SHIFT) / (gPredivS + 1U));
+
+    gCachedTr        = 0xFFFFFFFFU;
+    gCachedDr        = 0xFFFFFFFFU;
+    gLastMonotonicUs = 0U;
+}
+
+/**
+  * @brief  Unix time in microseconds.
+  *         Resolution is one RTC sub-second tick (see RTC_Time_GetResolutionUs).
+  */
+uint64_t RTC_Time_GetEpochUs(void)
+{
+    uint32_t tr;
+    uint32_t dr;
+    uint32_t ssr;
+    uint32_t sec;
+    uint32_t hit;
+    uint32_t primask;
+    int32_t  ticks;
+    int64_t  fracUs;
+
+    RTC_Time_ReadRaw(&tr, &dr, &ssr);
+
+    /* Also used from interrupts: the three cache fields only change and are
+     * only read together */
+    primask = __get_PRIMASK();
+    __disable_irq();
+    hit = ((tr == gCachedTr) && (dr == gCachedDr)) ? 1U : 0U;
+    sec = gCachedSec;
+    __set_PRIMASK(primask);
+
+    if (hit == 0U)
+    {
+        sec = RTC_Epoch_FromRegs(tr, dr, RTC->CR & RTC_CR_FMT);
+
+        __disable_irq();
+        gCachedSec = sec;
+        gCachedTr  = tr;
+        gCachedDr  = dr;
+        __set_PRIMASK(primask);
+    }
+
+    /* SSR may exceed PREDIV_S right after a shift operation: the fraction is
+     * then negative and belongs to the previous second. */
+    ticks  = (int32_t)gPredivS - (int32_t)ssr;
+    fracUs = ((int64_t)ticks * (int64_t)gUsPerTickQ16) >> RTC_TIME_FRAC_SHIFT;
+
+    return (uint64_t)((int64_t)sec * 1000000LL + fracUs);
+}
+
+/**
+  * @brief  Unix time in milliseconds.
+  */
+uint64_t RTC_Time_GetEpochMs(void)
+{
+    return RTC_Time_GetEpochUs() / 1000U;
+}
+
+/**
+  * @brief  Like RTC_Time_GetEpochUs() but never goes backwards, even if the
+  *         calendar is set back or shifted while running.
+  */
+uint64_t RTC_Time_GetMonotonicUs(void)
+{
+    uint64_t now = RTC_Time_GetEpochUs();
+    uint32_t primask;
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+
+    if (now < gLastMonotonicUs)
+    {
+        now = gLastMonotonicUs;
+    }
+    gLastMonotonicUs = now;
+
+    __set_PRIMASK(primask);
+
+    return now;
+}
+
+/**
+  * @brief  Length of one sub-second tick in microseconds (rounded down).
+  */
+uint32_t RTC_Time_GetResolutionUs(void)
+{
+    return gUsPerTickQ16 >> RTC_TIME_FRAC_SHIFT;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                              Local helpers                                 */
+/* -------------------------------------------------------------------------- */
+
+/**
+  * @brief  Coherent snapshot of the calendar with BYPSHAD = 1.
+  * @note   Without shadow registers the counters are read live.  SSR reloads
+  *         exactly when the seconds increment, so two equal SSR/TR reads
+  *         bracketing DR prove that no carry happened in between.
+  */
+static void RTC_Time_ReadRaw(uint32_t *tr, uint32_t *dr, uint32_t *ssr)
+{
+    uint32_t ssr1;
+    uint32_t tr1;
+    uint32_t dr1;
+
+    do
+    {
+        ssr1 = RTC->SSR;
+        tr1  = RTC->TR;
+        dr1  = RTC->DR;
+    } while ((ssr1 != RTC->SSR) || (tr1 != RTC->TR));
+
+    *tr  = tr1 & (RTC_TR_PM | RTC_TR_HT | RTC_TR_HU | RTC_TR_MNT |
+                  RTC_TR_MNU | RTC_TR_ST | RTC_TR_SU);
+    *dr  = dr1 & (RTC_DR_YT | RTC_DR_YU | RTC_DR_MT | RTC_DR_MU |
+                  RTC_DR_DT | RTC_DR_DU);
+    *ssr = ssr1 & RTC_SSR_SS;
+}
@@ -3,6 +3,7 @@
 #include "stm32f4xx_it.h"
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "crash_dump.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -65,7 +66,7 @@ void NMI_Handler(void)
 void HardFault_Handler(void)
 {
   /* USER CODE BEGIN HardFault_IRQn 0 */
-
+  CRASH_DUMP_CAPTURE();
   /* USER CODE END HardFault_IRQn 0 */
   while (1)
   {
@@ -80,7 +81,7 @@ void HardFault_Handler(void)
 void MemManage_Handler(void)
 {
   /* USER CODE BEGIN MemoryManagement_IRQn 0 */
-
+  CRASH_DUMP_CAPTURE();
   /* USER CODE END MemoryManagement_IRQn 0 */
   while (1)
   {
@@ -95,7 +96,7 @@ void MemManage_Handler(void)
 void BusFault_Handler(void)
 {
   /* USER CODE BEGIN BusFault_IRQn 0 */
-
+  CRASH_DUMP_CAPTURE();
   /* USER CODE END BusFault_IRQn 0 */
   while (1)
   {
@@ -110,7 +111,7 @@ void BusFault_Handler(void)
 void UsageFault_Handler(void)
 {
   /* USER CODE BEGIN UsageFault_IRQn 0 */
-
+  CRASH_DUMP_CAPTURE();
   /* USER CODE END UsageFault_IRQn 0 */
   while (1)
   {
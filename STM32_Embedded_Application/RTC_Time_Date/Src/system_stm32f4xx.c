@@ -137,6 +137,28 @@ void SystemInit(void)
     SCB->CPACR |= ((3UL << 10*2)|(3UL << 11*2));  /* set CP10 and CP11 Full Access */
   #endif
 
+  /* Boot-time instrumentation: start the cycle counter before .data/.bss init */
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0U;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  /* Copy the .fastcode section (FASTCODE in main_app.h) to SRAM1.  Empty
+     unless built with FASTCODE_IN_RAM; load and run addresses match when
+     linked with STM32F446RETX_RAM.ld. */
+  {
+    extern uint32_t _sifastcode, _sfastcode, _efastcode;
+    const uint32_t *src = &_sifastcode;
+    uint32_t *dst       = &_sfastcode;
+
+    if (src != dst)
+    {
+      while (dst < &_efastcode)
+      {
+        *dst++ = *src++;
+      }
+    }
+  }
+
 #if defined (DATA_IN_ExtSRAM) || defined (DATA_IN_ExtSDRAM)
   SystemInit_ExtMemCtl(); 
 #endif /* DATA_IN_ExtSRAM || DATA_IN_ExtSDRAM */
@@ -0,0 +1,20 @@
+/*
+ * Host stand-in for the exclusive monitor, force-included ahead of pool.c
+ * (see Makefile).  The CMSIS intrinsics become calls into the test, which
+ * can run a simulated interrupt between a load-exclusive and its store;
+ * the exception return clears the monitor as on the Cortex-M4.
+ */
+#ifndef LDREX_SIM_H_
+#define LDREX_SIM_H_
+
+#include "stm32f4xx_hal.h"          /* cmsis_gcc.h first, then override it  */
+
+uint32_t Sim_Ldrex(volatile uint32_t *addr);
+uint32_t Sim_Strex(uint32_t value, volatile uint32_t *addr);
+void     Sim_Clrex(void);
+
+#define __LDREXW(addr)          Sim_Ldrex(addr)
+#define __STREXW(value, addr)   Sim_Strex((value), (addr))
+#define __CLREX()               Sim_Clrex()
+
+#endif /* LDREX_SIM_H_ */
@@ -0,0 +1,14 @@
+/* Host stand-in for newlib's <reent.h>: only what pool.c touches */
+#ifndef REENT_H_
+#define REENT_H_
+
+struct _reent
+{
+    int _errno;
+};
+
+extern struct _reent *_impure_ptr;
+
+#define _REENT  _impure_ptr
+
+#endif /* REENT_H_ */
@@ -0,0 +1,61 @@
+#ifndef STM32F4xx_HAL_RTC_H
+#define STM32F4xx_HAL_RTC_H
+
+/*
+ * Host builds only: Drivers/ does not carry the RTC HAL module, which
+ * RTC_Time_Date enables.  Just enough of it for the sources under test.
+ */
+
+#include "stm32f4xx_hal_def.h"
+
+typedef struct
+{
+    uint32_t HourFormat;
+    uint32_t AsynchPrediv;
+    uint32_t SynchPrediv;
+    uint32_t OutPut;
+    uint32_t OutPutPolarity;
+    uint32_t OutPutType;
+} RTC_InitTypeDef;
+
+typedef struct
+{
+    RTC_TypeDef     *Instance;
+    RTC_InitTypeDef  Init;
+    HAL_LockTypeDef  Lock;
+    volatile uint32_t State;
+} RTC_HandleTypeDef;
+
+typedef struct
+{
+    uint8_t  Hours;
+    uint8_t  Minutes;
+    uint8_t  Seconds;
+    uint8_t  TimeFormat;
+    uint32_t SubSeconds;
+    uint32_t SecondFraction;
+    uint32_t DayLightSaving;
+    uint32_t StoreOperation;
+} RTC_TimeTypeDef;
+
+typedef struct
+{
+    uint8_t WeekDay;
+    uint8_t Month;
+    uint8_t Date;
+    uint8_t Year;
+} RTC_DateTypeDef;
+
+#define RTC_FORMAT_BIN      0U
+#define RTC_FORMAT_BCD      1U
+
+#define __HAL_RTC_WRITEPROTECTION_DISABLE(h) \
+    do { (h)->Instance->WPR = 0xCAU; (h)->Instance->WPR = 0x53U; } while (0)
+#define __HAL_RTC_WRITEPROTECTION_ENABLE(h) \
+    do { (h)->Instance->WPR = 0xFFU; } while (0)
+
+HAL_StatusTypeDef HAL_RTC_WaitForSynchro(RTC_HandleTypeDef *hrtc);
+HAL_StatusTypeDef HAL_RTC_GetTime(RTC_HandleTypeDef *hrtc, RTC_TimeTypeDef *sTime, uint32_t Format);
+HAL_StatusTypeDef HAL_RTC_GetDate(RTC_HandleTypeDef *hrtc, RTC_DateTypeDef *sDate, uint32_t Format);
+
+#endif /* STM32F4xx_HAL_RTC_H */
@@ -0,0 +1,744 @@
+/*
+ * Host test: kvstore.c (CAN_Normal_Mode) on a simulated flash.
+ *
+ *   The whole 512 KB flash is an anonymous mapping at its real address,
+ *   0x08000000, and the store's linker symbols point at sectors 1 and 2
+ *   as in the firmware.  The Flash_If_* layer below behaves like the F446
+ *   array: erase sets a sector to 0xFF, programming can only clear bits
+ *   (the test fails if the store ever asks for a 0 -> 1 change), and the
+ *   CRC32 matches the CRC unit.
+ *
+ *   Every flash operation is counted, which gives two kinds of injection:
+ *
+ *     power fail   the n-th operation is torn (a random part of an erase,
+ *                  a random subset of a word's bits) and the run is cut
+ *                  short with longjmp; the store is then rebooted with
+ *                  KV_Init() on whatever the flash holds
+ *     fault        the n-th operation fails with HAL_ERROR, without a
+ *                  reset, and the workload carries on
+ *
+ *   Both are swept over every operation of a workload that runs several
+ *   background and foreground compactions.  Faults are also swept over a
+ *   compaction driven by the idle loop alone, with keys that are never
+ *   rewritten and so only survive through the copy.  After each reboot, every key
+ *   must read back its last acknowledged value, or the value of the one
+ *   update that was in flight; the store must then accept new writes and
+ *   survive another reboot.
+ *
+ *   test_kvstore            full sweeps
+ *   test_kvstore <stride>   inject at every <stride>-th operation only
+ */
+
+#include "kvstore.h"
+#include "flash_if.h"
+#include "crc32.h"
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define SIM_FLASH_SIZE      (FLASH_IF_END - FLASH_IF_BASE)
+#define SIM_KV_BASE         0x08004000UL        /* _skvstore, see Makefile   */
+#define SIM_KV_END          0x0800C000UL        /* _ekvstore                 */
+
+#define SIM_KEYS            24U
+#define SIM_MAX_LEN         40U
+#define SIM_WORKLOAD_OPS    1500U
+
+/* One key in the reference model */
+typedef struct
+{
+    uint32_t present;
+    uint32_t len;
+    uint8_t  value[SIM_MAX_LEN];
+} Sim_ValueTypeDef;
+
+typedef struct
+{
+    Sim_ValueTypeDef acked;         /* last update the store returned OK for */
+    Sim_ValueTypeDef pending;       /* update in flight or failed            */
+    uint32_t         uncertain;     /* either of the two is acceptable       */
+} Sim_KeyTypeDef;
+
+/* Flash simulation state */
+static uint8_t  *gFlash;
+static uint32_t  gOps;
+static uint32_t  gPowerFailAt;      /* 0 = never                             */
+static uint32_t  gFaultAt;          /* 0 = never                             */
+static uint32_t  gInjectedAt;       /* operation of the last injection        */
+static uint32_t  gRandom = 1U;
+static jmp_buf   gPowerFail;
+
+/* CRC unit emulation */
+static uint32_t  gCrc;
+
+static Sim_KeyTypeDef gModel[SIM_KEYS];
+static unsigned long  gFailures;
+static const char    *gCase = "";
+
+/* -------------------------------------------------------------------------- */
+/*                         Flash_If / CRC32 emulation                         */
+/* -------------------------------------------------------------------------- */
+
+static uint32_t Sim_Rand(void)
+{
+    /* xorshift32: reproducible across hosts */
+    gRandom ^= gRandom << 13;
+    gRandom ^= gRandom >> 17;
+    gRandom ^= gRandom << 5;
+    return gRandom;
+}
+
+static void Sim_Fail(const char *fmt, ...)
+{
+    va_list args;
+
+    if (gFailures++ < 20U)
+    {
+        printf("FAIL [%s] ", gCase);
+        va_start(args, fmt);
+        vprintf(fmt, args);
+        va_end(args);
+        printf("\n");
+    }
+}
+
+/* Count one flash operation; returns 1 when it has to fail as a fault */
+static uint32_t Sim_Op(void)
+{
+    gOps++;
+    return ((gFaultAt != 0U) && (gOps == gFaultAt)) ? 1U : 0U;
+}
+
+static uint32_t Sim_PowerFailNow(void)
+{
+    return ((gPowerFailAt != 0U) && (gOps == gPowerFailAt)) ? 1U : 0U;
+}
+
+uint32_t Flash_If_GetSector(uint32_t addr)
+{
+    uint32_t offset = addr - FLASH_IF_BASE;
+
+    if (offset < 0x10000UL)
+    {
+        return offset / 0x4000UL;
+    }
+    if (offset < 0x20000UL)
+    {
+        return 4U;
+    }
+    return 5U + ((offset - 0x20000UL) / 0x20000UL);
+}
+
+uint32_t Flash_If_GetSectorSize(uint32_t sector)
+{
+    return (sector < 4U) ? 0x4000UL : ((sector == 4U) ? 0x10000UL : 0x20000UL);
+}
+
+static uint32_t Sim_SectorBase(uint32_t sector)
+{
+    return (sector < 4U) ? (FLASH_IF_BASE + (sector * 0x4000UL)) :
+           ((sector == 4U) ? (FLASH_IF_BASE + 0x10000UL) :
+                             (FLASH_IF_BASE + 0x20000UL + ((sector - 5U) * 0x20000UL)));
+}
+
+HAL_StatusTypeDef Flash_If_EraseSector(uint32_t sector)
+{
+    uint32_t base = Sim_SectorBase(sector);
+    uint32_t size = Flash_If_GetSectorSize(sector);
+
+    if ((base < SIM_KV_BASE) || ((base + size) > SIM_KV_END))
+    {
+        Sim_Fail("erase outside the store: sector %lu", (unsigned long)sector);
+        return HAL_ERROR;
+    }
+
+    if (Sim_Op() != 0U)
+    {
+        return HAL_ERROR;
+    }
+
+    if (Sim_PowerFailNow() != 0U)
+    {
+        /* Cut somewhere in the middle: the rest keeps its old contents */
+        memset((void *)base, 0xFF, Sim_Rand() % size);
+        longjmp(gPowerFail, 1);
+    }
+
+    memset((void *)base, 0xFF, size);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef Flash_If_ProgramWord(uint32_t addr, uint32_t word)
+{
+    volatile uint32_t *cell = (volatile uint32_t *)addr;
+
+    if (((addr & 3U) != 0U) || (addr < SIM_KV_BASE) || ((addr + 4U) > SIM_KV_END))
+    {
+        Sim_Fail("program outside the store or unaligned: 0x%08lX", (unsigned long)addr);
+        return HAL_ERROR;
+    }
+    if ((word & ~*cell) != 0U)
+    {
+        Sim_Fail("0 -> 1 program at 0x%08lX, word 0x%08lX", (unsigned long)addr, (unsigned long)word);
+    }
+
+    if (Sim_Op() != 0U)
+    {
+        return HAL_ERROR;
+    }
+
+    if (Sim_PowerFailNow() != 0U)
+    {
+        /* Torn: only some of the bits that had to clear did */
+        *cell &= word | Sim_Rand();
+        longjmp(gPowerFail, 1);
+    }
+
+    *cell &= word;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef Flash_If_Program(uint32_t addr, const uint32_t *words, uint32_t count)
+{
+    uint32_t i;
+
+    for (i = 0U; i < count; i++)
+    {
+        if (Flash_If_ProgramWord(addr + (i * 4U), words[i]) != HAL_OK)
+        {
+            return HAL_ERROR;
+        }
+    }
+
+    return HAL_OK;
+}
+
+uint32_t Flash_If_IsErased(uint32_t addr, uint32_t len)
+{
+    const uint8_t *p = (const uint8_t *)addr;
+    uint32_t i;
+
+    for (i = 0U; i < len; i++)
+    {
+        if (p[i] != 0xFFU)
+        {
+            return 0U;
+        }
+    }
+
+    return 1U;
+}
+
+void Flash_If_Init(void)
+{
+}
+
+void CRC32_Reset(void)
+{
+    gCrc = 0xFFFFFFFFUL;
+}
+
+uint32_t CRC32_Accumulate(const uint32_t *words, uint32_t count)
+{
+    uint32_t i;
+    uint32_t bit;
+
+    for (i = 0U; i < count; i++)
+    {
+        gCrc ^= words[i];
+        for (bit = 0U; bit < 32U; bit++)
+        {
+            gCrc = ((gCrc & 0x80000000UL) != 0U) ? ((gCrc << 1) ^ 0x04C11DB7UL) : (gCrc << 1);
+        }
+    }
+
+    return gCrc;
+}
+
+uint32_t CRC32_Compute(const uint32_t *words, uint32_t count)
+{
+    CRC32_Reset();
+    return CRC32_Accumulate(words, count);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                              Reference model                               */
+/* -------------------------------------------------------------------------- */
+
+static uint16_t Sim_Key(uint32_t i)
+{
+    /* Spread over the id space so the hash index probes and wraps */
+    return (uint16_t)(0x0100U + (i * 0x0123U));
+}
+
+static void Sim_MakeValue(uint32_t key, uint32_t version, Sim_ValueTypeDef *v)
+{
+    uint32_t i;
+
+    v->present = 1U;
+    v->len     = 1U + ((key * 7U + version * 13U) % SIM_MAX_LEN);
+    for (i = 0U; i < v->len; i++)
+    {
+        v->value[i] = (uint8_t)(key * 31U + version * 17U + i);
+    }
+}
+
+static uint32_t Sim_Matches(uint16_t key, const Sim_ValueTypeDef *want)
+{
+    uint8_t  buf[KV_MAX_VALUE_LEN];
+    uint16_t len = 0U;
+
+    if (KV_Get(key, buf, sizeof(buf), &len) != HAL_OK)
+    {
+        return (want->present == 0U) ? 1U : 0U;
+    }
+
+    return ((want->present != 0U) && (len == want->len) &&
+            (memcmp(buf, want->value, len) == 0)) ? 1U : 0U;
+}
+
+/* Every key holds its acked value, or the pending one where that is allowed */
+static void Sim_Verify(const char *when)
+{
+    uint32_t i;
+    uint16_t key;
+
+    for (i = 0U; i < SIM_KEYS; i++)
+    {
+        key = Sim_Key(i);
+        if (Sim_Matches(key, &gModel[i].acked) != 0U)
+        {
+            continue;
+        }
+        if ((gModel[i].uncertain != 0U) && (Sim_Matches(key, &gModel[i].pending) != 0U))
+        {
+            /* Now known: the failed or torn update did land */
+            continue;
+        }
+        Sim_Fail("key 0x%04lX wrong %s, injection at op %lu (0: none)",
+                 (unsigned long)key, when, (unsigned long)gInjectedAt);
+    }
+}
+
+/* After a reboot the pending updates are settled one way or the other */
+static void Sim_Settle(void)
+{
+    uint32_t i;
+
+    for (i = 0U; i < SIM_KEYS; i++)
+    {
+        if ((gModel[i].uncertain != 0U) &&
+            (Sim_Matches(Sim_Key(i), &gModel[i].acked) == 0U))
+        {
+            gModel[i].acked = gModel[i].pending;
+        }
+        gModel[i].uncertain = 0U;
+    }
+}
+
+static void Sim_Reboot(void)
+{
+    if (KV_Init() != HAL_OK)
+    {
+        Sim_Fail("KV_Init failed after %lu ops", (unsigned long)gOps);
+    }
+}
+
+static void Sim_FreshFlash(void)
+{
+    memset(gFlash, 0xFF, SIM_FLASH_SIZE);
+    memset(gModel, 0, sizeof(gModel));
+    gOps        = 0U;
+    gInjectedAt = 0U;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                 Workload                                   */
+/* -------------------------------------------------------------------------- */
+
+/*
+ * Deterministic mix of updates, identical rewrites and deletes, with the
+ * idle loop run in between so background compactions start, step and
+ * finish while writes keep coming.  Starts at step @p from.
+ */
+static void Sim_Workload(uint32_t from)
+{
+    Sim_ValueTypeDef v;
+    HAL_StatusTypeDef status;
+    uint32_t step;
+    uint32_t i;
+    uint32_t idle;
+
+    for (step = from; step < SIM_WORKLOAD_OPS; step++)
+    {
+        i = (step * 7U + (step >> 3)) % SIM_KEYS;
+
+        if ((step % 29U) == 11U)
+        {
+            gModel[i].pending.present = 0U;
+            gModel[i].uncertain       = 1U;
+            status = KV_Delete(Sim_Key(i));
+            if ((status != HAL_OK) && (gModel[i].acked.present != 0U))
+            {
+                continue;       /* fault: stays uncertain */
+            }
+            memset(&gModel[i].acked, 0, sizeof(gModel[i].acked));
+            gModel[i].uncertain = 0U;
+        }
+        else
+        {
+            Sim_MakeValue(i, step / 5U, &v);
+            gModel[i].pending   = v;
+            gModel[i].uncertain = 1U;
+            if (KV_Put(Sim_Key(i), v.value, (uint16_t)v.len) != HAL_OK)
+            {
+                continue;
+            }
+            gModel[i].acked     = v;
+            gModel[i].uncertain = 0U;
+        }
+
+        for (idle = 0U; idle < (step % 3U); idle++)
+        {
+            KV_Idle();
+        }
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                  Cases                                     */
+/* -------------------------------------------------------------------------- */
+
+static void Case_Basic(void)
+{
+    static const uint8_t a[] = { 1, 2, 3 };
+    static const uint8_t b[] = { 9, 8, 7, 6, 5 };
+    uint8_t  buf[8];
+    uint16_t len;
+    uint32_t ops;
+
+    gCase = "basic";
+    Sim_FreshFlash();
+    Sim_Reboot();
+
+    if ((KV_Put(1U, a, sizeof(a)) != HAL_OK) || (KV_Put(2U, b, sizeof(b)) != HAL_OK))
+    {
+        Sim_Fail("put failed");
+    }
+
+    ops = gOps;
+    (void)KV_Put(1U, a, sizeof(a));
+    if (gOps != ops)
+    {
+        Sim_Fail("identical rewrite cost %lu flash ops", (unsigned long)(gOps - ops));
+    }
+
+    if ((KV_Get(2U, buf, 4U, &len) != HAL_ERROR) || (len != sizeof(b)))
+    {
+        Sim_Fail("short buffer not rejected, len %lu", (unsigned long)len);
+    }
+    if ((KV_Put(KV_KEY_INVALID, a, 1U) != HAL_ERROR) ||
+        (KV_Put(3U, a, KV_MAX_VALUE_LEN + 1U) != HAL_ERROR))
+    {
+        Sim_Fail("invalid key or length accepted");
+    }
+
+    (void)KV_Delete(1U);
+    Sim_Reboot();
+
+    if (KV_Get(1U, buf, sizeof(buf), &len) != HAL_ERROR)
+    {
+        Sim_Fail("deleted key survived a reboot");
+    }
+    if ((KV_Get(2U, buf, sizeof(buf), &len) != HAL_OK) || (len != sizeof(b)) ||
+        (memcmp(buf, b, sizeof(b)) != 0))
+    {
+        Sim_Fail("value lost across a reboot");
+    }
+}
+
+/*
+ * Background compaction from KV_Idle() only, then reboot: the copy must
+ * have become the valid generation with every key in it.
+ */
+static void Case_IdleCompaction(void)
+{
+    KV_StatsTypeDef stats;
+    Sim_ValueTypeDef v;
+    uint32_t gen;
+    uint32_t idle;
+    uint32_t n;
+    uint32_t i;
+
+    gCase = "idle compaction + reboot";
+    Sim_FreshFlash();
+    Sim_Reboot();
+    KV_GetStats(&stats);
+    gen = stats.generation;
+
+    for (n = 0U; (n < 20000U) && (stats.generation == gen); n++)
+    {
+        i = n % SIM_KEYS;
+        Sim_MakeValue(i, n, &v);
+        if (KV_Put(Sim_Key(i), v.value, (uint16_t)v.len) == HAL_OK)
+        {
+            gModel[i].acked = v;
+        }
+
+        /* The idle loop runs far more often than settings change */
+        for (idle = 0U; idle < 8U; idle++)
+        {
+            KV_Idle();
+        }
+        KV_GetStats(&stats);
+    }
+
+    /* Let the idle loop retire the old generation as well */
+    for (n = 0U; n < 16U; n++)
+    {
+        KV_Idle();
+    }
+
+    Sim_Verify("before reboot");
+    Sim_Reboot();
+    Sim_Verify("after reboot");
+
+    KV_GetStats(&stats);
+    if ((stats.generation != (gen + 1U)) || (stats.keys != SIM_KEYS))
+    {
+        Sim_Fail("after reboot: generation %lu, keys %lu",
+                 (unsigned long)stats.generation, (unsigned long)stats.keys);
+    }
+}
+
+/* Full workload without injection; returns the number of flash operations */
+static uint32_t Case_Workload(void)
+{
+    KV_StatsTypeDef stats;
+
+    gCase = "workload";
+    Sim_FreshFlash();
+    Sim_Reboot();
+    Sim_Workload(0U);
+    Sim_Verify("at the end");
+    Sim_Reboot();
+    Sim_Verify("after reboot");
+
+    KV_GetStats(&stats);
+    printf("kvstore: workload %u updates, %lu flash ops, %lu compactions\n",
+           SIM_WORKLOAD_OPS, (unsigned long)gOps, (unsigned long)stats.generation);
+    if (stats.generation < 3U)
+    {
+        Sim_Fail("workload ran only %lu compactions", (unsigned long)stats.generation);
+    }
+
+    return gOps;
+}
+
+/* After an injected failure: writes still work and survive a reboot */
+static void Sim_Recover(void)
+{
+    Sim_ValueTypeDef v;
+    uint32_t i;
+
+    for (i = 0U; i < SIM_KEYS; i += 5U)
+    {
+        Sim_MakeValue(i, 0xABCU, &v);
+        if (KV_Put(Sim_Key(i), v.value, (uint16_t)v.len) != HAL_OK)
+        {
+            Sim_Fail("key 0x%04lX refused after recovery (injected at op %lu)",
+                     (unsigned long)Sim_Key(i), (unsigned long)gInjectedAt);
+            continue;
+        }
+        gModel[i].acked = v;
+    }
+
+    Sim_Reboot();
+    Sim_Verify("after recovery");
+}
+
+static void Case_PowerFail(uint32_t totalOps, uint32_t stride)
+{
+    volatile uint32_t at;
+    volatile unsigned long runs = 0UL;
+
+    gCase = "power fail";
+
+    for (at = 1U; at <= totalOps; at += stride)
+    {
+        Sim_FreshFlash();
+        gRandom      = at;
+        gPowerFailAt = 0U;
+        Sim_Reboot();
+
+        gPowerFailAt = at;
+        gInjectedAt  = at;
+        if (setjmp(gPowerFail) == 0)
+        {
+            Sim_Workload(0U);
+        }
+        gPowerFailAt = 0U;
+
+        Sim_Reboot();
+        Sim_Verify("after power fail");
+        Sim_Settle();
+        Sim_Recover();
+        runs++;
+    }
+
+    printf("kvstore: %lu power-fail points\n", runs);
+}
+
+static void Case_Fault(uint32_t totalOps, uint32_t stride)
+{
+    uint32_t at;
+    unsigned long runs = 0UL;
+
+    gCase = "fault";
+
+    for (at = 1U; at <= totalOps; at += stride)
+    {
+        Sim_FreshFlash();
+        gFaultAt = 0U;
+        Sim_Reboot();
+
+        gFaultAt    = at;
+        gInjectedAt = at;
+        Sim_Workload(0U);
+        gFaultAt = 0U;
+
+        Sim_Verify("after fault");
+        Sim_Reboot();
+        Sim_Verify("after fault and reboot");
+        Sim_Settle();
+        Sim_Recover();
+        runs++;
+    }
+
+    printf("kvstore: %lu fault points\n", runs);
+}
+
+/*
+ * Fill the store with every key once, then churn two of them until the
+ * active sector is past the compaction threshold.  The other keys are never
+ * rewritten, so they are only readable through records the compaction has
+ * to carry over.
+ */
+static void Sim_ColdAndHot(void)
+{
+    KV_StatsTypeDef stats;
+    Sim_ValueTypeDef v;
+    uint32_t n;
+    uint32_t i;
+
+    for (i = 0U; i < SIM_KEYS; i++)
+    {
+        Sim_MakeValue(i, 0U, &v);
+        if (KV_Put(Sim_Key(i), v.value, (uint16_t)v.len) == HAL_OK)
+        {
+            gModel[i].acked = v;
+        }
+    }
+
+    KV_GetStats(&stats);
+    for (n = 1U; (stats.freeBytes * 5U) > (stats.usedBytes + stats.freeBytes); n++)
+    {
+        i = n % 2U;
+        Sim_MakeValue(i, n, &v);
+        if (KV_Put(Sim_Key(i), v.value, (uint16_t)v.len) == HAL_OK)
+        {
+            gModel[i].acked = v;
+        }
+        KV_GetStats(&stats);
+    }
+}
+
+/*
+ * A fault in each flash operation of a compaction run from KV_Idle() alone,
+ * with no write in between to finish it: the idle loop that follows must
+ * not erase records the index still points at.
+ */
+static void Case_IdleStepFault(uint32_t stride)
+{
+    KV_StatsTypeDef stats;
+    uint32_t start;
+    uint32_t total;
+    uint32_t at;
+    uint32_t idle;
+    unsigned long runs = 0UL;
+
+    gCase = "idle step fault";
+
+    /* Dry run: how many operations the idle compaction takes */
+    Sim_FreshFlash();
+    Sim_Reboot();
+    Sim_ColdAndHot();
+    start = gOps;
+    for (idle = 0U; idle < 64U; idle++)
+    {
+        KV_Idle();
+    }
+    total = gOps - start;
+
+    KV_GetStats(&stats);
+    if (stats.generation != 1U)
+    {
+        Sim_Fail("idle loop ran %lu compactions, expected 1", (unsigned long)stats.generation);
+    }
+
+    for (at = 1U; at <= total; at += stride)
+    {
+        Sim_FreshFlash();
+        gFaultAt = 0U;
+        Sim_Reboot();
+        Sim_ColdAndHot();
+
+        gFaultAt    = gOps + at;
+        gInjectedAt = gFaultAt;
+        for (idle = 0U; idle < 64U; idle++)
+        {
+            KV_Idle();
+        }
+        gFaultAt = 0U;
+
+        Sim_Verify("after idle step fault");
+        Sim_Reboot();
+        Sim_Verify("after idle step fault and reboot");
+        runs++;
+    }
+
+    printf("kvstore: %lu idle step fault points\n", runs);
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t stride = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 1U;
+    uint32_t total;
+
+    if (stride == 0U)
+    {
+        stride = 1U;
+    }
+
+    gFlash = mmap((void *)FLASH_IF_BASE, SIM_FLASH_SIZE, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    if (gFlash != (uint8_t *)FLASH_IF_BASE)
+    {
+        perror("mmap flash at 0x08000000");
+        return EXIT_FAILURE;
+    }
+
+    Case_Basic();
+    Case_IdleCompaction();
+    total = Case_Workload();
+    Case_PowerFail(total, stride);
+    Case_Fault(total, stride);
+    Case_IdleStepFault(stride);
+
+    printf("kvstore: %lu failures\n", gFailures);
+
+    return (gFailures == 0UL) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
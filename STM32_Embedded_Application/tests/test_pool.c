@@ -0,0 +1,590 @@
+/*
+ * Host test: pool.c (Common, built into CAN_Normal_Mode, PWM_LED and
+ * RTC_Time_Date) under simulated interrupt preemption.
+ *
+ *   pool.c is built unmodified; host/ldrex_sim.h turns LDREX/STREX/CLREX
+ *   into calls below, and malloc/free/calloc/realloc are renamed Sim_*
+ *   so the host C library keeps its own heap.  At every load-exclusive
+ *   and store-exclusive an "interrupt" may be taken, nested up to
+ *   SIM_IRQ_DEPTH deep, which allocates and frees blocks of its own and
+ *   clears the monitor on return, as the exception return does.
+ *
+ *     exhaustion   fall-through to larger classes; failures counted only
+ *                  for requests that got NULL, against the class sized
+ *                  for them
+ *     hooks        calloc overflow and zeroing, realloc in place / moved
+ *     stress       no block handed out twice or overwritten while held,
+ *                  inUse back to zero, failures equal to the NULLs seen,
+ *                  a STREX only fails after an interrupt
+ *     latency      Pool_Alloc / Pool_Free percentiles without preemption
+ *                  (host nanoseconds: compare runs, not with the target)
+ *
+ *   test_pool            default run
+ *   test_pool <ops>      stress operations in the main context
+ */
+
+#include "pool.h"
+#include <errno.h>
+#include <reent.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define SIM_IRQ_DEPTH       2U          /* nested preemption levels          */
+#define SIM_IRQ_ONE_IN      8U          /* chance at each LDREX/STREX        */
+#define SIM_HELD_MAX        256U
+#define SIM_STRESS_OPS      200000UL
+#define SIM_LATENCY_OPS     1000000UL
+#define SIM_MAX_REQUEST     300U        /* a bit above the largest class     */
+
+/* One block held by the test, in any context */
+typedef struct
+{
+    uint8_t *ptr;
+    uint32_t size;
+    uint8_t  fill;
+    uint8_t  level;
+} Sim_HeldTypeDef;
+
+#define SIM_X_SIZE(size, blocks)    (size),
+#define SIM_X_BLOCKS(size, blocks)  (blocks),
+
+static const uint32_t gClassSize[POOL_CLASS_COUNT]   = { POOL_CLASSES(SIM_X_SIZE) };
+static const uint32_t gClassBlocks[POOL_CLASS_COUNT] = { POOL_CLASSES(SIM_X_BLOCKS) };
+
+/* newlib's per-thread state, see host/reent.h */
+static struct _reent   gReent;
+struct _reent          *_impure_ptr = &gReent;
+
+/* Exclusive monitor */
+static volatile uint32_t *gMonAddr;
+static uint32_t  gMonOpen;
+static uint32_t  gIrqEnabled;
+static uint32_t  gIrqDepth;
+static uint32_t  gIrqsTaken;        /* interrupts taken, any level           */
+static uint32_t  gStrexFails;       /* failed stores in the main context     */
+
+static Sim_HeldTypeDef gHeld[SIM_HELD_MAX];
+static uint32_t        gHeldCount;
+static uint32_t        gExpectFailures[POOL_CLASS_COUNT];
+static uint32_t        gRandom = 1U;
+static unsigned long   gFailures;
+static const char     *gCase = "";
+
+/* Latency samples, ns; malloc() is the pool under test here */
+static uint32_t        gAllocNs[SIM_LATENCY_OPS];
+static uint32_t        gFreeNs[SIM_LATENCY_OPS];
+
+static void Sim_Irq(void);
+
+/* -------------------------------------------------------------------------- */
+/*                          Exclusive monitor emulation                       */
+/* -------------------------------------------------------------------------- */
+
+static uint32_t Sim_Rand(void)
+{
+    /* xorshift32: reproducible across hosts */
+    gRandom ^= gRandom << 13;
+    gRandom ^= gRandom >> 17;
+    gRandom ^= gRandom << 5;
+    return gRandom;
+}
+
+static void Sim_Fail(const char *fmt, ...)
+{
+    va_list args;
+
+    if (gFailures++ < 20U)
+    {
+        printf("FAIL [%s] ", gCase);
+        va_start(args, fmt);
+        vprintf(fmt, args);
+        va_end(args);
+        printf("\n");
+    }
+}
+
+static void Sim_MaybeIrq(void)
+{
+    if ((gIrqEnabled != 0U) && (gIrqDepth < SIM_IRQ_DEPTH) && ((Sim_Rand() % SIM_IRQ_ONE_IN) == 0U))
+    {
+        gIrqDepth++;
+        gIrqsTaken++;
+        Sim_Irq();
+        gMonOpen = 0U;              /* exception return clears the monitor   */
+        gIrqDepth--;
+    }
+}
+
+uint32_t Sim_Ldrex(volatile uint32_t *addr)
+{
+    Sim_MaybeIrq();
+    gMonAddr = addr;
+    gMonOpen = 1U;
+    return *addr;
+}
+
+uint32_t Sim_Strex(uint32_t value, volatile uint32_t *addr)
+{
+    Sim_MaybeIrq();
+    if ((gMonOpen == 0U) || (gMonAddr != addr))
+    {
+        gMonOpen = 0U;
+        if (gIrqDepth == 0U)
+        {
+            gStrexFails++;
+        }
+        return 1U;
+    }
+
+    *addr = value;
+    gMonOpen = 0U;
+    return 0U;
+}
+
+void Sim_Clrex(void)
+{
+    gMonOpen = 0U;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                               Held blocks                                  */
+/* -------------------------------------------------------------------------- */
+
+/* Smallest class that fits, or the largest if none does */
+static uint32_t Sim_ClassFor(uint32_t size)
+{
+    uint32_t cls;
+
+    for (cls = 0U; (cls < (POOL_CLASS_COUNT - 1U)) && (size > gClassSize[cls]); cls++)
+    {
+    }
+    return cls;
+}
+
+static uint32_t Sim_InUse(void)
+{
+    Pool_StatsTypeDef stats;
+    uint32_t total = 0U;
+    uint32_t cls;
+
+    for (cls = 0U; cls < POOL_CLASS_COUNT; cls++)
+    {
+        Pool_GetStats(cls, &stats);
+        total += stats.inUse;
+    }
+    return total;
+}
+
+/* Allocate and record; any overlap with a held block is a double hand-out */
+static uint8_t *Sim_Alloc(uint32_t size, uint8_t level)
+{
+    uint8_t *ptr = Pool_Alloc(size);
+    uint32_t i;
+
+    if (ptr == NULL)
+    {
+        gExpectFailures[Sim_ClassFor(size)]++;
+        return NULL;
+    }
+    if (size > gClassSize[POOL_CLASS_COUNT - 1U])
+    {
+        Sim_Fail("%lu bytes served, larger than any class", (unsigned long)size);
+    }
+    if (((uintptr_t)ptr % 8U) != 0U)
+    {
+        Sim_Fail("block %p not 8-byte aligned", (void *)ptr);
+    }
+
+    for (i = 0U; i < gHeldCount; i++)
+    {
+        if ((ptr < (gHeld[i].ptr + gHeld[i].size)) && (gHeld[i].ptr < (ptr + size)))
+        {
+            Sim_Fail("block %p (%lu bytes) overlaps %p (%lu bytes) held at level %u",
+                     (void *)ptr, (unsigned long)size, (void *)gHeld[i].ptr,
+                     (unsigned long)gHeld[i].size, gHeld[i].level);
+        }
+    }
+
+    if (gHeldCount >= SIM_HELD_MAX)
+    {
+        Sim_Fail("more blocks held than the pool has");
+        return ptr;
+    }
+    gHeld[gHeldCount].ptr   = ptr;
+    gHeld[gHeldCount].size  = size;
+    gHeld[gHeldCount].fill  = (uint8_t)Sim_Rand();
+    gHeld[gHeldCount].level = level;
+    memset(ptr, gHeld[gHeldCount].fill, size);
+    gHeldCount++;
+
+    return ptr;
+}
+
+/* Free the i-th held block after checking nobody wrote into it */
+static void Sim_Release(uint32_t i)
+{
+    Sim_HeldTypeDef held = gHeld[i];
+    uint32_t n;
+
+    /* Unlink first: the free may be preempted by an interrupt that walks gHeld */
+    gHeld[i] = gHeld[--gHeldCount];
+
+    for (n = 0U; n < held.size; n++)
+    {
+        if (held.ptr[n] != held.fill)
+        {
+            Sim_Fail("block %p byte %lu changed while held", (void *)held.ptr, (unsigned long)n);
+            break;
+        }
+    }
+    Pool_Free(held.ptr);
+}
+
+/* Index of a random block held at @p level, or -1 */
+static int32_t Sim_PickHeld(uint8_t level)
+{
+    uint32_t start;
+    uint32_t n;
+    uint32_t i;
+
+    if (gHeldCount == 0U)
+    {
+        return -1;
+    }
+
+    start = Sim_Rand() % gHeldCount;
+    for (n = 0U; n < gHeldCount; n++)
+    {
+        i = (start + n) % gHeldCount;
+        if (gHeld[i].level == level)
+        {
+            return (int32_t)i;
+        }
+    }
+    return -1;
+}
+
+static void Sim_ReleaseAll(void)
+{
+    while (gHeldCount != 0U)
+    {
+        Sim_Release(gHeldCount - 1U);
+    }
+}
+
+/* Interrupt body: a few allocations and frees of its own */
+static void Sim_Irq(void)
+{
+    uint8_t level = (uint8_t)gIrqDepth;
+    uint32_t ops = 1U + (Sim_Rand() % 3U);
+    int32_t i;
+
+    while (ops-- != 0U)
+    {
+        i = Sim_PickHeld(level);
+        if ((i >= 0) && ((Sim_Rand() & 1U) != 0U))
+        {
+            Sim_Release((uint32_t)i);
+        }
+        else
+        {
+            (void)Sim_Alloc(1U + (Sim_Rand() % SIM_MAX_REQUEST), level);
+        }
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                  Cases                                     */
+/* -------------------------------------------------------------------------- */
+
+static void Sim_CheckFailures(void)
+{
+    Pool_StatsTypeDef stats;
+    uint32_t cls;
+
+    for (cls = 0U; cls < POOL_CLASS_COUNT; cls++)
+    {
+        Pool_GetStats(cls, &stats);
+        if (stats.failures != gExpectFailures[cls])
+        {
+            Sim_Fail("class %lu: %lu failures counted, %lu NULLs returned",
+                     (unsigned long)cls, (unsigned long)stats.failures,
+                     (unsigned long)gExpectFailures[cls]);
+        }
+        if ((stats.inUse > stats.blockCount) || (stats.highWater > stats.blockCount))
+        {
+            Sim_Fail("class %lu: inUse %lu highWater %lu of %lu blocks", (unsigned long)cls,
+                     (unsigned long)stats.inUse, (unsigned long)stats.highWater,
+                     (unsigned long)stats.blockCount);
+        }
+    }
+}
+
+static void Case_Exhaustion(void)
+{
+    Pool_StatsTypeDef stats;
+    uint32_t blocks = 0U;
+    uint32_t cls;
+    uint32_t i;
+
+    gCase = "exhaustion";
+
+    /* Every block in the pool fits 16 bytes: all of them, no failure yet */
+    for (cls = 0U; cls < POOL_CLASS_COUNT; cls++)
+    {
+        for (i = 0U; i < gClassBlocks[cls]; i++)
+        {
+            if (Sim_Alloc(16U, 0U) == NULL)
+            {
+                Sim_Fail("16 bytes refused with %lu blocks out", (unsigned long)blocks);
+            }
+            blocks++;
+        }
+        Pool_GetStats(cls, &stats);
+        if ((stats.inUse != gClassBlocks[cls]) || (stats.highWater != gClassBlocks[cls]))
+        {
+            Sim_Fail("class %lu not drained in order: inUse %lu", (unsigned long)cls,
+                     (unsigned long)stats.inUse);
+        }
+    }
+    Sim_CheckFailures();
+
+    /* Now a real failure, charged once, to class 0 only */
+    if (Sim_Alloc(16U, 0U) != NULL)
+    {
+        Sim_Fail("allocation from an empty pool");
+    }
+    if (Sim_Alloc(SIM_MAX_REQUEST, 0U) != NULL)
+    {
+        Sim_Fail("oversized request served");
+    }
+    Sim_CheckFailures();
+
+    Sim_ReleaseAll();
+    if (Sim_InUse() != 0U)
+    {
+        Sim_Fail("%lu blocks in use after freeing all", (unsigned long)Sim_InUse());
+    }
+
+    /* Free lists intact: the whole pool can be handed out again */
+    for (i = 0U; i < blocks; i++)
+    {
+        (void)Sim_Alloc(8U, 0U);
+    }
+    if (gHeldCount != blocks)
+    {
+        Sim_Fail("%lu of %lu blocks after refill", (unsigned long)gHeldCount, (unsigned long)blocks);
+    }
+    Sim_ReleaseAll();
+    Sim_CheckFailures();
+}
+
+static void Case_Hooks(void)
+{
+    uint8_t *p;
+    uint8_t *q;
+    uint32_t i;
+
+    gCase = "newlib hooks";
+
+    gReent._errno = 0;
+    if ((calloc(0x10000U, 0x10001U) != NULL) || (gReent._errno != ENOMEM))
+    {
+        Sim_Fail("calloc overflow not refused with ENOMEM");
+    }
+
+    p = malloc(40U);
+    memset(p, 0xA5, 40U);
+    free(p);
+    p = calloc(5U, 8U);
+    for (i = 0U; i < 40U; i++)
+    {
+        if (p[i] != 0U)
+        {
+            Sim_Fail("calloc byte %lu not zero", (unsigned long)i);
+            break;
+        }
+    }
+
+    /* Within the block: in place; beyond it: moved, content kept */
+    q = realloc(p, 64U);
+    if (q != p)
+    {
+        Sim_Fail("realloc within the block moved it");
+    }
+    memset(q, 0x5A, 64U);
+    q = realloc(p, 100U);
+    if ((q == NULL) || (q == p))
+    {
+        Sim_Fail("realloc beyond the block did not move it");
+    }
+    for (i = 0U; (q != NULL) && (i < 64U); i++)
+    {
+        if (q[i] != 0x5AU)
+        {
+            Sim_Fail("realloc lost byte %lu", (unsigned long)i);
+            break;
+        }
+    }
+    free(q);
+    free(NULL);
+
+    q = realloc(NULL, 20U);
+    free(q);
+
+    gReent._errno = 0;
+    if ((malloc(SIM_MAX_REQUEST) != NULL) || (gReent._errno != ENOMEM))
+    {
+        Sim_Fail("oversized malloc not refused with ENOMEM");
+    }
+    gExpectFailures[Sim_ClassFor(SIM_MAX_REQUEST)]++;
+
+    if (Sim_InUse() != 0U)
+    {
+        Sim_Fail("%lu blocks leaked", (unsigned long)Sim_InUse());
+    }
+    Sim_CheckFailures();
+}
+
+static void Case_Stress(unsigned long ops)
+{
+    unsigned long op;
+    unsigned long nulls = 0UL;
+    uint32_t irqs;
+    uint32_t maxRetries = 0U;
+    int32_t i;
+
+    gCase = "stress";
+    gIrqEnabled = 1U;
+    gIrqsTaken  = 0U;
+
+    for (op = 0UL; op < ops; op++)
+    {
+        irqs        = gIrqsTaken;
+        gStrexFails = 0U;
+
+        i = Sim_PickHeld(0U);
+        if ((i >= 0) && ((Sim_Rand() % 100U) < 45U))
+        {
+            Sim_Release((uint32_t)i);
+        }
+        else if (Sim_Alloc(1U + (Sim_Rand() % SIM_MAX_REQUEST), 0U) == NULL)
+        {
+            nulls++;
+        }
+
+        /* Without an interrupt in between, no store-exclusive can fail */
+        if (gStrexFails > (gIrqsTaken - irqs))
+        {
+            Sim_Fail("op %lu: %lu STREX retries with %lu interrupts", op,
+                     (unsigned long)gStrexFails, (unsigned long)(gIrqsTaken - irqs));
+        }
+        if (gStrexFails > maxRetries)
+        {
+            maxRetries = gStrexFails;
+        }
+    }
+
+    gIrqEnabled = 0U;
+    Sim_ReleaseAll();
+    if (Sim_InUse() != 0U)
+    {
+        Sim_Fail("%lu blocks in use after freeing all", (unsigned long)Sim_InUse());
+    }
+    Sim_CheckFailures();
+
+    printf("pool: stress %lu ops, %lu interrupts, %lu NULLs in main, max %lu retries per op\n",
+           ops, (unsigned long)gIrqsTaken, nulls, (unsigned long)maxRetries);
+}
+
+static int Sim_CompareU32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+static uint32_t Sim_Nanos(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((ts.tv_sec * 1000000000LL) + ts.tv_nsec);
+}
+
+static void Sim_Report(const char *what, uint32_t *ns, unsigned long n)
+{
+    qsort(ns, n, sizeof(ns[0]), Sim_CompareU32);
+    printf("pool: %-10s p50 %4lu ns  p99 %4lu ns  p99.9 %5lu ns  max %6lu ns\n", what,
+           (unsigned long)ns[n / 2UL], (unsigned long)ns[(n * 99UL) / 100UL],
+           (unsigned long)ns[(n * 999UL) / 1000UL], (unsigned long)ns[n - 1UL]);
+}
+
+static void Case_Latency(void)
+{
+    unsigned long nAlloc = 0UL;
+    unsigned long nFree = 0UL;
+    unsigned long op;
+    uint32_t size;
+    uint32_t t0;
+    uint8_t *ptr;
+    int32_t i;
+
+    gCase = "latency";
+
+    for (op = 0UL; op < SIM_LATENCY_OPS; op++)
+    {
+        i = Sim_PickHeld(0U);
+        if ((i >= 0) && ((Sim_Rand() & 1U) != 0U))
+        {
+            ptr = gHeld[i].ptr;
+            gHeld[i] = gHeld[--gHeldCount];
+            t0 = Sim_Nanos();
+            Pool_Free(ptr);
+            gFreeNs[nFree++] = Sim_Nanos() - t0;
+        }
+        else
+        {
+            size = 1U + (Sim_Rand() % gClassSize[POOL_CLASS_COUNT - 1U]);
+            t0   = Sim_Nanos();
+            ptr  = Pool_Alloc(size);
+            gAllocNs[nAlloc++] = Sim_Nanos() - t0;
+            if ((ptr != NULL) && (gHeldCount < SIM_HELD_MAX))
+            {
+                gHeld[gHeldCount].ptr   = ptr;
+                gHeld[gHeldCount].size  = 0U;
+                gHeld[gHeldCount].level = 0U;
+                gHeldCount++;
+            }
+            else if (ptr == NULL)
+            {
+                gExpectFailures[Sim_ClassFor(size)]++;
+            }
+        }
+    }
+
+    Sim_ReleaseAll();
+    Sim_CheckFailures();
+    Sim_Report("Pool_Alloc", gAllocNs, nAlloc);
+    Sim_Report("Pool_Free", gFreeNs, nFree);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long ops = (argc > 1) ? strtoul(argv[1], NULL, 0) : SIM_STRESS_OPS;
+
+    Pool_Init();
+
+    Case_Exhaustion();
+    Case_Hooks();
+    Case_Stress(ops);
+    Case_Latency();
+
+    printf("pool: %lu failures\n", gFailures);
+
+    return (gFailures == 0UL) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,150 @@
+/*
+ * Host test: RTC_Epoch_ToRegs / RTC_Epoch_FromRegs (RTC_Time_Date) against
+ * the C library over every second of 2000-01-01 .. 2099-12-31, in both
+ * the 24 h and the AM/PM register formats.
+ *
+ *   The calendar part of each day is checked against gmtime_r(); the time
+ *   of day is derived independently from the second count.  Both
+ *   directions must agree exactly, weekday included, and FromRegs must
+ *   ignore the reserved TR/DR bits.
+ *
+ *   test_rtc_epoch          every second (about 6.3e9 conversions)
+ *   test_rtc_epoch <step>   every <step>-th second of each day
+ */
+
+#include "rtc_epoch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define DAY_SECONDS         86400UL
+#define DAYS_2000_2099      36525UL
+
+#define TR_RESERVED         0xFF808080UL
+#define DR_RESERVED         0xFF0000C0UL
+
+#define BIN2BCD(v)          ((((uint32_t)(v) / 10U) << 4) | ((uint32_t)(v) % 10U))
+
+static unsigned long gFailures;
+
+/* Linked in with rtc_epoch.c; only RTC_Epoch_Set() would call them */
+uint32_t HAL_GetTick(void)
+{
+    return 0U;
+}
+
+HAL_StatusTypeDef HAL_RTC_WaitForSynchro(RTC_HandleTypeDef *hrtc)
+{
+    (void)hrtc;
+    return HAL_OK;
+}
+
+static void Fail(const char *what, uint32_t epoch, uint32_t hour12,
+                 uint32_t got, uint32_t want)
+{
+    if (gFailures++ < 20U)
+    {
+        printf("FAIL %s epoch %lu %s: got 0x%08lX want 0x%08lX\n", what,
+               (unsigned long)epoch, hour12 ? "12h" : "24h",
+               (unsigned long)got, (unsigned long)want);
+    }
+}
+
+/* Expected DR for the day starting at @p epoch, from the C library */
+static uint32_t ExpectedDr(uint32_t epoch)
+{
+    time_t t = (time_t)epoch;
+    struct tm tm;
+    uint32_t wdu;
+
+    gmtime_r(&t, &tm);
+    wdu = (tm.tm_wday == 0) ? 7U : (uint32_t)tm.tm_wday;   /* Monday = 1 */
+
+    return (BIN2BCD(tm.tm_year - 100) << 16) | (wdu << RTC_DR_WDU_Pos) |
+           (BIN2BCD(tm.tm_mon + 1) << 8) | BIN2BCD(tm.tm_mday);
+}
+
+static uint32_t ExpectedTr(uint32_t sod, uint32_t hour12)
+{
+    uint32_t hours = sod / 3600U;
+    uint32_t pm    = 0U;
+
+    if (hour12 != 0U)
+    {
+        pm    = (hours >= 12U) ? RTC_TR_PM : 0U;
+        hours = ((hours % 12U) == 0U) ? 12U : (hours % 12U);
+    }
+
+    return pm | (BIN2BCD(hours) << 16) | (BIN2BCD((sod / 60U) % 60U) << 8) |
+           BIN2BCD(sod % 60U);
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t step = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 1U;
+    unsigned long checked = 0UL;
+    uint32_t day;
+    uint32_t sod;
+    uint32_t hour12;
+    uint32_t epoch;
+    uint32_t wantDr;
+    uint32_t wantTr;
+    uint32_t tr;
+    uint32_t dr;
+
+    if (step == 0U)
+    {
+        step = 1U;
+    }
+
+    for (day = 0U; day < DAYS_2000_2099; day++)
+    {
+        wantDr = ExpectedDr(RTC_EPOCH_MIN + (day * DAY_SECONDS));
+
+        for (sod = 0U; sod < DAY_SECONDS; sod += step)
+        {
+            epoch = RTC_EPOCH_MIN + (day * DAY_SECONDS) + sod;
+
+            for (hour12 = 0U; hour12 < 2U; hour12++)
+            {
+                wantTr = ExpectedTr(sod, hour12);
+
+                RTC_Epoch_ToRegs(epoch, hour12, &tr, &dr);
+                if (tr != wantTr)
+                {
+                    Fail("ToRegs TR", epoch, hour12, tr, wantTr);
+                }
+                if (dr != wantDr)
+                {
+                    Fail("ToRegs DR", epoch, hour12, dr, wantDr);
+                }
+
+                if (RTC_Epoch_FromRegs(wantTr, wantDr, hour12) != epoch)
+                {
+                    Fail("FromRegs", epoch, hour12,
+                         RTC_Epoch_FromRegs(wantTr, wantDr, hour12), epoch);
+                }
+                checked++;
+            }
+        }
+
+        /* Reserved bits read back as anything: once per day is enough */
+        wantTr = ExpectedTr(DAY_SECONDS - 1U, 0U) | TR_RESERVED;
+        if (RTC_Epoch_FromRegs(wantTr, wantDr | DR_RESERVED, 0U) !=
+            (RTC_EPOCH_MIN + (day * DAY_SECONDS) + DAY_SECONDS - 1U))
+        {
+            Fail("FromRegs reserved bits", RTC_EPOCH_MIN + (day * DAY_SECONDS),
+                 0U, wantTr, wantDr);
+        }
+    }
+
+    if (day * DAY_SECONDS + RTC_EPOCH_MIN - 1U != RTC_EPOCH_MAX)
+    {
+        Fail("range", RTC_EPOCH_MAX, 0U, day, DAYS_2000_2099);
+    }
+
+    printf("rtc_epoch: %lu conversions checked (step %lu s), %lu failures\n",
+           checked * 2UL, (unsigned long)step, gFailures);
+
+    return (gFailures == 0UL) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
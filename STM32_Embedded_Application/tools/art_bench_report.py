@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+"""Energy per operation for every ART / prefetch / flash latency setting.
+
+Input 1 is the CSV that Current_Meg_Stop_Mode prints on USART2 when built
+with ART_BENCHMARK (extra lines such as the start prompt are ignored):
+
+    idx,mhz,ws,prften,icen,dcen,cycles_per_iter
+
+Input 2 holds the mean supply current in mA of each dwell, one value per
+line (or the last column of a CSV line), in marker order: the marker pin
+(PA8) is high for exactly one dwell per result line, so an ammeter on the
+IDD jumper triggered on it yields the values in the same order.
+
+    python3 tools/art_bench_report.py uart.log idd_ma.csv --vdd 3.3
+
+Reports uA/MHz (current normalised to clock) and nJ per iteration
+(VDD * I * cycles / f), best configuration first.
+"""
+
+import argparse
+import sys
+
+
+def read_results(path):
+    rows = []
+    for line in open(path):
+        fields = line.strip().split(",")
+        if len(fields) != 7 or not fields[0].isdigit():
+            continue
+        idx, mhz, ws, pf, ic, dc = (int(f) for f in fields[:6])
+        rows.append({"idx": idx, "mhz": mhz, "ws": ws, "prften": pf, "icen": ic,
+                     "dcen": dc, "cycles": float(fields[6])})
+    return rows
+
+
+def read_currents(path):
+    values = []
+    for line in open(path):
+        line = line.strip()
+        if not line or line.startswith("#"):
+            continue
+        try:
+            values.append(float(line.split(",")[-1]))
+        except ValueError:
+            continue                        # header line
+    return values
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("uart_log")
+    ap.add_argument("currents", help="mean mA per dwell, in marker order")
+    ap.add_argument("--vdd", type=float, default=3.3)
+    ap.add_argument("--mhz", type=int, help="only this clock frequency")
+    args = ap.parse_args()
+
+    rows = read_results(args.uart_log)
+    currents = read_currents(args.currents)
+    if not rows:
+        sys.exit("no result lines in %s" % args.uart_log)
+    if len(currents) != len(rows):
+        sys.exit("%d results but %d current readings" % (len(rows), len(currents)))
+
+    for row, ma in zip(rows, currents):
+        row["ma"] = ma
+        row["ua_mhz"] = ma * 1000.0 / row["mhz"]
+        # V * A * s = J; cycles / (MHz * 1e6) s per iteration
+        row["nj"] = args.vdd * ma * 1e-3 * row["cycles"] / (row["mhz"] * 1e6) * 1e9
+
+    if args.mhz:
+        rows = [r for r in rows if r["mhz"] == args.mhz]
+
+    print("%4s %4s %3s %3s %3s %3s %10s %8s %8s %9s" %
+          ("idx", "MHz", "WS", "PF", "IC", "DC", "cyc/iter", "mA", "uA/MHz", "nJ/iter"))
+    for r in sorted(rows, key=lambda r: r["nj"]):
+        print("%4d %4d %3d %3d %3d %3d %10.2f %8.3f %8.1f %9.2f" %
+              (r["idx"], r["mhz"], r["ws"], r["prften"], r["icen"], r["dcen"],
+               r["cycles"], r["ma"], r["ua_mhz"], r["nj"]))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+"""Send a firmware image to CAN_Normal_Mode's update agent (can_update.h).
+
+Usage:
+    can_update.py IMAGE_A.bin IMAGE_B.bin [--channel can0] [--interface socketcan]
+
+Both images are needed because each slot is linked for its own address
+(STM32F446RETX_SLOT_A.ld / _SLOT_B.ld); the node reports which slot it will
+write and the matching one is sent.  Data frames are pipelined go-back-N:
+up to `window` frames beyond the last acknowledged one stay in flight.
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+import can
+
+CMD_ID = 0x7E0
+RSP_ID = 0x7E8
+DATA_ID_BASE = 0x600
+
+CMD_START, CMD_ABORT, CMD_REBOOT, CMD_STATUS = 0x01, 0x03, 0x04, 0x05
+RSP_START, RSP_ACK, RSP_NACK, RSP_DONE, RSP_STATUS = 0x81, 0x82, 0x83, 0x84, 0x85
+
+ERRORS = {1: "bad state", 2: "bad size", 3: "flash error", 4: "CRC mismatch",
+          5: "standalone build, no inactive slot"}
+
+
+def stm32_crc(data):
+    """CRC unit: poly 0x04C11DB7, init 0xFFFFFFFF, LE words padded with 0xFF."""
+    data = data + b"\xff" * (-len(data) % 4)
+    crc = 0xFFFFFFFF
+    for (word,) in struct.iter_unpack("<I", data):
+        crc ^= word
+        for _ in range(32):
+            crc = ((crc << 1) ^ 0x04C11DB7) if crc & 0x80000000 else (crc << 1)
+            crc &= 0xFFFFFFFF
+    return crc
+
+
+def recv_rsp(bus, timeout):
+    deadline = time.monotonic() + timeout
+    while True:
+        left = deadline - time.monotonic()
+        if left <= 0:
+            return None
+        msg = bus.recv(left)
+        if msg is not None and msg.arbitration_id == RSP_ID and len(msg.data) == 8:
+            rsp, status = msg.data[0], msg.data[1]
+            value = struct.unpack_from("<I", msg.data, 2)[0]
+            return rsp, status, value, msg.data[6], msg.data[7]
+
+
+def send(bus, arb_id, data):
+    while True:
+        try:
+            bus.send(can.Message(arbitration_id=arb_id, data=data, is_extended_id=False))
+            return
+        except can.CanError:
+            time.sleep(0.0005)      # TX queue full: the bus is saturated
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("image_a")
+    ap.add_argument("image_b")
+    ap.add_argument("--interface", default="socketcan")
+    ap.add_argument("--channel", default="can0")
+    ap.add_argument("--no-reboot", action="store_true")
+    args = ap.parse_args()
+
+    images = [open(args.image_a, "rb").read(), open(args.image_b, "rb").read()]
+    bus = can.Bus(interface=args.interface, channel=args.channel)
+
+    # The node picks the slot; ask for it with a START for image A and
+    # restart with image B if needed (same size limit for both slots).
+    slot = None
+    for attempt in (0, 1):
+        image = images[slot if slot is not None else 0]
+        crc = stm32_crc(image)
+        send(bus, CMD_ID, bytes([CMD_START]) + struct.pack("<I", len(image))[:3] +
+             struct.pack("<I", crc))
+        rsp = recv_rsp(bus, 10.0)           # covers the slot erase
+        if rsp is None or rsp[0] != RSP_START:
+            sys.exit("no START response")
+        if rsp[1] != 0:
+            sys.exit("START refused: " + ERRORS.get(rsp[1], str(rsp[1])))
+        if slot is None and rsp[2] != 0:
+            slot = rsp[2]
+            send(bus, CMD_ID, bytes([CMD_ABORT]))
+            recv_rsp(bus, 1.0)
+            continue
+        slot = rsp[2]
+        window, ack_every = rsp[3], rsp[4]
+        break
+
+    frames = (len(image) + 7) // 8
+    print("slot %s, %d bytes, crc 0x%08X, window %d" % ("AB"[slot], len(image), crc, window))
+
+    acked = 0
+    nxt = 0
+    t0 = time.monotonic()
+    while True:
+        while nxt < frames and nxt < acked + window:
+            send(bus, DATA_ID_BASE + (nxt & 0xFF), image[nxt * 8:nxt * 8 + 8])
+            nxt += 1
+
+        rsp = recv_rsp(bus, 0.5)
+        if rsp is None:
+            # Lost progress (e.g. a NACK'd frame dropped again): resync
+            send(bus, CMD_ID, bytes([CMD_STATUS]))
+            rsp = recv_rsp(bus, 0.5)
+            if rsp is None:
+                sys.exit("node not responding")
+            acked = nxt = rsp[2]
+            continue
+
+        kind, status, value = rsp[0], rsp[1], rsp[2]
+        if kind == RSP_ACK:
+            acked = max(acked, value)
+        elif kind == RSP_NACK:
+            acked = nxt = value             # go back N
+        elif kind == RSP_DONE:
+            if status != 0:
+                sys.exit("update failed: %s (crc 0x%08X)" % (ERRORS.get(status, status), value))
+            break
+
+    dt = time.monotonic() - t0
+    print("done in %.2f s, %.1f KiB/s" % (dt, len(image) / 1024.0 / dt))
+
+    if not args.no_reboot:
+        send(bus, CMD_ID, bytes([CMD_REBOOT]))
+    bus.shutdown()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+"""Leading frames lost and average current of a CAN node that sleeps in STOP.
+
+CAN_Normal_Mode built with CAN_LOW_POWER (can_lp.h) sleeps once the bus has
+been quiet for CAN_LP_IDLE_MS.  The benchmark sends bursts of --burst frames
+on 0x7F0, back to back, carrying the frame index in data[0..1].  The first
+frame the node receives after each wake-up is answered on 0x7F8 with
+
+    [lost (LE16), wakeups (LE16), awake ms (LE32)]
+
+Usage:
+    can_wake_bench.py --rates 1,5,20,50 --seconds 20 --i-run 28 --i-stop 0.3
+
+For each burst rate this reports the mean and worst number of lost leading
+frames, and the fraction of time awake (from the node's awake counter,
+which stops while asleep).  With the run and STOP currents measured once on
+the IDD jumper, that gives the average current at that bus load.
+"""
+
+import argparse
+import struct
+import time
+
+import can
+
+BENCH_ID = 0x7F0
+REPORT_ID = 0x7F8
+
+
+def wait_report(bus, timeout):
+    end = time.monotonic() + timeout
+    while True:
+        left = end - time.monotonic()
+        if left <= 0:
+            return None
+        msg = bus.recv(left)
+        if msg is not None and msg.arbitration_id == REPORT_ID and len(msg.data) == 8:
+            return struct.unpack("<HHI", bytes(msg.data))
+
+
+def run(bus, rate, seconds, burst):
+    period = 1.0 / rate
+    lost = []
+    first = last = None
+    missing = 0
+    start = time.monotonic()
+
+    while time.monotonic() - start < seconds:
+        t0 = time.monotonic()
+        for index in range(burst):
+            bus.send(can.Message(arbitration_id=BENCH_ID, is_extended_id=False,
+                                 data=struct.pack("<H", index) + b"\x00" * 6))
+        rsp = wait_report(bus, min(period, 0.2))
+        if rsp is None:
+            missing += 1                # node was awake already, or lost them all
+        else:
+            lost.append(rsp[0])
+            first = first or rsp
+            last = rsp
+        time.sleep(max(0.0, period - (time.monotonic() - t0)))
+
+    wall = time.monotonic() - start
+    awake = (last[2] - first[2]) / 1000.0 if first and last else None
+    return lost, missing, wall, awake
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("--interface", default="socketcan")
+    ap.add_argument("--channel", default="can0")
+    ap.add_argument("--rates", type=lambda s: [float(r) for r in s.split(",")],
+                    default=[1.0, 5.0, 20.0], help="bursts per second")
+    ap.add_argument("--burst", type=int, default=8)
+    ap.add_argument("--seconds", type=float, default=10.0)
+    ap.add_argument("--i-run", type=float, help="run current, mA")
+    ap.add_argument("--i-stop", type=float, help="STOP current, mA")
+    args = ap.parse_args()
+
+    bus = can.Bus(interface=args.interface, channel=args.channel)
+
+    print("%8s %7s %9s %9s %8s %9s" % ("burst/s", "wakes", "lost avg", "lost max",
+                                       "awake %", "I avg mA"))
+    for rate in args.rates:
+        lost, missing, wall, awake = run(bus, rate, args.seconds, args.burst)
+        duty = awake / wall if awake is not None else None
+        avg = "-"
+        if duty is not None and args.i_run is not None and args.i_stop is not None:
+            avg = "%.3f" % (duty * args.i_run + (1.0 - duty) * args.i_stop)
+        print("%8.1f %7d %9s %9s %8s %9s" % (
+            rate, len(lost),
+            "%.2f" % (sum(lost) / len(lost)) if lost else "-",
+            max(lost) if lost else "-",
+            "%.1f" % (100.0 * duty) if duty is not None else "-",
+            avg))
+        if missing:
+            print("         %d bursts without a report" % missing)
+
+    bus.shutdown()
+
+
+if __name__ == "__main__":
+    main()
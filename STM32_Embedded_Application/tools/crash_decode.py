@@ -0,0 +1,212 @@
+#!/usr/bin/env python3
+"""Decode a crash record printed at boot by crash_dump.c against the ELF.
+
+After a HardFault, MemManage, BusFault or UsageFault the firmware resets and
+prints the saved record on its console as "CRASH ..." lines:
+
+    CRASH exc=3 (HardFault) flags=00 tick=48211
+    CRASH pc=0801a3c4 lr=0801a2f1 xpsr=21000000 sp=2001bf60 exc_return=fffffff9
+    CRASH r0=00000000 r1=... r2=... r3=... r12=...
+    CRASH cfsr=00008200 hfsr=40000000 mmfar=... bfar=00000000
+    CRASH mem 2001bf60: 00000001 0801a2f1 ...
+    CRASH end
+
+Usage:
+    crash_decode.py Debug/CAN_Normal_Mode.elf console.log
+    picocom -b 115200 /dev/ttyACM0 | tee console.log      # capture
+
+The log may hold any other output; the last complete record is decoded
+(--all for every record).  The ELF must be the image that crashed.
+
+Output: the fault cause from CFSR/HFSR, the faulting PC and the caller in
+LR with function and file:line, and every stack word that points into code.
+Those stack words are candidate return addresses: walking them from the top
+gives the call chain, with the odd stale entry left over from older frames.
+"""
+
+import argparse
+import bisect
+import re
+import subprocess
+import sys
+
+LINE_RE = re.compile(r"CRASH (.*)$")
+PAIR_RE = re.compile(r"(\w+)=([0-9a-fA-F]+)")
+MEM_RE = re.compile(r"mem ([0-9a-fA-F]{8}):((?: [0-9a-fA-F]{8})*)")
+
+EXCEPTIONS = {3: "HardFault", 4: "MemManage", 5: "BusFault", 6: "UsageFault"}
+
+CFSR_BITS = [
+    # MMFSR
+    (0, "IACCVIOL", "MPU or XN: instruction fetch from a no-execute region"),
+    (1, "DACCVIOL", "MPU: data access violation"),
+    (3, "MUNSTKERR", "MemManage fault on unstacking (exception return)"),
+    (4, "MSTKERR", "MemManage fault on stacking (exception entry)"),
+    (5, "MLSPERR", "MemManage fault during lazy FP state preservation"),
+    (7, "MMARVALID", "MMFAR holds the faulting address"),
+    # BFSR
+    (8, "IBUSERR", "bus error on instruction fetch"),
+    (9, "PRECISERR", "precise data bus error, PC is the faulting instruction"),
+    (10, "IMPRECISERR", "imprecise data bus error, PC is after the write"),
+    (11, "UNSTKERR", "bus fault on unstacking (exception return)"),
+    (12, "STKERR", "bus fault on stacking: stack overflow or bad SP"),
+    (13, "LSPERR", "bus fault during lazy FP state preservation"),
+    (15, "BFARVALID", "BFAR holds the faulting address"),
+    # UFSR
+    (16, "UNDEFINSTR", "undefined instruction"),
+    (17, "INVSTATE", "invalid EPSR state: branch to an even address (no Thumb bit)"),
+    (18, "INVPC", "invalid EXC_RETURN on exception return"),
+    (19, "NOCP", "coprocessor access: FPU used while disabled"),
+    (24, "UNALIGNED", "unaligned access with UNALIGN_TRP set"),
+    (25, "DIVBYZERO", "division by zero with DIV_0_TRP set"),
+]
+
+HFSR_BITS = [
+    (1, "VECTTBL", "bus fault on vector table read"),
+    (30, "FORCED", "escalated from a configurable fault (see CFSR)"),
+    (31, "DEBUGEVT", "debug event"),
+]
+
+FLAGS = [(0x01, "FP context stacked"), (0x02, "SP outside the stack, frame not read"),
+         (0x04, "thread mode on PSP")]
+
+
+def parse(lines):
+    """Records in order, each a dict of register values plus "mem" words."""
+    records = []
+    cur = None
+    for line in lines:
+        m = LINE_RE.search(line.rstrip("\r\n"))
+        if not m:
+            continue
+        body = m.group(1)
+        if body.startswith("exc="):
+            cur = {"mem": []}
+            records.append(cur)
+        if cur is None:
+            continue
+        if body == "end":
+            cur["complete"] = True
+            cur = None
+            continue
+        mm = MEM_RE.match(body)
+        if mm:
+            base = int(mm.group(1), 16)
+            for i, word in enumerate(mm.group(2).split()):
+                cur["mem"].append((base + 4 * i, int(word, 16)))
+            continue
+        for key, value in PAIR_RE.findall(body):
+            cur[key] = int(value, 10 if key in ("exc", "tick") else 16)
+    return [r for r in records if r.get("complete")]
+
+
+class Symbols:
+    """Function ranges from nm, file:line from addr2line."""
+
+    def __init__(self, elf, nm, addr2line):
+        self.elf = elf
+        self.addr2line = addr2line
+        out = subprocess.run([nm, "-S", "-n", "-C", elf], check=True,
+                             capture_output=True, text=True).stdout
+        self.funcs = []
+        for line in out.splitlines():
+            parts = line.split(None, 3)
+            if len(parts) == 4 and parts[2] in ("T", "t", "W", "w"):
+                start, size = int(parts[0], 16), int(parts[1], 16)
+                if size:
+                    self.funcs.append((start & ~1, size, parts[3]))
+        self.starts = [f[0] for f in self.funcs]
+
+    def function(self, addr):
+        addr &= ~1
+        i = bisect.bisect_right(self.starts, addr) - 1
+        if i >= 0:
+            start, size, name = self.funcs[i]
+            if addr < start + size:
+                return "%s+0x%x" % (name, addr - start)
+        return None
+
+    def lines(self, addrs):
+        if not addrs:
+            return {}
+        out = subprocess.run([self.addr2line, "-e", self.elf, "-f", "-C", "-i", "-p"]
+                             + ["0x%08x" % a for a in addrs],
+                             check=True, capture_output=True, text=True).stdout
+        # -i adds " (inlined by) ..." lines after the one for each address
+        result, idx = {}, -1
+        for line in out.splitlines():
+            if line.lstrip().startswith("(inlined by)"):
+                result[addrs[idx]] += "\n" + " " * 24 + line.strip()
+            else:
+                idx += 1
+                result[addrs[idx]] = line.strip()
+        return result
+
+
+def decode_bits(value, table):
+    return [(name, text) for bit, name, text in table if value & (1 << bit)]
+
+
+def report(rec, syms):
+    exc = rec.get("exc", 0)
+    print("%s (exception %d) at tick %d ms" % (EXCEPTIONS.get(exc, "?"), exc, rec.get("tick", 0)))
+    for mask, text in FLAGS:
+        if rec.get("flags", 0) & mask:
+            print("  note: " + text)
+
+    print("\nCFSR %08x  HFSR %08x" % (rec["cfsr"], rec["hfsr"]))
+    for name, text in decode_bits(rec["hfsr"], HFSR_BITS) + decode_bits(rec["cfsr"], CFSR_BITS):
+        print("  %-12s %s" % (name, text))
+    if rec["cfsr"] & (1 << 7):
+        print("  MMFAR        %08x" % rec["mmfar"])
+    if rec["cfsr"] & (1 << 15):
+        print("  BFAR         %08x" % rec["bfar"])
+
+    # LR in the frame has the Thumb bit set; the call is the instruction before
+    pc, lr = rec["pc"], rec["lr"]
+    lines = syms.lines([pc, (lr & ~1) - 2] if lr & 1 else [pc])
+    print("\nPC  %08x  %s" % (pc, lines.get(pc, "?")))
+    if lr & 1:
+        print("LR  %08x  %s" % (lr, lines.get((lr & ~1) - 2, "?")))
+    else:
+        print("LR  %08x  (not a code address)" % lr)
+    print("SP  %08x  xPSR %08x  EXC_RETURN %08x" % (rec["sp"], rec["xpsr"], rec["exc_return"]))
+    print("r0 %08x r1 %08x r2 %08x r3 %08x r12 %08x"
+          % (rec["r0"], rec["r1"], rec["r2"], rec["r3"], rec["r12"]))
+
+    candidates = [(a, w) for a, w in rec["mem"] if w & 1 and syms.function(w)]
+    if candidates:
+        lines = syms.lines([(w & ~1) - 2 for _, w in candidates])
+        print("\nReturn address candidates on the stack (innermost first):")
+        for addr, word in candidates:
+            print("  [%08x] %08x  %-28s %s" % (addr, word, syms.function(word),
+                                               lines.get((word & ~1) - 2, "")))
+    print("\n%d stack words captured from %08x" % (len(rec["mem"]), rec["sp"]))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("elf")
+    ap.add_argument("log", nargs="?", help="console capture (default: stdin)")
+    ap.add_argument("--all", action="store_true", help="decode every record in the log")
+    ap.add_argument("--nm", default="arm-none-eabi-nm")
+    ap.add_argument("--addr2line", default="arm-none-eabi-addr2line")
+    args = ap.parse_args()
+
+    if args.log:
+        with open(args.log, errors="replace") as f:
+            records = parse(f)
+    else:
+        records = parse(sys.stdin)
+    if not records:
+        sys.exit("no complete CRASH record in the log")
+
+    syms = Symbols(args.elf, args.nm, args.addr2line)
+    for i, rec in enumerate(records if args.all else records[-1:]):
+        if i:
+            print("\n" + "-" * 72 + "\n")
+        report(rec, syms)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,150 @@
+#!/usr/bin/env python3
+"""Worst-case stack per IRQ handler and per task from -fstack-usage output.
+
+Build step (CubeIDE: C/C++ Build > Settings > MCU GCC Compiler > Miscellaneous,
+then Post-build steps):
+
+    arm-none-eabi-gcc ... -fstack-usage          # one .su file per object
+    python3 tools/stack_report.py Debug/CAN_Normal_Mode.elf Debug
+
+The call graph comes from the disassembly of the linked image (`bl` and
+tail-call `b.w` to a symbol), the frame sizes from the .su files.  Roots are
+`main` and every *_Handler / *_IRQHandler not called by other code.  Functions without a .su entry
+(libc, libgcc, assembly) and indirect calls are listed, since the worst case
+is only a lower bound where they appear; recursion is reported and cut.
+
+Each exception adds its hardware frame: 32 bytes, or 104 bytes when the
+FPU context is stacked.  The "nested" line is the upper bound for main plus
+every handler preempting each other, to be compared with _Min_Stack_Size
+and the runtime high-water mark from stack_mon.c.
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+EXC_FRAME_FPU = 104
+
+FUNC_RE = re.compile(r"^[0-9a-f]+ <([^>]+)>:$")
+CALL_RE = re.compile(r"\s(bl|b\.w|b)\s+[0-9a-f]+ <([^>+]+)>$")
+INDIRECT_RE = re.compile(r"\s(blx)\s+r\d+")
+
+
+def read_su(root):
+    """file.c:line:col:func<TAB>bytes<TAB>qualifier -> {func: (bytes, qual)}"""
+    frames = {}
+    for dirpath, _, files in os.walk(root):
+        for name in files:
+            if not name.endswith(".su"):
+                continue
+            with open(os.path.join(dirpath, name)) as f:
+                for line in f:
+                    parts = line.rstrip("\n").split("\t")
+                    if len(parts) != 3:
+                        continue
+                    func = parts[0].rsplit(":", 1)[-1]
+                    size = int(parts[1])
+                    # Same static name in several files: keep the largest
+                    if func not in frames or frames[func][0] < size:
+                        frames[func] = (size, parts[2])
+    return frames
+
+
+def read_calls(elf, objdump):
+    out = subprocess.run([objdump, "-d", "--no-show-raw-insn", elf],
+                         check=True, capture_output=True, text=True).stdout
+    calls, indirect, current = {}, set(), None
+    for line in out.splitlines():
+        m = FUNC_RE.match(line)
+        if m:
+            current = m.group(1)
+            calls.setdefault(current, set())
+            continue
+        if current is None:
+            continue
+        m = CALL_RE.search(line)
+        if m and m.group(2) != current:
+            calls[current].add(m.group(2))
+        elif INDIRECT_RE.search(line):
+            indirect.add(current)
+    return calls, indirect
+
+
+class Analyzer:
+    def __init__(self, frames, calls, indirect):
+        self.frames, self.calls, self.indirect = frames, calls, indirect
+        self.memo, self.unknown, self.recursive, self.dynamic = {}, set(), set(), set()
+
+    def worst(self, func, stack=()):
+        if func in self.memo:
+            return self.memo[func]
+        if func in stack:
+            self.recursive.add(func)
+            return 0, [func + " (recursion)"]
+
+        size, qual = self.frames.get(func, (0, None))
+        if qual is None:
+            self.unknown.add(func)
+        elif qual != "static":
+            self.dynamic.add(func)
+
+        best, path = 0, []
+        for callee in sorted(self.calls.get(func, ())):
+            s, p = self.worst(callee, stack + (func,))
+            if s > best:
+                best, path = s, p
+
+        result = (size + best, [func] + path)
+        self.memo[func] = result
+        return result
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("elf")
+    ap.add_argument("su_dir", help="directory searched recursively for .su files")
+    ap.add_argument("--objdump", default="arm-none-eabi-objdump")
+    ap.add_argument("--paths", action="store_true", help="print the worst call chain")
+    args = ap.parse_args()
+
+    frames = read_su(args.su_dir)
+    if not frames:
+        sys.exit("no .su files under %s (build with -fstack-usage)" % args.su_dir)
+    calls, indirect = read_calls(args.elf, args.objdump)
+    an = Analyzer(frames, calls, indirect)
+
+    # Handlers called from another handler (shared dispatch) are not roots
+    called = set().union(*calls.values())
+    roots = sorted(f for f in calls
+                   if (f.endswith("_Handler") or f.endswith("_IRQHandler")) and f not in called)
+    total = 0
+
+    print("%-32s %8s" % ("root", "bytes"))
+    for root in ["main"] + roots:
+        if root not in calls:
+            continue
+        size, path = an.worst(root)
+        if root != "main":
+            size += EXC_FRAME_FPU
+        total += size
+        flags = " *" if any(f in indirect for f in path) else ""
+        print("%-32s %8d%s" % (root, size, flags))
+        if args.paths:
+            print("    " + " -> ".join(path))
+
+    print("%-32s %8d" % ("nested (upper bound)", total))
+    if indirect:
+        print("\n* chain contains indirect calls (function pointers), not followed")
+    if an.dynamic:
+        print("dynamic/bounded frames: " + ", ".join(sorted(an.dynamic)))
+    if an.recursive:
+        print("recursion cut at: " + ", ".join(sorted(an.recursive)))
+    if an.unknown:
+        print("no .su entry (counted as 0): %d functions, e.g. %s"
+              % (len(an.unknown), ", ".join(sorted(an.unknown)[:8])))
+
+
+if __name__ == "__main__":
+    main()
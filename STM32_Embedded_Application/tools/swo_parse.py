@@ -0,0 +1,225 @@
+#!/usr/bin/env python3
+"""Split a captured SWO byte stream into log text, events and a PC profile.
+
+The firmware built with -DLOG_BACKEND_ITM (log_itm.c) sends, as ITM
+packets on the SWO pin:
+
+    port 0      log text (printf, Log_Write)
+    port 1      Log_Event(): a 1-byte id packet, then a 4-byte value packet
+    DWT         PC samples (shell "pcsample <cycles>"), exception trace
+    timestamps  local timestamps in CPU cycles, sync and overflow packets
+
+The input is the raw stream as the probe delivers it with the TPIU
+formatter off, for example:
+
+    openocd ... -c "tpiu config internal swo.bin uart off 50000000 2000000"
+    pyocd swv ... or JLinkSWOViewerCL -itmport 0xFFFFFFFF -outputfile swo.bin
+
+Usage:
+    swo_parse.py swo.bin                      # text, then a summary
+    swo_parse.py swo.bin --events --cpu-hz 50000000
+    swo_parse.py swo.bin --pc --elf Debug/CAN_Normal_Mode.elf
+
+A capture may start in the middle of a packet: bytes are skipped until the
+first sync packet unless --no-sync is given.
+"""
+
+import argparse
+import bisect
+import collections
+import subprocess
+import sys
+
+SIZES = {1: 1, 2: 2, 3: 4}
+EXCEPTION_FN = {1: "enter", 2: "exit", 3: "return"}
+
+
+def packets(data, need_sync=True):
+    """Yield (kind, fields) for each packet: "sw" (port, value, size),
+    "hw" (id, value, size), "ts" (delta), "sync", "overflow"."""
+    i, n = 0, len(data)
+    if need_sync:
+        i = find_sync(data, 0)
+        if i is None:
+            return
+    while i < n:
+        b = data[i]
+        if b == 0x00:
+            # Sync: at least 47 zero bits then a one; a lone zero is padding
+            j = i
+            while j < n and data[j] == 0x00:
+                j += 1
+            if j < n and data[j] == 0x80 and j - i >= 5:
+                yield "sync", ()
+                i = j + 1
+            else:
+                i = j
+            continue
+        if b == 0x70:
+            yield "overflow", ()
+            i += 1
+            continue
+        ss = b & 0x03
+        if ss:
+            size = SIZES[ss]
+            if i + 1 + size > n:
+                return
+            value = int.from_bytes(data[i + 1:i + 1 + size], "little")
+            address = b >> 3
+            yield ("hw" if b & 0x04 else "sw"), (address, value, size)
+            i += 1 + size
+            continue
+        if (b & 0x0F) == 0x00:
+            if (b & 0xC0) == 0xC0:
+                # Local timestamp format 1: 7-bit groups with continuation
+                delta, shift, i = 0, 0, i + 1
+                while i < n:
+                    delta |= (data[i] & 0x7F) << shift
+                    shift += 7
+                    i += 1
+                    if not data[i - 1] & 0x80:
+                        break
+                yield "ts", (delta,)
+            elif not b & 0x80:
+                # Local timestamp format 2: delta in the header
+                yield "ts", ((b >> 4) & 0x07,)
+                i += 1
+            else:
+                i += 1
+            continue
+        # Extension and global timestamp packets: header plus continuations
+        i += 1
+        if b & 0x80:
+            while i < n and data[i] & 0x80:
+                i += 1
+            i += 1
+
+
+def find_sync(data, start):
+    zeros = 0
+    for i in range(start, len(data)):
+        if data[i] == 0x00:
+            zeros += 1
+        elif data[i] == 0x80 and zeros >= 5:
+            return i - zeros
+        else:
+            zeros = 0
+    return None
+
+
+class Symbols:
+    """Function ranges from nm (same approach as crash_decode.py)."""
+
+    def __init__(self, elf, nm):
+        out = subprocess.run([nm, "-S", "-n", "-C", elf], check=True,
+                             capture_output=True, text=True).stdout
+        self.funcs = []
+        for line in out.splitlines():
+            parts = line.split(None, 3)
+            if len(parts) == 4 and parts[2] in ("T", "t", "W", "w"):
+                start, size = int(parts[0], 16), int(parts[1], 16)
+                if size:
+                    self.funcs.append((start & ~1, size, parts[3]))
+        self.starts = [f[0] for f in self.funcs]
+
+    def function(self, addr):
+        i = bisect.bisect_right(self.starts, addr & ~1) - 1
+        if i >= 0:
+            start, size, name = self.funcs[i]
+            if addr < start + size:
+                return name
+        return "0x%08x" % addr
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("capture", help="raw SWO bytes, '-' for stdin")
+    ap.add_argument("--events", action="store_true", help="list every port 1 event")
+    ap.add_argument("--pc", action="store_true", help="print the PC sample profile")
+    ap.add_argument("--elf", help="map PC samples to functions")
+    ap.add_argument("--nm", default="arm-none-eabi-nm")
+    ap.add_argument("--cpu-hz", type=float, help="show timestamps in seconds")
+    ap.add_argument("--top", type=int, default=25, help="profile rows (default 25)")
+    ap.add_argument("--no-sync", action="store_true", help="parse from the first byte")
+    ap.add_argument("--quiet", action="store_true", help="do not print the log text")
+    args = ap.parse_args()
+
+    if args.capture == "-":
+        data = sys.stdin.buffer.read()
+    else:
+        with open(args.capture, "rb") as f:
+            data = f.read()
+
+    def stamp(t):
+        return "%12.6f" % (t / args.cpu_hz) if args.cpu_hz else "%12d" % t
+
+    now = 0
+    text = bytearray()
+    pending_id = None
+    events = []
+    pcs = collections.Counter()
+    sleeps = 0
+    counts = collections.Counter()
+    exceptions = collections.Counter()
+
+    for kind, fields in packets(data, not args.no_sync):
+        counts[kind] += 1
+        if kind == "ts":
+            now += fields[0]
+        elif kind == "sw":
+            port, value, size = fields
+            if port == 0:
+                text += value.to_bytes(size, "little")
+            elif port == 1:
+                if size == 1:
+                    pending_id = value
+                elif size == 4 and pending_id is not None:
+                    events.append((now, pending_id, value))
+                    pending_id = None
+        elif kind == "hw":
+            hw_id, value, size = fields
+            if hw_id == 2:
+                if size == 4:
+                    pcs[value] += 1
+                else:
+                    sleeps += 1
+            elif hw_id == 1:
+                exceptions[(value & 0x1FF, EXCEPTION_FN.get((value >> 12) & 0x3, "?"))] += 1
+
+    if not args.quiet and text:
+        sys.stdout.write(text.decode("utf-8", errors="replace").replace("\r\n", "\n"))
+        if not text.endswith(b"\n"):
+            sys.stdout.write("\n")
+
+    if args.events:
+        print("\n%12s  %4s  %s" % ("time" if args.cpu_hz else "cycles", "id", "value"))
+        for t, ev_id, value in events:
+            print("%s  %4d  0x%08x (%d)" % (stamp(t), ev_id, value, value))
+
+    if args.pc and (pcs or sleeps):
+        total = sum(pcs.values()) + sleeps
+        if args.elf:
+            syms = Symbols(args.elf, args.nm)
+            profile = collections.Counter()
+            for pc, hits in pcs.items():
+                profile[syms.function(pc)] += hits
+        else:
+            profile = collections.Counter({"0x%08x" % pc: hits for pc, hits in pcs.items()})
+        if sleeps:
+            profile["(sleeping)"] = sleeps
+        print("\n%d PC samples" % total)
+        for name, hits in profile.most_common(args.top):
+            print("  %6.2f%%  %7d  %s" % (100.0 * hits / total, hits, name))
+
+    print("\n%d bytes: %d text, %d events, %d PC samples, %d exception packets, "
+          "%d overflows, %d syncs, span %s" %
+          (len(data), len(text), len(events), sum(pcs.values()) + sleeps,
+           sum(exceptions.values()), counts["overflow"], counts["sync"], stamp(now).strip()),
+          file=sys.stderr)
+    if counts["overflow"]:
+        print("ITM overflowed: lower the PC sample rate or raise the SWO clock",
+              file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,193 @@
+#!/usr/bin/env python3
+"""Convert a Trace_Dump() console capture to Chrome trace / Perfetto JSON.
+
+Firmware built with TRACE_RECORDER (trace.h) prints its event ring on the
+console, on the "trace" command and, on RTC_Time_Date, before STANDBY:
+
+    TRACE begin hz=50000000 count=812 lost=0 cost=14
+    TRACE task 1 frame
+    TRACE 0012A4F0 01240000         cycles, type << 24 | id << 16 | arg
+    ...
+    TRACE end
+
+Any other console text around the dump is ignored, so a plain terminal log
+works.  The output opens in https://ui.perfetto.dev or chrome://tracing:
+
+    interrupts  one slice per handler run, named from the exception number
+    tasks       one slice per traced task run
+    power       SLEEP / STOP / STANDBY as slices; CYCCNT stops in STOP, so
+                a STOP slice only covers the clock restore after the wake-up
+
+Usage:
+    trace2perfetto.py console.log -o trace.json         # last complete dump
+    trace2perfetto.py console.log --all -o trace.json   # every dump, in turn
+"""
+
+import argparse
+import json
+import re
+import sys
+
+EV_ISR_ENTER, EV_ISR_EXIT, EV_TASK_BEGIN, EV_TASK_END, EV_POWER, EV_MARK = range(1, 7)
+POWER_STATES = {0: "RUN", 1: "SLEEP", 2: "STOP", 3: "STANDBY"}
+
+# STM32F446 exception numbers (IRQn + 16) of the handlers these projects use
+EXCEPTIONS = {
+    2: "NMI", 3: "HardFault", 4: "MemManage", 5: "BusFault", 6: "UsageFault",
+    11: "SVCall", 14: "PendSV", 15: "SysTick",
+    32: "DMA1_Stream5", 33: "DMA1_Stream6", 35: "CAN1_TX", 36: "CAN1_RX0",
+    37: "CAN1_RX1", 38: "CAN1_SCE", 44: "TIM2", 54: "USART2", 56: "EXTI15_10",
+    57: "RTC_Alarm", 70: "TIM6_DAC", 71: "TIM7",
+}
+
+PID = 1
+TID_ISR, TID_TASK, TID_POWER = 1, 2, 3
+
+LINE = re.compile(r"TRACE (begin .*|task .*|end|[0-9A-Fa-f]{8} [0-9A-Fa-f]{8})\s*$")
+
+
+def dumps(lines):
+    """Yield one dict per complete dump: hz, lost, cost, tasks, records."""
+    dump = None
+    for line in lines:
+        m = LINE.search(line)
+        if m is None:
+            continue
+        body = m.group(1)
+        if body.startswith("begin"):
+            fields = dict(f.split("=", 1) for f in body.split()[1:])
+            dump = {"hz": int(fields["hz"]), "lost": int(fields.get("lost", 0)),
+                    "cost": int(fields.get("cost", 0)), "tasks": {}, "records": []}
+        elif dump is None:
+            continue
+        elif body.startswith("task"):
+            _, task_id, name = body.split(None, 2)
+            dump["tasks"][int(task_id)] = name
+        elif body == "end":
+            yield dump
+            dump = None
+        else:
+            cycles, info = body.split()
+            dump["records"].append((int(cycles, 16), int(info, 16)))
+
+
+class Track:
+    """Begin/end slices on one thread, tolerant of a ring that starts or
+    stops in the middle of a slice."""
+
+    def __init__(self, tid, events):
+        self.tid = tid
+        self.events = events
+        self.open = []
+
+    def begin(self, ts, name):
+        self.open.append(name)
+        self.events.append({"ph": "B", "pid": PID, "tid": self.tid, "ts": ts, "name": name})
+
+    def end(self, ts, name):
+        # The matching begin was overwritten in the ring: drop the end
+        if name not in self.open:
+            return
+        while self.open:
+            top = self.open.pop()
+            self.events.append({"ph": "E", "pid": PID, "tid": self.tid, "ts": ts, "name": top})
+            if top == name:
+                break
+
+    def close(self, ts):
+        while self.open:
+            self.end(ts, self.open[-1])
+
+
+def convert(dump, offset_us, events):
+    """Append the events of @dump, shifted by @offset_us; return its end."""
+    hz = float(dump["hz"])
+    isr = Track(TID_ISR, events)
+    task = Track(TID_TASK, events)
+    power = None
+    ts = offset_us
+    base = None
+    wraps = 0
+    last = 0
+
+    for cycles, info in dump["records"]:
+        # CYCCNT is 32 bits: about 86 s at 50 MHz
+        if base is None:
+            base = cycles
+        elif cycles < last:
+            wraps += 1
+        last = cycles
+        ts = offset_us + ((wraps << 32) + cycles - base) * 1e6 / hz
+
+        kind, ev_id, arg = info >> 24, (info >> 16) & 0xFF, info & 0xFFFF
+        if kind == EV_ISR_ENTER:
+            isr.begin(ts, EXCEPTIONS.get(ev_id, "IRQ %d" % (ev_id - 16)))
+        elif kind == EV_ISR_EXIT:
+            isr.end(ts, EXCEPTIONS.get(ev_id, "IRQ %d" % (ev_id - 16)))
+        elif kind == EV_TASK_BEGIN:
+            task.begin(ts, dump["tasks"].get(ev_id, "task %d" % ev_id))
+        elif kind == EV_TASK_END:
+            task.end(ts, dump["tasks"].get(ev_id, "task %d" % ev_id))
+        elif kind == EV_POWER:
+            if power is not None and power[1] != 0:
+                events.append({"ph": "X", "pid": PID, "tid": TID_POWER, "ts": power[0],
+                               "dur": ts - power[0],
+                               "name": POWER_STATES.get(power[1], "state %d" % power[1])})
+            power = (ts, ev_id)
+        elif kind == EV_MARK:
+            events.append({"ph": "i", "s": "t", "pid": PID, "tid": TID_TASK, "ts": ts,
+                           "name": "mark %d" % ev_id, "args": {"arg": arg}})
+
+    isr.close(ts)
+    task.close(ts)
+    if power is not None and power[1] != 0:
+        # STANDBY (or a dump taken asleep): mark the entry point
+        events.append({"ph": "i", "s": "p", "pid": PID, "tid": TID_POWER, "ts": power[0],
+                       "name": POWER_STATES.get(power[1], "state %d" % power[1])})
+    return ts
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("log", help="console capture, '-' for stdin")
+    ap.add_argument("-o", "--output", help="JSON file (default stdout)")
+    ap.add_argument("--all", action="store_true",
+                    help="every dump one after the other, not only the last")
+    ap.add_argument("--gap-us", type=float, default=1000.0,
+                    help="space between dumps with --all (default 1000 us)")
+    args = ap.parse_args()
+
+    if args.log == "-":
+        lines = sys.stdin.read().splitlines()
+    else:
+        with open(args.log, errors="replace") as f:
+            lines = f.read().splitlines()
+
+    found = list(dumps(lines))
+    if not found:
+        sys.exit("no complete TRACE begin ... TRACE end block in %s" % args.log)
+    if not args.all:
+        found = found[-1:]
+
+    events = [
+        {"ph": "M", "pid": PID, "name": "process_name", "args": {"name": "STM32F446"}},
+        {"ph": "M", "pid": PID, "tid": TID_ISR, "name": "thread_name", "args": {"name": "interrupts"}},
+        {"ph": "M", "pid": PID, "tid": TID_TASK, "name": "thread_name", "args": {"name": "tasks"}},
+        {"ph": "M", "pid": PID, "tid": TID_POWER, "name": "thread_name", "args": {"name": "power"}},
+    ]
+    offset = 0.0
+    for dump in found:
+        offset = convert(dump, offset, events) + args.gap_us
+        print("%d events at %d Hz, %d lost, %d cycles per event" %
+              (len(dump["records"]), dump["hz"], dump["lost"], dump["cost"]), file=sys.stderr)
+
+    text = json.dumps({"traceEvents": events, "displayTimeUnit": "ns"})
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(text)
+    else:
+        print(text)
+
+
+if __name__ == "__main__":
+    main()
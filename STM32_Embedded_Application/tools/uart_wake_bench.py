@@ -0,0 +1,83 @@
+#!/usr/bin/env python3
+"""Highest baud rate at which a node in STOP keeps the first frame.
+
+Current_Meg_Stop_Mode built with UART_WAKE sleeps in STOP and wakes on the
+first start bit on USART2 RX.  Every command is sent as the wake character
+0xFF followed by one line.  The node answers PING with
+
+    PONG <wakes> <ready_cycles> <max_ready_cycles>
+
+and stays silent if the line was lost, i.e. if wake-up took longer than the
+nine idle bits of the wake character.  For each rate the node is switched
+with BAUD <rate> (sent at the current rate), then pinged --count times.
+
+    python3 tools/uart_wake_bench.py /dev/ttyACM0
+"""
+
+import argparse
+import sys
+import time
+
+import serial
+
+WAKE = b"\xff"
+DEFAULT_RATES = [9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600,
+                 1000000, 1500000, 2000000]
+
+
+def command(port, line, timeout):
+    port.reset_input_buffer()
+    port.write(WAKE + line.encode() + b"\n")
+    port.flush()
+    port.timeout = timeout
+    return port.readline().decode(errors="replace").strip()
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("port")
+    ap.add_argument("--start", type=int, default=115200, help="rate the node boots with")
+    ap.add_argument("--count", type=int, default=50, help="pings per rate")
+    ap.add_argument("--gap", type=float, default=0.05, help="seconds between wake-ups")
+    ap.add_argument("--rates", type=lambda s: [int(r) for r in s.split(",")],
+                    default=DEFAULT_RATES)
+    args = ap.parse_args()
+
+    port = serial.Serial(args.port, args.start)
+    current = args.start
+    best = None
+
+    print("%9s %6s %10s %10s" % ("baud", "ok", "ready cyc", "max cyc"))
+    for rate in args.rates:
+        # Switch the node; retry since this command can itself be lost
+        for _ in range(5):
+            if command(port, "BAUD %d" % rate, 0.5) == "OK":
+                break
+            time.sleep(args.gap)
+        else:
+            sys.exit("node did not accept BAUD %d at %d" % (rate, current))
+        time.sleep(0.01)
+        port.baudrate = rate
+        current = rate
+
+        ok = 0
+        fields = None
+        for _ in range(args.count):
+            time.sleep(args.gap)
+            rsp = command(port, "PING", 0.2).split()
+            if len(rsp) == 4 and rsp[0] == "PONG":
+                ok += 1
+                fields = rsp
+        print("%9d %3d/%-3d %10s %10s" % (rate, ok, args.count,
+                                           fields[2] if fields else "-",
+                                           fields[3] if fields else "-"))
+        if ok == args.count:
+            best = rate
+        else:
+            break
+
+    print("highest loss-free rate: %s" % (best if best else "none"))
+
+
+if __name__ == "__main__":
+    main()